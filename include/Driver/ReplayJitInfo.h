@@ -0,0 +1,387 @@
+//===---------------- include/Driver/ReplayJitInfo.h ------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares an ICorJitInfo that answers the jit's queries from a
+/// recorded collection instead of from a running CoreCLR.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef REPLAY_JIT_INFO_H
+#define REPLAY_JIT_INFO_H
+
+#include "JitRecord.h"
+#include "llvm/Support/Allocator.h"
+
+/// \brief Exception thrown to abandon the replay of a method.
+class ReplayException {
+public:
+  enum ReplayExceptionKind {
+    MissingQuery, ///< The jit asked something the collection can't answer.
+    EEException   ///< The EE would have raised an exception here.
+  };
+
+  ReplayException(ReplayExceptionKind Kind, JitApi Api)
+      : Kind(Kind), Api(Api) {}
+
+  ReplayExceptionKind Kind;
+  JitApi Api;
+};
+
+/// \brief An ICorJitInfo where every method reports that it was not
+/// recorded. ReplayJitInfo overrides the methods the jit actually uses.
+class UnrecordedJitInfo : public ICorJitInfo {
+public:
+#define JITINTERFACE_METHOD(Ret, Name, Params, Args)                          \
+  Ret __stdcall Name Params override {                                         \
+    return notRecorded<Ret>(JitApi::Name);                                     \
+  }
+#include "JitInterface.def"
+
+protected:
+  template <typename T> static T notRecorded(JitApi Api) {
+    throw ReplayException(ReplayException::MissingQuery, Api);
+  }
+};
+
+/// \brief The ICorJitInfo handed to the jit while replaying one method.
+///
+/// Queries are answered from the method's recorded values. Calls that hand
+/// results to the EE (code, GC info, unwind and debug info) are accepted,
+/// and the code, GC info and relocations are kept so they can be digested
+/// for comparison with other runs.
+class ReplayJitInfo : public UnrecordedJitInfo {
+public:
+  ReplayJitInfo(const CollectionReader &Collection,
+                const CollectionMethod &Method)
+      : Collection(Collection), Method(Method) {}
+
+  /// \brief Get the size of the hot code the jit produced.
+  size_t getHotCodeSize() const { return Digest.getHotCodeSize(); }
+
+  /// \brief Compute a digest of the code, read-only data and GC info the
+  /// jit produced. Equal digests mean equal compiler output.
+  uint64_t getCodeHash() const { return Digest.compute(); }
+
+  /// \brief Get the number of bytes allocated on behalf of the jit.
+  size_t getBytesAllocated() const { return Allocator.getBytesAllocated(); }
+
+  /// \name ICorMethodInfo
+  //@{
+  DWORD __stdcall getMethodAttribs(CORINFO_METHOD_HANDLE ftn) override;
+  void __stdcall setMethodAttribs(CORINFO_METHOD_HANDLE ftn,
+                                  CorInfoMethodRuntimeFlags attribs) override;
+  void __stdcall getMethodSig(CORINFO_METHOD_HANDLE ftn, CORINFO_SIG_INFO *sig,
+                              CORINFO_CLASS_HANDLE memberParent) override;
+  bool __stdcall getMethodInfo(CORINFO_METHOD_HANDLE ftn,
+                               CORINFO_METHOD_INFO *info) override;
+  CorInfoInline __stdcall canInline(CORINFO_METHOD_HANDLE callerHnd,
+                                    CORINFO_METHOD_HANDLE calleeHnd,
+                                    DWORD *pRestrictions) override;
+  void __stdcall reportInliningDecision(CORINFO_METHOD_HANDLE inlinerHnd,
+                                        CORINFO_METHOD_HANDLE inlineeHnd,
+                                        CorInfoInline inlineResult,
+                                        const char *reason) override;
+  bool __stdcall canTailCall(CORINFO_METHOD_HANDLE callerHnd,
+                             CORINFO_METHOD_HANDLE declaredCalleeHnd,
+                             CORINFO_METHOD_HANDLE exactCalleeHnd,
+                             bool fIsTailPrefix) override;
+  void __stdcall reportTailCallDecision(CORINFO_METHOD_HANDLE callerHnd,
+                                        CORINFO_METHOD_HANDLE calleeHnd,
+                                        bool fIsTailPrefix,
+                                        CorInfoTailCall tailCallResult,
+                                        const char *reason) override;
+  void __stdcall getEHinfo(CORINFO_METHOD_HANDLE ftn, unsigned EHnumber,
+                           CORINFO_EH_CLAUSE *clause) override;
+  CORINFO_CLASS_HANDLE __stdcall getMethodClass(
+      CORINFO_METHOD_HANDLE method) override;
+  void __stdcall getMethodVTableOffset(
+      CORINFO_METHOD_HANDLE method, unsigned *offsetOfIndirection,
+      unsigned *offsetAfterIndirection) override;
+  CorInfoIntrinsics __stdcall getIntrinsicID(
+      CORINFO_METHOD_HANDLE method) override;
+  bool __stdcall isInSIMDModule(CORINFO_CLASS_HANDLE classHnd) override;
+  BOOL __stdcall pInvokeMarshalingRequired(
+      CORINFO_METHOD_HANDLE method, CORINFO_SIG_INFO *callSiteSig) override;
+  BOOL __stdcall isDelegateCreationAllowed(
+      CORINFO_CLASS_HANDLE delegateHnd,
+      CORINFO_METHOD_HANDLE calleeHnd) override;
+  void __stdcall methodMustBeLoadedBeforeCodeIsRun(
+      CORINFO_METHOD_HANDLE method) override;
+  //@}
+
+  /// \name ICorModuleInfo
+  //@{
+  void __stdcall resolveToken(CORINFO_RESOLVED_TOKEN *pResolvedToken) override;
+  void __stdcall findSig(CORINFO_MODULE_HANDLE module, unsigned sigTOK,
+                         CORINFO_CONTEXT_HANDLE context,
+                         CORINFO_SIG_INFO *sig) override;
+  void __stdcall findCallSiteSig(CORINFO_MODULE_HANDLE module,
+                                 unsigned methTOK,
+                                 CORINFO_CONTEXT_HANDLE context,
+                                 CORINFO_SIG_INFO *sig) override;
+  CORINFO_CLASS_HANDLE __stdcall getTokenTypeAsHandle(
+      CORINFO_RESOLVED_TOKEN *pResolvedToken) override;
+  BOOL __stdcall isValidToken(CORINFO_MODULE_HANDLE module,
+                              unsigned metaTOK) override;
+  //@}
+
+  /// \name ICorClassInfo
+  //@{
+  CorInfoType __stdcall asCorInfoType(CORINFO_CLASS_HANDLE cls) override;
+  const char *__stdcall getClassName(CORINFO_CLASS_HANDLE cls) override;
+  int __stdcall appendClassName(WCHAR **ppBuf, int *pnBufLen,
+                                CORINFO_CLASS_HANDLE cls, BOOL fNamespace,
+                                BOOL fFullInst, BOOL fAssembly) override;
+  BOOL __stdcall isValueClass(CORINFO_CLASS_HANDLE cls) override;
+  BOOL __stdcall canInlineTypeCheckWithObjectVTable(
+      CORINFO_CLASS_HANDLE cls) override;
+  DWORD __stdcall getClassAttribs(CORINFO_CLASS_HANDLE cls) override;
+  BOOL __stdcall isStructRequiringStackAllocRetBuf(
+      CORINFO_CLASS_HANDLE cls) override;
+  size_t __stdcall getClassModuleIdForStatics(CORINFO_CLASS_HANDLE cls,
+                                              CORINFO_MODULE_HANDLE *pModule,
+                                              void **ppIndirection) override;
+  unsigned __stdcall getClassSize(CORINFO_CLASS_HANDLE cls) override;
+  unsigned __stdcall getClassAlignmentRequirement(
+      CORINFO_CLASS_HANDLE cls, BOOL fDoubleAlignHint) override;
+  unsigned __stdcall getClassGClayout(CORINFO_CLASS_HANDLE cls,
+                                      BYTE *gcPtrs) override;
+  unsigned __stdcall getClassNumInstanceFields(
+      CORINFO_CLASS_HANDLE cls) override;
+  CORINFO_FIELD_HANDLE __stdcall getFieldInClass(CORINFO_CLASS_HANDLE clsHnd,
+                                                 INT num) override;
+  BOOL __stdcall checkMethodModifier(CORINFO_METHOD_HANDLE hMethod,
+                                     LPCSTR modifier, BOOL fOptional) override;
+  CorInfoHelpFunc __stdcall getNewHelper(
+      CORINFO_RESOLVED_TOKEN *pResolvedToken,
+      CORINFO_METHOD_HANDLE callerHandle) override;
+  CorInfoHelpFunc __stdcall getNewArrHelper(
+      CORINFO_CLASS_HANDLE arrayCls) override;
+  CorInfoHelpFunc __stdcall getCastingHelper(
+      CORINFO_RESOLVED_TOKEN *pResolvedToken, bool fThrowing) override;
+  CorInfoHelpFunc __stdcall getSharedCCtorHelper(
+      CORINFO_CLASS_HANDLE clsHnd) override;
+  CorInfoHelpFunc __stdcall getSecurityPrologHelper(
+      CORINFO_METHOD_HANDLE ftn) override;
+  CORINFO_CLASS_HANDLE __stdcall getTypeForBox(
+      CORINFO_CLASS_HANDLE cls) override;
+  CorInfoHelpFunc __stdcall getBoxHelper(CORINFO_CLASS_HANDLE cls) override;
+  CorInfoHelpFunc __stdcall getUnBoxHelper(CORINFO_CLASS_HANDLE cls) override;
+  void __stdcall getReadyToRunHelper(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                                     CorInfoHelpFunc id,
+                                     CORINFO_CONST_LOOKUP *pLookup) override;
+  const char *__stdcall getHelperName(CorInfoHelpFunc helpFunc) override;
+  CorInfoInitClassResult __stdcall initClass(CORINFO_FIELD_HANDLE field,
+                                             CORINFO_METHOD_HANDLE method,
+                                             CORINFO_CONTEXT_HANDLE context,
+                                             BOOL speculative) override;
+  void __stdcall classMustBeLoadedBeforeCodeIsRun(
+      CORINFO_CLASS_HANDLE cls) override;
+  CORINFO_CLASS_HANDLE __stdcall getBuiltinClass(
+      CorInfoClassId classId) override;
+  CORINFO_CLASS_HANDLE __stdcall mergeClasses(
+      CORINFO_CLASS_HANDLE cls1, CORINFO_CLASS_HANDLE cls2) override;
+  CORINFO_CLASS_HANDLE __stdcall getParentType(
+      CORINFO_CLASS_HANDLE cls) override;
+  CorInfoType __stdcall getChildType(CORINFO_CLASS_HANDLE clsHnd,
+                                     CORINFO_CLASS_HANDLE *clsRet) override;
+  BOOL __stdcall isSDArray(CORINFO_CLASS_HANDLE cls) override;
+  unsigned __stdcall getArrayRank(CORINFO_CLASS_HANDLE cls) override;
+  CorInfoIsAccessAllowedResult __stdcall canAccessClass(
+      CORINFO_RESOLVED_TOKEN *pResolvedToken,
+      CORINFO_METHOD_HANDLE callerHandle,
+      CORINFO_HELPER_DESC *pAccessHelper) override;
+  //@}
+
+  /// \name ICorFieldInfo
+  //@{
+  const char *__stdcall getFieldName(CORINFO_FIELD_HANDLE ftn,
+                                     const char **moduleName) override;
+  CORINFO_CLASS_HANDLE __stdcall getFieldClass(
+      CORINFO_FIELD_HANDLE field) override;
+  CorInfoType __stdcall getFieldType(
+      CORINFO_FIELD_HANDLE field, CORINFO_CLASS_HANDLE *structType,
+      CORINFO_CLASS_HANDLE memberParent) override;
+  unsigned __stdcall getFieldOffset(CORINFO_FIELD_HANDLE field) override;
+  bool __stdcall isWriteBarrierHelperRequired(
+      CORINFO_FIELD_HANDLE field) override;
+  void __stdcall getFieldInfo(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                              CORINFO_METHOD_HANDLE callerHandle,
+                              CORINFO_ACCESS_FLAGS flags,
+                              CORINFO_FIELD_INFO *pResult) override;
+  //@}
+
+  /// \name ICorDebugInfo
+  //@{
+  void __stdcall getBoundaries(
+      CORINFO_METHOD_HANDLE ftn, unsigned int *cILOffsets, DWORD **pILOffsets,
+      ICorDebugInfo::BoundaryTypes *implictBoundaries) override;
+  void __stdcall setBoundaries(CORINFO_METHOD_HANDLE ftn, ULONG32 cMap,
+                               ICorDebugInfo::OffsetMapping *pMap) override;
+  void __stdcall setVars(CORINFO_METHOD_HANDLE ftn, ULONG32 cVars,
+                         ICorDebugInfo::NativeVarInfo *vars) override;
+  void *__stdcall allocateArray(ULONG cBytes) override;
+  void __stdcall freeArray(void *array) override;
+  //@}
+
+  /// \name ICorArgInfo
+  //@{
+  CORINFO_ARG_LIST_HANDLE __stdcall getArgNext(
+      CORINFO_ARG_LIST_HANDLE args) override;
+  CorInfoTypeWithMod __stdcall getArgType(
+      CORINFO_SIG_INFO *sig, CORINFO_ARG_LIST_HANDLE args,
+      CORINFO_CLASS_HANDLE *vcTypeRet) override;
+  CORINFO_CLASS_HANDLE __stdcall getArgClass(
+      CORINFO_SIG_INFO *sig, CORINFO_ARG_LIST_HANDLE args) override;
+  //@}
+
+  /// \name ICorErrorInfo
+  //@{
+  HRESULT __stdcall GetErrorHRESULT(
+      struct _EXCEPTION_POINTERS *pExceptionPointers) override;
+  int __stdcall FilterException(
+      struct _EXCEPTION_POINTERS *pExceptionPointers) override;
+  void __stdcall HandleException(
+      struct _EXCEPTION_POINTERS *pExceptionPointers) override;
+  void __stdcall ThrowExceptionForHelper(
+      const CORINFO_HELPER_DESC *throwHelper) override;
+  //@}
+
+  /// \name ICorStaticInfo
+  //@{
+  void __stdcall getEEInfo(CORINFO_EE_INFO *pEEInfoOut) override;
+  mdMethodDef __stdcall getMethodDefFromMethod(
+      CORINFO_METHOD_HANDLE hMethod) override;
+  const char *__stdcall getMethodName(CORINFO_METHOD_HANDLE ftn,
+                                      const char **moduleName) override;
+  unsigned __stdcall getMethodHash(CORINFO_METHOD_HANDLE ftn) override;
+  size_t __stdcall findNameOfToken(CORINFO_MODULE_HANDLE module,
+                                   mdToken metaTOK, char *szFQName,
+                                   size_t FQNameCapacity) override;
+  bool __stdcall getSystemVAmd64PassStructInRegisterDescriptor(
+      CORINFO_CLASS_HANDLE structHnd,
+      SYSTEMV_AMD64_CORINFO_STRUCT_REG_PASSING_DESCRIPTOR
+          *structPassInRegDescPtr) override;
+  //@}
+
+  /// \name ICorDynamicInfo
+  //@{
+  LONG *__stdcall getAddrOfCaptureThreadGlobal(void **ppIndirection) override;
+  void *__stdcall getHelperFtn(CorInfoHelpFunc ftnNum,
+                               void **ppIndirection) override;
+  void __stdcall getFunctionEntryPoint(
+      CORINFO_METHOD_HANDLE ftn, CORINFO_CONST_LOOKUP *pResult,
+      CORINFO_ACCESS_FLAGS accessFlags) override;
+  void __stdcall getFunctionFixedEntryPoint(
+      CORINFO_METHOD_HANDLE ftn, CORINFO_CONST_LOOKUP *pResult) override;
+  void *__stdcall getMethodSync(CORINFO_METHOD_HANDLE ftn,
+                                void **ppIndirection) override;
+  CORINFO_MODULE_HANDLE __stdcall embedModuleHandle(
+      CORINFO_MODULE_HANDLE handle, void **ppIndirection) override;
+  CORINFO_CLASS_HANDLE __stdcall embedClassHandle(
+      CORINFO_CLASS_HANDLE handle, void **ppIndirection) override;
+  CORINFO_METHOD_HANDLE __stdcall embedMethodHandle(
+      CORINFO_METHOD_HANDLE handle, void **ppIndirection) override;
+  CORINFO_FIELD_HANDLE __stdcall embedFieldHandle(
+      CORINFO_FIELD_HANDLE handle, void **ppIndirection) override;
+  void __stdcall embedGenericHandle(
+      CORINFO_RESOLVED_TOKEN *pResolvedToken, BOOL fEmbedParent,
+      CORINFO_GENERICHANDLE_RESULT *pResult) override;
+  CORINFO_LOOKUP_KIND __stdcall getLocationOfThisType(
+      CORINFO_METHOD_HANDLE context) override;
+  void *__stdcall getPInvokeUnmanagedTarget(CORINFO_METHOD_HANDLE method,
+                                            void **ppIndirection) override;
+  void *__stdcall getAddressOfPInvokeFixup(CORINFO_METHOD_HANDLE method,
+                                           void **ppIndirection) override;
+  LPVOID __stdcall GetCookieForPInvokeCalliSig(CORINFO_SIG_INFO *szMetaSig,
+                                               void **ppIndirection) override;
+  bool __stdcall canGetCookieForPInvokeCalliSig(
+      CORINFO_SIG_INFO *szMetaSig) override;
+  CORINFO_JUST_MY_CODE_HANDLE __stdcall getJustMyCodeHandle(
+      CORINFO_METHOD_HANDLE method,
+      CORINFO_JUST_MY_CODE_HANDLE **ppIndirection) override;
+  void __stdcall getCallInfo(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                             CORINFO_RESOLVED_TOKEN *pConstrainedResolvedToken,
+                             CORINFO_METHOD_HANDLE callerHandle,
+                             CORINFO_CALLINFO_FLAGS flags,
+                             CORINFO_CALL_INFO *pResult) override;
+  unsigned __stdcall getClassDomainID(CORINFO_CLASS_HANDLE cls,
+                                      void **ppIndirection) override;
+  void *__stdcall getFieldAddress(CORINFO_FIELD_HANDLE field,
+                                  void **ppIndirection) override;
+  CORINFO_VARARGS_HANDLE __stdcall getVarArgsHandle(
+      CORINFO_SIG_INFO *pSig, void **ppIndirection) override;
+  bool __stdcall canGetVarArgsHandle(CORINFO_SIG_INFO *pSig) override;
+  InfoAccessType __stdcall constructStringLiteral(CORINFO_MODULE_HANDLE module,
+                                                  mdToken metaTok,
+                                                  void **ppValue) override;
+  InfoAccessType __stdcall emptyStringLiteral(void **ppValue) override;
+  CORINFO_METHOD_HANDLE __stdcall GetDelegateCtor(
+      CORINFO_METHOD_HANDLE methHnd, CORINFO_CLASS_HANDLE clsHnd,
+      CORINFO_METHOD_HANDLE targetMethodHnd,
+      DelegateCtorArgs *pCtorData) override;
+  //@}
+
+  /// \name ICorJitInfo
+  //@{
+  void __stdcall allocMem(ULONG hotCodeSize, ULONG coldCodeSize,
+                          ULONG roDataSize, ULONG xcptnsCount,
+                          CorJitAllocMemFlag flag, void **hotCodeBlock,
+                          void **coldCodeBlock, void **roDataBlock) override;
+  void __stdcall reserveUnwindInfo(BOOL isFunclet, BOOL isColdCode,
+                                   ULONG unwindSize) override;
+  void __stdcall allocUnwindInfo(BYTE *pHotCode, BYTE *pColdCode,
+                                 ULONG startOffset, ULONG endOffset,
+                                 ULONG unwindSize, BYTE *pUnwindBlock,
+                                 CorJitFuncKind funcKind) override;
+  void *__stdcall allocGCInfo(size_t size) override;
+  void __stdcall yieldExecution() override;
+  void __stdcall setEHcount(unsigned cEH) override;
+  void __stdcall setEHinfo(unsigned EHnumber,
+                           const CORINFO_EH_CLAUSE *clause) override;
+  void __stdcall recordCallSite(ULONG instrOffset, CORINFO_SIG_INFO *callSig,
+                                CORINFO_METHOD_HANDLE methodHandle) override;
+  void __stdcall recordRelocation(void *location, void *target,
+                                  WORD fRelocType, WORD slotNum,
+                                  INT32 addlDelta) override;
+  //@}
+
+private:
+  /// \brief Find the recorded value of the query \p Api with the given key
+  /// arguments, or throw a MissingQuery ReplayException.
+  template <typename... KeyTypes>
+  RecordCursor lookup(JitApi Api, KeyTypes... Keys) {
+    RecordBuilder Key;
+    Key.putKeys(Keys...);
+    llvm::StringRef Value;
+    if (!Method.lookup(Api, Key.bytes(), Value)) {
+      throw ReplayException(ReplayException::MissingQuery, Api);
+    }
+    return RecordCursor(Collection, Value);
+  }
+
+  /// \brief Read a pointer result followed by its indirection cell.
+  template <typename T> T getIndirectable(RecordCursor Cursor, void **Cell) {
+    T Result = Cursor.get<T>();
+    void *Indirection = Cursor.get<void *>();
+    if (Cell != nullptr) {
+      *Cell = Indirection;
+    }
+    return Result;
+  }
+
+  const CollectionReader &Collection;
+  const CollectionMethod &Method;
+  llvm::BumpPtrAllocator Allocator;
+  CodeDigest Digest;
+};
+
+#endif // REPLAY_JIT_INFO_H
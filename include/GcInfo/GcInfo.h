@@ -160,6 +160,7 @@ public:
 
   GcFuncInfo *newGcInfo(const llvm::Function *F);
   GcFuncInfo *getGcInfo(const llvm::Function *F);
+  void deleteGcInfo(const llvm::Function *F);
 
   llvm::ValueMap<const llvm::Function *, GcFuncInfo *> GcInfoMap;
 };
@@ -0,0 +1,54 @@
+//===------------ include/Jit/BoundsCheckElimination.h ----------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the pass that removes array bounds checks that are known
+/// to succeed.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef BOUNDS_CHECK_ELIMINATION_H
+#define BOUNDS_CHECK_ELIMINATION_H
+
+#include "llvm/Pass.h"
+
+struct LLILCJitContext;
+
+/// \brief FunctionPass to remove the reader's array bounds checks where the
+/// index is known to be in range.
+///
+/// The reader tags the compare of each bounds check, the load of each array
+/// length, and each array allocation with metadata, which lets this pass see
+/// that two lengths are those of the same array even after the loads have
+/// been moved or duplicated. A check is removed if its index is
+/// - a constant below the length of an array allocated with a constant
+///   length, or
+/// - known to be below the length on some edge that dominates the check:
+///   the in-range edge of an earlier check of the same index against the
+///   same array, or of a compare such as the `i < a.Length` of a for loop,
+///   where `i` is an induction variable that starts at zero and counts up
+///   by one.
+///
+/// The check's branch is made unconditional; later passes delete the throw
+/// block. The number of checks removed is added to
+/// \p LLILCJitContext::NumBoundsChecksRemoved.
+class BoundsCheckElimination : public llvm::FunctionPass {
+public:
+  explicit BoundsCheckElimination(LLILCJitContext *Context)
+      : FunctionPass(ID), Context(Context) {}
+  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+  bool runOnFunction(llvm::Function &F) override;
+
+private:
+  static char ID;
+  LLILCJitContext *Context;
+};
+
+#endif // BOUNDS_CHECK_ELIMINATION_H
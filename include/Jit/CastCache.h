@@ -0,0 +1,45 @@
+//===------------------- include/Jit/CastCache.h ----------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the cells that cache the classes cast to interfaces.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef CAST_CACHE_H
+#define CAST_CACHE_H
+
+#include <deque>
+#include <mutex>
+
+/// \brief Cache cells for casts to interfaces, shared by all jit threads.
+///
+/// Each cached cast site has a cell holding the method table of the last
+/// object the casting helper found to implement the interface. Code checks
+/// the cell before calling the helper, and updates it when the helper
+/// succeeds. Cells are read and written without synchronization: a method
+/// table is a single pointer, and a stale one only costs a helper call.
+class CastCache {
+public:
+  /// \brief Allocate a cell for a cast site, holding null.
+  ///
+  /// Cells are never freed, since compiled code refers to them.
+  void **allocateCell() {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Cells.push_back(nullptr);
+    return &Cells.back();
+  }
+
+private:
+  std::mutex Lock;
+  std::deque<void *> Cells; ///< Adding to the end does not move the others.
+};
+
+#endif // CAST_CACHE_H
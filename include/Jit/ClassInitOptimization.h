@@ -0,0 +1,61 @@
+//===------------- include/Jit/ClassInitOptimization.h ----------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the pass that hoists and removes redundant class
+/// initialization and static base helper calls.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef CLASS_INIT_OPTIMIZATION_H
+#define CLASS_INIT_OPTIMIZATION_H
+
+#include "llvm/Pass.h"
+
+struct LLILCJitContext;
+
+/// \brief FunctionPass to move class initialization and static base helper
+/// calls out of loops and remove those that repeat an earlier call.
+///
+/// The reader only reuses the result of such a call when it was made in a
+/// block that dominates the block being read, so a static field accessed
+/// in a loop costs a helper call per iteration. The reader tags the calls
+/// that may be moved: those that cannot run a class constructor, and those
+/// for classes marked beforefieldinit, whose constructors may run at any
+/// time before the first access to a static field. Each call returns the
+/// same result, and has no effect after the first, whenever it is made
+/// with the same arguments.
+///
+/// A tagged call in a loop is moved to the loop's preheader if its
+/// arguments and target are constants or loads of the runtime's handle
+/// indirection cells, made through constant addresses or marked invariant,
+/// and its block dominates every exit from the loop, so that it would have
+/// been made before the loop was left. A call that may run a constructor is
+/// not moved in a method with exception handlers, whose protected regions
+/// the move could leave. Then each tagged call dominated by an identical one
+/// is removed.
+///
+/// The calls are not given LLVM attributes that would let the generic
+/// passes do this: a constructor writes memory, so its call is neither
+/// readonly nor deletable, and a class initialization call's result is
+/// usually unused.
+class ClassInitOptimization : public llvm::FunctionPass {
+public:
+  explicit ClassInitOptimization(LLILCJitContext *Context)
+      : FunctionPass(ID), Context(Context) {}
+  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+  bool runOnFunction(llvm::Function &F) override;
+
+private:
+  static char ID;
+  LLILCJitContext *Context;
+};
+
+#endif // CLASS_INIT_OPTIMIZATION_H
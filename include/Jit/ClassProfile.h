@@ -0,0 +1,136 @@
+//===----------------- include/Jit/ClassProfile.h ---------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the profile of the receiver classes seen at virtual call
+/// sites.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef CLASS_PROFILE_H
+#define CLASS_PROFILE_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+/// \brief The receivers seen at one virtual call site.
+///
+/// A site is identified by the calling method, named uniquely by its class,
+/// name, token and instantiation, the IL offset of the call, and the name
+/// of the class that declares the called method, which is the class a
+/// guarded call can be made directly for. Receivers are counted by method
+/// table, which for the classes guarded calls are made for is the class
+/// handle.
+struct ClassProfileSite {
+  /// Number of distinct method tables counted separately.
+  static const unsigned NumEntries = 4;
+
+  ClassProfileSite(const std::string &MethodName, uint32_t ILOffset,
+                   const std::string &ClassName);
+
+  /// \brief Get the number of receivers that were of class \p Class.
+  ///
+  /// \param Class Handle of the class the site is named for, or null if it
+  ///              is not loaded in this process.
+  uint64_t getClassCount(void *Class) const;
+
+  /// \brief Get the number of receivers of any class.
+  uint64_t getTotal() const;
+
+  std::string MethodName;  ///< Name of the calling method.
+  uint32_t ILOffset;       ///< IL offset of the call.
+  std::string ClassName;   ///< Name of the class declaring the callee.
+  void *Class;             ///< Handle of that class, once instrumented.
+  uint64_t SavedClassCount; ///< Receivers of that class in the profile file.
+  uint64_t SavedTotal;      ///< Receivers of any class in the profile file.
+
+  /// Method tables of receivers, in the order they were first seen.
+  std::atomic<void *> MethodTables[NumEntries];
+
+  /// Number of receivers with the corresponding method table.
+  std::atomic<uint64_t> Counts[NumEntries];
+
+  /// Number of receivers whose method table did not fit in the table.
+  std::atomic<uint64_t> OtherCount;
+};
+
+/// \brief Receiver class histograms for virtual call sites, shared by all
+/// jit threads.
+///
+/// Instrumented code calls \p recordReceiver before each virtual call with
+/// the call's site and the receiver's method table. Optimized code asks
+/// \p isLikelyClass whether most receivers at a site were of the class that
+/// declares the callee, and if so calls that class's method directly when
+/// the receiver's method table matches.
+///
+/// The profile may be read from a file when it is created, and written back
+/// to that file, adding the counts since, when the process exits. The file
+/// has one site per line: the calling method, the IL offset, the class
+/// name, the number of receivers of that class and the number of receivers
+/// of any class, separated by tabs.
+class ClassProfile {
+public:
+  /// \brief Create a profile.
+  ///
+  /// \param Path  File the profile is read from, if it exists, and written
+  ///              to. May be empty to keep the profile in memory only.
+  /// \param Error Set to a description of the failure, if any.
+  /// \returns The profile, or nullptr if the file could not be read.
+  static ClassProfile *create(const std::string &Path, std::string &Error);
+
+  /// \brief Get the site to count the receivers of a call in, creating it
+  /// if it does not exist.
+  ///
+  /// Sites are never destroyed, since instrumented code refers to them.
+  ClassProfileSite *getSite(const std::string &MethodName, uint32_t ILOffset,
+                            const std::string &ClassName, void *Class);
+
+  /// \brief Check whether most receivers of a call were of class \p Class.
+  ///
+  /// \returns True if at least \p MinTotal receivers were seen, and at
+  /// least \p LikelyPercent percent of them were of that class.
+  bool isLikelyClass(const std::string &MethodName, uint32_t ILOffset,
+                     const std::string &ClassName, void *Class);
+
+  /// \brief Count one receiver at \p Site. Called from instrumented code.
+  static void recordReceiver(ClassProfileSite *Site, void *MethodTable);
+
+  /// \brief Write the profile to its file, if it has one and any site has
+  /// been instrumented.
+  ///
+  /// This is meant to be called as the process shuts down; receivers that
+  /// are being counted concurrently may be missed.
+  bool write(std::string &Error);
+
+  /// Fewest receivers a site must have seen to have a likely class.
+  static const uint64_t MinTotal = 30;
+
+  /// Smallest share of a site's receivers, in percent, a likely class has.
+  static const uint64_t LikelyPercent = 80;
+
+private:
+  ClassProfile(const std::string &Path) : Path(Path), IsInstrumented(false) {}
+
+  bool read(std::string &Error);
+
+  typedef std::tuple<std::string, uint32_t, std::string> SiteKey;
+
+  std::string Path;
+  std::mutex Lock;
+  std::map<SiteKey, std::unique_ptr<ClassProfileSite>> Sites;
+  bool IsInstrumented;
+};
+
+#endif // CLASS_PROFILE_H
@@ -0,0 +1,53 @@
+//===---------------- include/Jit/ColdBlockLayout.h -------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the pass that moves rarely run blocks to the end of the
+/// method.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef COLD_BLOCK_LAYOUT_H
+#define COLD_BLOCK_LAYOUT_H
+
+#include "llvm/Pass.h"
+
+struct LLILCJitContext;
+
+/// \brief FunctionPass to gather the blocks that are rarely run after the
+/// rest of the method's code.
+///
+/// A block is cold if it ends by throwing, if each way into it is from a
+/// cold block or along an edge the method's profile weighs zero, or if
+/// each way out of it leads to a cold block. The cold blocks are moved to
+/// the end of the function, keeping their order. Without optimization the
+/// code follows the order of the blocks; block placement, which also takes
+/// the cold blocks last, lays out the hot blocks by their branch weights
+/// and then the rest in this order. The code that runs is so packed into
+/// fewer cache lines and pages. Handlers are already emitted as funclets
+/// after the method's body.
+///
+/// The cold blocks stay in the method's single code section, sharing its
+/// unwind and GC info. The code generator emits each function in one
+/// section, and the EE only takes a separate cold code block for code that
+/// is prejitted.
+class ColdBlockLayout : public llvm::FunctionPass {
+public:
+  explicit ColdBlockLayout(LLILCJitContext *Context)
+      : FunctionPass(ID), Context(Context) {}
+  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+  bool runOnFunction(llvm::Function &F) override;
+
+private:
+  static char ID;
+  LLILCJitContext *Context;
+};
+
+#endif // COLD_BLOCK_LAYOUT_H
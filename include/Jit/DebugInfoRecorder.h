@@ -0,0 +1,54 @@
+//===--------------- include/Jit/DebugInfoRecorder.h ------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the collection of the debug information reported to the
+/// EE: the native to IL offset map and the homes of arguments and locals.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef DEBUG_INFO_RECORDER_H
+#define DEBUG_INFO_RECORDER_H
+
+#include "llvm/CodeGen/MachineFunctionPass.h"
+
+struct LLILCJitContext;
+
+/// \brief MachineFunctionPass to record the debug information for the EE
+/// in the jit context.
+///
+/// This runs just before the AsmPrinter. The reader gives each instruction
+/// a debug location whose line is the IL offset it came from; wherever that
+/// changes, the pass inserts a label, which the object writer resolves to a
+/// native offset once the code has been laid out. Loads that codegen made
+/// into implicit null checks are labeled the same way. If the EE asked for
+/// debug info, the frame offsets of the arguments and locals are recorded
+/// too.
+/// Nothing here depends on DWARF, which is only generated for debuggable
+/// code.
+class DebugInfoRecorder : public llvm::MachineFunctionPass {
+public:
+  explicit DebugInfoRecorder() : MachineFunctionPass(ID) {}
+  bool runOnMachineFunction(llvm::MachineFunction &MF) override;
+
+private:
+  static char ID;
+};
+
+/// \brief Report the debug information recorded for the method being
+/// jitted to the EE.
+///
+/// The code must have been emitted, so that the native offsets of the
+/// recorded labels are known.
+///
+/// \param Context Context of the method being jitted.
+void reportDebugInfo(LLILCJitContext *Context);
+
+#endif // DEBUG_INFO_RECORDER_H
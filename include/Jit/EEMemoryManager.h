@@ -112,6 +112,12 @@ public:
   /// \param Obj - the Object being loaded
   void reserveUnwindSpace(const object::ObjectFile &Obj);
 
+  /// Inform the memory manager about the amount of memory required to hold
+  /// unwind codes, given the contents of the .xdata section.
+  ///
+  /// \param Xdata - the contents of the .xdata section
+  void reserveUnwindSpace(StringRef Xdata);
+
   /// \brief Override to enable the reserveAllocationSpace callback.
   ///
   /// The CoreCLR's EE requires an up-front resevation of the total allocation
@@ -0,0 +1,77 @@
+//===---------------- include/Jit/EEObjectWriter.h --------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares direct emission of MC output into memory from the EE,
+/// without an intermediate object file.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef EE_OBJECT_WRITER_H
+#define EE_OBJECT_WRITER_H
+
+#include <string>
+
+struct LLILCJitContext;
+
+namespace llvm {
+
+class EEMemoryManager;
+class Target;
+
+/// \brief The state of emitting one method.
+///
+/// When the MC assembler for a method finishes layout, the object writer
+/// resolves the labels \p DebugInfoRecorder placed in the code to native
+/// offsets. If direct emission was asked for, it then checks that everything
+/// in the method can be handled without an object file: a single code
+/// section, read-only data, stack maps and unwind info, and relocations the
+/// EE understands. If so, it allocates the EE's memory through \p MM, copies
+/// the sections straight into it, and reports relocations and unwind info.
+/// Otherwise it writes the usual object file, and the caller loads that as
+/// before. The check is made before anything is reported to the EE, so
+/// falling back is always safe.
+struct DirectEmission {
+  DirectEmission(LLILCJitContext *Context, EEMemoryManager *MM,
+                 bool IsDirectEmitRequested)
+      : Context(Context), MM(MM),
+        IsDirectEmitRequested(IsDirectEmitRequested), IsEmitted(false) {}
+
+  LLILCJitContext *Context;   ///< Context of the request being compiled.
+  EEMemoryManager *MM;        ///< Memory manager for the request.
+  bool IsDirectEmitRequested; ///< True to try to emit directly.
+  bool IsEmitted;             ///< True if the code was emitted directly.
+  std::string FallbackReason; ///< Why an object file was written instead.
+};
+
+/// \brief Makes compiles on this thread report to \p Emission for as long
+/// as the scope is live.
+///
+/// This only has an effect on target machines created from the target
+/// returned by \p getEETarget.
+class DirectEmissionScope {
+public:
+  DirectEmissionScope(DirectEmission &Emission);
+  ~DirectEmissionScope();
+
+private:
+  DirectEmission *Saved;
+};
+
+/// \brief Get a copy of \p TheTarget whose object writers report to the
+/// EE when a \p DirectEmissionScope is active.
+///
+/// Target machines created from the copy are otherwise identical to those
+/// created from \p TheTarget.
+const Target &getEETarget(const Target &TheTarget);
+
+} // namespace llvm
+
+#endif // EE_OBJECT_WRITER_H
@@ -0,0 +1,176 @@
+//===----------------- include/Jit/JitEventLog.h ----------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the per-phase compile time instrumentation and the log
+/// that per-method jit events are written to.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef JIT_EVENT_LOG_H
+#define JIT_EVENT_LOG_H
+
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/// \brief The phases of a jit request that are timed separately.
+enum JitPhase {
+  EESetupPhase,         ///< EE info, options and pipeline setup.
+  ReaderPrePassPhase,   ///< Reader setup up to the end of GenIR's pre-pass.
+  ReaderFlowGraphPhase, ///< EH regions and flow graph construction.
+  ReaderMainPassPhase,  ///< Reading MSIL blocks and the reader's post pass.
+  VerifyPhase,          ///< Verification of the reader's IR.
+  OptimizePhase,        ///< The IR optimization pipeline.
+  StatepointPhase,      ///< PlaceSafepoints and RewriteStatepointsForGC.
+  CodeGenPhase,         ///< MC code generation by LLILCCompiler.
+  LinkPhase,            ///< RuntimeDyld loading and relocation recording.
+  DebugInfoPhase,       ///< Extracting and reporting debug information.
+  GCInfoPhase,          ///< Encoding GC info with GcInfoEmitter.
+  NumJitPhases
+};
+
+/// \brief Accumulates the time a jit request spends in each \p JitPhase.
+///
+/// The timer is always in at most one phase; entering a phase charges the
+/// time since the last transition to the phase being left. A disabled timer
+/// does not read the clock.
+class JitPhaseTimer {
+public:
+  JitPhaseTimer() : Enabled(false), Current(NumJitPhases), Elapsed() {}
+
+  /// Start timing, in \p Phase.
+  void start(JitPhase Phase);
+
+  /// Leave the current phase, if any, and enter \p Phase.
+  void enterPhase(JitPhase Phase);
+
+  /// Leave the current phase and stop timing.
+  void stop();
+
+  /// \returns Nanoseconds spent in \p Phase so far.
+  uint64_t getElapsed(JitPhase Phase) const { return Elapsed[Phase]; }
+
+  /// \returns Steady clock time in nanoseconds at which timing started.
+  uint64_t getStartTime() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               StartTime.time_since_epoch())
+        .count();
+  }
+
+  /// \returns True if the timer has been started.
+  bool isEnabled() const { return Enabled; }
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  bool Enabled;
+  JitPhase Current;
+  Clock::time_point StartTime;
+  Clock::time_point PhaseStart;
+  uint64_t Elapsed[NumJitPhases];
+};
+
+/// \brief Summary of one jit request, as written to the event log.
+///
+/// This is also the record layout of the binary log, so it has no pointers
+/// and a fixed size.
+struct JitEvent {
+  static const unsigned MaxNameLength = 127;
+
+  uint64_t StartTime;    ///< Steady clock time the request began, in ns.
+  uint64_t MethodHandle; ///< CORINFO_METHOD_HANDLE of the method.
+  uint32_t ThreadId;     ///< Hash of the jitting thread's id.
+  int32_t Result;        ///< CorJitResult of the request.
+  uint32_t ILSize;       ///< Size of the method's MSIL in bytes.
+  uint32_t NumBlocks;    ///< Basic blocks in the IR the reader built.
+  uint32_t CodeSize;     ///< Native code size reported to the EE.
+  uint32_t NumBoundsChecksRemoved;  ///< Array bounds checks removed.
+  uint32_t NumCallsDevirtualized;   ///< Virtual calls made direct.
+  uint32_t NumCallsGuarded;         ///< Virtual calls given a guarded
+                                    ///< direct call.
+  uint32_t NumAllocationsRemoved;   ///< Heap allocations moved to the stack.
+  uint32_t NumBoxesRemoved;         ///< Boxes the reader did not allocate.
+  uint32_t NumWriteBarriersRemoved; ///< Write barriers made plain stores.
+  uint32_t Reserved;
+  uint64_t PhaseTime[NumJitPhases]; ///< Nanoseconds spent in each phase.
+  char Name[MaxNameLength + 1];     ///< Method name, possibly truncated.
+};
+
+/// \brief A log of jit events shared by all jit threads.
+///
+/// Events are written into a fixed-size ring without taking any lock: a
+/// writer claims a slot by incrementing the ring's head and publishes the
+/// event with a per-slot sequence number. The ring is divided into batches,
+/// and the writer that starts a batch flushes the batch two before it to
+/// the log file, so the writers of that batch have had a whole batch's
+/// worth of requests to finish. Events still unpublished when their batch
+/// is flushed, or overwritten before it is, are counted as lost.
+///
+/// The log is either a binary file (a header followed by \p JitEvent
+/// records) or JSON, one object per line.
+class JitEventLog {
+public:
+  /// \brief Create a log.
+  ///
+  /// \param Path    File to write the log to. It is overwritten.
+  /// \param IsJSON  True to write JSON rather than binary records.
+  /// \param Error   Set to a description of the failure, if any.
+  /// \returns The log, or nullptr on failure.
+  static JitEventLog *create(const std::string &Path, bool IsJSON,
+                             std::string &Error);
+
+  /// \brief Add an event to the log.
+  void log(const JitEvent &Event);
+
+  /// \brief Write all published events that have not been written yet.
+  ///
+  /// This is meant to be called as the process shuts down; events that are
+  /// being logged concurrently may be missed.
+  void flush();
+
+  /// \returns The number of events that were logged but never written.
+  uint64_t getNumLost() const { return NumLost; }
+
+  /// \brief Name of a phase, as used in the JSON log.
+  static const char *getPhaseName(JitPhase Phase);
+
+private:
+  static const uint64_t BatchSize = 1024;
+  static const uint64_t NumBatches = 4;
+  static const uint64_t Capacity = BatchSize * NumBatches;
+
+  /// One slot of the ring. \p Seq is one more than the index of the event
+  /// in the slot once it is published, and zero while it is being written.
+  struct Slot {
+    std::atomic<uint64_t> Seq;
+    JitEvent Event;
+  };
+
+  JitEventLog(int FD, bool IsJSON);
+
+  /// Write the events before index \p End that have not been written yet
+  /// and are still in the ring.
+  void flushUpTo(uint64_t End);
+
+  /// Append the formatted \p Event to \p OS.
+  void writeEvent(llvm::raw_ostream &OS, const JitEvent &Event);
+
+  int FD;
+  bool IsJSON;
+  std::atomic<uint64_t> Head;    ///< Index of the next event to be logged.
+  std::atomic<uint64_t> Flushed; ///< Events before this have been written.
+  std::atomic<uint64_t> NumLost; ///< Events that were never written.
+  Slot Ring[Capacity];
+};
+
+#endif // JIT_EVENT_LOG_H
@@ -18,6 +18,7 @@
 
 #include "Pal/LLILCPal.h"
 #include "Reader/options.h"
+#include "JitEventLog.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/IR/LLVMContext.h"
@@ -26,12 +27,20 @@
 #include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
 #include "llvm/ExecutionEngine/Orc/NullResolver.h"
 #include "llvm/Config/config.h"
+#include "llvm/Support/CodeGen.h"
+#include <tuple>
 
 class ABIInfo;
+class CastCache;
+class ClassProfile;
+struct CollectionChunk;
 class GcInfo;
+class LLILCJitPipeline;
 struct LLILCJitPerThreadState;
 namespace llvm {
 class EEMemoryManager;
+class MCSymbol;
+class MDNode;
 } // namespace llvm
 
 /// \brief This struct holds per-jit request state.
@@ -43,12 +52,23 @@ class EEMemoryManager;
 /// middle of jitting a method, if other methods must be run and also require
 /// jitting. To handle this, the contexts form a stack, so that the jit can
 /// keep the state from nested jit requests distinct from parent requests.
+/// The reader also pushes a context for each method it reads to inline.
 struct LLILCJitContext {
 
   /// Construct a context and push it onto the context stack.
   /// \param State the per-thread state for this thread.
   LLILCJitContext(LLILCJitPerThreadState *State);
 
+  /// \brief Construct a context for reading a method to be inlined and push
+  /// it onto the context stack.
+  ///
+  /// The inlinee is read into the inliner's module, and shares its EE
+  /// interface, target, options and GC info.
+  ///
+  /// \param Inliner    The context of the method the inlinee is inlined into.
+  /// \param MethodInfo The CoreCLR method info for the inlinee.
+  LLILCJitContext(LLILCJitContext *Inliner, CORINFO_METHOD_INFO *MethodInfo);
+
   /// Destruct this context and pop it from the context stack.
   ~LLILCJitContext();
 
@@ -108,6 +128,36 @@ public:
   ::Options *Options;
   //@}
 
+  /// \name Profile information
+  //@{
+  ::ClassProfile *ClassProfile = nullptr; ///< Receiver classes at virtual
+                                          ///< calls, if instrumenting or
+                                          ///< guarding calls.
+  ::CastCache *CastCache = nullptr;       ///< Cells for caching the classes
+                                          ///< cast to interfaces, if
+                                          ///< caching them.
+  //@}
+
+  /// \name Inlining
+  //@{
+  uint32_t InlineDepth = 0; ///< How deeply the method read is inlined;
+                            ///< zero for the method being jitted.
+  //@}
+
+  /// \name Optimization statistics
+  //@{
+  uint32_t NumBoundsChecksRemoved = 0;  ///< Array bounds checks removed.
+  uint32_t NumCallsDevirtualized = 0;   ///< Virtual calls made direct.
+  uint32_t NumCallsGuarded = 0;         ///< Virtual calls given a guarded
+                                        ///< direct call.
+  uint32_t NumAllocationsRemoved = 0;   ///< Heap allocations moved to the
+                                        ///< stack.
+  uint32_t NumBoxesRemoved = 0;         ///< Boxes the reader did not
+                                        ///< allocate.
+  uint32_t NumWriteBarriersRemoved = 0; ///< Write barriers made plain
+                                        ///< stores.
+  //@}
+
   /// \name Jit output sizes
   //@{
   uintptr_t HotCodeSize = 0;      ///< Size of hot code section in bytes.
@@ -116,8 +166,35 @@ public:
   uintptr_t StackMapSize = 0;     ///< Size of readonly Stackmap section.
   //@}
 
+  /// \name Jit output debug information
+  //@{
+  /// Native to IL offset map reported to the EE, kept for profilers.
+  std::vector<ICorDebugInfo::OffsetMapping> OffsetMappings;
+  /// Label at the start of the code for each IL offset, as recorded by
+  /// \p DebugInfoRecorder, and its mapping. The native offsets are filled in
+  /// when the code is laid out.
+  std::vector<std::pair<llvm::MCSymbol *, ICorDebugInfo::OffsetMapping>>
+      OffsetLabels;
+  /// Stack homes of the arguments and locals, if the EE asked for them.
+  std::vector<ICorDebugInfo::NativeVarInfo> VarHomes;
+  /// Label at each load that also serves as a null check, and the load's
+  /// native offset once the code is laid out.
+  std::vector<std::pair<llvm::MCSymbol *, uint32_t>> ImplicitNullChecks;
+  //@}
+
+  /// \name Compile time instrumentation
+  //@{
+  JitPhaseTimer PhaseTimer; ///< Time spent in each phase of this request.
+  //@}
+
   /// \name GC Information
   ::GcInfo *GcInfo; ///< GcInfo for functions in CurrentModule
+
+  /// \name Memory management
+  //@{
+  ArenaAllocator TempArena; ///< Reader-lifetime memory, reset after reading.
+  ArenaAllocator ProcArena; ///< Request-lifetime memory.
+  //@}
 };
 
 /// \brief This struct holds per-thread Jit state.
@@ -133,8 +210,12 @@ public:
   /// Construct a new state.
   LLILCJitPerThreadState()
       : LLVMContext(), JitContext(nullptr), ClassTypeMap(),
-        ReverseClassTypeMap(), BoxedTypeMap(), ArrayTypeMap(), FieldIndexMap() {
-  }
+        ReverseClassTypeMap(), BoxedTypeMap(), ArrayTypeMap(), FieldIndexMap(),
+        FieldAccessTagMap(), PipelineMap(), PipelinesCreated(0),
+        PipelinesReused(0), RecordChunk(nullptr), PerfBuffer() {}
+
+  /// Destroy the state, along with any cached compilation pipelines.
+  ~LLILCJitPerThreadState();
 
   /// Each thread maintains its own \p LLVMContext. This is where
   /// LLVM keeps definitions of types and similar constructs.
@@ -168,6 +249,34 @@ public:
   ///
   /// Used to build struct GEP instructions in LLVM IR for field accesses.
   std::map<CORINFO_FIELD_HANDLE, uint32_t> FieldIndexMap;
+
+  /// \brief Map from a field handle to the TBAA access tag for loads and
+  /// stores of that field, or null if they must not be tagged.
+  std::map<CORINFO_FIELD_HANDLE, llvm::MDNode *> FieldAccessTagMap;
+
+  /// \brief Key identifying a compilation pipeline: the codegen opt level,
+  /// code model and relocation model its \p TargetMachine was created with.
+  typedef std::tuple<llvm::CodeGenOpt::Level, llvm::CodeModel::Model,
+                     llvm::Reloc::Model>
+      PipelineKey;
+
+  /// \brief Map from pipeline configuration to the cached pipeline for it.
+  ///
+  /// Creating a \p TargetMachine and the Orc layers on top of it is costly,
+  /// so each thread keeps one pipeline per configuration alive across jit
+  /// requests. Each request binds its own memory manager and load listener
+  /// to the pipeline for the duration of the request.
+  std::map<PipelineKey, LLILCJitPipeline *> PipelineMap;
+
+  uint32_t PipelinesCreated; ///< Pipelines constructed on this thread.
+  uint32_t PipelinesReused;  ///< Requests served by a cached pipeline.
+
+  /// \brief This thread's part of the collection jit requests are recorded
+  /// into, or null if this thread has not recorded anything.
+  CollectionChunk *RecordChunk;
+
+  /// \brief Scratch space for describing jitted code to profilers.
+  std::vector<char> PerfBuffer;
 };
 
 /// \brief Stub \p SymbolResolver that tells dynamic linker not to apply
@@ -278,6 +387,18 @@ private:
   /// \returns \p true if the conversion was successful.
   bool readMethod(LLILCJitContext *JitContext, bool &ContainsUnmanagedCall);
 
+  /// \brief Run the mid-level IR optimization pipeline for a method.
+  ///
+  /// The passes run depend on the method's \p OptLevel. Nothing is run when
+  /// generating debuggable code.
+  ///
+  /// \param JitContext Context record for the method's jit request.
+  void optimizeMethod(LLILCJitContext *JitContext);
+
+  /// \brief Release the reader's temporary memory once reading is done.
+  /// \param JitContext Context record for the method's jit request.
+  void releaseReaderMemory(LLILCJitContext *JitContext);
+
 public:
   /// A pointer to the singleton jit instance.
   static LLILCJit *TheJit;
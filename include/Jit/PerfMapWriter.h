@@ -0,0 +1,80 @@
+//===---------------- include/Jit/PerfMapWriter.h ---------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the writer that describes jitted code to the Linux perf
+/// tools.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef PERF_MAP_WRITER_H
+#define PERF_MAP_WRITER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+/// \brief Describes jitted methods to the Linux perf tools.
+///
+/// Two outputs are supported:
+///  - A perf map, /tmp/perf-<pid>.map, with one "start size name" line per
+///    method. perf reads it to name samples in jitted code.
+///  - A jitdump file, jit-<pid>.dump, holding each method's name, code bytes
+///    and native-to-IL offset map. `perf inject --jit` turns it into ELF
+///    images so that `perf annotate` can disassemble jitted code. The IL
+///    offsets are reported as line numbers.
+///
+/// Each method is described with a single write to each file, which is
+/// opened for appending, so jit threads never wait on each other. The
+/// bytes for a write are assembled in a buffer owned by the calling thread.
+class PerfMapWriter {
+public:
+  /// \brief Create a writer.
+  ///
+  /// \param WritePerfMap  Whether to write /tmp/perf-<pid>.map.
+  /// \param JitDumpDir    Directory to write jit-<pid>.dump into, or empty
+  ///                      for no jitdump.
+  /// \param Error         Set to a description of the failure, if any.
+  /// \returns The writer, or nullptr if nothing is to be written, the files
+  /// can't be created, or the host is not Linux.
+  static PerfMapWriter *create(bool WritePerfMap, const std::string &JitDumpDir,
+                               std::string &Error);
+
+  ~PerfMapWriter();
+
+  /// \brief Describe a newly jitted method.
+  ///
+  /// \param Name      Name of the method.
+  /// \param Code      Start of the method's hot code, after relocation.
+  /// \param CodeSize  Size of the hot code in bytes.
+  /// \param Mappings  The native to IL offset map reported to the EE.
+  /// \param Buffer    Scratch space owned by the calling thread.
+  void logMethod(const std::string &Name, const uint8_t *Code,
+                 size_t CodeSize,
+                 llvm::ArrayRef<ICorDebugInfo::OffsetMapping> Mappings,
+                 std::vector<char> &Buffer);
+
+private:
+  PerfMapWriter()
+      : PerfMapFD(-1), JitDumpFD(-1), JitDumpMarker(nullptr),
+        NextCodeIndex(0) {}
+
+  /// \brief Append \p Buffer to the file \p FD with a single write.
+  static void append(int FD, const std::vector<char> &Buffer);
+
+  int PerfMapFD;       ///< The perf map, or -1.
+  int JitDumpFD;       ///< The jitdump file, or -1.
+  void *JitDumpMarker; ///< Executable mapping that tells perf about the
+                       ///< jitdump file.
+  std::atomic<uint64_t> NextCodeIndex; ///< Unique index of each method.
+};
+
+#endif // PERF_MAP_WRITER_H
@@ -0,0 +1,62 @@
+//===--------------- include/Jit/StackAllocation.h --------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the pass that moves objects which do not escape the
+/// method allocating them from the GC heap to the stack.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef STACK_ALLOCATION_H
+#define STACK_ALLOCATION_H
+
+#include "llvm/Pass.h"
+
+struct LLILCJitContext;
+
+/// \brief FunctionPass to allocate objects that do not escape on the stack.
+///
+/// The reader tags the calls to the helpers that allocate plain objects
+/// (newobj of a class without a finalizer) and boxes, and the calls to the
+/// write barriers. When small objects are allocated inline, the tag is on
+/// the merge of the inline allocation and its helper call, which is handled
+/// like the call itself. An allocation is moved to the stack if
+/// - its helper call is a call, not an invoke, and is not in a cycle, so
+///   each object in the method's frame is allocated at most once, and
+/// - the object is only used as the address of loads and stores within the
+///   object, as the destination of a write barrier, and in compares with
+///   null.
+///
+/// The object becomes an alloca in the entry block, whose method table is
+/// stored where the helper was called, and, for a box, the boxed value is
+/// copied in. An inline allocation's paths are removed, and the method
+/// table is stored where they merged. The object's uses are rewritten to
+/// unmanaged pointers, so the GC never sees a pointer to it, and its write
+/// barriers become plain stores. If the object holds GC pointers, the
+/// alloca is zeroed in the prolog, recorded as a GC aggregate in the
+/// function's \p GcFuncInfo and escaped with the reader's other GC slots,
+/// so that the pointers it holds are reported for the whole method.
+/// Otherwise SROA may break it up into scalars.
+///
+/// The number of allocations moved is added to
+/// \p LLILCJitContext::NumAllocationsRemoved.
+class StackAllocation : public llvm::FunctionPass {
+public:
+  explicit StackAllocation(LLILCJitContext *Context)
+      : FunctionPass(ID), Context(Context) {}
+  void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+  bool runOnFunction(llvm::Function &F) override;
+
+private:
+  static char ID;
+  LLILCJitContext *Context;
+};
+
+#endif // STACK_ALLOCATION_H
@@ -0,0 +1,60 @@
+//===----------- include/Jit/WriteBarrierOptimization.h ---------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the pass that removes the write barriers the GC does not
+/// need and marks cards inline for the rest.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef WRITE_BARRIER_OPTIMIZATION_H
+#define WRITE_BARRIER_OPTIMIZATION_H
+
+#include "llvm/Pass.h"
+
+struct LLILCJitContext;
+
+/// \brief FunctionPass to remove unneeded write barriers and expand the
+/// others inline.
+///
+/// The GC only needs to hear about a store of a pointer into an object that
+/// may be in an older generation than the object pointed to. A barrier the
+/// reader tagged becomes a plain store if
+/// - the value stored is null,
+/// - the address is on the stack, or
+/// - the address is within an object allocated by the method, small enough
+///   to be allocated in the youngest generation, and no safepoint lies
+///   between the allocation and the store on any path, so the object has
+///   not been promoted.
+///
+/// If \p Options::DoInlineWriteBarrier is set, each remaining barrier that
+/// is a call, rather than an invoke, becomes the store followed by the
+/// runtime's card marking sequence, which reads the GC's heap range,
+/// ephemeral range and card table through the addresses in
+/// \p Options::WriteBarrierGlobals.
+///
+/// This pass must run after any pass that may move code: the pointers it
+/// converts to integers must not be kept across a safepoint, and a store
+/// with no barrier must not be moved after one.
+///
+/// The number of barriers removed is added to
+/// \p LLILCJitContext::NumWriteBarriersRemoved.
+class WriteBarrierOptimization : public llvm::FunctionPass {
+public:
+  explicit WriteBarrierOptimization(LLILCJitContext *Context)
+      : FunctionPass(ID), Context(Context) {}
+  bool runOnFunction(llvm::Function &F) override;
+
+private:
+  static char ID;
+  LLILCJitContext *Context;
+};
+
+#endif // WRITE_BARRIER_OPTIMIZATION_H
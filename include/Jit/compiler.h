@@ -17,8 +17,11 @@
 #ifndef COMPILER_H
 #define COMPILER_H
 
+#include "DebugInfoRecorder.h"
+#include "EEObjectWriter.h"
 #include "GcInfo.h"
 #include "LLILCJit.h"
+#include "llvm/CodeGen/AsmPrinter.h"
 #include "llvm/ExecutionEngine/ObjectMemoryBuffer.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/MC/MCContext.h"
@@ -28,6 +31,20 @@
 namespace llvm {
 namespace orc {
 
+/// \brief Pass manager for code generation that runs a
+/// \p DebugInfoRecorder just before the target's AsmPrinter, once the
+/// machine code is final but while its debug locations can still be tied to
+/// labels in the emitted code.
+class CodeGenPassManager : public legacy::PassManager {
+public:
+  void add(Pass *P) override {
+    if (P->getPassID() == &AsmPrinter::ID) {
+      legacy::PassManager::add(new DebugInfoRecorder());
+    }
+    legacy::PassManager::add(P);
+  }
+};
+
 /// \brief Default compile functor: Takes a single IR module and returns an
 ///        ObjectFile.
 class LLILCCompiler {
@@ -40,7 +57,7 @@ public:
     SmallVector<char, 0> ObjBufferSV;
     raw_svector_ostream ObjStream(ObjBufferSV);
 
-    legacy::PassManager PM;
+    CodeGenPassManager PM;
     MCContext *Ctx;
     if (TM.addPassesToEmitMC(PM, Ctx, ObjStream))
       llvm_unreachable("Target does not support MC emission.");
@@ -57,6 +74,17 @@ public:
     return OwningObj(nullptr, nullptr);
   }
 
+  /// \brief Compile a Module, reporting to \p Emission and emitting it
+  /// directly into the EE's memory if asked to and possible.
+  ///
+  /// \returns An empty ObjectFile if \p Emission.IsEmitted is set on return,
+  /// otherwise the ObjectFile as above.
+  object::OwningBinary<object::ObjectFile>
+  operator()(Module &M, DirectEmission &Emission) const {
+    DirectEmissionScope Scope(Emission);
+    return (*this)(M);
+  }
+
 private:
   TargetMachine &TM;
 };
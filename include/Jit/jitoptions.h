@@ -38,6 +38,48 @@ public:
   /// Destruct Options object.
   ~JitOptions();
 
+  /// \brief Get the collection file jit requests should be recorded into.
+  ///
+  /// Recording is process-wide, so this is queried once rather than per
+  /// request. Any "%p" in the path is replaced with the process id.
+  /// \returns The path from COMPlus_JitRecordCollection, or an empty string
+  /// if requests are not to be recorded.
+  static std::string queryRecordCollection(LLILCJitContext &JitContext);
+
+  /// \brief Get the maximum size of the record collection.
+  ///
+  /// \returns The size in bytes given in megabytes by
+  /// COMPlus_JitRecordCollectionSizeMB, or 1GB if unset.
+  static uint64_t queryRecordCollectionSize(LLILCJitContext &JitContext);
+
+  /// \brief Determine if jitted methods should be listed in a perf map.
+  ///
+  /// Like recording, this is process-wide and queried once.
+  /// \returns True if COMPlus_JitPerfMap is non-null and non-empty.
+  static bool queryDoPerfMap(LLILCJitContext &JitContext);
+
+  /// \brief Get the directory a jitdump file should be written into.
+  ///
+  /// \returns The directory from COMPlus_JitPerfDumpDir, or an empty string
+  /// if no jitdump file is to be written.
+  static std::string queryPerfJitDumpDir(LLILCJitContext &JitContext);
+
+  /// \brief Get the file per-method jit events should be logged to.
+  ///
+  /// Like recording, this is process-wide and queried once. Any "%p" in the
+  /// path is replaced with the process id.
+  /// \returns The path from COMPlus_JitEventLog, or an empty string if
+  /// events are not to be logged.
+  static std::string queryEventLog(LLILCJitContext &JitContext);
+
+  /// \brief Get the file the receiver class profile is kept in.
+  ///
+  /// Like recording, this is process-wide and queried once. Any "%p" in the
+  /// path is replaced with the process id.
+  /// \returns The path from COMPlus_JitClassProfile, or an empty string if
+  /// the profile is not kept in a file.
+  static std::string queryClassProfile(LLILCJitContext &JitContext);
+
 private:
   /// Set current JIT invocation as "AltJit".  This sets up
   /// the JIT to filter based on the AltJit flag contents.
@@ -72,6 +114,70 @@ private:
   /// \returns true if COMPLUS_TAILCALLOPT is set in the environment.
   static bool queryDoTailCallOpt(LLILCJitContext &JitContext);
 
+  /// \brief Set DoInlining based on environment variable and jit flags.
+  ///
+  /// \returns true if optimizing, COMPlus_JitNoInline is not set in the
+  /// environment, and the request is not for ReadyToRun code.
+  static bool queryDoInlining(LLILCJitContext &JitContext);
+
+  /// \brief Set DoImplicitNullCheck based on environment variable.
+  ///
+  /// \returns true if COMPlus_JitImplicitNullChecks is set in the
+  /// environment.
+  static bool queryDoImplicitNullCheck(LLILCJitContext &JitContext);
+
+  /// \brief Set DoClassInstrument based on environment variable and jit
+  /// flags.
+  ///
+  /// \returns true if COMPlus_JitInstrumentClasses is set in the
+  /// environment and the request is not for an ngen image.
+  static bool queryDoClassInstrument(LLILCJitContext &JitContext);
+
+  /// \brief Set DoGuardedDevirt based on environment variable and jit flags.
+  ///
+  /// \returns true if COMPlus_JitGuardedDevirt is set in the environment
+  /// and the request is not for ReadyToRun code.
+  static bool queryDoGuardedDevirt(LLILCJitContext &JitContext);
+
+  /// \brief Set DoStackAllocation based on environment variable.
+  ///
+  /// \returns true if COMPlus_JitStackAllocation is set in the environment.
+  static bool queryDoStackAllocation(LLILCJitContext &JitContext);
+
+  /// \brief Set DoInlineAlloc and AllocContextOffset based on environment
+  /// variable and jit flags.
+  ///
+  /// \param Offset [out] The offset from COMPlus_JitAllocContextOffset.
+  /// \returns true if COMPlus_JitAllocContextOffset is set to a number in
+  /// the environment and the request is not for an ngen image.
+  static bool queryDoInlineAlloc(LLILCJitContext &JitContext,
+                                 unsigned &Offset);
+
+  /// \brief Set DoInlineWriteBarrier and WriteBarrierGlobals based on
+  /// environment variable and jit flags.
+  ///
+  /// \param Globals [out] The addresses from COMPlus_JitWriteBarrierGlobals.
+  /// \returns true if COMPlus_JitWriteBarrierGlobals is set to five
+  /// comma-separated addresses in the environment and the request is not for
+  /// an ngen image.
+  static bool queryDoInlineWriteBarrier(LLILCJitContext &JitContext,
+                                        ::WriteBarrierGlobals &Globals);
+
+  /// \brief Set CastCacheExcludeFlags based on environment variable and jit
+  /// flags.
+  ///
+  /// \returns The flags from COMPlus_JitCastCache, or zero if it is not set
+  /// to a number in the environment or the request is for an ngen image.
+  static uint32_t queryCastCacheExcludeFlags(LLILCJitContext &JitContext);
+
+  /// \brief Set ParentMethodTableOffset based on environment variable and
+  /// jit flags.
+  ///
+  /// \returns The offset from COMPlus_JitParentMethodTableOffset, or zero if
+  /// it is not set to a number in the environment or the request is for an
+  /// ngen image.
+  static unsigned queryParentMethodTableOffset(LLILCJitContext &JitContext);
+
   /// \brief Set LogGcInfo based on environment variable.
   ///
   /// \returns true if COMPLUS_JitGCInfoLogging is set in the environment.
@@ -122,6 +228,17 @@ private:
   /// \returns true if SIMD_INTRINSIC is set in the environment set.
   static bool queryDoSIMDIntrinsic(LLILCJitContext &JitContext);
 
+  /// \brief Set DoTimePasses based on environment variable.
+  ///
+  /// \returns true if COMPlus_JitTimePasses is set in the environment.
+  static bool queryDoTimePasses(LLILCJitContext &JitContext);
+
+  /// \brief Set DoDirectEmit based on environment variable and jit flags.
+  ///
+  /// \returns true if COMPlus_JitDirectEmit is set in the environment and
+  /// the request is not for an ngen image.
+  static bool queryDoDirectEmit(LLILCJitContext &JitContext);
+
 public:
   bool IsAltJit;        ///< True if running as the alternative JIT.
   bool IsExcludeMethod; ///< True if method is to be excluded.
@@ -130,6 +247,8 @@ public:
   bool IsMSILDumpMethod;  ///< True if dump of MSIL requested.
   bool IsLLVMDumpMethod;  ///< True if dump of LLVM requested.
   bool IsCodeRangeMethod; ///< True if desired to dump entry address and size.
+  bool DoTimePasses;      ///< True if per-pass timings should be reported.
+  bool DoDirectEmit;      ///< True to emit code without an object file.
 
 private:
   static MethodSet AltJitMethodSet;     ///< Singleton AltJit MethodSet.
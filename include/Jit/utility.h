@@ -16,9 +16,11 @@
 #ifndef UTILITY_H
 #define UTILITY_H
 
+#include <algorithm>
 #include <list>
 #include <cassert>
 #include <memory>
+#include <vector>
 
 #include "cor.h"
 #include "utility.h"
@@ -26,6 +28,7 @@
 #include "llvm/Support/Atomic.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Allocator.h"
 
 // The MethodID.NumArgs field may hold either of 2 values:
 //   Empty   => the input string was all-blank, or empty.
@@ -173,4 +176,59 @@ public:
   static std::unique_ptr<std::string> utf16ToUtf8(const char16_t *WideStr);
 };
 
+/// \brief Bump-pointer arena for jit-request lifetime allocations.
+///
+/// Memory handed out by the arena is zero-initialized and is never freed
+/// individually; it is all released at once when the arena is reset or
+/// destroyed. Objects placed in arena memory that own other resources can
+/// register themselves so that their destructors run at reset time.
+///
+/// An arena also keeps statistics about its use so that per-method memory
+/// consumption can be reported.
+class ArenaAllocator {
+public:
+  ArenaAllocator() : PeakBytesAllocated(0), NumAllocations(0) {}
+  ~ArenaAllocator() { reset(); }
+
+  ArenaAllocator(const ArenaAllocator &) = delete;
+  ArenaAllocator &operator=(const ArenaAllocator &) = delete;
+
+  /// Allocate \p NumBytes of zero-initialized memory.
+  /// \param NumBytes  Size of the requested allocation.
+  /// \returns Pointer to memory that lives until the next reset.
+  void *allocate(size_t NumBytes);
+
+  /// \brief Arrange for the destructor of \p Object to run on reset.
+  ///
+  /// \p Object must live in memory allocated from this arena.
+  /// \returns \p Object, for convenience.
+  template <typename T> T *registerDestructor(T *Object) {
+    Destructors.emplace_back(Object, [](void *P) { ((T *)P)->~T(); });
+    return Object;
+  }
+
+  /// Run registered destructors and release all memory held by the arena.
+  void reset();
+
+  /// \name Statistics
+  //@{
+  /// \returns Bytes handed out since the last reset.
+  size_t getBytesAllocated() const { return Allocator.getBytesAllocated(); }
+  /// \returns Largest value of \p getBytesAllocated over the arena lifetime.
+  size_t getPeakBytesAllocated() const {
+    return std::max(PeakBytesAllocated, getBytesAllocated());
+  }
+  /// \returns Number of allocations since the last reset.
+  size_t getNumAllocations() const { return NumAllocations; }
+  /// \returns Number of chunks currently held by the arena.
+  size_t getNumChunks() const { return Allocator.GetNumSlabs(); }
+  //@}
+
+private:
+  llvm::BumpPtrAllocator Allocator;
+  std::vector<std::pair<void *, void (*)(void *)>> Destructors;
+  size_t PeakBytesAllocated;
+  size_t NumAllocations;
+};
+
 #endif // UTILITY_H
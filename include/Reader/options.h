@@ -37,6 +37,16 @@ enum class DumpLevel {
   VERBOSE  ///< Dump full LLVM IR and method summary.
 };
 
+/// \brief Addresses of the runtime's GC globals that an inline write
+/// barrier reads.
+struct WriteBarrierGlobals {
+  uint64_t LowestAddress;  ///< Address of the GC heap's lowest address.
+  uint64_t HighestAddress; ///< Address of the GC heap's highest address.
+  uint64_t EphemeralLow;   ///< Address of the start of the ephemeral range.
+  uint64_t EphemeralHigh;  ///< Address of the end of the ephemeral range.
+  uint64_t CardTable;      ///< Address of the card table pointer.
+};
+
 // Macro to determine the default behavior of automatically
 // detecting tail calls (without the "tail." opcode in MSIL).
 #define DEFAULT_TAIL_CALL_OPT 1
@@ -54,6 +64,26 @@ struct Options {
   bool UseConservativeGC;   ///< True if the environment is set to use CGC.
   bool DoInsertStatepoints; ///< True if the environment calls for statepoints.
   bool DoTailCallOpt;       ///< Tail call optimization.
+  bool DoInlining;          ///< Inline small callees in the reader.
+  bool DoImplicitNullCheck; ///< Let loads fault instead of null checks.
+  bool DoClassInstrument;  ///< Count receiver classes at virtual calls.
+  bool DoGuardedDevirt;    ///< Guard direct calls to profiled classes.
+  bool DoInlineAlloc;      ///< Bump-allocate small objects inline.
+  bool DoStackAllocation;  ///< Put objects that don't escape on the stack.
+  unsigned AllocContextOffset; ///< Offset of the allocation context in the
+                               ///< runtime thread, if DoInlineAlloc.
+  bool DoInlineWriteBarrier;   ///< Mark cards inline instead of calling the
+                               ///< write barrier helpers.
+  ::WriteBarrierGlobals WriteBarrierGlobals; ///< GC globals the inline write
+                                             ///< barrier reads, if
+                                             ///< DoInlineWriteBarrier.
+  uint32_t CastCacheExcludeFlags; ///< Method table flags of classes that
+                                  ///< decide casts per object, whose
+                                  ///< casts to interfaces are not cached;
+                                  ///< zero not to cache them at all.
+  unsigned ParentMethodTableOffset; ///< Offset of the parent class in a
+                                    ///< method table, or zero not to check
+                                    ///< it inline.
   bool LogGcInfo;           ///< Generate GCInfo Translation logs
   bool ExecuteHandlers;     ///< Squelch handler suppression.
   bool DoSIMDIntrinsic;     ///< True if SIMD intrinsic is on.
@@ -586,6 +586,8 @@ private:
   bool NeedsNullCheck;                            ///< Is a null check needed.
   bool IsOptimizedDelegateCtor;                   ///< Is this an optimized.
                                                   ///< delegate constructor.
+  bool IsDevirtualized;                           ///< Is this a virtual call
+                                                  ///< made direct.
   bool IsReadonlyCall;                            ///< Is there a readonly
                                                   ///< prefix.
   CorInfoIntrinsics CorIntrinsicId;               ///< Intrinsic ID for method
@@ -609,6 +611,11 @@ private:
                                                   ///< secret parameter.
   IRNode *CallTargetNode;                         ///< Client IR for the call
                                                   ///< target.
+  IRNode *GuardClassNode;                         ///< Client IR for the
+                                                  ///< likely receiver class.
+  IRNode *GuardedCallTargetNode;                  ///< Client IR for the call
+                                                  ///< target when the
+                                                  ///< receiver has that class.
   ReaderCallSignature CallTargetSignature;        ///< Signature information for
                                                   ///< the call target.
 #if defined(_DEBUG)
@@ -693,6 +700,25 @@ public:
   /// \returns      Client IR node for the call target.
   IRNode *getCallTargetNode() { return CallTargetNode; }
 
+  /// \brief Get the client IR for the class a guarded direct call is made
+  /// for.
+  ///
+  /// If profiling shows that most receivers of a virtual call are of the
+  /// class that declares the target method, the client compares the
+  /// receiver's method table with this class handle, calls
+  /// \p getGuardedCallTargetNode directly if they match, and makes the
+  /// virtual call through \p getCallTargetNode otherwise.
+  ///
+  /// \returns      Client IR node for the class handle, or nullptr if the
+  ///               call is not guarded.
+  IRNode *getGuardClassNode() { return GuardClassNode; }
+
+  /// \brief Get the client IR for the target of a guarded direct call.
+  ///
+  /// \returns      Client IR node for the direct call target, or nullptr if
+  ///               the call is not guarded.
+  IRNode *getGuardedCallTargetNode() { return GuardedCallTargetNode; }
+
   /// \brief Get the class attributes for the call target method's class.
   ///
   /// Gets the target method's class attributes as reported by the CoreCLR EE.
@@ -856,6 +882,15 @@ public:
   /// \returns           True if so, false otherwise.
   bool isOptimizedDelegateCtor() { return IsOptimizedDelegateCtor; }
 
+  /// \brief Check if this virtual call was made a direct call.
+  ///
+  /// The reader makes a virtual call a direct call to the target method if
+  /// it knows that the target is what the receiver's class uses for the
+  /// method.
+  ///
+  /// \returns           True if so, false otherwise.
+  bool isDevirtualized() { return IsDevirtualized; }
+
   /// \brief Check if this call had a readonly prefix.
   ///
   /// The \p ldelema opcode may be implemented via a helper call. It can
@@ -920,7 +955,8 @@ public:
   ///
   /// \returns Method handle for the call target, or nullptr.
   CORINFO_METHOD_HANDLE getKnownMethodHandle() {
-    if (IsCallI || !IsCallInfoValid || (CallInfo.kind != CORINFO_CALL))
+    if (IsCallI || !IsCallInfoValid ||
+        ((CallInfo.kind != CORINFO_CALL) && !IsDevirtualized))
       return nullptr;
     return TargetMethodHandle;
   }
@@ -1335,6 +1371,23 @@ public:
   /// True if this method takes a local or argument's address.
   bool HasAddressTaken;
 
+  /// Locals the method's MSIL stores to.
+  ReaderBitVector *StoredLocals;
+
+  /// Locals the method's MSIL stores to more than once, or whose address it
+  /// takes.
+  ReaderBitVector *ReassignedLocals;
+
+  /// \brief Check whether the method's MSIL stores to a local just once and
+  /// never takes its address.
+  ///
+  /// Such a local only ever holds its initial zero value or the one value
+  /// stored to it.
+  ///
+  /// \param LocalOrdinal MSIL number of the local.
+  /// \returns True if the local is assigned just once.
+  bool isSingleAssignmentLocal(uint32_t LocalOrdinal);
+
   /// The current instruction's IL offset.
   uint32_t CurrInstrOffset;
 
@@ -1376,7 +1429,8 @@ protected:
   // Compiling with this set to false isn't really supported (the generated IR
   // would not have sufficient EH annotations), but it is provided as a mock
   // configuration flag to facilitate experimenting with what the IR/codegen
-  // could look like with null checks folded onto loads/stores.
+  // could look like with null checks folded onto loads/stores. Codegen can
+  // still fold the explicit checks into loads; see DoImplicitNullCheck.
   static const bool UseExplicitNullChecks = true;
 
   // \brief Indicates that divide-by-zero checks use explicit compare+branch IR
@@ -1590,7 +1644,48 @@ public:
   /// \returns true if simd intrinsic opt is enabled.
   virtual bool doSimdIntrinsicOpt() = 0;
 
+  /// \brief Check options as to whether to remove boxes whose value the
+  /// following MSIL only unboxes or tests.
+  ///
+  /// Derived class will provide an implementation that is correct for the
+  /// client.
+  ///
+  /// \returns true if box removal is enabled.
+  virtual bool doBoxOpt() = 0;
+
+  /// \brief Note that the reader did not allocate a box.
+  ///
+  /// Called each time \p box removes a box, so the client can count them.
+  ///
+  /// \param Class The value class that was not boxed.
+  virtual void boxRemoved(CORINFO_CLASS_HANDLE Class) = 0;
+
 private:
+  /// \brief Try to read a box and the MSIL using it without allocating
+  /// the box.
+  ///
+  /// The box of a value class other than \p Nullable<T> is never null, and
+  /// its class is exactly the value's class. So
+  /// - <tt>box T; unbox.any T</tt> leaves the value itself,
+  /// - <tt>box T; brtrue</tt> and <tt>box T; brfalse</tt> test a non-zero
+  ///   constant, and
+  /// - <tt>box T; isinst C; brtrue</tt> and <tt>box T; isinst C;
+  ///   brfalse</tt> test a constant that is non-zero if \p T can be cast
+  ///   to \p C.
+  ///
+  /// Instructions after the box are only considered if they are in the same
+  /// block, so no branch can reach them with some other value.
+  ///
+  /// \param ResolvedToken    The resolved token of the box.
+  /// \param Value            The value being boxed.
+  /// \param NextOffset [in]  Offset of the instruction after the box.
+  ///                   [out] Offset of the next instruction to read.
+  ///
+  /// \returns The node to push in place of the box, or nullptr if the box
+  /// is needed.
+  IRNode *removeBox(CORINFO_RESOLVED_TOKEN *ResolvedToken, IRNode *Value,
+                    uint32_t *NextOffset);
+
   /// \brief Determine if a call instruction is a candidate to be a tail call.
   ///
   /// The client may decide to give special tail-call treatment to calls that
@@ -2292,6 +2387,34 @@ private:
   IRNode *rdrGetVirtualTableCallTarget(ReaderCallTargetData *CallTargetData,
                                        IRNode **ThisPointer);
 
+  /// \brief Check whether a virtual call can be made a direct call to the
+  /// method its token resolved to.
+  ///
+  /// This is so if the method is final or its class is sealed, or if the
+  /// receiver's class is known and declares the method. The receiver's class
+  /// is known if \p getExactClass knows it, or if the receiver's static type
+  /// is a sealed class.
+  ///
+  /// \param CallTargetData Data about the call.
+  /// \param ThisArg        The receiver of the call.
+  /// \returns True if the call can be made direct.
+  bool rdrCanDevirtualize(ReaderCallTargetData *CallTargetData,
+                          IRNode *ThisArg);
+
+  /// \brief Check whether a virtual call can be guarded by a check of the
+  /// receiver's class, and made directly to the method its token resolved
+  /// to if the check passes.
+  ///
+  /// This is so if the method is declared by a class whose instances all
+  /// share one method table, and \p isLikelyReceiverClass says most
+  /// receivers at the call are of that class.
+  ///
+  /// \param CallTargetData Data about the call.
+  /// \param ThisArg        The receiver of the call.
+  /// \returns True if the call can be guarded.
+  bool rdrCanGuardDevirtualize(ReaderCallTargetData *CallTargetData,
+                               IRNode *ThisArg);
+
   // Delegate invoke and delegate construct optimizations
   bool rdrCallIsDelegateInvoke(ReaderCallTargetData *CallTargetData);
   bool rdrCallIsDelegateConstruct(ReaderCallTargetData *CallTargetData);
@@ -3010,10 +3133,12 @@ public:
   virtual bool generateDebugInfo() { return false; }
   virtual bool generateDebugEnC() { return false; }
 
-  // Allocate temporary (Reader lifetime) memory
+  // Allocate zeroed temporary (Reader lifetime) memory. The client owns
+  // this memory and releases it once reading completes; the reader never
+  // frees it.
   virtual void *getTempMemory(size_t Bytes) = 0;
 
-  // Allocate procedure-lifetime memory
+  // Allocate zeroed procedure-lifetime memory, also owned by the client.
   virtual void *getProcMemory(size_t Bytes) = 0;
 
   virtual EHRegion *rgnAllocateRegion() = 0;
@@ -3240,6 +3365,15 @@ public:
   virtual IRNode *convertToBoxHelperArgumentType(IRNode *Opr,
                                                  uint32_t DestSize) = 0;
 
+  /// Converts the operand to the value that unboxing a box of it would
+  /// leave on the stack, narrowing it to the box type as the box would.
+  ///
+  /// \param Opr   Operand that would be boxed.
+  /// \param Class Class of the box.
+  /// \returns     Converted operand
+  virtual IRNode *convertToUnboxedStackType(IRNode *Opr,
+                                            CORINFO_CLASS_HANDLE Class) = 0;
+
   virtual IRNode *genNullCheck(IRNode *Node) = 0;
 
   virtual void
@@ -3315,6 +3449,26 @@ public:
   /// \returns The class handle that corresponds to the type of the node.
   virtual CORINFO_CLASS_HANDLE inferThisClass(IRNode *ThisArgument) = 0;
 
+  /// \brief Get the exact class of the object the given IR node refers to,
+  ///        if it is known.
+  ///
+  /// The object may still be null.
+  ///
+  /// \param Node  The IR node that represents the object reference.
+  /// \returns The class handle of the object's exact class, or nullptr if
+  ///          it is not known.
+  virtual CORINFO_CLASS_HANDLE getExactClass(IRNode *Node) = 0;
+
+  /// \brief Check whether profiling shows that most receivers of the
+  ///        virtual call at the given offset are of the given class.
+  ///
+  /// \param MsilOffset  The MSIL offset of the call.
+  /// \param Class       The class that declares the called method.
+  /// \returns True if a direct call guarded by a check for \p Class is
+  ///          likely to be taken.
+  virtual bool isLikelyReceiverClass(uint32_t MsilOffset,
+                                     CORINFO_CLASS_HANDLE Class) = 0;
+
   // Called once region tree has been built.
   virtual void setEHInfo(EHRegion *EhRegionTree,
                          EHRegionList *EhRegionList) = 0;
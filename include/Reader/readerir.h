@@ -17,6 +17,7 @@
 #ifndef MSIL_READER_IR_H
 #define MSIL_READER_IR_H
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
@@ -27,6 +28,8 @@
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/IR/ValueMap.h"
 #include "GcInfo.h"
 #include "reader.h"
 #include "abi.h"
@@ -189,8 +192,9 @@ public:
   GenIR(LLILCJitContext *JitContext)
       : ReaderBase(JitContext->JitInfo, JitContext->MethodInfo,
                    JitContext->Flags),
-        UnmanagedCallFrame(nullptr), ThreadPointer(nullptr),
-        BuiltinObjectType(nullptr), ElementToArrayTypeMap() {
+        Function(nullptr), UnmanagedCallFrame(nullptr), ThreadPointer(nullptr),
+        AllocContext(nullptr), BuiltinObjectType(nullptr),
+        ElementToArrayTypeMap() {
     this->JitContext = JitContext;
     this->NameToHandleMap = &JitContext->NameToHandleMap;
     // Cache a few things from the per-thread state.
@@ -200,6 +204,7 @@ public:
     this->BoxedTypeMap = &State->BoxedTypeMap;
     this->ArrayTypeMap = &State->ArrayTypeMap;
     this->FieldIndexMap = &State->FieldIndexMap;
+    this->FieldAccessTagMap = &State->FieldAccessTagMap;
   }
 
   static bool isValidStackType(IRNode *Node);
@@ -468,6 +473,12 @@ public:
   // Called to instantiate an empty reader stack.
   ReaderStack *createStack() override;
 
+  /// \brief Allocate an operand stack in reader temporary memory.
+  ///
+  /// \param MaxStack Suggested capacity for the stack.
+  /// \returns The new, empty stack.
+  GenStack *allocateStack(uint32_t MaxStack);
+
   // Called when reader begins processing method.
   void readerPrePass(uint8_t *Buf, uint32_t NumBytes) override;
 
@@ -632,12 +643,124 @@ public:
   IRNode *genNewObjReturnNode(ReaderCallTargetData *CalLTargetData,
                               IRNode *ThisArg) override;
 
+  /// \brief Allocate an object by bumping the current thread's allocation
+  /// context, calling the allocation helper if the context is exhausted.
+  ///
+  /// The fast path makes no call, so no safepoint separates claiming the
+  /// space from storing the method table: the GC never sees the object
+  /// before it is well formed. The memory the allocation context hands out
+  /// is already zeroed.
+  ///
+  /// \param Size        Size of the object in the heap in bytes, a multiple
+  ///                    of the pointer size.
+  /// \param MethodTable Method table to store in the new object.
+  /// \param NumElements Length to store in the new array, or null if the
+  ///                    object is not an array.
+  /// \param ResultType  Type of the new object.
+  /// \param CallHelper  Emits the call to the allocation helper, at the
+  ///                    builder's insertion point, and returns its result.
+  /// \returns The new object, from either path.
+  llvm::Value *
+  genInlineAllocation(uint64_t Size, llvm::Value *MethodTable,
+                      llvm::Value *NumElements, llvm::Type *ResultType,
+                      llvm::function_ref<llvm::Value *()> CallHelper);
+
+  /// \brief Get the size in the heap of a new array if it may be allocated
+  /// inline.
+  ///
+  /// \param HelperId    The helper the EE would have the array allocated by.
+  /// \param ArrayTy     Type of the new array.
+  /// \param NumElements Number of elements in the new array.
+  /// \returns The size in bytes, or zero if the array must be allocated by
+  /// the helper.
+  uint64_t getInlineArraySize(CorInfoHelpFunc HelperId, llvm::Type *ArrayTy,
+                              llvm::Value *NumElements);
+
+  /// \brief Emit the checks that decide a cast inline when they can, before
+  /// falling back to the casting helper.
+  ///
+  /// Null is cast to null. Then the object's method table is compared with
+  /// the class cast to, with the class's parent, and with the method table
+  /// cached for the cast site, as asked for; a match casts the object. Any
+  /// other object goes to the helper.
+  ///
+  /// \param Object       The object to cast.
+  /// \param ClassHandle  Handle of the class cast to.
+  /// \param ResultType   Type of the result of the cast.
+  /// \param CheckExact   Compare the method table with \p ClassHandle.
+  /// \param MissIsNull   The class cast to is final, so an object that is
+  ///                     not exactly of that class is not an instance of it
+  ///                     and the result is null. Only set with \p CheckExact,
+  ///                     for isinst.
+  /// \param CheckParent  Compare the parent class in the method table with
+  ///                     \p ClassHandle.
+  /// \param CheckCache   Compare the method table with the one in a new
+  ///                     cache cell, which the helper's successful casts
+  ///                     update unless the object's class has any of the
+  ///                     options' CastCacheExcludeFlags.
+  /// \param CallHelper   Emits the call to the casting helper, at the
+  ///                     builder's insertion point, and returns its result.
+  /// \returns The result of the cast, from whichever path decides it.
+  llvm::Value *genInlineCast(llvm::Value *Object, llvm::Value *ClassHandle,
+                             llvm::Type *ResultType, bool CheckExact,
+                             bool MissIsNull, bool CheckParent,
+                             bool CheckCache,
+                             llvm::function_ref<llvm::Value *()> CallHelper);
+
+  /// \brief Get the address of the temporary holding the address of the
+  /// current thread's allocation context, loading it in the entry block
+  /// the first time it is asked for.
+  llvm::Value *getAllocContext();
+
   // Helper callback used by rdrCall to emit call code.
   IRNode *genCall(ReaderCallTargetData *CallTargetInfo, bool MayThrow,
                   std::vector<IRNode *> Args, IRNode **CallNode) override;
 
   bool canMakeDirectCall(ReaderCallTargetData *CallTargetData) override;
 
+  /// \brief Count the method table of the receiver of a virtual call in
+  /// the receiver class profile.
+  ///
+  /// \param CallTargetInfo Data about the call.
+  /// \param ThisArg        The receiver, which is not null.
+  void genReceiverClassProbe(ReaderCallTargetData *CallTargetInfo,
+                             llvm::Value *ThisArg);
+
+  /// \brief Emit a virtual call guarded by a check of the receiver's class.
+  ///
+  /// If the receiver's method table is the class handle from
+  /// \p getGuardClassNode, the call is made directly to the target from
+  /// \p getGuardedCallTargetNode, where the IR optimizer and the inliner
+  /// can see it. Otherwise it is made through \p VirtualTarget.
+  ///
+  /// \param CallTargetInfo Data about the call.
+  /// \param ABICallSig     The ABI signature of both calls.
+  /// \param VirtualTarget  The target of the virtual call.
+  /// \param MayThrow       True if the callee may throw.
+  /// \param Arguments      The arguments, the first being the receiver.
+  /// \param DirectCall [out]  The direct call instruction.
+  /// \param VirtualCall [out] The virtual call instruction.
+  /// \returns The result of whichever call is made.
+  llvm::Value *genGuardedCall(ReaderCallTargetData *CallTargetInfo,
+                              const ABICallSignature &ABICallSig,
+                              llvm::Value *VirtualTarget, bool MayThrow,
+                              llvm::ArrayRef<llvm::Value *> Arguments,
+                              llvm::Value **DirectCall,
+                              llvm::Value **VirtualCall);
+
+  /// \brief Get the name of \p Class as used to identify call sites in the
+  /// receiver class profile.
+  std::string getProfileClassName(CORINFO_CLASS_HANDLE Class);
+
+  /// \brief Get the name of the method being read as used to identify call
+  /// sites in the receiver class profile.
+  ///
+  /// Overloads share a name and instantiations a token, so the name is
+  /// made of the method's class with its instantiation, the method's name
+  /// and token, and its own instantiation, all of which are the same in
+  /// each process that loads the method.
+  const std::string &getProfileMethodName();
+
   // Generate call to helper
   IRNode *callHelper(CorInfoHelpFunc HelperID, bool MayThrow, IRNode *Dst,
                      IRNode *Arg1 = nullptr, IRNode *Arg2 = nullptr,
@@ -762,6 +885,9 @@ public:
   IRNode *convertToBoxHelperArgumentType(IRNode *Opr,
                                          uint32_t DestSize) override;
 
+  IRNode *convertToUnboxedStackType(IRNode *Opr,
+                                    CORINFO_CLASS_HANDLE Class) override;
+
   IRNode *makeBoxDstOperand(CORINFO_CLASS_HANDLE Class) override;
 
   IRNode *genNullCheck(IRNode *Node) override;
@@ -852,6 +978,11 @@ public:
 
   CORINFO_CLASS_HANDLE inferThisClass(IRNode *ThisArgument) override;
 
+  CORINFO_CLASS_HANDLE getExactClass(IRNode *Node) override;
+
+  bool isLikelyReceiverClass(uint32_t MsilOffset,
+                             CORINFO_CLASS_HANDLE Class) override;
+
   // Called once region tree has been built.
   void setEHInfo(EHRegion *EhRegionTree, EHRegionList *EhRegionList) override;
 
@@ -997,19 +1128,23 @@ private:
   /// \param AlignmentPrefix Alignment of the value.
   /// \param IsVolatile true iff the load is volatile.
   /// \param AddressMayBeNull true iff the address may be null.
+  /// \param AccessTag TBAA access tag for the load, if the value is not a
+  /// struct.
   /// \returns Value at the specified address.
   IRNode *loadAtAddress(IRNode *Address, llvm::Type *Ty, CorInfoType CorType,
                         CORINFO_RESOLVED_TOKEN *ResolvedToken,
                         ReaderAlignType AlignmentPrefix, bool IsVolatile,
-                        bool AddressMayBeNull = true);
+                        bool AddressMayBeNull = true,
+                        llvm::MDNode *AccessTag = nullptr);
 
   IRNode *loadAtAddressNonNull(IRNode *Address, llvm::Type *Ty,
                                CorInfoType CorType,
                                CORINFO_RESOLVED_TOKEN *ResolvedToken,
                                ReaderAlignType AlignmentPrefix,
-                               bool IsVolatile) {
+                               bool IsVolatile,
+                               llvm::MDNode *AccessTag = nullptr) {
     return loadAtAddress(Address, Ty, CorType, ResolvedToken, AlignmentPrefix,
-                         IsVolatile, false);
+                         IsVolatile, false, AccessTag);
   }
 
   IRNode *loadAtAddress(IRNode *Address, llvm::Type *Ty, CorInfoType CorType,
@@ -1036,18 +1171,22 @@ private:
   /// \param IsVolatile true iff the store is volatile.
   /// \param IsField true iff this is a field address.
   /// \param AddressMayBeNull true iff the address may be null.
+  /// \param AccessTag TBAA access tag for the store, if the value is not a
+  /// struct.
   void storeAtAddress(IRNode *Address, IRNode *ValueToStore, llvm::Type *Ty,
                       CORINFO_RESOLVED_TOKEN *ResolvedToken,
                       ReaderAlignType AlignmentPrefix, bool IsVolatile,
-                      bool IsField, bool AddressMayBeNull);
+                      bool IsField, bool AddressMayBeNull,
+                      llvm::MDNode *AccessTag = nullptr);
 
   void storeAtAddressNonNull(IRNode *Address, IRNode *ValueToStore,
                              llvm::Type *Ty,
                              CORINFO_RESOLVED_TOKEN *ResolvedToken,
                              ReaderAlignType AlignmentPrefix, bool IsVolatile,
-                             bool IsField) {
+                             bool IsField, llvm::MDNode *AccessTag = nullptr) {
     return storeAtAddress(Address, ValueToStore, Ty, ResolvedToken,
-                          AlignmentPrefix, IsVolatile, IsField, false);
+                          AlignmentPrefix, IsVolatile, IsField, false,
+                          AccessTag);
   }
 
   /// Generate instructions for storing value of the specified type at the
@@ -1151,6 +1290,15 @@ private:
   /// \param Call - The call/invoke to annotate.
   void markGCLeaf(llvm::CallSite Call);
 
+  /// Annotate the given call/invoke as returning a non-null pointer, as
+  /// the allocation helpers do.
+  ///
+  /// \param Call - The call/invoke to annotate.
+  /// \param DereferenceableBytes - If nonzero, the number of bytes known to
+  /// be dereferenceable at the returned pointer.
+  void markNonNullResult(llvm::CallSite Call,
+                         uint64_t DereferenceableBytes = 0);
+
   /// \brief Insert a PHI to merge two values
   ///
   /// Create a \p PHINode in \p JoinBlock to merge \p Arg1 and \p Arg2.
@@ -1291,18 +1439,43 @@ private:
   llvm::PointerType *getUnmanagedPointerType(llvm::Type *ElementType);
 
   llvm::StoreInst *makeStore(llvm::Value *ValueToStore, llvm::Value *Address,
-                             bool IsVolatile, bool AddressMayBeNull = true);
+                             bool IsVolatile, bool AddressMayBeNull = true,
+                             llvm::MDNode *AccessTag = nullptr);
   llvm::StoreInst *makeStoreNonNull(llvm::Value *ValueToStore,
                                     llvm::Value *Address, bool IsVolatile) {
     return makeStore(ValueToStore, Address, IsVolatile, false);
   }
 
   llvm::LoadInst *makeLoad(llvm::Value *Address, bool IsVolatile,
-                           bool AddressMayBeNull = true);
+                           bool AddressMayBeNull = true,
+                           llvm::MDNode *AccessTag = nullptr);
   llvm::LoadInst *makeLoadNonNull(llvm::Value *Address, bool IsVolatile) {
     return makeLoad(Address, IsVolatile, false);
   }
 
+  /// \brief Get the TBAA access tag for memory of the kind named \p Name.
+  ///
+  /// Tagged loads and stores only alias those with the same tag, or with
+  /// none; untagged ones may alias anything.
+  llvm::MDNode *getAccessTag(const llvm::Twine &Name);
+
+  /// \brief Get the TBAA access tag for loads and stores of the instance
+  /// field \p Field, or null if they must not be tagged.
+  ///
+  /// Only fields of reference types without overlapping fields are tagged.
+  /// A field of a value type can be accessed through a byref to storage
+  /// that is also accessed as something else, such as an int[] element
+  /// accessed as the m_value field of an Int32.
+  llvm::MDNode *getFieldAccessTag(CORINFO_FIELD_HANDLE Field);
+
+  /// \brief Get the TBAA access tag for loads and stores of array elements
+  /// of type \p ElementTy, or null if they must not be tagged.
+  ///
+  /// Arrays of primitives of the same size can be cast to one another, as
+  /// can arrays of references, so elements are only told apart by size and
+  /// by whether they are references.
+  llvm::MDNode *getArrayElementAccessTag(llvm::Type *ElementTy);
+
   /// \brief Create a call or invoke instruction
   ///
   /// The call is inserted at the LLVMBuilder's current insertion point.
@@ -1466,6 +1639,42 @@ private:
   /// insertion phase.
   void createSafepointPoll();
 
+  /// \brief Inline the profitable calls recorded while reading.
+  ///
+  /// Run once the whole method has been read, so that the calls can be
+  /// weighed by where they are in the flow graph, and before the stack
+  /// slots of the method are zero-initialized and escaped, so that those of
+  /// the inlinees are handled along with them.
+  void inlineCalls();
+
+  /// \brief Inline one call if it is within the budget and the inlinee can
+  /// be read and merged into this method.
+  ///
+  /// \param Call     The call to inline.
+  /// \param Method   The method called.
+  /// \param IsInLoop True if the call is in a loop.
+  /// \param Budget   IL bytes left to inline; reduced if the call is inlined.
+  /// \param Result   [out] The outcome to report to the EE.
+  /// \returns The reason for the outcome.
+  const char *inlineCall(llvm::CallSite Call, CORINFO_METHOD_HANDLE Method,
+                         bool IsInLoop, uint32_t &Budget,
+                         CorInfoInline &Result);
+
+  /// \brief Report an inlining decision to the EE.
+  ///
+  /// \param Method The method called.
+  /// \param Result The outcome.
+  /// \param Reason Why that was the outcome.
+  void reportInlineDecision(CORINFO_METHOD_HANDLE Method,
+                            CorInfoInline Result, const char *Reason);
+
+  /// \brief Determine whether the EE asked for debug info.
+  ///
+  /// \returns true if variable homes should be tracked and DWARF emitted.
+  bool emitDebugInfo() const {
+    return (JitContext->Flags & CORJIT_FLG_DEBUG_INFO) != 0;
+  }
+
   /// \brief Override of doTailCallOpt method
   /// Provides client specific Options look up.
   bool doTailCallOpt() override;
@@ -1474,6 +1683,14 @@ private:
   /// Provides client specific Options look up.
   bool doSimdIntrinsicOpt() override;
 
+  /// \brief Override of doBoxOpt method
+  /// Provides client specific Options look up.
+  bool doBoxOpt() override;
+
+  /// \brief Override of boxRemoved method
+  /// Counts the box in the jit context's statistics.
+  void boxRemoved(CORINFO_CLASS_HANDLE Class) override;
+
   /// If isZeroInitLocals() returns true, zero intitialize all locals;
   /// otherwise, zero initialize all gc pointers and structs with gc pointers.
   void zeroInitLocals();
@@ -1481,6 +1698,26 @@ private:
   /// Zero initialize a stack allocation
   void zeroInit(llvm::Value *Var);
 
+  /// \brief Hold the scalar locals and arguments that are only loaded and
+  /// stored in SSA values rather than stack slots, when optimizing.
+  ///
+  /// This is done once the method is read, so that the loads and stores
+  /// are known for each variable, and the flow graph is complete despite
+  /// the blocks added while reading. GC pointers so held are reported at
+  /// safepoints rather than as untracked stack slots that live throughout
+  /// the method, which kept them from being promoted by later passes.
+  /// Variables whose address is taken, pinned locals and special symbols
+  /// stay in memory, as do all those of methods with exception handlers.
+  void promoteLocals();
+
+  /// Get the execution count the method's profile gives for the IL at
+  /// \p Offset, which is that of the profiled block containing it.
+  ///
+  /// \param Offset  IL offset to look up.
+  /// \param Count   [out] Times the IL at \p Offset ran in the profile.
+  /// \returns True iff the method has a profile covering \p Offset.
+  bool getProfileCount(uint32_t Offset, uint32_t &Count);
+
   /// Zero initialize the block.
   ///
   /// \param Address Address of the block.
@@ -1767,6 +2004,7 @@ private:
   std::map<std::tuple<CorInfoType, CORINFO_CLASS_HANDLE, uint32_t, bool>,
            llvm::Type *> *ArrayTypeMap;
   std::map<CORINFO_FIELD_HANDLE, uint32_t> *FieldIndexMap;
+  std::map<CORINFO_FIELD_HANDLE, llvm::MDNode *> *FieldAccessTagMap;
   llvm::StringMap<uint64_t> *NameToHandleMap; ///< Map from GlobalObject names
                                               ///< to handles corresponding to
                                               ///< those GlobalObjects.
@@ -1780,6 +2018,9 @@ private:
   llvm::Value *ThreadPointer;      ///< If the method contains unmanaged calls,
                                    ///< this is the address of the pointer to
                                    ///< the runtime thread.
+  llvm::Value *AllocContext;       ///< If the method allocates inline, this
+                                   ///< is the address of the pointer to the
+                                   ///< thread's allocation context.
   std::vector<CorInfoType> LocalVarCorTypes;
   std::vector<llvm::Value *> Arguments;
   llvm::Value *IndirectResult;
@@ -1802,6 +2043,30 @@ private:
   bool NeedsSecurityObject;
   bool DoneBuildingFlowGraph;
   llvm::BasicBlock *EntryBlock;
+
+  /// \brief A direct call that may be inlined once the method is read.
+  struct InlineCandidate {
+    llvm::WeakVH Call;            ///< The call; null if it was removed.
+    CORINFO_METHOD_HANDLE Method; ///< The method called.
+    bool IsNeverRun;              ///< The profile shows the call never ran.
+  };
+  std::vector<InlineCandidate> InlineCandidates;
+
+  /// Name of the method in the receiver class profile, once needed.
+  std::string ProfileMethodName;
+
+  /// \brief IL offsets of the blocks in the method's profile, in order, with
+  /// the number of times each ran. Empty if the method has no profile.
+  std::vector<std::pair<uint32_t, uint32_t>> ProfileCounts;
+
+  /// \brief Map from object references whose exact class is known, such as
+  /// those newobj allocates, to that class.
+  llvm::ValueMap<llvm::Value *, CORINFO_CLASS_HANDLE> ExactClassMap;
+
+  /// \brief Map from single-assignment locals to the exact class of the
+  /// object stored in them.
+  std::map<uint32_t, CORINFO_CLASS_HANDLE> LocalExactClassMap;
+
   llvm::Instruction *AllocaInsertionPoint; ///< Position in the Prolog where
                                            ///< Alloca instructions should be
                                            ///< inserted after the
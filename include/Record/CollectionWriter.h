@@ -0,0 +1,123 @@
+//===-------------- include/Record/CollectionWriter.h -----------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the writer that appends records to a memory-mapped
+/// collection file from many threads at once.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef COLLECTION_WRITER_H
+#define COLLECTION_WRITER_H
+
+#include "JitRecord.h"
+#include "llvm/Support/FileSystem.h"
+#include <atomic>
+
+/// \brief The part of the collection a single thread is appending to.
+///
+/// Each writing thread owns one of these and passes it to every
+/// CollectionWriter call it makes, so threads never contend on anything
+/// but the occasional reservation of a fresh chunk.
+struct CollectionChunk {
+  CollectionChunk() : Next(0), End(0) {}
+
+  uint64_t Next; ///< Offset of the next free byte in the chunk.
+  uint64_t End;  ///< Offset just past the end of the chunk.
+};
+
+/// \brief Appends records to a collection file.
+///
+/// The file is created at its full capacity and mapped into memory; records
+/// are written straight into the mapping. Space is handed out in chunks by
+/// an atomic bump of the tail in the file header, so there is no lock on
+/// the write path. Blobs are interned through a fixed-size, lock-free hash
+/// table so each distinct string, signature or IL body is stored once.
+///
+/// When the file fills up, further records are dropped and counted; what
+/// was written remains a valid collection.
+class CollectionWriter {
+public:
+  /// \brief Create (or overwrite) the collection file at \p Path.
+  ///
+  /// \param Capacity   Maximum size of the file in bytes.
+  /// \param ChunkSize  Size of the chunks threads reserve at a time.
+  /// \returns The writer, or nullptr with \p Error set on failure.
+  static std::unique_ptr<CollectionWriter> create(llvm::StringRef Path,
+                                                  uint64_t Capacity,
+                                                  uint64_t ChunkSize,
+                                                  std::string &Error);
+
+  ~CollectionWriter();
+
+  /// \brief Get a new id for a compile request.
+  uint32_t allocateMethodId() { return NextMethodId.fetch_add(1) + 1; }
+
+  /// \brief Append a record.
+  ///
+  /// \returns The offset of the record, or zero if it was dropped.
+  uint64_t append(CollectionChunk &Chunk, RecordKind Kind, JitApi Api,
+                  uint32_t MethodId, llvm::StringRef Key,
+                  llvm::StringRef Value);
+
+  /// \brief Get a reference to a blob holding the given bytes, writing the
+  /// blob if it has not been seen before.
+  ///
+  /// \returns The blob reference, or zero if the blob was dropped.
+  uint64_t internBlob(CollectionChunk &Chunk, const void *Data, size_t Size);
+
+  /// \brief Check whether records are being dropped for lack of space.
+  bool isFull() const { return Full.load(std::memory_order_relaxed); }
+
+  /// \brief Get the number of records dropped for lack of space.
+  uint64_t getNumDropped() const {
+    return NumDropped.load(std::memory_order_relaxed);
+  }
+
+  /// \brief Get the number of blob writes avoided by interning.
+  uint64_t getNumBlobsShared() const {
+    return NumBlobsShared.load(std::memory_order_relaxed);
+  }
+
+private:
+  CollectionWriter(std::unique_ptr<llvm::sys::fs::mapped_file_region> Region,
+                   uint64_t Capacity, uint64_t ChunkSize);
+
+  /// \brief Reserve \p Size bytes from \p Chunk, refilling it if needed.
+  ///
+  /// \returns The offset of the space, or zero if the file is full.
+  uint64_t reserve(CollectionChunk &Chunk, uint64_t Size);
+
+  /// \brief Check whether the blob at \p Ref holds the given bytes.
+  bool blobMatches(uint64_t Ref, const void *Data, size_t Size) const;
+
+  /// \brief One slot of the blob intern table. A slot is claimed by setting
+  /// its hash; the reference is published once the blob is written.
+  struct InternSlot {
+    std::atomic<uint64_t> Hash;
+    std::atomic<uint64_t> Ref;
+  };
+
+  static const size_t InternTableSize = 1 << 18;
+  static const unsigned InternProbeLimit = 16;
+
+  std::unique_ptr<llvm::sys::fs::mapped_file_region> Region;
+  char *Base;
+  uint64_t Capacity;
+  uint64_t ChunkSize;
+  std::atomic<uint64_t> *Tail;
+  std::atomic<uint32_t> NextMethodId;
+  std::atomic<bool> Full;
+  std::atomic<uint64_t> NumDropped;
+  std::atomic<uint64_t> NumBlobsShared;
+  std::unique_ptr<InternSlot[]> InternTable;
+};
+
+#endif // COLLECTION_WRITER_H
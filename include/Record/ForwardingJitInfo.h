@@ -0,0 +1,34 @@
+//===-------------- include/Record/ForwardingJitInfo.h ----------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares an ICorJitInfo that passes every call through to another
+/// ICorJitInfo, as a base for wrappers that observe the JIT-EE traffic.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef FORWARDING_JIT_INFO_H
+#define FORWARDING_JIT_INFO_H
+
+/// \brief An ICorJitInfo where every method forwards to \p Inner. Derived
+/// classes override the methods they are interested in.
+class ForwardingJitInfo : public ICorJitInfo {
+public:
+  explicit ForwardingJitInfo(ICorJitInfo *Inner) : Inner(Inner) {}
+
+#define JITINTERFACE_METHOD(Ret, Name, Params, Args)                          \
+  Ret __stdcall Name Params override { return Inner->Name Args; }
+#include "JitInterface.def"
+
+protected:
+  ICorJitInfo *Inner;
+};
+
+#endif // FORWARDING_JIT_INFO_H
@@ -0,0 +1,366 @@
+//===----------------- include/Record/JitRecord.h ---------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares the on-disk format of a collection of recorded JIT-EE
+/// interactions, and the helpers used to write and read its records.
+///
+/// A collection is a header followed by a sequence of 8-byte aligned
+/// records. Every record starts with a CollectionRecordHeader that gives
+/// its total size, its kind, the ICorJitInfo method it describes (for
+/// queries), and the compile request it belongs to. The record payload is
+/// a key followed by a value:
+///
+/// - MethodBegin: no key; the value holds the compile flags, the
+///   CORINFO_METHOD_INFO passed to compileMethod and the method name.
+/// - Query: the key holds the inputs of one ICorJitInfo call and the value
+///   holds everything the EE handed back for them.
+/// - MethodEnd: no key; the value holds the result of the compile and a
+///   digest of the code the EE was given.
+/// - Blob: the key holds a hash and the length of the bytes in the value.
+///   Strings, IL and signatures are stored once as blobs and referenced
+///   from other records by the blob record's offset in the file.
+///
+/// Keys are built from the arguments of the call in parameter order:
+/// scalars and handles are stored by value, signatures and resolved tokens
+/// are stored by identity (see RecordBuilder::putKey), and pure out
+/// parameters are skipped. Values hold the return value, if any, followed
+/// by the out parameters in parameter order. The recorder and the replayer
+/// must build keys and values with the same RecordBuilder calls.
+///
+/// Collections hold raw EE handles and host-layout structures, so they can
+/// only be replayed on the architecture and CoreCLR version they were
+/// recorded with.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef JIT_RECORD_H
+#define JIT_RECORD_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/type_traits.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// \brief Identifies an ICorJitInfo method in a collection.
+enum class JitApi : uint16_t {
+#define JITINTERFACE_METHOD(Ret, Name, Params, Args) Name,
+#include "JitInterface.def"
+  Count
+};
+
+/// \brief Get the printable name of an ICorJitInfo method.
+const char *getJitApiName(JitApi Api);
+
+/// \brief The kinds of record that can appear in a collection.
+enum class RecordKind : uint16_t {
+  Padding = 0, ///< Unused or not yet committed space; skipped by readers.
+  Blob,        ///< Bytes shared between records.
+  MethodBegin, ///< Start of a compile request.
+  Query,       ///< One ICorJitInfo call made during a compile request.
+  MethodEnd    ///< End of a compile request.
+};
+
+/// \brief Header at the start of a collection file.
+struct CollectionFileHeader {
+  static const char MagicValue[8];
+  static const uint32_t CurrentVersion = 1;
+
+  char Magic[8];        ///< Always MagicValue.
+  uint32_t Version;     ///< Format version; CurrentVersion when written.
+  uint32_t PointerSize; ///< sizeof(void *) of the recording process.
+  uint64_t Tail;        ///< Offset just past the last reserved record.
+  uint64_t ChunkSize;   ///< Size of the chunks writers reserve, or zero.
+  uint64_t Reserved[4]; ///< Zero; pads the header to 64 bytes.
+};
+
+/// \brief Header at the start of every record.
+///
+/// Writers reserve a record, fill in everything but \p Kind, and then store
+/// \p Kind last. A record whose kind is still Padding has not been
+/// committed and is skipped by readers.
+///
+/// When the file header gives a chunk size, the space after the header is
+/// divided into chunks of that size that writers fill independently, and
+/// records never straddle a chunk boundary unless they are larger than a
+/// chunk. A zero record size marks the unused end of a chunk.
+struct CollectionRecordHeader {
+  uint32_t Size;     ///< Total size including this header; multiple of 8.
+  uint16_t Kind;     ///< A RecordKind.
+  uint16_t Api;      ///< A JitApi for Query records; zero otherwise.
+  uint32_t MethodId; ///< Compile request the record belongs to.
+  uint32_t KeySize;  ///< Bytes of key following this header.
+};
+
+/// All records start on a multiple of this alignment.
+const uint32_t RecordAlignment = 8;
+
+/// \brief Round \p Size up to the record alignment.
+inline uint64_t alignRecordSize(uint64_t Size) {
+  return (Size + RecordAlignment - 1) & ~uint64_t(RecordAlignment - 1);
+}
+
+/// \brief Compute the 64-bit FNV-1a hash of a byte range.
+uint64_t hashBytes(const void *Data, size_t Size, uint64_t Seed = 0);
+
+/// \brief Interface used by RecordBuilder to store shared byte ranges.
+class BlobInterner {
+public:
+  virtual ~BlobInterner() {}
+
+  /// \brief Return a reference to a blob record holding the given bytes.
+  ///
+  /// References are nonzero; zero always denotes a null pointer.
+  virtual uint64_t internBlob(const void *Data, size_t Size) = 0;
+};
+
+/// \brief Serializes the key or value of a record into a byte buffer.
+class RecordBuilder {
+public:
+  /// \brief Construct a builder.
+  ///
+  /// \param Interner   Storage for blobs. Only needed when building values
+  ///                   that contain strings, signatures or IL.
+  explicit RecordBuilder(BlobInterner *Interner = nullptr)
+      : Interner(Interner) {}
+
+  /// \brief Discard the contents built so far.
+  void clear() { Bytes.clear(); }
+
+  /// \brief Get the bytes built so far.
+  llvm::StringRef bytes() const {
+    return llvm::StringRef(Bytes.data(), Bytes.size());
+  }
+
+  /// \name Values
+  //@{
+
+  void putBytes(const void *Data, size_t Size) {
+    const char *Begin = static_cast<const char *>(Data);
+    Bytes.append(Begin, Begin + Size);
+  }
+
+  /// \brief Append a plain value (a scalar, a handle, or a structure with
+  /// no pointers that need to be followed) by copying its bytes.
+  template <typename T> void put(const T &Value) {
+    static_assert(llvm::isPodLike<T>::value,
+                  "Only plain values can be stored directly");
+    putBytes(&Value, sizeof(T));
+  }
+
+  /// \brief Append a reference to a copy of \p Size bytes at \p Data.
+  void putBlob(const void *Data, size_t Size);
+
+  /// \brief Append a reference to a copy of a nul-terminated string.
+  void putString(const char *String);
+
+  /// \brief Append a reference to a copy of a nul-terminated UTF-16 string.
+  void putString16(const char16_t *String);
+
+  void putSig(const CORINFO_SIG_INFO &Sig);
+  void putMethodInfo(const CORINFO_METHOD_INFO &Info);
+  void putResolvedToken(const CORINFO_RESOLVED_TOKEN &Token);
+  void putCallInfo(const CORINFO_CALL_INFO &Info);
+
+  //@}
+
+  /// \name Keys
+  //@{
+
+  template <typename T> void putKey(T Value) { put(Value); }
+
+  /// \brief Append the identity of a signature: its scope, token, shape,
+  /// and a hash of its bytes. The signature's pointers are not followed.
+  void putKey(CORINFO_SIG_INFO *Sig);
+
+  /// \brief Append the inputs of a token resolution: context, scope, token
+  /// and token kind.
+  void putKey(CORINFO_RESOLVED_TOKEN *Token);
+
+  /// \brief Append the contents of a nul-terminated string.
+  void putKey(const char *String);
+
+  void putKeys() {}
+
+  template <typename T, typename... Rest>
+  void putKeys(T First, Rest... Others) {
+    putKey(First);
+    putKeys(Others...);
+  }
+
+  //@}
+
+private:
+  BlobInterner *Interner;
+  llvm::SmallVector<char, 256> Bytes;
+};
+
+class CollectionReader;
+
+/// \brief Deserializes the key or value of a record written by a
+/// RecordBuilder. Pointers in the results refer to the collection, which
+/// must outlive them.
+class RecordCursor {
+public:
+  RecordCursor(const CollectionReader &Collection, llvm::StringRef Data)
+      : Collection(Collection), Data(Data) {}
+
+  /// \brief Check whether all bytes have been consumed.
+  bool empty() const { return Data.empty(); }
+
+  /// \brief Consume \p Size bytes and return a pointer to them.
+  const char *getBytes(size_t Size);
+
+  template <typename T> T get() {
+    static_assert(llvm::isPodLike<T>::value,
+                  "Only plain values can be read directly");
+    T Value;
+    std::memcpy(&Value, getBytes(sizeof(T)), sizeof(T));
+    return Value;
+  }
+
+  template <typename T> void get(T &Value) { Value = get<T>(); }
+
+  /// \brief Read a blob reference; returns an empty range for null.
+  llvm::ArrayRef<uint8_t> getBlob();
+
+  /// \brief Read a string reference; returns nullptr for null.
+  const char *getString();
+
+  /// \brief Read a UTF-16 string reference; returns nullptr for null.
+  const char16_t *getString16();
+
+  void getSig(CORINFO_SIG_INFO &Sig);
+  void getMethodInfo(CORINFO_METHOD_INFO &Info);
+  void getResolvedToken(CORINFO_RESOLVED_TOKEN &Token);
+  void getCallInfo(CORINFO_CALL_INFO &Info);
+
+private:
+  const CollectionReader &Collection;
+  llvm::StringRef Data;
+};
+
+/// \brief A compile request in a collection, along with the answers to the
+/// queries made while compiling it.
+struct CollectionMethod {
+  uint32_t Id;              ///< Recording-time request id.
+  uint32_t Flags;           ///< Flags passed to compileMethod.
+  CORINFO_METHOD_INFO Info; ///< Method info passed to compileMethod.
+  const char *Name;         ///< Printable method name; may be null.
+  bool HasResult;           ///< True if a MethodEnd record was found.
+  CorJitResult Result;      ///< Result of the recorded compile.
+  uint32_t CodeSize;        ///< Hot code size of the recorded compile.
+  uint64_t CodeHash;        ///< Digest of the recorded code and GC info.
+
+  /// Recorded query values, indexed by makeQueryKey.
+  llvm::StringMap<llvm::StringRef> Queries;
+
+  /// \brief Find the recorded value for a query.
+  ///
+  /// \returns true and sets \p Value if the query was recorded.
+  bool lookup(JitApi Api, llvm::StringRef Key, llvm::StringRef &Value) const;
+};
+
+/// \brief Build the map key used to index a query of \p Api with \p Key.
+std::string makeQueryKey(JitApi Api, llvm::StringRef Key);
+
+/// \brief Read-only view of a collection file.
+class CollectionReader {
+public:
+  /// \brief Map and index the collection at \p Path.
+  ///
+  /// \returns The reader, or nullptr with \p Error set on failure.
+  static std::unique_ptr<CollectionReader> open(llvm::StringRef Path,
+                                                std::string &Error);
+
+  /// \brief Get the compile requests in the order they started.
+  const std::vector<std::unique_ptr<CollectionMethod>> &methods() const {
+    return Methods;
+  }
+
+  /// \brief Get the bytes of the blob record at offset \p Ref.
+  llvm::ArrayRef<uint8_t> getBlob(uint64_t Ref) const;
+
+private:
+  CollectionReader(std::unique_ptr<llvm::MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  bool index(std::string &Error);
+
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+  std::vector<std::unique_ptr<CollectionMethod>> Methods;
+};
+
+/// \brief Computes a digest of the code and GC info a compile hands to the
+/// EE.
+///
+/// Fields patched by relocations are hashed by what they refer to (a
+/// section and offset, or an address outside the method) rather than by
+/// their contents, so the same code gets the same digest wherever it is
+/// placed. This lets digests taken in a live process be compared with
+/// digests taken during replay.
+class CodeDigest {
+public:
+  CodeDigest() : Sections(), GCInfo(nullptr), GCInfoSize(0) {}
+
+  /// \brief Note the blocks allocMem handed out.
+  void setCode(const uint8_t *HotCode, size_t HotCodeSize,
+               const uint8_t *ColdCode, size_t ColdCodeSize,
+               const uint8_t *ROData, size_t RODataSize);
+
+  /// \brief Note the block allocGCInfo handed out.
+  void setGCInfo(const uint8_t *Block, size_t Size) {
+    GCInfo = Block;
+    GCInfoSize = Size;
+  }
+
+  /// \brief Note a relocation reported through recordRelocation.
+  void addRelocation(const uint8_t *Location, const uint8_t *Target,
+                     uint16_t Type) {
+    Relocations.push_back({Location, Target, Type});
+  }
+
+  /// \brief Get the size of the hot code block.
+  size_t getHotCodeSize() const { return Sections[0].Size; }
+
+  /// \brief Compute the digest of everything noted so far.
+  uint64_t compute() const;
+
+private:
+  struct Section {
+    const uint8_t *Start;
+    size_t Size;
+  };
+
+  struct Relocation {
+    const uint8_t *Location;
+    const uint8_t *Target;
+    uint16_t Type;
+  };
+
+  /// \brief Find the section containing \p Address.
+  ///
+  /// \returns The section index plus one, or zero if none contains it.
+  unsigned locate(const uint8_t *Address, uint64_t &Offset) const;
+
+  Section Sections[3];
+  const uint8_t *GCInfo;
+  size_t GCInfoSize;
+  std::vector<Relocation> Relocations;
+};
+
+#endif // JIT_RECORD_H
@@ -0,0 +1,356 @@
+//===-------------- include/Record/RecordingJitInfo.h -----------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Declares an ICorJitInfo that records the jit's queries, and the
+/// EE's answers, into a collection while passing them through to the EE.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef RECORDING_JIT_INFO_H
+#define RECORDING_JIT_INFO_H
+
+#include "CollectionWriter.h"
+#include "ForwardingJitInfo.h"
+#include "llvm/ADT/DenseSet.h"
+
+/// \brief The ICorJitInfo handed to the jit while recording one compile
+/// request.
+///
+/// Every query the replayer can answer is forwarded to the EE and then
+/// written to the collection, keyed the same way ReplayJitInfo looks it up.
+/// A query asked again with the same key during the request is only
+/// written once. Strings, signatures and IL are interned by the writer, so
+/// they are stored once per collection however many methods use them.
+///
+/// The code, GC info and relocations the jit hands to the EE are digested
+/// so that replays can be checked against the recorded compile.
+class RecordingJitInfo : public ForwardingJitInfo, private BlobInterner {
+public:
+  /// \brief Start recording a compile request.
+  ///
+  /// Writes the request's MethodBegin record.
+  ///
+  /// \param Inner       The EE's ICorJitInfo.
+  /// \param Writer      Collection to record into.
+  /// \param Chunk       The calling thread's chunk of the collection.
+  /// \param MethodInfo  The method being compiled.
+  /// \param Flags       The CORJIT_FLG flags of the request.
+  RecordingJitInfo(ICorJitInfo *Inner, CollectionWriter &Writer,
+                   CollectionChunk &Chunk, CORINFO_METHOD_INFO *MethodInfo,
+                   UINT Flags);
+
+  /// \brief Finish recording; writes the request's MethodEnd record with
+  /// the result set by setResult.
+  ~RecordingJitInfo();
+
+  /// \brief Set the result the jit returns to the EE for this request.
+  void setResult(CorJitResult Result) { RequestResult = Result; }
+
+  /// \name ICorMethodInfo
+  //@{
+  DWORD __stdcall getMethodAttribs(CORINFO_METHOD_HANDLE ftn) override;
+  void __stdcall getMethodSig(CORINFO_METHOD_HANDLE ftn, CORINFO_SIG_INFO *sig,
+                              CORINFO_CLASS_HANDLE memberParent) override;
+  bool __stdcall getMethodInfo(CORINFO_METHOD_HANDLE ftn,
+                               CORINFO_METHOD_INFO *info) override;
+  CorInfoInline __stdcall canInline(CORINFO_METHOD_HANDLE callerHnd,
+                                    CORINFO_METHOD_HANDLE calleeHnd,
+                                    DWORD *pRestrictions) override;
+  bool __stdcall canTailCall(CORINFO_METHOD_HANDLE callerHnd,
+                             CORINFO_METHOD_HANDLE declaredCalleeHnd,
+                             CORINFO_METHOD_HANDLE exactCalleeHnd,
+                             bool fIsTailPrefix) override;
+  void __stdcall getEHinfo(CORINFO_METHOD_HANDLE ftn, unsigned EHnumber,
+                           CORINFO_EH_CLAUSE *clause) override;
+  CORINFO_CLASS_HANDLE __stdcall getMethodClass(
+      CORINFO_METHOD_HANDLE method) override;
+  void __stdcall getMethodVTableOffset(
+      CORINFO_METHOD_HANDLE method, unsigned *offsetOfIndirection,
+      unsigned *offsetAfterIndirection) override;
+  CorInfoIntrinsics __stdcall getIntrinsicID(
+      CORINFO_METHOD_HANDLE method) override;
+  bool __stdcall isInSIMDModule(CORINFO_CLASS_HANDLE classHnd) override;
+  BOOL __stdcall pInvokeMarshalingRequired(
+      CORINFO_METHOD_HANDLE method, CORINFO_SIG_INFO *callSiteSig) override;
+  BOOL __stdcall isDelegateCreationAllowed(
+      CORINFO_CLASS_HANDLE delegateHnd,
+      CORINFO_METHOD_HANDLE calleeHnd) override;
+  //@}
+
+  /// \name ICorModuleInfo
+  //@{
+  void __stdcall resolveToken(CORINFO_RESOLVED_TOKEN *pResolvedToken) override;
+  void __stdcall findSig(CORINFO_MODULE_HANDLE module, unsigned sigTOK,
+                         CORINFO_CONTEXT_HANDLE context,
+                         CORINFO_SIG_INFO *sig) override;
+  void __stdcall findCallSiteSig(CORINFO_MODULE_HANDLE module,
+                                 unsigned methTOK,
+                                 CORINFO_CONTEXT_HANDLE context,
+                                 CORINFO_SIG_INFO *sig) override;
+  CORINFO_CLASS_HANDLE __stdcall getTokenTypeAsHandle(
+      CORINFO_RESOLVED_TOKEN *pResolvedToken) override;
+  BOOL __stdcall isValidToken(CORINFO_MODULE_HANDLE module,
+                              unsigned metaTOK) override;
+  //@}
+
+  /// \name ICorClassInfo
+  //@{
+  CorInfoType __stdcall asCorInfoType(CORINFO_CLASS_HANDLE cls) override;
+  const char *__stdcall getClassName(CORINFO_CLASS_HANDLE cls) override;
+  int __stdcall appendClassName(WCHAR **ppBuf, int *pnBufLen,
+                                CORINFO_CLASS_HANDLE cls, BOOL fNamespace,
+                                BOOL fFullInst, BOOL fAssembly) override;
+  BOOL __stdcall isValueClass(CORINFO_CLASS_HANDLE cls) override;
+  BOOL __stdcall canInlineTypeCheckWithObjectVTable(
+      CORINFO_CLASS_HANDLE cls) override;
+  DWORD __stdcall getClassAttribs(CORINFO_CLASS_HANDLE cls) override;
+  BOOL __stdcall isStructRequiringStackAllocRetBuf(
+      CORINFO_CLASS_HANDLE cls) override;
+  size_t __stdcall getClassModuleIdForStatics(CORINFO_CLASS_HANDLE cls,
+                                              CORINFO_MODULE_HANDLE *pModule,
+                                              void **ppIndirection) override;
+  unsigned __stdcall getClassSize(CORINFO_CLASS_HANDLE cls) override;
+  unsigned __stdcall getClassAlignmentRequirement(
+      CORINFO_CLASS_HANDLE cls, BOOL fDoubleAlignHint) override;
+  unsigned __stdcall getClassGClayout(CORINFO_CLASS_HANDLE cls,
+                                      BYTE *gcPtrs) override;
+  unsigned __stdcall getClassNumInstanceFields(
+      CORINFO_CLASS_HANDLE cls) override;
+  CORINFO_FIELD_HANDLE __stdcall getFieldInClass(CORINFO_CLASS_HANDLE clsHnd,
+                                                 INT num) override;
+  BOOL __stdcall checkMethodModifier(CORINFO_METHOD_HANDLE hMethod,
+                                     LPCSTR modifier, BOOL fOptional) override;
+  CorInfoHelpFunc __stdcall getNewHelper(
+      CORINFO_RESOLVED_TOKEN *pResolvedToken,
+      CORINFO_METHOD_HANDLE callerHandle) override;
+  CorInfoHelpFunc __stdcall getNewArrHelper(
+      CORINFO_CLASS_HANDLE arrayCls) override;
+  CorInfoHelpFunc __stdcall getCastingHelper(
+      CORINFO_RESOLVED_TOKEN *pResolvedToken, bool fThrowing) override;
+  CorInfoHelpFunc __stdcall getSharedCCtorHelper(
+      CORINFO_CLASS_HANDLE clsHnd) override;
+  CorInfoHelpFunc __stdcall getSecurityPrologHelper(
+      CORINFO_METHOD_HANDLE ftn) override;
+  CORINFO_CLASS_HANDLE __stdcall getTypeForBox(
+      CORINFO_CLASS_HANDLE cls) override;
+  CorInfoHelpFunc __stdcall getBoxHelper(CORINFO_CLASS_HANDLE cls) override;
+  CorInfoHelpFunc __stdcall getUnBoxHelper(CORINFO_CLASS_HANDLE cls) override;
+  void __stdcall getReadyToRunHelper(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                                     CorInfoHelpFunc id,
+                                     CORINFO_CONST_LOOKUP *pLookup) override;
+  const char *__stdcall getHelperName(CorInfoHelpFunc helpFunc) override;
+  CorInfoInitClassResult __stdcall initClass(CORINFO_FIELD_HANDLE field,
+                                             CORINFO_METHOD_HANDLE method,
+                                             CORINFO_CONTEXT_HANDLE context,
+                                             BOOL speculative) override;
+  CORINFO_CLASS_HANDLE __stdcall getBuiltinClass(
+      CorInfoClassId classId) override;
+  CORINFO_CLASS_HANDLE __stdcall mergeClasses(
+      CORINFO_CLASS_HANDLE cls1, CORINFO_CLASS_HANDLE cls2) override;
+  CORINFO_CLASS_HANDLE __stdcall getParentType(
+      CORINFO_CLASS_HANDLE cls) override;
+  CorInfoType __stdcall getChildType(CORINFO_CLASS_HANDLE clsHnd,
+                                     CORINFO_CLASS_HANDLE *clsRet) override;
+  BOOL __stdcall isSDArray(CORINFO_CLASS_HANDLE cls) override;
+  unsigned __stdcall getArrayRank(CORINFO_CLASS_HANDLE cls) override;
+  CorInfoIsAccessAllowedResult __stdcall canAccessClass(
+      CORINFO_RESOLVED_TOKEN *pResolvedToken,
+      CORINFO_METHOD_HANDLE callerHandle,
+      CORINFO_HELPER_DESC *pAccessHelper) override;
+  //@}
+
+  /// \name ICorFieldInfo
+  //@{
+  const char *__stdcall getFieldName(CORINFO_FIELD_HANDLE ftn,
+                                     const char **moduleName) override;
+  CORINFO_CLASS_HANDLE __stdcall getFieldClass(
+      CORINFO_FIELD_HANDLE field) override;
+  CorInfoType __stdcall getFieldType(
+      CORINFO_FIELD_HANDLE field, CORINFO_CLASS_HANDLE *structType,
+      CORINFO_CLASS_HANDLE memberParent) override;
+  unsigned __stdcall getFieldOffset(CORINFO_FIELD_HANDLE field) override;
+  bool __stdcall isWriteBarrierHelperRequired(
+      CORINFO_FIELD_HANDLE field) override;
+  void __stdcall getFieldInfo(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                              CORINFO_METHOD_HANDLE callerHandle,
+                              CORINFO_ACCESS_FLAGS flags,
+                              CORINFO_FIELD_INFO *pResult) override;
+  //@}
+
+  /// \name ICorDebugInfo
+  //@{
+  void __stdcall getBoundaries(
+      CORINFO_METHOD_HANDLE ftn, unsigned int *cILOffsets, DWORD **pILOffsets,
+      ICorDebugInfo::BoundaryTypes *implictBoundaries) override;
+  //@}
+
+  /// \name ICorArgInfo
+  //@{
+  CORINFO_ARG_LIST_HANDLE __stdcall getArgNext(
+      CORINFO_ARG_LIST_HANDLE args) override;
+  CorInfoTypeWithMod __stdcall getArgType(
+      CORINFO_SIG_INFO *sig, CORINFO_ARG_LIST_HANDLE args,
+      CORINFO_CLASS_HANDLE *vcTypeRet) override;
+  CORINFO_CLASS_HANDLE __stdcall getArgClass(
+      CORINFO_SIG_INFO *sig, CORINFO_ARG_LIST_HANDLE args) override;
+  //@}
+
+  /// \name ICorStaticInfo
+  //@{
+  void __stdcall getEEInfo(CORINFO_EE_INFO *pEEInfoOut) override;
+  mdMethodDef __stdcall getMethodDefFromMethod(
+      CORINFO_METHOD_HANDLE hMethod) override;
+  const char *__stdcall getMethodName(CORINFO_METHOD_HANDLE ftn,
+                                      const char **moduleName) override;
+  unsigned __stdcall getMethodHash(CORINFO_METHOD_HANDLE ftn) override;
+  size_t __stdcall findNameOfToken(CORINFO_MODULE_HANDLE module,
+                                   mdToken metaTOK, char *szFQName,
+                                   size_t FQNameCapacity) override;
+  bool __stdcall getSystemVAmd64PassStructInRegisterDescriptor(
+      CORINFO_CLASS_HANDLE structHnd,
+      SYSTEMV_AMD64_CORINFO_STRUCT_REG_PASSING_DESCRIPTOR
+          *structPassInRegDescPtr) override;
+  //@}
+
+  /// \name ICorDynamicInfo
+  //@{
+  LONG *__stdcall getAddrOfCaptureThreadGlobal(void **ppIndirection) override;
+  void *__stdcall getHelperFtn(CorInfoHelpFunc ftnNum,
+                               void **ppIndirection) override;
+  void __stdcall getFunctionEntryPoint(
+      CORINFO_METHOD_HANDLE ftn, CORINFO_CONST_LOOKUP *pResult,
+      CORINFO_ACCESS_FLAGS accessFlags) override;
+  void __stdcall getFunctionFixedEntryPoint(
+      CORINFO_METHOD_HANDLE ftn, CORINFO_CONST_LOOKUP *pResult) override;
+  void *__stdcall getMethodSync(CORINFO_METHOD_HANDLE ftn,
+                                void **ppIndirection) override;
+  CORINFO_MODULE_HANDLE __stdcall embedModuleHandle(
+      CORINFO_MODULE_HANDLE handle, void **ppIndirection) override;
+  CORINFO_CLASS_HANDLE __stdcall embedClassHandle(
+      CORINFO_CLASS_HANDLE handle, void **ppIndirection) override;
+  CORINFO_METHOD_HANDLE __stdcall embedMethodHandle(
+      CORINFO_METHOD_HANDLE handle, void **ppIndirection) override;
+  CORINFO_FIELD_HANDLE __stdcall embedFieldHandle(
+      CORINFO_FIELD_HANDLE handle, void **ppIndirection) override;
+  void __stdcall embedGenericHandle(
+      CORINFO_RESOLVED_TOKEN *pResolvedToken, BOOL fEmbedParent,
+      CORINFO_GENERICHANDLE_RESULT *pResult) override;
+  CORINFO_LOOKUP_KIND __stdcall getLocationOfThisType(
+      CORINFO_METHOD_HANDLE context) override;
+  void *__stdcall getPInvokeUnmanagedTarget(CORINFO_METHOD_HANDLE method,
+                                            void **ppIndirection) override;
+  void *__stdcall getAddressOfPInvokeFixup(CORINFO_METHOD_HANDLE method,
+                                           void **ppIndirection) override;
+  LPVOID __stdcall GetCookieForPInvokeCalliSig(CORINFO_SIG_INFO *szMetaSig,
+                                               void **ppIndirection) override;
+  bool __stdcall canGetCookieForPInvokeCalliSig(
+      CORINFO_SIG_INFO *szMetaSig) override;
+  CORINFO_JUST_MY_CODE_HANDLE __stdcall getJustMyCodeHandle(
+      CORINFO_METHOD_HANDLE method,
+      CORINFO_JUST_MY_CODE_HANDLE **ppIndirection) override;
+  void __stdcall getCallInfo(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                             CORINFO_RESOLVED_TOKEN *pConstrainedResolvedToken,
+                             CORINFO_METHOD_HANDLE callerHandle,
+                             CORINFO_CALLINFO_FLAGS flags,
+                             CORINFO_CALL_INFO *pResult) override;
+  unsigned __stdcall getClassDomainID(CORINFO_CLASS_HANDLE cls,
+                                      void **ppIndirection) override;
+  void *__stdcall getFieldAddress(CORINFO_FIELD_HANDLE field,
+                                  void **ppIndirection) override;
+  CORINFO_VARARGS_HANDLE __stdcall getVarArgsHandle(
+      CORINFO_SIG_INFO *pSig, void **ppIndirection) override;
+  bool __stdcall canGetVarArgsHandle(CORINFO_SIG_INFO *pSig) override;
+  InfoAccessType __stdcall constructStringLiteral(CORINFO_MODULE_HANDLE module,
+                                                  mdToken metaTok,
+                                                  void **ppValue) override;
+  InfoAccessType __stdcall emptyStringLiteral(void **ppValue) override;
+  CORINFO_METHOD_HANDLE __stdcall GetDelegateCtor(
+      CORINFO_METHOD_HANDLE methHnd, CORINFO_CLASS_HANDLE clsHnd,
+      CORINFO_METHOD_HANDLE targetMethodHnd,
+      DelegateCtorArgs *pCtorData) override;
+  //@}
+
+  /// \name ICorJitInfo
+  //@{
+  void __stdcall allocMem(ULONG hotCodeSize, ULONG coldCodeSize,
+                          ULONG roDataSize, ULONG xcptnsCount,
+                          CorJitAllocMemFlag flag, void **hotCodeBlock,
+                          void **coldCodeBlock, void **roDataBlock) override;
+  void *__stdcall allocGCInfo(size_t size) override;
+  void __stdcall recordRelocation(void *location, void *target,
+                                  WORD fRelocType, WORD slotNum,
+                                  INT32 addlDelta) override;
+  //@}
+
+private:
+  uint64_t internBlob(const void *Data, size_t Size) override;
+
+  /// \brief Prepare to record the query \p Api with the given key
+  /// arguments.
+  ///
+  /// \returns true if the caller should put the query's value into
+  /// \p Value and call endQuery; false if the query has already been
+  /// recorded for this request or the collection is full.
+  template <typename... KeyTypes>
+  bool beginQuery(JitApi Api, KeyTypes... Keys) {
+    if (Writer.isFull()) {
+      return false;
+    }
+    Key.clear();
+    Key.putKeys(Keys...);
+    llvm::StringRef KeyBytes = Key.bytes();
+    uint64_t Hash = hashBytes(KeyBytes.data(), KeyBytes.size(),
+                              static_cast<uint64_t>(Api));
+    if (!Recorded.insert(Hash).second) {
+      return false;
+    }
+    Value.clear();
+    BlobDropped = false;
+    return true;
+  }
+
+  /// \brief Write the query started by beginQuery.
+  void endQuery(JitApi Api);
+
+  /// \brief Record a query whose value is just its result.
+  template <typename T, typename... KeyTypes>
+  T record(T Result, JitApi Api, KeyTypes... Keys) {
+    if (beginQuery(Api, Keys...)) {
+      Value.put(Result);
+      endQuery(Api);
+    }
+    return Result;
+  }
+
+  /// \brief Record a query whose value is a pointer result followed by its
+  /// indirection cell.
+  template <typename T, typename... KeyTypes>
+  T recordIndirectable(T Result, void **Cell, JitApi Api, KeyTypes... Keys) {
+    if (beginQuery(Api, Keys...)) {
+      Value.put(Result);
+      Value.put((Cell != nullptr) ? *Cell : (void *)nullptr);
+      endQuery(Api);
+    }
+    return Result;
+  }
+
+  CollectionWriter &Writer;
+  CollectionChunk &Chunk;
+  uint32_t MethodId;
+  CorJitResult RequestResult;
+  RecordBuilder Key;
+  RecordBuilder Value;
+  bool BlobDropped;
+  llvm::DenseSet<uint64_t> Recorded;
+  CodeDigest Digest;
+};
+
+#endif // RECORDING_JIT_INFO_H
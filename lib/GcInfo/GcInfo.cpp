@@ -152,6 +152,16 @@ GcFuncInfo *GcInfo::getGcInfo(const llvm::Function *F) {
   return GcFInfo;
 }
 
+void GcInfo::deleteGcInfo(const llvm::Function *F) {
+  auto Iterator = GcInfoMap.find(F);
+  if (Iterator == GcInfoMap.end()) {
+    return;
+  }
+
+  delete Iterator->second;
+  GcInfoMap.erase(Iterator);
+}
+
 //-------------------------------GcFuncInfo------------------------------------------
 
 GcFuncInfo::GcFuncInfo(const llvm::Function *F) {
@@ -0,0 +1,309 @@
+//===------------ lib/Jit/BoundsCheckElimination.cpp ------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the removal of array bounds checks that are
+/// known to succeed.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "LLILCJit.h"
+#include "BoundsCheckElimination.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <algorithm>
+
+using namespace llvm;
+
+namespace {
+
+/// \brief What is known about the array lengths and indices of a function.
+class RangeFacts {
+public:
+  RangeFacts(Function &F)
+      : DT(F),
+        ArrayLengthKind(F.getContext().getMDKindID("llilc.array.length")),
+        NewArrayKind(F.getContext().getMDKindID("llilc.new.array")) {}
+
+  /// \brief Check whether \p Index is below \p Length, treating both as
+  /// unsigned, whenever \p Block is reached.
+  bool isInRange(Value *Index, Value *Length, BasicBlock *Block);
+
+private:
+  /// \brief Get the array whose length \p Length is, or null if it is not
+  /// known to be an array length.
+  Value *getArrayOfLength(Value *Length);
+
+  /// \brief Get the value of \p Bound if it is a nonnegative constant or the
+  /// length of an array allocated with a constant length.
+  bool getConstantBound(Value *Bound, int64_t &Result);
+
+  /// \brief Check whether \p Bound is at most \p Length.
+  bool isBoundAtMost(Value *Bound, Value *Length);
+
+  /// \brief Check whether \p Index is at most \p Bound.
+  bool isIndexAtMost(Value *Index, Value *Bound);
+
+  /// \brief Check whether \p Candidate is nonnegative wherever \p Guard,
+  /// which is known to make it less than some other value, has been taken.
+  bool isNonNegative(Value *Candidate, const BasicBlockEdge &Guard);
+
+  DominatorTree DT;
+  unsigned ArrayLengthKind;
+  unsigned NewArrayKind;
+};
+
+} // namespace
+
+/// \brief Strip the zero extensions the reader makes of an index, which do
+/// not change its unsigned value.
+static Value *stripIndex(Value *Index) {
+  while (ZExtInst *Extend = dyn_cast<ZExtInst>(Index)) {
+    Index = Extend->getOperand(0);
+  }
+  return Index;
+}
+
+Value *RangeFacts::getArrayOfLength(Value *Length) {
+  if (!Length->getType()->isIntegerTy()) {
+    return nullptr;
+  }
+
+  // The length may have been widened and narrowed again, but not narrowed
+  // below the width of the field.
+  unsigned MinWidth = Length->getType()->getIntegerBitWidth();
+  while (isa<ZExtInst>(Length) || isa<TruncInst>(Length)) {
+    Length = cast<CastInst>(Length)->getOperand(0);
+    MinWidth = std::min(MinWidth, Length->getType()->getIntegerBitWidth());
+  }
+
+  LoadInst *Load = dyn_cast<LoadInst>(Length);
+  if ((Load == nullptr) || (Load->getMetadata(ArrayLengthKind) == nullptr) ||
+      (Load->getType()->getIntegerBitWidth() > MinWidth)) {
+    return nullptr;
+  }
+  GEPOperator *Address = dyn_cast<GEPOperator>(Load->getPointerOperand());
+  if (Address == nullptr) {
+    return nullptr;
+  }
+  return Address->getPointerOperand()->stripPointerCasts();
+}
+
+bool RangeFacts::getConstantBound(Value *Bound, int64_t &Result) {
+  if (ConstantInt *Constant = dyn_cast<ConstantInt>(Bound)) {
+    Result = Constant->getSExtValue();
+    return !Constant->isNegative();
+  }
+
+  // The reader tags a new array with its length if it is a constant.
+  Instruction *Array = dyn_cast_or_null<Instruction>(getArrayOfLength(Bound));
+  MDNode *NewArray =
+      (Array == nullptr) ? nullptr : Array->getMetadata(NewArrayKind);
+  if ((NewArray == nullptr) || (NewArray->getNumOperands() != 1)) {
+    return false;
+  }
+  ConstantInt *NumElements =
+      mdconst::dyn_extract<ConstantInt>(NewArray->getOperand(0));
+  if ((NumElements == nullptr) || NumElements->isNegative()) {
+    return false;
+  }
+  Result = NumElements->getSExtValue();
+  return true;
+}
+
+bool RangeFacts::isBoundAtMost(Value *Bound, Value *Length) {
+  if (Bound == Length) {
+    return true;
+  }
+  Value *Array = getArrayOfLength(Length);
+  if ((Array != nullptr) && (Array == getArrayOfLength(Bound))) {
+    return true;
+  }
+  int64_t BoundValue;
+  int64_t LengthValue;
+  return getConstantBound(Bound, BoundValue) &&
+         getConstantBound(Length, LengthValue) && (BoundValue <= LengthValue);
+}
+
+bool RangeFacts::isIndexAtMost(Value *Index, Value *Bound) {
+  Index = stripIndex(Index);
+  Bound = stripIndex(Bound);
+  if (Index == Bound) {
+    return true;
+  }
+  ConstantInt *IndexConstant = dyn_cast<ConstantInt>(Index);
+  ConstantInt *BoundConstant = dyn_cast<ConstantInt>(Bound);
+  return (IndexConstant != nullptr) && (BoundConstant != nullptr) &&
+         !IndexConstant->isNegative() && !BoundConstant->isNegative() &&
+         (IndexConstant->getSExtValue() <= BoundConstant->getSExtValue());
+}
+
+bool RangeFacts::isNonNegative(Value *Candidate,
+                               const BasicBlockEdge &Guard) {
+  if (isa<ZExtInst>(Candidate)) {
+    return true;
+  }
+  if (ConstantInt *Constant = dyn_cast<ConstantInt>(Candidate)) {
+    return !Constant->isNegative();
+  }
+
+  // Look for an induction variable that starts at a nonnegative constant
+  // and is only incremented by one after the guard has been taken. Since the
+  // guard uses the variable, every path from the loop header to an
+  // increment takes the guard, so the value incremented is below some other
+  // value; the increment cannot overflow, and the result is still
+  // nonnegative.
+  PHINode *Phi = dyn_cast<PHINode>(Candidate);
+  if (Phi == nullptr) {
+    return false;
+  }
+  for (unsigned I = 0; I < Phi->getNumIncomingValues(); ++I) {
+    Value *Incoming = Phi->getIncomingValue(I);
+    if (ConstantInt *Constant = dyn_cast<ConstantInt>(Incoming)) {
+      if (Constant->isNegative()) {
+        return false;
+      }
+      continue;
+    }
+    BinaryOperator *Increment = dyn_cast<BinaryOperator>(Incoming);
+    if ((Increment == nullptr) ||
+        (Increment->getOpcode() != Instruction::Add)) {
+      return false;
+    }
+    Value *Step = Increment->getOperand(1);
+    if (Increment->getOperand(0) != Phi) {
+      if (Step != Phi) {
+        return false;
+      }
+      Step = Increment->getOperand(0);
+    }
+    ConstantInt *StepConstant = dyn_cast<ConstantInt>(Step);
+    if ((StepConstant == nullptr) || !StepConstant->isOne() ||
+        !DT.dominates(Guard, Phi->getIncomingBlock(I))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RangeFacts::isInRange(Value *Index, Value *Length, BasicBlock *Block) {
+  // A constant index into an array allocated with a constant length.
+  ConstantInt *Constant = dyn_cast<ConstantInt>(stripIndex(Index));
+  int64_t LengthValue;
+  if ((Constant != nullptr) && !Constant->isNegative() &&
+      getConstantBound(Length, LengthValue) &&
+      (Constant->getSExtValue() < LengthValue)) {
+    return true;
+  }
+
+  // A dominating edge on which the index is known to be below the length,
+  // such as the in-range edge of an earlier check or a loop's exit test.
+  DomTreeNode *Node = DT.getNode(Block);
+  if (Node == nullptr) {
+    return false;
+  }
+  for (Node = Node->getIDom(); Node != nullptr; Node = Node->getIDom()) {
+    BasicBlock *Dominator = Node->getBlock();
+    BranchInst *Guard = dyn_cast<BranchInst>(Dominator->getTerminator());
+    if ((Guard == nullptr) || !Guard->isConditional()) {
+      continue;
+    }
+    ICmpInst *Compare = dyn_cast<ICmpInst>(Guard->getCondition());
+    if (Compare == nullptr) {
+      continue;
+    }
+    for (unsigned I = 0; I < 2; ++I) {
+      BasicBlockEdge Edge(Dominator, Guard->getSuccessor(I));
+      if (!DT.dominates(Edge, Block)) {
+        continue;
+      }
+
+      // The compare is true on the first edge and false on the second.
+      // Put it in the form Below < Above.
+      CmpInst::Predicate Predicate = (I == 0)
+                                         ? Compare->getPredicate()
+                                         : Compare->getInversePredicate();
+      Value *Below = Compare->getOperand(0);
+      Value *Above = Compare->getOperand(1);
+      if ((Predicate == CmpInst::ICMP_UGT) ||
+          (Predicate == CmpInst::ICMP_SGT)) {
+        std::swap(Below, Above);
+        Predicate = CmpInst::getSwappedPredicate(Predicate);
+      }
+
+      // A signed compare only bounds a value known to be nonnegative.
+      if ((Predicate != CmpInst::ICMP_ULT) &&
+          ((Predicate != CmpInst::ICMP_SLT) || !isNonNegative(Below, Edge))) {
+        continue;
+      }
+      if (isIndexAtMost(Index, Below) && isBoundAtMost(Above, Length)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+//-------------------------BoundsCheckElimination-----------------------------
+
+char BoundsCheckElimination::ID = 0;
+
+void BoundsCheckElimination::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesCFG();
+}
+
+bool BoundsCheckElimination::runOnFunction(Function &F) {
+  unsigned BoundsCheckKind = F.getContext().getMDKindID("llilc.bounds.check");
+  RangeFacts Facts(F);
+
+  // The reader branches to a throw block if the index is not below the
+  // length. Find the checks to remove before changing any, so that each is
+  // judged against the IR the reader made.
+  uint32_t NumChecks = 0;
+  std::vector<BranchInst *> Redundant;
+  for (BasicBlock &Block : F) {
+    BranchInst *Branch = dyn_cast<BranchInst>(Block.getTerminator());
+    if ((Branch == nullptr) || !Branch->isConditional()) {
+      continue;
+    }
+    ICmpInst *Check = dyn_cast<ICmpInst>(Branch->getCondition());
+    if ((Check == nullptr) ||
+        (Check->getMetadata(BoundsCheckKind) == nullptr) ||
+        (Check->getPredicate() != CmpInst::ICMP_UGE)) {
+      continue;
+    }
+    ++NumChecks;
+    if (Facts.isInRange(Check->getOperand(0), Check->getOperand(1), &Block)) {
+      Redundant.push_back(Branch);
+    }
+  }
+
+  for (BranchInst *Branch : Redundant) {
+    Value *Check = Branch->getCondition();
+    Branch->setCondition(ConstantInt::getFalse(F.getContext()));
+    RecursivelyDeleteTriviallyDeadInstructions(Check);
+  }
+
+  Context->NumBoundsChecksRemoved += Redundant.size();
+  if ((NumChecks != 0) &&
+      (Context->Options->DumpLevel == ::DumpLevel::VERBOSE)) {
+    dbgs() << "INFO:  removed " << Redundant.size() << " of " << NumChecks
+           << " bounds checks in " << F.getName() << "\n";
+  }
+  return !Redundant.empty();
+}
@@ -0,0 +1,229 @@
+//===------------- lib/Jit/ClassInitOptimization.cpp ------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the pass that hoists and removes redundant class
+/// initialization and static base helper calls.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "LLILCJit.h"
+#include "ClassInitOptimization.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+
+/// \brief Get the value a handle is computed from, if \p V is a cast of it
+/// or a load through it.
+///
+/// The reader embeds handles as constants, or loads them from the runtime's
+/// indirection cells, which do not change once the method runs. Other loads
+/// may read memory the method writes, so only loads marked invariant or
+/// made through a constant address count.
+static Value *getHandleSource(Value *V) {
+  if (CastInst *Cast = dyn_cast<CastInst>(V)) {
+    return Cast->getOperand(0);
+  }
+  LoadInst *Load = dyn_cast<LoadInst>(V);
+  if ((Load == nullptr) || Load->isVolatile()) {
+    return nullptr;
+  }
+  Value *Address = Load->getPointerOperand();
+  if ((Load->getMetadata(LLVMContext::MD_invariant_load) == nullptr) &&
+      !isa<Constant>(Address)) {
+    return nullptr;
+  }
+  return Address;
+}
+
+/// \brief Get the address of the helper \p Call calls.
+static Value *getTarget(CallInst *Call) {
+  Value *Target = Call->getCalledValue();
+  if (Operator::getOpcode(Target) == Instruction::IntToPtr) {
+    return cast<User>(Target)->getOperand(0);
+  }
+  return Target;
+}
+
+/// \brief Check whether \p A and \p B are the same handle.
+static bool isSameHandle(Value *A, Value *B) {
+  while (A != B) {
+    Instruction *InstrA = dyn_cast<Instruction>(A);
+    Instruction *InstrB = dyn_cast<Instruction>(B);
+    if ((InstrA == nullptr) || (InstrB == nullptr) ||
+        (InstrA->getOpcode() != InstrB->getOpcode()) ||
+        (InstrA->getType() != InstrB->getType())) {
+      return false;
+    }
+    A = getHandleSource(InstrA);
+    B = getHandleSource(InstrB);
+    if ((A == nullptr) || (B == nullptr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// \brief Check whether \p A and \p B call the same helper with the same
+/// arguments.
+static bool isSameCall(CallInst *A, CallInst *B) {
+  if ((A->getNumArgOperands() != B->getNumArgOperands()) ||
+      !isSameHandle(getTarget(A), getTarget(B))) {
+    return false;
+  }
+  for (unsigned I = 0; I < A->getNumArgOperands(); ++I) {
+    if (!isSameHandle(A->getArgOperand(I), B->getArgOperand(I))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// \brief Check whether handle \p V is defined outside loop \p L, or is
+/// computed in it from constants by instructions that may be moved out.
+static bool isInvariantHandle(Value *V, Loop *L) {
+  for (;;) {
+    Instruction *Instr = dyn_cast<Instruction>(V);
+    if ((Instr == nullptr) || !L->contains(Instr)) {
+      return true;
+    }
+    V = getHandleSource(Instr);
+    if (V == nullptr) {
+      return false;
+    }
+  }
+}
+
+/// \brief Move the instructions computing handle \p V in loop \p L before
+/// \p InsertPoint.
+static void hoistHandle(Value *V, Loop *L, Instruction *InsertPoint) {
+  Instruction *Instr = dyn_cast<Instruction>(V);
+  if ((Instr == nullptr) || !L->contains(Instr)) {
+    return;
+  }
+  hoistHandle(getHandleSource(Instr), L, InsertPoint);
+  Instr->moveBefore(InsertPoint);
+}
+
+/// \brief Check whether \p Call may be moved to the preheader of loop \p L.
+static bool canHoist(CallInst *Call, Loop *L, DominatorTree &DT) {
+  BasicBlock *Block = Call->getParent();
+  if ((L->getLoopPreheader() == nullptr) || !L->contains(Block)) {
+    return false;
+  }
+  SmallVector<BasicBlock *, 4> ExitingBlocks;
+  L->getExitingBlocks(ExitingBlocks);
+  for (BasicBlock *Exiting : ExitingBlocks) {
+    if (!DT.dominates(Block, Exiting)) {
+      return false;
+    }
+  }
+  if (!isInvariantHandle(Call->getCalledValue(), L)) {
+    return false;
+  }
+  for (Value *Argument : Call->arg_operands()) {
+    if (!isInvariantHandle(Argument, L)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//--------------------------ClassInitOptimization-----------------------------
+
+char ClassInitOptimization::ID = 0;
+
+void ClassInitOptimization::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.addRequired<DominatorTreeWrapperPass>();
+  AU.addRequired<LoopInfoWrapperPass>();
+  AU.setPreservesCFG();
+}
+
+bool ClassInitOptimization::runOnFunction(Function &F) {
+  unsigned ClassInitKind = F.getContext().getMDKindID("llilc.class.init");
+  DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+
+  SmallVector<CallInst *, 8> Calls;
+  for (BasicBlock &Block : F) {
+    for (Instruction &Instr : Block) {
+      CallInst *Call = dyn_cast<CallInst>(&Instr);
+      if ((Call != nullptr) && (Call->getMetadata(ClassInitKind) != nullptr)) {
+        Calls.push_back(Call);
+      }
+    }
+  }
+  if (Calls.empty()) {
+    return false;
+  }
+
+  // Move each call out of as many loops as it may leave, innermost first.
+  // The tag of a call that cannot run a constructor says so.
+  bool HasHandlers = F.hasPersonalityFn();
+  uint32_t NumHoisted = 0;
+  for (CallInst *Call : Calls) {
+    bool MayRunConstructor =
+        (Call->getMetadata(ClassInitKind)->getNumOperands() == 0);
+    if (HasHandlers && MayRunConstructor) {
+      continue;
+    }
+    bool IsHoisted = false;
+    for (Loop *L = LI.getLoopFor(Call->getParent());
+         (L != nullptr) && canHoist(Call, L, DT); L = L->getParentLoop()) {
+      Instruction *InsertPoint = L->getLoopPreheader()->getTerminator();
+      hoistHandle(Call->getCalledValue(), L, InsertPoint);
+      for (Value *Argument : Call->arg_operands()) {
+        hoistHandle(Argument, L, InsertPoint);
+      }
+      Call->moveBefore(InsertPoint);
+      IsHoisted = true;
+    }
+    if (IsHoisted) {
+      ++NumHoisted;
+    }
+  }
+
+  // Remove each call that repeats one that dominates it. A call whose
+  // result is used may only be replaced by one with a result of its type.
+  SmallPtrSet<CallInst *, 8> Removed;
+  for (CallInst *Call : Calls) {
+    for (CallInst *Other : Calls) {
+      if ((Other == Call) || Removed.count(Other) ||
+          (!Call->use_empty() && (Other->getType() != Call->getType())) ||
+          !isSameCall(Other, Call) || !DT.dominates(Other, Call)) {
+        continue;
+      }
+      Call->replaceAllUsesWith(Other);
+      Removed.insert(Call);
+      break;
+    }
+  }
+  for (CallInst *Call : Removed) {
+    Call->eraseFromParent();
+  }
+
+  if (Context->Options->DumpLevel == ::DumpLevel::VERBOSE) {
+    dbgs() << "INFO:  hoisted " << NumHoisted << " and removed "
+           << Removed.size() << " of " << Calls.size()
+           << " class initialization calls in " << F.getName() << "\n";
+  }
+  return (NumHoisted + Removed.size()) != 0;
+}
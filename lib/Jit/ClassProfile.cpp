@@ -0,0 +1,177 @@
+//===------------------- lib/Jit/ClassProfile.cpp ---------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the profile of the receiver classes seen at
+/// virtual call sites.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "ClassProfile.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+ClassProfileSite::ClassProfileSite(const std::string &MethodName,
+                                   uint32_t ILOffset,
+                                   const std::string &ClassName)
+    : MethodName(MethodName), ILOffset(ILOffset), ClassName(ClassName),
+      Class(nullptr), SavedClassCount(0), SavedTotal(0), OtherCount(0) {
+  for (unsigned I = 0; I < NumEntries; ++I) {
+    MethodTables[I] = nullptr;
+    Counts[I] = 0;
+  }
+}
+
+uint64_t ClassProfileSite::getClassCount(void *Class) const {
+  uint64_t Count = SavedClassCount;
+  if (Class == nullptr) {
+    return Count;
+  }
+  for (unsigned I = 0; I < NumEntries; ++I) {
+    if (MethodTables[I].load(std::memory_order_relaxed) == Class) {
+      Count += Counts[I].load(std::memory_order_relaxed);
+    }
+  }
+  return Count;
+}
+
+uint64_t ClassProfileSite::getTotal() const {
+  uint64_t Total = SavedTotal + OtherCount.load(std::memory_order_relaxed);
+  for (unsigned I = 0; I < NumEntries; ++I) {
+    Total += Counts[I].load(std::memory_order_relaxed);
+  }
+  return Total;
+}
+
+ClassProfile *ClassProfile::create(const std::string &Path,
+                                   std::string &Error) {
+  std::unique_ptr<ClassProfile> Profile(new ClassProfile(Path));
+  if (!Path.empty() && !Profile->read(Error)) {
+    return nullptr;
+  }
+  return Profile.release();
+}
+
+bool ClassProfile::read(std::string &Error) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer = MemoryBuffer::getFile(Path);
+  if (std::error_code EC = Buffer.getError()) {
+    // A profile that has not been written yet is empty.
+    if (EC == std::errc::no_such_file_or_directory) {
+      return true;
+    }
+    Error = EC.message();
+    return false;
+  }
+
+  for (line_iterator Line(**Buffer); !Line.is_at_eof(); ++Line) {
+    SmallVector<StringRef, 5> Fields;
+    Line->split(Fields, '\t');
+    uint32_t ILOffset;
+    uint64_t ClassCount;
+    uint64_t Total;
+    if ((Fields.size() != 5) || Fields[1].getAsInteger(10, ILOffset) ||
+        Fields[3].getAsInteger(10, ClassCount) ||
+        Fields[4].getAsInteger(10, Total) || (ClassCount > Total)) {
+      Error = "malformed line " + std::to_string(Line.line_number());
+      return false;
+    }
+
+    std::string MethodName = Fields[0].str();
+    std::string ClassName = Fields[2].str();
+    std::unique_ptr<ClassProfileSite> &Site =
+        Sites[SiteKey(MethodName, ILOffset, ClassName)];
+    if (Site == nullptr) {
+      Site.reset(new ClassProfileSite(MethodName, ILOffset, ClassName));
+    }
+    Site->SavedClassCount += ClassCount;
+    Site->SavedTotal += Total;
+  }
+  return true;
+}
+
+ClassProfileSite *ClassProfile::getSite(const std::string &MethodName,
+                                        uint32_t ILOffset,
+                                        const std::string &ClassName,
+                                        void *Class) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  std::unique_ptr<ClassProfileSite> &Site =
+      Sites[SiteKey(MethodName, ILOffset, ClassName)];
+  if (Site == nullptr) {
+    Site.reset(new ClassProfileSite(MethodName, ILOffset, ClassName));
+  }
+  Site->Class = Class;
+  IsInstrumented = true;
+  return Site.get();
+}
+
+bool ClassProfile::isLikelyClass(const std::string &MethodName,
+                                 uint32_t ILOffset,
+                                 const std::string &ClassName, void *Class) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto Iterator = Sites.find(SiteKey(MethodName, ILOffset, ClassName));
+  if (Iterator == Sites.end()) {
+    return false;
+  }
+  const ClassProfileSite &Site = *Iterator->second;
+  uint64_t Total = Site.getTotal();
+  return (Total >= MinTotal) &&
+         (Site.getClassCount(Class) * 100 >= Total * LikelyPercent);
+}
+
+void ClassProfile::recordReceiver(ClassProfileSite *Site, void *MethodTable) {
+  // Counts are relaxed: nothing else is ordered with them, and the profile
+  // is only read once the code being profiled has run for a while.
+  for (unsigned I = 0; I < ClassProfileSite::NumEntries; ++I) {
+    void *Entry = Site->MethodTables[I].load(std::memory_order_relaxed);
+    if (Entry == nullptr) {
+      // Claim the empty entry. If another thread got there first, Entry is
+      // updated to the method table it stored.
+      if (Site->MethodTables[I].compare_exchange_strong(
+              Entry, MethodTable, std::memory_order_relaxed)) {
+        Entry = MethodTable;
+      }
+    }
+    if (Entry == MethodTable) {
+      Site->Counts[I].fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+  Site->OtherCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ClassProfile::write(std::string &Error) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  if (Path.empty() || !IsInstrumented) {
+    return true;
+  }
+
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_Text);
+  if (EC) {
+    Error = EC.message();
+    return false;
+  }
+  for (auto &Entry : Sites) {
+    const ClassProfileSite &Site = *Entry.second;
+    OS << Site.MethodName << '\t' << Site.ILOffset << '\t' << Site.ClassName
+       << '\t' << Site.getClassCount(Site.Class) << '\t' << Site.getTotal()
+       << '\n';
+  }
+  return true;
+}
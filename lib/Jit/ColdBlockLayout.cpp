@@ -0,0 +1,133 @@
+//===---------------- lib/Jit/ColdBlockLayout.cpp ---------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the pass that moves rarely run blocks to the end
+/// of the method.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "LLILCJit.h"
+#include "ColdBlockLayout.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+
+/// \brief Check whether the profile weighs each edge from \p Pred to
+/// \p Succ zero.
+static bool isNeverTaken(BasicBlock *Pred, BasicBlock *Succ) {
+  TerminatorInst *Terminator = Pred->getTerminator();
+  MDNode *Weights = Terminator->getMetadata(LLVMContext::MD_prof);
+  if ((Weights == nullptr) ||
+      (Weights->getNumOperands() != Terminator->getNumSuccessors() + 1)) {
+    return false;
+  }
+  MDString *Name = dyn_cast<MDString>(Weights->getOperand(0));
+  if ((Name == nullptr) || !Name->getString().equals("branch_weights")) {
+    return false;
+  }
+  for (unsigned I = 0; I < Terminator->getNumSuccessors(); ++I) {
+    if (Terminator->getSuccessor(I) != Succ) {
+      continue;
+    }
+    ConstantInt *Weight =
+        mdconst::dyn_extract<ConstantInt>(Weights->getOperand(I + 1));
+    if ((Weight == nullptr) || !Weight->isZero()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// \brief Check whether \p Block is cold, given the blocks in \p Cold.
+static bool isCold(BasicBlock *Block,
+                   const SmallPtrSetImpl<BasicBlock *> &Cold) {
+  if (isa<UnreachableInst>(Block->getTerminator())) {
+    return true;
+  }
+  // Each way in is cold.
+  if (pred_begin(Block) != pred_end(Block)) {
+    bool IsEnteredCold = true;
+    for (BasicBlock *Pred : predecessors(Block)) {
+      if (!Cold.count(Pred) && !isNeverTaken(Pred, Block)) {
+        IsEnteredCold = false;
+        break;
+      }
+    }
+    if (IsEnteredCold) {
+      return true;
+    }
+  }
+  // Each way out is cold.
+  if (succ_begin(Block) == succ_end(Block)) {
+    return false;
+  }
+  for (BasicBlock *Succ : successors(Block)) {
+    if (!Cold.count(Succ)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//----------------------------ColdBlockLayout---------------------------------
+
+char ColdBlockLayout::ID = 0;
+
+void ColdBlockLayout::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesCFG();
+}
+
+bool ColdBlockLayout::runOnFunction(Function &F) {
+  BasicBlock *Entry = &F.getEntryBlock();
+  SmallPtrSet<BasicBlock *, 16> Cold;
+  bool IsChanged;
+  do {
+    IsChanged = false;
+    for (BasicBlock &Block : F) {
+      if ((&Block != Entry) && !Cold.count(&Block) && isCold(&Block, Cold)) {
+        Cold.insert(&Block);
+        IsChanged = true;
+      }
+    }
+  } while (IsChanged);
+
+  // Move the cold blocks after the hot ones, in the order they were in, if
+  // any hot block follows a cold one.
+  SmallVector<BasicBlock *, 16> ColdBlocks;
+  bool IsMoved = false;
+  for (BasicBlock &Block : F) {
+    if (Cold.count(&Block)) {
+      ColdBlocks.push_back(&Block);
+    } else if (!ColdBlocks.empty()) {
+      IsMoved = true;
+    }
+  }
+  if (IsMoved) {
+    for (BasicBlock *Block : ColdBlocks) {
+      Block->moveAfter(&F.back());
+    }
+  }
+
+  if (Context->Options->DumpLevel == ::DumpLevel::VERBOSE) {
+    dbgs() << "INFO:  " << Cold.size() << " of " << F.size()
+           << " blocks are cold in " << F.getName() << "\n";
+  }
+  return IsMoved;
+}
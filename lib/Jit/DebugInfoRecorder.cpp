@@ -0,0 +1,194 @@
+//===---------------- lib/Jit/DebugInfoRecorder.cpp -------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the collection and reporting of the debug
+/// information the EE needs.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "LLILCJit.h"
+#include "DebugInfoRecorder.h"
+#include "llvm/CodeGen/MachineFrameInfo.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/Target/TargetFrameLowering.h"
+#include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+#include "llvm/Target/TargetSubtargetInfo.h"
+
+using namespace llvm;
+
+/// \brief Convert a DWARF register number to a CLR register number.
+///
+/// \param DwarfRegister Register number to convert.
+/// \returns The CLR register, or REGNUM_COUNT if there is none.
+static ICorDebugInfo::RegNum mapDwarfRegisterToRegNum(int DwarfRegister) {
+#if _TARGET_AMD64_
+  static const ICorDebugInfo::RegNum Registers[] = {
+      ICorDebugInfo::REGNUM_RAX, ICorDebugInfo::REGNUM_RDX,
+      ICorDebugInfo::REGNUM_RCX, ICorDebugInfo::REGNUM_RBX,
+      ICorDebugInfo::REGNUM_RSI, ICorDebugInfo::REGNUM_RDI,
+      ICorDebugInfo::REGNUM_RBP, ICorDebugInfo::REGNUM_RSP,
+      ICorDebugInfo::REGNUM_R8,  ICorDebugInfo::REGNUM_R9,
+      ICorDebugInfo::REGNUM_R10, ICorDebugInfo::REGNUM_R11,
+      ICorDebugInfo::REGNUM_R12, ICorDebugInfo::REGNUM_R13,
+      ICorDebugInfo::REGNUM_R14, ICorDebugInfo::REGNUM_R15};
+  if ((DwarfRegister >= 0) &&
+      (DwarfRegister < (int)(sizeof(Registers) / sizeof(Registers[0])))) {
+    return Registers[DwarfRegister];
+  }
+#endif
+  return ICorDebugInfo::REGNUM_COUNT;
+}
+
+/// \brief Insert a label before \p Before.
+static MCSymbol *insertLabel(MachineBasicBlock &MBB,
+                             MachineBasicBlock::iterator Before) {
+  MachineFunction &MF = *MBB.getParent();
+  MCSymbol *Label = MF.getContext().createTempSymbol();
+
+  // GC_LABEL is emitted as a bare label and, unlike EH_LABEL, is ignored
+  // when the EH tables are built.
+  const TargetInstrInfo *TII = MF.getSubtarget().getInstrInfo();
+  BuildMI(MBB, Before, DebugLoc(), TII->get(TargetOpcode::GC_LABEL))
+      .addSym(Label);
+  return Label;
+}
+
+/// \brief Insert a label before \p Before and record it as the start of the
+/// native code for \p ILOffset.
+static void addOffsetLabel(LLILCJitContext *Context, MachineBasicBlock &MBB,
+                           MachineBasicBlock::iterator Before,
+                           uint32_t ILOffset, bool IsCall) {
+  MCSymbol *Label = insertLabel(MBB, Before);
+
+  ICorDebugInfo::OffsetMapping Mapping;
+  Mapping.nativeOffset = 0;
+  Mapping.ilOffset = ILOffset;
+  Mapping.source = IsCall ? ICorDebugInfo::CALL_INSTRUCTION
+                          : ICorDebugInfo::STACK_EMPTY;
+  Context->OffsetLabels.push_back(std::make_pair(Label, Mapping));
+}
+
+//-----------------------------DebugInfoRecorder------------------------------
+
+char DebugInfoRecorder::ID = 0;
+
+bool DebugInfoRecorder::runOnMachineFunction(MachineFunction &MF) {
+  LLILCJitContext *Context = LLILCJit::TheJit->getLLILCJitContext();
+  if (MF.empty()) {
+    return false;
+  }
+
+  // Only the method being jitted is reported; the module may also hold the
+  // safepoint poll function, which is emitted after it.
+  if (MF.getFunction()->getName() != Context->MethodName) {
+    return false;
+  }
+
+  // The code before the first instruction from the IL is the prolog.
+  MachineBasicBlock &Entry = MF.front();
+  addOffsetLabel(Context, Entry, Entry.begin(),
+                 (uint32_t)ICorDebugInfo::PROLOG, false);
+
+  // The reader stores the IL offset of each instruction as its line, and
+  // marks calls with column 1. Label each change of IL offset, and each
+  // load that a null check was folded into.
+  uint32_t LastILOffset = (uint32_t)ICorDebugInfo::PROLOG;
+  for (MachineBasicBlock &MBB : MF) {
+    for (MachineInstr &MI : MBB) {
+      if (MI.getOpcode() == TargetOpcode::FAULTING_LOAD_OP) {
+        Context->ImplicitNullChecks.push_back(
+            std::make_pair(insertLabel(MBB, MI), 0));
+      }
+      const DebugLoc &Loc = MI.getDebugLoc();
+      if (!Loc || MI.isDebugValue()) {
+        continue;
+      }
+      uint32_t ILOffset = Loc.getLine();
+      if (ILOffset != LastILOffset) {
+        addOffsetLabel(Context, MBB, MI, ILOffset, Loc.getCol() == 1);
+        LastILOffset = ILOffset;
+      }
+    }
+  }
+
+  // Variables only have debug info when the EE asked for it. The reader
+  // stores the IL variable number as the line of each variable.
+  const TargetFrameLowering *TFL = MF.getSubtarget().getFrameLowering();
+  const TargetRegisterInfo *TRI = MF.getSubtarget().getRegisterInfo();
+  for (const MachineModuleInfo::VariableDbgInfo &Info :
+       MF.getMMI().getVariableDbgInfo()) {
+    unsigned FrameRegister;
+    int Offset = TFL->getFrameIndexReference(MF, Info.Slot, FrameRegister);
+
+    ICorDebugInfo::NativeVarInfo Home;
+    Home.startOffset = 0;
+    Home.endOffset = 0;
+    Home.varNumber = Info.Var->getLine();
+    Home.loc.vlType = ICorDebugInfo::VLT_STK;
+    Home.loc.vlStk.vlsBaseReg =
+        mapDwarfRegisterToRegNum(TRI->getDwarfRegNum(FrameRegister, false));
+    Home.loc.vlStk.vlsOffset = Offset;
+    Context->VarHomes.push_back(Home);
+  }
+
+  return false; // success
+}
+
+void reportDebugInfo(LLILCJitContext *Context) {
+  CORINFO_METHOD_HANDLE MethodHandle = Context->MethodInfo->ftn;
+
+  // Report the offset map. A label followed by another at the same native
+  // offset, such as that of an empty prolog, marks no code and is dropped.
+  std::vector<ICorDebugInfo::OffsetMapping> &Mappings =
+      Context->OffsetMappings;
+  Mappings.clear();
+  const auto &Labels = Context->OffsetLabels;
+  for (size_t I = 0; I < Labels.size(); ++I) {
+    const ICorDebugInfo::OffsetMapping &Mapping = Labels[I].second;
+    if ((I + 1 < Labels.size()) &&
+        (Labels[I + 1].second.nativeOffset == Mapping.nativeOffset)) {
+      continue;
+    }
+    Mappings.push_back(Mapping);
+  }
+  if (!Mappings.empty()) {
+    // The EE owns the array once it has the boundaries; Context keeps a
+    // copy for profilers.
+    uint32_t NumMappings = Mappings.size();
+    ICorDebugInfo::OffsetMapping *OM =
+        (ICorDebugInfo::OffsetMapping *)Context->JitInfo->allocateArray(
+            NumMappings * sizeof(ICorDebugInfo::OffsetMapping));
+    std::copy(Mappings.begin(), Mappings.end(), OM);
+    Context->JitInfo->setBoundaries(MethodHandle, NumMappings, OM);
+  }
+
+  // The homes are on the stack for the whole method.
+  std::vector<ICorDebugInfo::NativeVarInfo> &Homes = Context->VarHomes;
+  if (!Homes.empty()) {
+    uint32_t NumHomes = Homes.size();
+    ICorDebugInfo::NativeVarInfo *Vars =
+        (ICorDebugInfo::NativeVarInfo *)Context->JitInfo->allocateArray(
+            NumHomes * sizeof(ICorDebugInfo::NativeVarInfo));
+    for (uint32_t I = 0; I < NumHomes; ++I) {
+      Vars[I] = Homes[I];
+      Vars[I].startOffset = 0;
+      Vars[I].endOffset = Context->HotCodeSize;
+    }
+    Context->JitInfo->setVars(MethodHandle, NumHomes, Vars);
+  }
+}
@@ -147,50 +147,51 @@ static void getXdataSize(const uint8_t *XdataPtr, size_t *ReportedSize,
 }
 
 void EEMemoryManager::reserveUnwindSpace(const object::ObjectFile &Obj) {
-  // The EE needs to be informed for each funclet (and the main function)
-  // what the size of its unwind codes will be.  Parse the header info in
-  // the xdata section to determine this.
-  BOOL IsHandler = FALSE;
   for (const object::SectionRef &Section : Obj.sections()) {
     StringRef SectionName;
     if (!Section.getName(SectionName) && (SectionName == ".xdata")) {
       StringRef Contents;
       if (!Section.getContents(Contents)) {
-        const uint8_t *DataPtr =
-            reinterpret_cast<const uint8_t *>(Contents.data());
-        const uint8_t *DataEnd =
-            reinterpret_cast<const uint8_t *>(Contents.end());
-        do {
-          size_t ReportedByteCount;
-          size_t TotalByteCount;
-          getXdataSize(DataPtr, &ReportedByteCount, &TotalByteCount);
-          // Bit 5 indicates whether this is chained unwind info.  If we saw
-          // that here, we'd have wanted to include it with the previous
-          // reservation (or we'd be separating cold code).  Since it's not
-          // currently emitted, just verify that we don't see it.
-          assert((*DataPtr & 0x20) != 0x10 &&
-                 "chained unwind info not supported");
-          this->Context->JitInfo->reserveUnwindInfo(IsHandler, FALSE,
-                                                    ReportedByteCount);
-          IsHandler = TRUE;
-          DataPtr += TotalByteCount;
-          if (DataPtr == DataEnd) {
-            break;
-          }
-
-          // The next thing should either be the next xdata entry or the
-          // sentinel we insert between that and the clause descriptors.
-          // If it is the next xdata entry, bits 0-2 will be the version
-          // number (currently only version 1 exists).
-        } while ((*DataPtr & 0x7) == 1);
-        // If we didn't reach the end of the xdata, the next thing should be
-        // our sentinel.
-        assert(DataPtr == DataEnd || *DataPtr == 0xff && "Malformed .xdata");
+        reserveUnwindSpace(Contents);
       }
     }
   }
 }
 
+void EEMemoryManager::reserveUnwindSpace(StringRef Xdata) {
+  // The EE needs to be informed for each funclet (and the main function)
+  // what the size of its unwind codes will be.  Parse the header info in
+  // the xdata section to determine this.
+  BOOL IsHandler = FALSE;
+  const uint8_t *DataPtr = reinterpret_cast<const uint8_t *>(Xdata.data());
+  const uint8_t *DataEnd = reinterpret_cast<const uint8_t *>(Xdata.end());
+  do {
+    size_t ReportedByteCount;
+    size_t TotalByteCount;
+    getXdataSize(DataPtr, &ReportedByteCount, &TotalByteCount);
+    // Bit 5 indicates whether this is chained unwind info.  If we saw
+    // that here, we'd have wanted to include it with the previous
+    // reservation (or we'd be separating cold code).  Since it's not
+    // currently emitted, just verify that we don't see it.
+    assert((*DataPtr & 0x20) != 0x10 && "chained unwind info not supported");
+    this->Context->JitInfo->reserveUnwindInfo(IsHandler, FALSE,
+                                              ReportedByteCount);
+    IsHandler = TRUE;
+    DataPtr += TotalByteCount;
+    if (DataPtr == DataEnd) {
+      break;
+    }
+
+    // The next thing should either be the next xdata entry or the
+    // sentinel we insert between that and the clause descriptors.
+    // If it is the next xdata entry, bits 0-2 will be the version
+    // number (currently only version 1 exists).
+  } while ((*DataPtr & 0x7) == 1);
+  // If we didn't reach the end of the xdata, the next thing should be
+  // our sentinel.
+  assert(DataPtr == DataEnd || *DataPtr == 0xff && "Malformed .xdata");
+}
+
 void EEMemoryManager::reserveAllocationSpace(
     uintptr_t CodeSize, uint32_t CodeAlign, uintptr_t RODataSize,
     uint32_t RODataAlign, uintptr_t RWDataSize, uint32_t RWDataAlign) {
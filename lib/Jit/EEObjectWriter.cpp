@@ -0,0 +1,465 @@
+//===------------------ lib/Jit/EEObjectWriter.cpp --------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of direct emission of MC output into memory from
+/// the EE.
+///
+/// The target's asm backend is wrapped so that the object writer it creates
+/// can be intercepted. The wrapping writer forwards everything to the
+/// target's own writer, so the section contents are exactly those of the
+/// object file path, and records each relocation on the side. At the end of
+/// assembly it resolves the debug info labels, then either lays the
+/// sections out in the EE's memory itself or lets the target's writer
+/// produce the object file.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "LLILCJit.h"
+#include "EEMemoryManager.h"
+#include "EEObjectWriter.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/MC/MCAsmBackend.h"
+#include "llvm/MC/MCAsmLayout.h"
+#include "llvm/MC/MCAssembler.h"
+#include "llvm/MC/MCFixupKindInfo.h"
+#include "llvm/MC/MCObjectWriter.h"
+#include "llvm/MC/MCSectionCOFF.h"
+#include "llvm/MC/MCSectionELF.h"
+#include "llvm/MC/MCSectionMachO.h"
+#include "llvm/MC/MCSymbol.h"
+#include "llvm/MC/MCValue.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/TargetRegistry.h"
+#include <cstring>
+
+using namespace llvm;
+
+namespace {
+
+/// The emission that writers created on this thread report to, if any.
+LLVM_THREAD_LOCAL DirectEmission *CurrentEmission = nullptr;
+
+/// The target whose asm backend is wrapped.
+const Target *NativeTarget = nullptr;
+
+/// A relocation the target's writer was asked to record.
+struct EEFixup {
+  const MCSection *Section; ///< Section holding the fixup.
+  uint64_t Offset;          ///< Offset of the fixup in its section.
+  const MCSymbol *Symbol;   ///< Symbol the fixup refers to.
+  int64_t Constant;         ///< Addend, relative to the start of the fixup.
+  unsigned Size;            ///< Size of the fixup in bytes.
+  bool IsPCRel;             ///< True if the fixup is PC-relative.
+};
+
+/// A section that is copied into the EE's memory.
+struct EESection {
+  const MCSection *Section;
+  StringRef Name;
+  SmallString<0> Data;
+  unsigned Alignment;
+  uint8_t *Address;
+};
+
+StringRef getSectionName(const MCSection &Section) {
+  if (const MCSectionCOFF *COFF = dyn_cast<MCSectionCOFF>(&Section)) {
+    return COFF->getSectionName();
+  }
+  if (const MCSectionELF *ELF = dyn_cast<MCSectionELF>(&Section)) {
+    return ELF->getSectionName();
+  }
+  if (const MCSectionMachO *MachO = dyn_cast<MCSectionMachO>(&Section)) {
+    return MachO->getSectionName();
+  }
+  return StringRef();
+}
+
+/// Sections whose contents are not copied into the EE's memory. These are
+/// the same sections the object file path skips when it reports
+/// relocations.
+bool isUnreportedSection(StringRef Name) {
+  return Name.startswith(".debug") || Name.equals(".pdata") ||
+         Name.startswith(".eh_frame") || Name.startswith(".comment") ||
+         Name.startswith(".note");
+}
+
+/// \brief Object writer that emits straight into the EE's memory when it
+/// can, and otherwise defers to the target's object writer.
+class EEObjectWriter : public MCObjectWriter {
+public:
+  EEObjectWriter(raw_pwrite_stream &OS, MCObjectWriter *Inner,
+                 DirectEmission &Emission)
+      : MCObjectWriter(OS, Inner->isLittleEndian()), Inner(Inner),
+        Emission(Emission) {}
+
+  void reset() override {
+    Inner->reset();
+    Fixups.clear();
+    Emission.FallbackReason.clear();
+  }
+
+  void executePostLayoutBinding(MCAssembler &Asm,
+                                const MCAsmLayout &Layout) override {
+    Inner->executePostLayoutBinding(Asm, Layout);
+  }
+
+  void recordRelocation(MCAssembler &Asm, const MCAsmLayout &Layout,
+                        const MCFragment *Fragment, const MCFixup &Fixup,
+                        MCValue Target, bool &IsPCRel,
+                        uint64_t &FixedValue) override;
+
+  bool isSymbolRefDifferenceFullyResolvedImpl(const MCAssembler &Asm,
+                                              const MCSymbol &SymA,
+                                              const MCFragment &FB, bool InSet,
+                                              bool IsPCRel) const override {
+    return Inner->isSymbolRefDifferenceFullyResolvedImpl(Asm, SymA, FB, InSet,
+                                                         IsPCRel);
+  }
+
+  bool isWeak(const MCSymbol &Sym) const override {
+    return Inner->isWeak(Sym);
+  }
+
+  void writeObject(MCAssembler &Asm, const MCAsmLayout &Layout) override {
+    for (auto &OffsetLabel : Emission.Context->OffsetLabels) {
+      OffsetLabel.second.nativeOffset =
+          Layout.getSymbolOffset(*OffsetLabel.first);
+    }
+    for (auto &NullCheck : Emission.Context->ImplicitNullChecks) {
+      NullCheck.second = Layout.getSymbolOffset(*NullCheck.first);
+    }
+    if (Emission.IsDirectEmitRequested && Emission.FallbackReason.empty() &&
+        emitIntoEE(Asm, Layout)) {
+      Emission.IsEmitted = true;
+      return;
+    }
+    Inner->writeObject(Asm, Layout);
+  }
+
+private:
+  /// Note that the method can't be emitted directly.
+  bool fallBack(const Twine &Reason) {
+    if (Emission.FallbackReason.empty()) {
+      Emission.FallbackReason = Reason.str();
+    }
+    return false;
+  }
+
+  /// Check that \p Fixup can be reported to the EE.
+  bool checkFixup(const EEFixup &Fixup,
+                  const DenseMap<const MCSection *, EESection *> &Placed);
+
+  /// Lay the method out in the EE's memory and report it to the EE.
+  /// \returns false, before anything has been reported, if the method
+  /// needs the object file path.
+  bool emitIntoEE(MCAssembler &Asm, const MCAsmLayout &Layout);
+
+  std::unique_ptr<MCObjectWriter> Inner;
+  DirectEmission &Emission;
+  std::vector<EEFixup> Fixups;
+};
+
+void EEObjectWriter::recordRelocation(MCAssembler &Asm,
+                                      const MCAsmLayout &Layout,
+                                      const MCFragment *Fragment,
+                                      const MCFixup &Fixup, MCValue Target,
+                                      bool &IsPCRel, uint64_t &FixedValue) {
+  // Let the target's writer set the value left in the section data, so
+  // that it matches the object file path.
+  Inner->recordRelocation(Asm, Layout, Fragment, Fixup, Target, IsPCRel,
+                          FixedValue);
+
+  const MCSymbolRefExpr *RefA = Target.getSymA();
+  if ((RefA == nullptr) || (Target.getSymB() != nullptr) ||
+      (RefA->getKind() != MCSymbolRefExpr::VK_None)) {
+    fallBack("unsupported relocation expression");
+    return;
+  }
+
+  EEFixup Record;
+  Record.Section = Fragment->getParent();
+  Record.Offset = Layout.getFragmentOffset(Fragment) + Fixup.getOffset();
+  Record.Symbol = &RefA->getSymbol();
+  Record.Constant = Target.getConstant();
+  Record.Size =
+      Asm.getBackend().getFixupKindInfo(Fixup.getKind()).TargetSize / 8;
+  Record.IsPCRel = IsPCRel;
+  Fixups.push_back(Record);
+}
+
+bool EEObjectWriter::checkFixup(
+    const EEFixup &Fixup,
+    const DenseMap<const MCSection *, EESection *> &Placed) {
+  if (Placed.find(Fixup.Section) == Placed.end()) {
+    // Nothing in this section is reported to the EE.
+    return true;
+  }
+  if (!(Fixup.IsPCRel && (Fixup.Size == 4)) &&
+      !(!Fixup.IsPCRel && (Fixup.Size == 8))) {
+    return fallBack("unsupported relocation size");
+  }
+
+  const MCSymbol &Symbol = *Fixup.Symbol;
+  if (Symbol.isInSection()) {
+    if (Placed.find(&Symbol.getSection()) == Placed.end()) {
+      return fallBack("relocation against an unreported section");
+    }
+    return true;
+  }
+
+  // External symbols must be ones we created for EE handles. The xdata
+  // refers to a dummy personality routine that the EE replaces.
+  LLILCJitContext *Context = Emission.Context;
+  if (Context->NameToHandleMap.count(Symbol.getName()) == 0 &&
+      !Symbol.getName().equals("ProcessCLRException")) {
+    return fallBack("relocation against unknown symbol " + Symbol.getName());
+  }
+  return true;
+}
+
+bool EEObjectWriter::emitIntoEE(MCAssembler &Asm, const MCAsmLayout &Layout) {
+  // Find the sections to copy and capture their contents. The contents are
+  // written through this writer's stream, so point it at each buffer in
+  // turn.
+  std::vector<std::unique_ptr<EESection>> Sections;
+  DenseMap<const MCSection *, EESection *> Placed;
+  EESection *Code = nullptr;
+  EESection *Xdata = nullptr;
+  raw_pwrite_stream &ObjectStream = getStream();
+  for (const MCSection &Section : Asm) {
+    StringRef Name = getSectionName(Section);
+    uint64_t Size = Layout.getSectionAddressSize(&Section);
+    if ((Size == 0) || isUnreportedSection(Name)) {
+      continue;
+    }
+
+    SectionKind Kind = Section.getKind();
+    if (Kind.isWriteable()) {
+      return fallBack("writeable section " + Name);
+    }
+    if (Section.getAlignment() > 16) {
+      return fallBack("over-aligned section " + Name);
+    }
+    if (Kind.isText() && (Code != nullptr)) {
+      return fallBack("more than one code section");
+    }
+
+    std::unique_ptr<EESection> Placement(new EESection());
+    Placement->Section = &Section;
+    Placement->Name = Name;
+    Placement->Alignment = std::max(Section.getAlignment(), 1u);
+    Placement->Address = nullptr;
+    raw_svector_ostream SectionStream(Placement->Data);
+    setStream(SectionStream);
+    Asm.writeSectionData(&Section, Layout);
+    setStream(ObjectStream);
+
+    if (Kind.isText()) {
+      Code = Placement.get();
+    } else if (Name.equals(".xdata")) {
+      Xdata = Placement.get();
+    }
+    Placed[&Section] = Placement.get();
+    Sections.push_back(std::move(Placement));
+  }
+  if (Code == nullptr) {
+    return fallBack("no code section");
+  }
+  for (const EEFixup &Fixup : Fixups) {
+    if (!checkFixup(Fixup, Placed)) {
+      return false;
+    }
+  }
+
+  // From here on the EE is being told about the method, so there is no
+  // going back. The unwind space has to be reserved before allocMem.
+  EEMemoryManager &MM = *Emission.MM;
+  if (Xdata != nullptr) {
+    MM.reserveUnwindSpace(Xdata->Data.str());
+  }
+
+  uintptr_t RODataSize = 0;
+  uint32_t RODataAlign = 1;
+  for (const auto &Placement : Sections) {
+    if (Placement.get() != Code) {
+      RODataSize = RoundUpToAlignment(RODataSize, Placement->Alignment) +
+                   Placement->Data.size();
+      RODataAlign = std::max(RODataAlign, Placement->Alignment);
+    }
+  }
+  MM.reserveAllocationSpace(Code->Data.size(), Code->Alignment, RODataSize,
+                            RODataAlign, 0, 0);
+
+  unsigned SectionID = 0;
+  for (const auto &Placement : Sections) {
+    if (Placement.get() == Code) {
+      Placement->Address =
+          MM.allocateCodeSection(Placement->Data.size(), Placement->Alignment,
+                                 SectionID++, Placement->Name);
+    } else {
+      Placement->Address = MM.allocateDataSection(
+          Placement->Data.size(), Placement->Alignment, SectionID++,
+          Placement->Name, /*IsReadOnly=*/true);
+    }
+    memcpy(Placement->Address, Placement->Data.data(),
+           Placement->Data.size());
+  }
+
+  // The EE applies the relocations. Its REL32 is relative to the end of
+  // the fixup, where MC's addend is relative to the start.
+  LLILCJitContext *Context = Emission.Context;
+  for (const EEFixup &Fixup : Fixups) {
+    auto Section = Placed.find(Fixup.Section);
+    if (Section == Placed.end()) {
+      continue;
+    }
+    const MCSymbol &Symbol = *Fixup.Symbol;
+    uint8_t *Target;
+    if (Symbol.isInSection()) {
+      Target = Placed[&Symbol.getSection()]->Address +
+               Layout.getSymbolOffset(Symbol);
+    } else {
+      auto Handle = Context->NameToHandleMap.find(Symbol.getName());
+      if (Handle == Context->NameToHandleMap.end()) {
+        // The dummy personality routine.
+        continue;
+      }
+      Target = (uint8_t *)Handle->second;
+    }
+    Target += Fixup.Constant;
+    uint16_t EERelType = IMAGE_REL_BASED_DIR64;
+    if (Fixup.IsPCRel) {
+      Target += Fixup.Size;
+      EERelType = IMAGE_REL_BASED_REL32;
+    }
+    Context->JitInfo->recordRelocation(
+        Section->second->Address + Fixup.Offset, Target, EERelType);
+  }
+
+  if (Xdata != nullptr) {
+    MM.registerEHFrames(Xdata->Address, (uint64_t)Xdata->Address,
+                        Xdata->Data.size());
+  }
+  return true;
+}
+
+/// \brief Asm backend that forwards to the target's backend, but creates
+/// an \p EEObjectWriter when direct emission has been asked for.
+class EEAsmBackend : public MCAsmBackend {
+public:
+  EEAsmBackend(MCAsmBackend *Inner) : Inner(Inner) {
+    HasDataInCodeSupport = Inner->hasDataInCodeSupport();
+  }
+
+  void reset() override { Inner->reset(); }
+
+  MCObjectWriter *createObjectWriter(raw_pwrite_stream &OS) const override {
+    MCObjectWriter *Writer = Inner->createObjectWriter(OS);
+    if ((Writer == nullptr) || (CurrentEmission == nullptr)) {
+      return Writer;
+    }
+    return new EEObjectWriter(OS, Writer, *CurrentEmission);
+  }
+
+  unsigned getNumFixupKinds() const override {
+    return Inner->getNumFixupKinds();
+  }
+
+  const MCFixupKindInfo &getFixupKindInfo(MCFixupKind Kind) const override {
+    return Inner->getFixupKindInfo(Kind);
+  }
+
+  void processFixupValue(const MCAssembler &Asm, const MCAsmLayout &Layout,
+                         const MCFixup &Fixup, const MCFragment *DF,
+                         const MCValue &Target, uint64_t &Value,
+                         bool &IsResolved) override {
+    Inner->processFixupValue(Asm, Layout, Fixup, DF, Target, Value,
+                             IsResolved);
+  }
+
+  void applyFixup(const MCFixup &Fixup, char *Data, unsigned DataSize,
+                  uint64_t Value, bool IsPCRel) const override {
+    Inner->applyFixup(Fixup, Data, DataSize, Value, IsPCRel);
+  }
+
+  bool mayNeedRelaxation(const MCInst &Inst) const override {
+    return Inner->mayNeedRelaxation(Inst);
+  }
+
+  bool fixupNeedsRelaxation(const MCFixup &Fixup, uint64_t Value,
+                            const MCRelaxableFragment *DF,
+                            const MCAsmLayout &Layout) const override {
+    return Inner->fixupNeedsRelaxation(Fixup, Value, DF, Layout);
+  }
+
+  void relaxInstruction(const MCInst &Inst, MCInst &Res) const override {
+    Inner->relaxInstruction(Inst, Res);
+  }
+
+  unsigned getMinimumNopSize() const override {
+    return Inner->getMinimumNopSize();
+  }
+
+  bool writeNopData(uint64_t Count, MCObjectWriter *OW) const override {
+    return Inner->writeNopData(Count, OW);
+  }
+
+  void handleAssemblerFlag(MCAssemblerFlag Flag) override {
+    Inner->handleAssemblerFlag(Flag);
+  }
+
+  uint32_t generateCompactUnwindEncoding(
+      ArrayRef<MCCFIInstruction> Instrs) const override {
+    return Inner->generateCompactUnwindEncoding(Instrs);
+  }
+
+private:
+  std::unique_ptr<MCAsmBackend> Inner;
+};
+
+MCAsmBackend *createEEAsmBackend(const Target &T, const MCRegisterInfo &MRI,
+                                 const Triple &TT, StringRef CPU) {
+  MCAsmBackend *Inner = NativeTarget->createMCAsmBackend(MRI, TT.str(), CPU);
+  if (Inner == nullptr) {
+    return nullptr;
+  }
+  return new EEAsmBackend(Inner);
+}
+
+} // namespace
+
+namespace llvm {
+
+DirectEmissionScope::DirectEmissionScope(DirectEmission &Emission)
+    : Saved(CurrentEmission) {
+  CurrentEmission = &Emission;
+}
+
+DirectEmissionScope::~DirectEmissionScope() { CurrentEmission = Saved; }
+
+const Target &getEETarget(const Target &TheTarget) {
+  // There is only ever one native target, so one copy suffices.
+  static Target EETarget = [&TheTarget]() {
+    NativeTarget = &TheTarget;
+    Target Copy = TheTarget;
+    TargetRegistry::RegisterMCAsmBackend(Copy, createEEAsmBackend);
+    return Copy;
+  }();
+  assert(NativeTarget == &TheTarget && "EE emission for a second target");
+  return EETarget;
+}
+
+} // namespace llvm
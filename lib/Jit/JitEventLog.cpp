@@ -0,0 +1,219 @@
+//===------------------- lib/Jit/JitEventLog.cpp ----------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the per-phase jit timers and the jit event log.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "JitEventLog.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include <cstring>
+
+using namespace llvm;
+
+void JitPhaseTimer::start(JitPhase Phase) {
+  Enabled = true;
+  Current = Phase;
+  StartTime = Clock::now();
+  PhaseStart = StartTime;
+}
+
+void JitPhaseTimer::enterPhase(JitPhase Phase) {
+  if (!Enabled) {
+    return;
+  }
+  Clock::time_point Now = Clock::now();
+  if (Current != NumJitPhases) {
+    Elapsed[Current] +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Now - PhaseStart)
+            .count();
+  }
+  Current = Phase;
+  PhaseStart = Now;
+}
+
+void JitPhaseTimer::stop() {
+  enterPhase(NumJitPhases);
+  Enabled = false;
+}
+
+namespace {
+
+const uint32_t EventLogMagic = 0x56454A4C; // "LJEV"
+const uint32_t EventLogVersion = 7;
+
+/// Header of the binary log. It is followed by \p JitEvent records.
+struct EventLogHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t NumPhases;
+  uint32_t RecordSize;
+};
+
+} // namespace
+
+JitEventLog::JitEventLog(int FD, bool IsJSON)
+    : FD(FD), IsJSON(IsJSON), Head(0), Flushed(0), NumLost(0) {
+  for (Slot &S : Ring) {
+    S.Seq.store(0, std::memory_order_relaxed);
+  }
+}
+
+JitEventLog *JitEventLog::create(const std::string &Path, bool IsJSON,
+                                 std::string &Error) {
+  // Truncate the file and write the header, then reopen it for appending so
+  // that flushes from different threads never overwrite each other.
+  int FD;
+  std::error_code EC = sys::fs::openFileForWrite(Path, FD, sys::fs::F_None);
+  if (EC) {
+    Error = EC.message();
+    return nullptr;
+  }
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    if (!IsJSON) {
+      EventLogHeader Header = {EventLogMagic, EventLogVersion, NumJitPhases,
+                               sizeof(JitEvent)};
+      OS.write((const char *)&Header, sizeof(Header));
+    }
+  }
+
+  EC = sys::fs::openFileForWrite(Path, FD, sys::fs::F_Append);
+  if (EC) {
+    Error = EC.message();
+    return nullptr;
+  }
+  return new JitEventLog(FD, IsJSON);
+}
+
+void JitEventLog::log(const JitEvent &Event) {
+  uint64_t Index = Head.fetch_add(1, std::memory_order_relaxed);
+  Slot &S = Ring[Index % Capacity];
+  S.Seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  S.Event = Event;
+  S.Seq.store(Index + 1, std::memory_order_release);
+
+  if ((Index % BatchSize == 0) && (Index >= 2 * BatchSize)) {
+    flushUpTo(Index - BatchSize);
+  }
+}
+
+void JitEventLog::flush() { flushUpTo(Head.load(std::memory_order_relaxed)); }
+
+void JitEventLog::flushUpTo(uint64_t End) {
+  // Claim everything not yet flushed. A flusher that was overtaken finds
+  // its events already claimed and has nothing to do.
+  uint64_t Begin = Flushed.load(std::memory_order_relaxed);
+  do {
+    if (Begin >= End) {
+      return;
+    }
+  } while (!Flushed.compare_exchange_weak(Begin, End));
+
+  if (End - Begin > Capacity) {
+    NumLost += End - Capacity - Begin;
+    Begin = End - Capacity;
+  }
+
+  SmallString<4096> Buffer;
+  raw_svector_ostream BufferOS(Buffer);
+  JitEvent Event;
+  for (uint64_t Index = Begin; Index < End; ++Index) {
+    // Copy the event out and make sure it was not being rewritten while we
+    // did so.
+    Slot &S = Ring[Index % Capacity];
+    uint64_t Seq = S.Seq.load(std::memory_order_acquire);
+    if (Seq != Index + 1) {
+      NumLost++;
+      continue;
+    }
+    Event = S.Event;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (S.Seq.load(std::memory_order_relaxed) != Seq) {
+      NumLost++;
+      continue;
+    }
+    writeEvent(BufferOS, Event);
+  }
+
+  raw_fd_ostream OS(FD, /*shouldClose=*/false, /*unbuffered=*/true);
+  OS << BufferOS.str();
+}
+
+const char *JitEventLog::getPhaseName(JitPhase Phase) {
+  switch (Phase) {
+  case EESetupPhase:
+    return "ee_setup";
+  case ReaderPrePassPhase:
+    return "reader_pre_pass";
+  case ReaderFlowGraphPhase:
+    return "reader_flow_graph";
+  case ReaderMainPassPhase:
+    return "reader_main_pass";
+  case VerifyPhase:
+    return "verify";
+  case OptimizePhase:
+    return "optimize";
+  case StatepointPhase:
+    return "statepoints";
+  case CodeGenPhase:
+    return "codegen";
+  case LinkPhase:
+    return "link";
+  case DebugInfoPhase:
+    return "debug_info";
+  case GCInfoPhase:
+    return "gc_info";
+  default:
+    llvm_unreachable("unexpected jit phase");
+  }
+}
+
+void JitEventLog::writeEvent(raw_ostream &OS, const JitEvent &Event) {
+  if (!IsJSON) {
+    OS.write((const char *)&Event, sizeof(Event));
+    return;
+  }
+
+  OS << "{\"method\":\"";
+  for (const char *C = Event.Name; *C != '\0'; ++C) {
+    if ((*C == '"') || (*C == '\\')) {
+      OS << '\\' << *C;
+    } else if ((unsigned char)*C < 0x20) {
+      OS << format("\\u%04x", *C);
+    } else {
+      OS << *C;
+    }
+  }
+  OS << "\",\"handle\":" << Event.MethodHandle
+     << ",\"thread\":" << Event.ThreadId << ",\"start_ns\":" << Event.StartTime
+     << ",\"result\":" << Event.Result << ",\"il_size\":" << Event.ILSize
+     << ",\"blocks\":" << Event.NumBlocks
+     << ",\"code_size\":" << Event.CodeSize
+     << ",\"bounds_checks_removed\":" << Event.NumBoundsChecksRemoved
+     << ",\"calls_devirtualized\":" << Event.NumCallsDevirtualized
+     << ",\"calls_guarded\":" << Event.NumCallsGuarded
+     << ",\"allocations_removed\":" << Event.NumAllocationsRemoved
+     << ",\"boxes_removed\":" << Event.NumBoxesRemoved
+     << ",\"write_barriers_removed\":" << Event.NumWriteBarriersRemoved
+     << ",\"phases_ns\":{";
+  for (unsigned Phase = 0; Phase < NumJitPhases; ++Phase) {
+    OS << (Phase == 0 ? "\"" : ",\"") << getPhaseName((JitPhase)Phase)
+       << "\":" << Event.PhaseTime[Phase];
+  }
+  OS << "}}\n";
+}
@@ -19,15 +19,25 @@
 #include "GcInfo.h"
 #include "jitoptions.h"
 #include "compiler.h"
+#include "DebugInfoRecorder.h"
 #include "readerir.h"
 #include "abi.h"
+#include "BoundsCheckElimination.h"
+#include "CastCache.h"
+#include "ClassInitOptimization.h"
+#include "ClassProfile.h"
+#include "ColdBlockLayout.h"
 #include "EEMemoryManager.h"
 #include "EEObjectLinkingLayer.h"
+#include "EEObjectWriter.h"
+#include "PerfMapWriter.h"
+#include "RecordingJitInfo.h"
+#include "StackAllocation.h"
+#include "WriteBarrierOptimization.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/TypeBasedAliasAnalysis.h"
 #include "llvm/CodeGen/GCs.h"
 #include "llvm/Config/llvm-config.h"
-#include "llvm/DebugInfo/DIContext.h"
-#include "llvm/DebugInfo/DWARF/DWARFContext.h"
-#include "llvm/DebugInfo/DWARF/DWARFFormValue.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
 #include "llvm/ExecutionEngine/Orc/ObjectTransformLayer.h"
@@ -56,9 +66,13 @@
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/Timer.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include <cstdlib>
+#include <cstring>
 #include <string>
+#include <thread>
 #if defined(WIN32) && defined(_MSC_VER)
 #include <crtdbg.h>
 #endif
@@ -80,8 +94,6 @@ public:
       const object::ObjectFile &Obj = *PObj->getBinary();
       const RuntimeDyld::LoadedObjectInfo &L = *LoadedObjInfos[I];
 
-      getDebugInfoForObject(Obj, L);
-
       recordRelocations(Obj, L);
 
       ++I;
@@ -89,12 +101,6 @@ public:
   }
 
 private:
-  /// \brief Get debug info for object and send to CLR EE
-  ///
-  /// \param Obj Object file to get debug info for
-  void getDebugInfoForObject(const ObjectFile &Obj,
-                             const RuntimeDyld::LoadedObjectInfo &L);
-
   /// \brief Record relocations for external symbols via Jit interface.
   ///
   /// \param Obj Object file to record relocations for.
@@ -115,35 +121,157 @@ private:
   uint64_t getRelocationAddend(uint64_t LLVMRelocationType,
                                uint8_t *FixupAddress);
 
-  /// \brief Extract stack offsets for locals
-  ///
-  /// \param CU Dwarf Unit where locals exist
-  /// \param DebugEntry Debug Entry to look for local info
-  /// \param Offsets [out] List of offsets to record local info
-  void extractLocalLocations(const DWARFUnit *CU,
-                             const DWARFDebugInfoEntryMinimal *DebugEntry,
-                             std::vector<uint64_t> &Offsets);
-
-  /// \brief Extract debug info for locals from DWARF sections
-  ///
-  /// \param DwarfContext Dwarf Context to extract debug info from
-  /// \param Size Size of the function we are gathering info from
-  void getDebugInfoForLocals(DWARFContextInMemory &DwarfContext, uint64_t Addr,
-                             uint64_t Size);
+private:
+  LLILCJitContext *Context;
+};
 
-  /// \brief Convert DWARF register number to CLR register number
-  ///
-  /// \param DwarfRegister Register number to convert
-  ICorDebugInfo::RegNum mapDwarfRegisterToRegNum(uint8_t DwarfRegister);
+/// \brief The per-request state a reusable compilation pipeline forwards to.
+///
+/// The Orc layers of a pipeline outlive any one jit request, but the memory
+/// manager and the jit context they report to are specific to a request.
+/// The layers' functors refer to this binding, which is updated as each
+/// request acquires and releases the pipeline.
+struct PipelineBinding {
+  LLILCJitContext *Context = nullptr; ///< Context of the bound request.
+  EEMemoryManager *MM = nullptr;      ///< Memory manager of the bound request.
+};
 
-  /// \brief Find the Subprogram DebugInfoEntry in list of DIEs
-  ///
-  /// \param DebugEntry DebugInfoEntry to start from
-  const DWARFDebugInfoEntryMinimal *
-  getSubprogramDIE(const DWARFDebugInfoEntryMinimal *DebugEntry);
+/// \brief Load listener that forwards to an \p ObjectLoadListener for the
+/// request currently bound to the pipeline.
+class PipelineLoadListener {
+public:
+  PipelineLoadListener(PipelineBinding *Binding) : Binding(Binding) {}
+
+  template <typename ObjSetT, typename LoadResult>
+  void operator()(llvm::orc::ObjectLinkingLayerBase::ObjSetHandleT ObjHandles,
+                  const ObjSetT &Objs, const LoadResult &LoadedObjInfos) {
+    assert(Binding->Context != nullptr && "pipeline is not bound");
+    ObjectLoadListener Listener(Binding->Context);
+    Listener(ObjHandles, Objs, LoadedObjInfos);
+  }
 
 private:
-  LLILCJitContext *Context;
+  PipelineBinding *Binding;
+};
+
+/// \brief Object transform that reserves unwind space in the memory manager
+/// of the request currently bound to the pipeline.
+class UnwindSpaceReserver {
+public:
+  UnwindSpaceReserver(PipelineBinding *Binding) : Binding(Binding) {}
+
+  std::unique_ptr<object::OwningBinary<object::ObjectFile>>
+  operator()(std::unique_ptr<object::OwningBinary<object::ObjectFile>> Obj) {
+    assert(Binding->MM != nullptr && "pipeline is not bound");
+    Binding->MM->reserveUnwindSpace(*Obj->getBinary());
+    return Obj;
+  }
+
+private:
+  PipelineBinding *Binding;
+};
+
+/// \brief A target machine and the stack of Orc layers built on it.
+///
+/// Pipelines are cached in the per-thread state, keyed by the configuration
+/// of their target machine, and reused by successive jit requests on that
+/// thread. A pipeline serves one request at a time; a nested request that
+/// finds the cached pipeline busy gets a private pipeline instead.
+class LLILCJitPipeline {
+public:
+  LLILCJitPipeline(TargetMachine *TM)
+      : TM(TM), Binding(), Loader(PipelineLoadListener(&Binding)),
+        UnwindReserver(Loader, UnwindSpaceReserver(&Binding)),
+        Compiler(UnwindReserver, orc::LLILCCompiler(*TM)), InUse(false) {}
+
+  /// Attach the memory manager and context of a jit request.
+  void bind(LLILCJitContext *Context, EEMemoryManager *MM) {
+    Binding.Context = Context;
+    Binding.MM = MM;
+  }
+
+  /// Detach the current jit request.
+  void unbind() { Binding = PipelineBinding(); }
+
+public:
+  std::unique_ptr<TargetMachine> TM; ///< Target to emit code for.
+  PipelineBinding Binding;           ///< Currently bound request.
+  orc::EEObjectLinkingLayer<PipelineLoadListener> Loader;
+  orc::ObjectTransformLayer<decltype(Loader), UnwindSpaceReserver>
+      UnwindReserver;
+  orc::IRCompileLayer<decltype(UnwindReserver)> Compiler;
+  bool InUse; ///< True while a request is using this pipeline.
+};
+
+/// \brief Scoped ownership of a compilation pipeline for one jit request.
+///
+/// Acquires the cached pipeline for the requested configuration, creating
+/// it if necessary, and returns it to the cache (or deletes it, if it was a
+/// private pipeline for a nested request) when the request completes.
+class PipelineLease {
+public:
+  PipelineLease(LLILCJitPerThreadState *State, CodeGenOpt::Level OptLevel,
+                CodeModel::Model CodeModel, Reloc::Model RelocModel)
+      : Pipeline(nullptr), IsCached(false), IsReused(false) {
+    LLILCJitPerThreadState::PipelineKey Key(OptLevel, CodeModel, RelocModel);
+    LLILCJitPipeline *&Cached = State->PipelineMap[Key];
+    if ((Cached != nullptr) && !Cached->InUse) {
+      Pipeline = Cached;
+      IsCached = true;
+      IsReused = true;
+      State->PipelinesReused++;
+    } else {
+      Pipeline = createPipeline(OptLevel, CodeModel, RelocModel);
+      if (Pipeline == nullptr) {
+        return;
+      }
+      State->PipelinesCreated++;
+      if (Cached == nullptr) {
+        Cached = Pipeline;
+        IsCached = true;
+      }
+    }
+    Pipeline->InUse = true;
+  }
+
+  ~PipelineLease() {
+    if (Pipeline == nullptr) {
+      return;
+    }
+    Pipeline->unbind();
+    Pipeline->InUse = false;
+    if (!IsCached) {
+      delete Pipeline;
+    }
+  }
+
+  LLILCJitPipeline *get() const { return Pipeline; }
+  bool isReused() const { return IsReused; }
+
+private:
+  static LLILCJitPipeline *createPipeline(CodeGenOpt::Level OptLevel,
+                                          CodeModel::Model CodeModel,
+                                          Reloc::Model RelocModel) {
+    std::string ErrStr;
+    const llvm::Target *TheTarget =
+        TargetRegistry::lookupTarget(LLILC_TARGET_TRIPLE, ErrStr);
+    if (!TheTarget) {
+      errs() << "Could not create Target: " << ErrStr << "\n";
+      return nullptr;
+    }
+    // Use the target whose object writers report debug info labels and can
+    // emit directly into the EE's memory.
+    TheTarget = &getEETarget(*TheTarget);
+    TargetOptions Options;
+    TargetMachine *TM = TheTarget->createTargetMachine(
+        LLILC_TARGET_TRIPLE, "", "", Options, RelocModel, CodeModel, OptLevel);
+    return new LLILCJitPipeline(TM);
+  }
+
+private:
+  LLILCJitPipeline *Pipeline;
+  bool IsCached;
+  bool IsReused;
 };
 
 // The one and only Jit Object.
@@ -203,6 +331,14 @@ ICorJitCompiler *__stdcall getJit() {
       Opts["disable-cgp-gc-opts"]->addOccurrence(0, "disable-cgp-gc-opts",
                                                  "true");
     }
+    if (Opts["enable-implicit-null-checks"]->getNumOccurrences() == 0) {
+      // Only null checks the reader marks as implicit are folded, and it
+      // only marks them if COMPlus_JitImplicitNullChecks is set. Accesses
+      // within a page of null are folded, which is within the range the EE
+      // maps to a NullReferenceException.
+      Opts["enable-implicit-null-checks"]->addOccurrence(
+          0, "enable-implicit-null-checks", "true");
+    }
   }
 
   return LLILCJit::TheJit;
@@ -241,18 +377,219 @@ extern "C" void __stdcall jitStartup(ICorJitHost *JitHost) {
   LLILCJit::TheJitHost = JitHost;
 }
 
+LLILCJitPerThreadState::~LLILCJitPerThreadState() {
+  for (auto &Entry : PipelineMap) {
+    assert((Entry.second == nullptr || !Entry.second->InUse) &&
+           "Destroying a pipeline that is in use");
+    delete Entry.second;
+  }
+  delete RecordChunk;
+}
+
 LLILCJitContext::LLILCJitContext(LLILCJitPerThreadState *PerThreadState)
     : HasLoadedBitCode(false), State(PerThreadState) {
   this->Next = State->JitContext;
   State->JitContext = this;
 }
 
+LLILCJitContext::LLILCJitContext(LLILCJitContext *Inliner,
+                                 CORINFO_METHOD_INFO *MethodInfo)
+    : LLILCJitContext(Inliner->State) {
+  JitInfo = Inliner->JitInfo;
+  this->MethodInfo = MethodInfo;
+  // The inlinee's variables are not reported, and it has no secret
+  // parameter of its own.
+  Flags = Inliner->Flags &
+          ~(CORJIT_FLG_DEBUG_INFO | CORJIT_FLG_PUBLISH_SECRET_PARAM);
+  EEInfo = Inliner->EEInfo;
+  const char *ModuleName = nullptr;
+  const char *Name = JitInfo->getMethodName(MethodInfo->ftn, &ModuleName);
+  MethodName = std::string(ModuleName) + "." + Name;
+  LLVMContext = Inliner->LLVMContext;
+  CurrentModule = Inliner->CurrentModule;
+  TM = Inliner->TM;
+  TheABIInfo = Inliner->TheABIInfo;
+  Options = Inliner->Options;
+  ClassProfile = Inliner->ClassProfile;
+  CastCache = Inliner->CastCache;
+  GcInfo = Inliner->GcInfo;
+  InlineDepth = Inliner->InlineDepth + 1;
+}
+
 LLILCJitContext::~LLILCJitContext() {
   LLILCJitContext *TopContext = State->JitContext;
   assert(this == TopContext && "Unbalanced contexts!");
   State->JitContext = TopContext->Next;
 }
 
+/// \brief Create the collection jit requests are recorded into, if
+/// recording was asked for.
+static CollectionWriter *createRecordCollection(LLILCJitContext &Context) {
+  std::string Path = JitOptions::queryRecordCollection(Context);
+  if (Path.empty()) {
+    return nullptr;
+  }
+
+  // Threads reserve space this many bytes at a time.
+  const uint64_t ChunkSize = 64 * 1024;
+  std::string Error;
+  std::unique_ptr<CollectionWriter> Writer = CollectionWriter::create(
+      Path, JitOptions::queryRecordCollectionSize(Context), ChunkSize, Error);
+  if (Writer == nullptr) {
+    errs() << "LLILC: not recording, cannot create " << Path << ": " << Error
+           << "\n";
+  }
+  return Writer.release();
+}
+
+/// \brief Get the collection jit requests are recorded into, or null if
+/// they are not being recorded.
+static CollectionWriter *getRecordCollection(LLILCJitContext &Context) {
+  // The writer is never destroyed: jit requests on other threads may still
+  // be recording while the process shuts down, and the file is complete
+  // as soon as each record is written.
+  static CollectionWriter *Writer = createRecordCollection(Context);
+  return Writer;
+}
+
+/// \brief The jit event log, for flushing at process exit.
+static JitEventLog *EventLogToFlush = nullptr;
+
+/// \brief Write out whatever is still in the jit event log's ring.
+static void flushEventLog() {
+  EventLogToFlush->flush();
+  if (EventLogToFlush->getNumLost() != 0) {
+    errs() << "LLILC: " << EventLogToFlush->getNumLost()
+           << " jit events were not logged\n";
+  }
+}
+
+/// \brief Create the log per-method jit events are written to, or return
+/// null if events are not being logged.
+static JitEventLog *createEventLog(LLILCJitContext &Context) {
+  std::string Path = JitOptions::queryEventLog(Context);
+  if (Path.empty()) {
+    return nullptr;
+  }
+
+  std::string Error;
+  bool IsJSON = StringRef(Path).endswith(".json");
+  JitEventLog *Log = JitEventLog::create(Path, IsJSON, Error);
+  if (Log == nullptr) {
+    errs() << "LLILC: not logging jit events, cannot create " << Path << ": "
+           << Error << "\n";
+    return nullptr;
+  }
+  EventLogToFlush = Log;
+  std::atexit(flushEventLog);
+  return Log;
+}
+
+/// \brief Get the log per-method jit events are written to, or null if
+/// events are not being logged.
+static JitEventLog *getEventLog(LLILCJitContext &Context) {
+  // Never destroyed, for the same reason as the record collection.
+  static JitEventLog *Log = createEventLog(Context);
+  return Log;
+}
+
+/// \brief Log the outcome and phase times of a jit request, if events are
+/// being logged.
+static void logJitEvent(LLILCJitContext &Context, CorJitResult Result,
+                        uint32_t NumBlocks, ULONG CodeSize) {
+  if (!Context.PhaseTimer.isEnabled()) {
+    return;
+  }
+  Context.PhaseTimer.stop();
+
+  JitEvent Event;
+  memset(&Event, 0, sizeof(Event));
+  Event.StartTime = Context.PhaseTimer.getStartTime();
+  Event.MethodHandle = (uint64_t)(uintptr_t)Context.MethodInfo->ftn;
+  Event.ThreadId =
+      (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+  Event.Result = Result;
+  Event.ILSize = Context.MethodInfo->ILCodeSize;
+  Event.NumBlocks = NumBlocks;
+  Event.CodeSize = CodeSize;
+  Event.NumBoundsChecksRemoved = Context.NumBoundsChecksRemoved;
+  Event.NumCallsDevirtualized = Context.NumCallsDevirtualized;
+  Event.NumCallsGuarded = Context.NumCallsGuarded;
+  Event.NumAllocationsRemoved = Context.NumAllocationsRemoved;
+  Event.NumBoxesRemoved = Context.NumBoxesRemoved;
+  Event.NumWriteBarriersRemoved = Context.NumWriteBarriersRemoved;
+  for (unsigned Phase = 0; Phase < NumJitPhases; ++Phase) {
+    Event.PhaseTime[Phase] = Context.PhaseTimer.getElapsed((JitPhase)Phase);
+  }
+  strncpy(Event.Name, Context.MethodName.c_str(), JitEvent::MaxNameLength);
+  getEventLog(Context)->log(Event);
+}
+
+/// \brief Create the writer that describes jitted code to the Linux perf
+/// tools, or return null if perf support was not asked for.
+static PerfMapWriter *createPerfMapWriter(LLILCJitContext &Context) {
+  std::string Error;
+  PerfMapWriter *Writer =
+      PerfMapWriter::create(JitOptions::queryDoPerfMap(Context),
+                            JitOptions::queryPerfJitDumpDir(Context), Error);
+  if (!Error.empty()) {
+    errs() << "LLILC: not writing perf maps: " << Error << "\n";
+  }
+  return Writer;
+}
+
+/// \brief Get the writer that describes jitted code to the Linux perf
+/// tools, or null if perf support was not asked for.
+static PerfMapWriter *getPerfMapWriter(LLILCJitContext &Context) {
+  // Never destroyed, for the same reason as the record collection.
+  static PerfMapWriter *Writer = createPerfMapWriter(Context);
+  return Writer;
+}
+
+/// \brief The receiver class profile, for writing at process exit.
+static ClassProfile *ClassProfileToWrite = nullptr;
+
+/// \brief Write the receiver class profile back to its file.
+static void writeClassProfile() {
+  std::string Error;
+  if (!ClassProfileToWrite->write(Error)) {
+    errs() << "LLILC: cannot write class profile: " << Error << "\n";
+  }
+}
+
+/// \brief Create the profile of receiver classes at virtual call sites,
+/// reading it from its file if there is one.
+static ClassProfile *createClassProfile(LLILCJitContext &Context) {
+  std::string Path = JitOptions::queryClassProfile(Context);
+  std::string Error;
+  ClassProfile *Profile = ClassProfile::create(Path, Error);
+  if (Profile == nullptr) {
+    errs() << "LLILC: not using class profile, cannot read " << Path << ": "
+           << Error << "\n";
+    return nullptr;
+  }
+  if (!Path.empty()) {
+    ClassProfileToWrite = Profile;
+    std::atexit(writeClassProfile);
+  }
+  return Profile;
+}
+
+/// \brief Get the profile of receiver classes at virtual call sites, or
+/// null if it could not be read.
+static ClassProfile *getClassProfile(LLILCJitContext &Context) {
+  // Never destroyed, since instrumented code refers to its sites.
+  static ClassProfile *Profile = createClassProfile(Context);
+  return Profile;
+}
+
+/// \brief Get the cells for caching the classes cast to interfaces.
+static CastCache *getCastCache() {
+  // Never destroyed, since compiled code refers to its cells.
+  static CastCache *Cache = new CastCache();
+  return Cache;
+}
+
 // This is the method invoked by the EE to Jit code.
 CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
                                      CORINFO_METHOD_INFO *MethodInfo,
@@ -278,6 +615,22 @@ CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
 
   // Set up context for this Jit request
   LLILCJitContext Context(PerThreadState);
+  Context.JitInfo = JitInfo;
+  if (getEventLog(Context) != nullptr) {
+    Context.PhaseTimer.start(EESetupPhase);
+  }
+
+  // If jit requests are being recorded, put the recorder between the jit
+  // and the EE so that it sees every query, starting with getEEInfo.
+  std::unique_ptr<RecordingJitInfo> Recorder;
+  if (CollectionWriter *Writer = getRecordCollection(Context)) {
+    if (PerThreadState->RecordChunk == nullptr) {
+      PerThreadState->RecordChunk = new CollectionChunk();
+    }
+    Recorder.reset(new RecordingJitInfo(
+        JitInfo, *Writer, *PerThreadState->RecordChunk, MethodInfo, Flags));
+    JitInfo = Recorder.get();
+  }
 
   // Fill in context information from the CLR
   Context.JitInfo = JitInfo;
@@ -309,18 +662,16 @@ CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
     ReaderBase::printMSIL(MethodInfo->ILCode, 0, MethodInfo->ILCodeSize);
   }
   CorJitResult Result = CORJIT_INTERNALERROR;
+  uint32_t NumBlocks = 0;
   if (JitOptions.IsAltJit && !JitOptions.IsExcludeMethod) {
     Context.Options = &JitOptions;
-
-    // Construct the TargetMachine that we will emit code for
-    std::string ErrStr;
-    const llvm::Target *TheTarget =
-        TargetRegistry::lookupTarget(LLILC_TARGET_TRIPLE, ErrStr);
-    if (!TheTarget) {
-      errs() << "Could not create Target: " << ErrStr << "\n";
-      return CORJIT_INTERNALERROR;
+    if (JitOptions.DoClassInstrument || JitOptions.DoGuardedDevirt) {
+      Context.ClassProfile = getClassProfile(Context);
     }
-    TargetOptions Options;
+    if (JitOptions.CastCacheExcludeFlags != 0) {
+      Context.CastCache = getCastCache();
+    }
+
     CodeGenOpt::Level OptLevel;
     bool IsNgen = Context.Flags & CORJIT_FLG_PREJIT;
     bool IsReadyToRun = Context.Flags & CORJIT_FLG_READYTORUN;
@@ -340,27 +691,31 @@ CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
     }
     llvm::CodeModel::Model CodeModel =
         (IsNgen || IsReadyToRun) ? CodeModel::Default : CodeModel::JITDefault;
-    TargetMachine *TM =
-        TheTarget->createTargetMachine(LLILC_TARGET_TRIPLE, "", "", Options,
-                                       Reloc::Default, CodeModel, OptLevel);
+
+    // Get the TargetMachine and jitting layers we will emit code with. These
+    // are cached per thread and only rebuilt when the configuration changes.
+    PipelineLease Lease(PerThreadState, OptLevel, CodeModel, Reloc::Default);
+    LLILCJitPipeline *Pipeline = Lease.get();
+    if (Pipeline == nullptr) {
+      logJitEvent(Context, CORJIT_INTERNALERROR, 0, 0);
+      return CORJIT_INTERNALERROR;
+    }
+    if (Context.Options->DumpLevel == DumpLevel::VERBOSE) {
+      dbgs() << "INFO:  " << (Lease.isReused() ? "reusing" : "created")
+             << " compilation pipeline (" << PerThreadState->PipelinesCreated
+             << " created, " << PerThreadState->PipelinesReused
+             << " reused on this thread)\n";
+    }
+    TargetMachine *TM = Pipeline->TM.get();
     Context.TM = TM;
 
     // Set target machine datalayout on the method module.
     Context.CurrentModule->setDataLayout(TM->createDataLayout());
 
-    // Construct the jitting layers.
+    // Bind this request's memory manager and load listener to the layers.
     EEMemoryManager MM(&Context);
-    ObjectLoadListener Listener(&Context);
-    orc::EEObjectLinkingLayer<decltype(Listener)> Loader(Listener);
-    auto ReserveUnwindSpace =
-        [&MM](std::unique_ptr<object::OwningBinary<object::ObjectFile>> Obj) {
-          MM.reserveUnwindSpace(*Obj->getBinary());
-          return std::move(Obj);
-        };
-    orc::ObjectTransformLayer<decltype(Loader), decltype(ReserveUnwindSpace)>
-        UnwindReserver(Loader, ReserveUnwindSpace);
-    orc::IRCompileLayer<decltype(UnwindReserver)> Compiler(
-        UnwindReserver, orc::LLILCCompiler(*TM));
+    Pipeline->bind(&Context, &MM);
+    auto &Compiler = Pipeline->Compiler;
 
     // Now jit the method.
     if (Context.Options->DumpLevel == DumpLevel::VERBOSE) {
@@ -369,6 +724,10 @@ CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
     }
     bool ContainsUnmanagedCall;
     bool HasMethod = this->readMethod(&Context, ContainsUnmanagedCall);
+    if (HasMethod) {
+      Function *Method = M->getFunction(Context.MethodName);
+      NumBlocks = (Method != nullptr) ? Method->size() : 0;
+    }
 
 #ifndef FEATURE_VERIFICATION
     bool IsImportOnly = (Context.Flags & CORJIT_FLG_IMPORT_ONLY) != 0;
@@ -381,6 +740,10 @@ CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
 
       JitInfo->setMethodAttribs(MethodInfo->ftn, verFlag);
 
+      if (Recorder != nullptr) {
+        Recorder->setResult(Result);
+      }
+      logJitEvent(Context, Result, NumBlocks, 0);
       return Result;
     }
 #endif
@@ -391,11 +754,20 @@ CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
                << "\n";
         Context.CurrentModule->dump();
       }
+      // Run the IR optimizer. This must happen before statepoints are
+      // inserted, while GC pointers are still tracked implicitly.
+      if (JitOptions.DoTimePasses) {
+        TimePassesIsEnabled = true;
+      }
+      Context.PhaseTimer.enterPhase(OptimizePhase);
+      optimizeMethod(&Context);
+
       // If using Precise GC, run the GC-Safepoint insertion
       // and lowering passes before generating code.  If
       // using conservative GC but the function has an unmanaged
       // call, skip safepoint insertion but run the lowering
       // pass to lower the gc-transition arguments.
+      Context.PhaseTimer.enterPhase(StatepointPhase);
       if (ContainsUnmanagedCall || Context.Options->DoInsertStatepoints) {
         legacy::PassManager Passes;
         if (Context.Options->DoInsertStatepoints) {
@@ -410,11 +782,51 @@ CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
       // report relocations for those symbols via Jit interface's
       // recordRelocation method.
       EESymbolResolver Resolver(&Context.NameToHandleMap);
-      auto HandleSet =
-          Compiler.addModuleSet<ArrayRef<Module *>>(M.get(), &MM, &Resolver);
+      Context.PhaseTimer.enterPhase(CodeGenPhase);
+      decltype(Pipeline->Compiler)::ModuleSetHandleT HandleSet;
+      bool IsLinked = false;
+
+      // Try to emit straight into the EE's memory, if asked to. Otherwise,
+      // or if that isn't possible, the compiler hands back an object file,
+      // which is loaded as usual.
+      DirectEmission Emission(&Context, &MM, JitOptions.DoDirectEmit);
+      std::vector<std::unique_ptr<OwningBinary<ObjectFile>>> Objects;
+      Objects.push_back(llvm::make_unique<OwningBinary<ObjectFile>>(
+          orc::LLILCCompiler(*TM)(*M, Emission)));
+      if (Emission.IsEmitted) {
+        *NativeEntry = MM.getHotCodeBlock();
+      } else {
+        if (JitOptions.DoDirectEmit &&
+            (Context.Options->DumpLevel == DumpLevel::VERBOSE)) {
+          dbgs() << "INFO:  emitting object file for " << Context.MethodName
+                 << ": " << Emission.FallbackReason << "\n";
+        }
+        HandleSet = Pipeline->UnwindReserver.addObjectSet(std::move(Objects),
+                                                          &MM, &Resolver);
+        IsLinked = true;
+
+        // Finding the symbol loads the object, which reports its
+        // relocations.
+        Context.PhaseTimer.enterPhase(LinkPhase);
+        *NativeEntry =
+            (BYTE *)Compiler.findSymbol(Context.MethodName, false).getAddress();
+      }
 
-      *NativeEntry =
-          (BYTE *)Compiler.findSymbol(Context.MethodName, false).getAddress();
+      // The native offsets of the debug info labels are known once the code
+      // has been laid out.
+      Context.PhaseTimer.enterPhase(DebugInfoPhase);
+      reportDebugInfo(&Context);
+
+      // The EE needs no table of implicit null checks: it maps any fault
+      // near null in jitted code to a NullReferenceException.
+      if ((JitOptions.DumpLevel == DumpLevel::VERBOSE) &&
+          !Context.ImplicitNullChecks.empty()) {
+        dbgs() << "INFO:  implicit null checks at";
+        for (const auto &NullCheck : Context.ImplicitNullChecks) {
+          dbgs() << format(" 0x%x", NullCheck.second);
+        }
+        dbgs() << "\n";
+      }
 
       // TODO: ColdCodeSize, or separated code, is not enabled or included.
       *NativeSizeOfCode = Context.HotCodeSize + Context.ReadOnlyDataSize;
@@ -425,6 +837,11 @@ CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
                << ", size = " << *NativeSizeOfCode
                << " method = " << Context.MethodName << '\n';
       }
+      if (PerfMapWriter *PerfMap = getPerfMapWriter(Context)) {
+        PerfMap->logMethod(Context.MethodName, *NativeEntry,
+                           Context.HotCodeSize, Context.OffsetMappings,
+                           PerThreadState->PerfBuffer);
+      }
 
       // The Method Jitted must begin at the start of the allocated
       // Code block. The EE's DebugInfoManager relies on this.
@@ -433,23 +850,27 @@ CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
       // at a fixed offset from *NativeEntry.
       assert(*NativeEntry == MM.getHotCodeBlock() &&
              "Expect the JITted method at the beginning of the code block");
+      Context.PhaseTimer.enterPhase(GCInfoPhase);
       GcInfoAllocator GcInfoAllocator;
       GcInfoEmitter GcInfoEmitter(&Context, MM.getStackMapSection(),
                                   &GcInfoAllocator);
       GcInfoEmitter.emitGCInfo();
 
       // Dump out any enabled timing info.
-      TimerGroup::printAll(errs());
+      if (JitOptions.DoTimePasses) {
+        TimerGroup::printAll(errs());
+      }
 
       // Give the jit layers a chance to free resources.
-      Compiler.removeModuleSet(HandleSet);
+      if (IsLinked) {
+        Compiler.removeModuleSet(HandleSet);
+      }
 
       // Tell the CLR that we've successfully generated code for this method.
       Result = CORJIT_OK;
     }
 
-    // Clean up a bit
-    delete Context.TM;
+    // The TargetMachine is owned by the pipeline.
     Context.TM = nullptr;
   } else {
     // This method was not selected for jitting by LLILC.
@@ -459,12 +880,23 @@ CorJitResult LLILCJit::compileMethod(ICorJitInfo *JitInfo,
     }
   }
 
+  if (JitOptions.DumpLevel == DumpLevel::VERBOSE) {
+    dbgs() << "INFO:  jit memory for " << Context.MethodName << ": temp peak "
+           << Context.TempArena.getPeakBytesAllocated() << " bytes, proc "
+           << Context.ProcArena.getBytesAllocated() << " bytes in "
+           << Context.ProcArena.getNumChunks() << " chunks\n";
+  }
+
   // Clean up a bit more
   delete Context.TheABIInfo;
   delete Context.GcInfo;
   Context.TheABIInfo = nullptr;
   Context.GcInfo = nullptr;
 
+  if (Recorder != nullptr) {
+    Recorder->setResult(Result);
+  }
+  logJitEvent(Context, Result, NumBlocks, *NativeSizeOfCode);
   return Result;
 }
 
@@ -524,6 +956,7 @@ bool LLILCJit::readMethod(LLILCJitContext *JitContext,
   DumpLevel DumpLevel = JitContext->Options->DumpLevel;
   std::string FuncName = JitContext->MethodName;
 
+  JitContext->PhaseTimer.enterPhase(ReaderPrePassPhase);
   try {
     GenIR Reader(JitContext);
     Reader.msilToIR();
@@ -532,9 +965,13 @@ bool LLILCJit::readMethod(LLILCJitContext *JitContext,
     if (DumpLevel >= ::DumpLevel::SUMMARY) {
       errs() << "Failed to read " << FuncName << '[' << Nyi.reason() << "]\n";
     }
+    releaseReaderMemory(JitContext);
     return false;
   }
 
+  releaseReaderMemory(JitContext);
+
+  JitContext->PhaseTimer.enterPhase(VerifyPhase);
   bool IsOk = !verifyModule(*JitContext->CurrentModule, &dbgs());
   assert(IsOk && "verification failed");
 
@@ -556,6 +993,92 @@ bool LLILCJit::readMethod(LLILCJitContext *JitContext,
   return IsOk;
 }
 
+void LLILCJit::optimizeMethod(LLILCJitContext *JitContext) {
+  ::OptLevel OptLevel = JitContext->Options->OptLevel;
+  if (OptLevel == ::OptLevel::DEBUG_CODE) {
+    return;
+  }
+
+  // The pipeline is built by hand rather than via PassManagerBuilder so that
+  // only passes that are safe on the pre-statepoint managed IR are run:
+  // - No inlining or IPO; the reader has done the inlining, and the module
+  //   holds just the method being jitted.
+  // - No vectorization; vectors of GC pointers are not reported correctly.
+  // - No LoopIdiom or MemCpyOpt; these can introduce memset/memcpy calls
+  //   that copy GC references without the required write barriers.
+  bool IsSmall = (OptLevel == ::OptLevel::SMALL_CODE);
+  bool IsFast = (OptLevel == ::OptLevel::FAST_CODE);
+  legacy::PassManager Passes;
+  Passes.add(createTargetTransformInfoWrapperPass(
+      JitContext->TM->getTargetIRAnalysis()));
+
+  // Use the reader's TBAA tags, which tell apart fields, array elements and
+  // lengths, so that LICM and GVN can move loads past unrelated stores.
+  Passes.add(createTypeBasedAAWrapperPass());
+
+  // Promote the reader's locals and clean up the resulting IR.
+  Passes.add(createSROAPass());
+  Passes.add(createEarlyCSEPass());
+
+  // Move objects that don't escape to the stack, once the reader's inlining
+  // has exposed their constructors' stores, and break up those without GC
+  // pointers into scalars.
+  if (JitContext->Options->DoStackAllocation) {
+    Passes.add(new StackAllocation(JitContext));
+    Passes.add(createSROAPass());
+  }
+
+  // Remove redundant array bounds checks while the compares are still as
+  // the reader tagged them; InstCombine may rewrite them.
+  Passes.add(new BoundsCheckElimination(JitContext));
+  Passes.add(createCFGSimplificationPass());
+  Passes.add(createInstructionCombiningPass());
+  if (IsFast) {
+    Passes.add(createJumpThreadingPass());
+    Passes.add(createCorrelatedValuePropagationPass());
+  }
+  Passes.add(createReassociatePass());
+
+  // Loop optimizations.
+  Passes.add(createLoopRotatePass(IsSmall ? 0 : -1));
+  // Move class initialization out of the rotated loops before LICM, so that
+  // the loads of static fields that follow it may be moved too.
+  Passes.add(new ClassInitOptimization(JitContext));
+  Passes.add(createLICMPass());
+  if (IsFast) {
+    Passes.add(createIndVarSimplifyPass());
+    Passes.add(createLoopDeletionPass());
+  }
+
+  // Redundancy elimination and final cleanup.
+  Passes.add(createGVNPass());
+  Passes.add(createSCCPPass());
+  Passes.add(createInstructionCombiningPass());
+  Passes.add(createDeadStoreEliminationPass());
+  Passes.add(createAggressiveDCEPass());
+  Passes.add(createCFGSimplificationPass());
+
+  // Remove the write barriers the GC doesn't need, and expand the others
+  // inline if asked to. This comes last, since no store whose barrier was
+  // removed may move past a safepoint.
+  Passes.add(new WriteBarrierOptimization(JitContext));
+
+  // Gather the rarely run blocks at the end of the method, once no more
+  // blocks will be added or merged.
+  Passes.add(new ColdBlockLayout(JitContext));
+  Passes.run(*JitContext->CurrentModule);
+}
+
+void LLILCJit::releaseReaderMemory(LLILCJitContext *JitContext) {
+  ArenaAllocator &Arena = JitContext->TempArena;
+  if (JitContext->Options->DumpLevel == ::DumpLevel::VERBOSE) {
+    dbgs() << "INFO:  reader temp memory: " << Arena.getBytesAllocated()
+           << " bytes in " << Arena.getNumAllocations() << " allocations, "
+           << Arena.getNumChunks() << " chunks\n";
+  }
+  Arena.reset();
+}
+
 // Notification from the runtime that any caches should be cleaned up.
 void LLILCJit::clearCache() { return; }
 
@@ -581,108 +1104,6 @@ void LLILCJit::signalHandler(void *Cookie) {
   // do nothing
 }
 
-void ObjectLoadListener::getDebugInfoForObject(
-    const ObjectFile &Obj, const RuntimeDyld::LoadedObjectInfo &L) {
-  OwningBinary<ObjectFile> DebugObjOwner = L.getObjectForDebug(Obj);
-  const ObjectFile &DebugObj = *DebugObjOwner.getBinary();
-
-  // TODO: This extracts DWARF information from the object file, but we will
-  // want to also be able to eventually extract WinCodeView information as well
-  DWARFContextInMemory DwarfContext(DebugObj);
-
-  // Use symbol info to find the function size.
-  // If there are funclets, they will each have separate symbols, so we need
-  // to sum the sizes, since the EE wants a single report for the entire
-  // function+funclets.
-
-  uint64_t Addr = UINT64_MAX;
-  uint64_t Size = 0;
-
-  std::vector<std::pair<SymbolRef, uint64_t>> SymbolSizes =
-      object::computeSymbolSizes(DebugObj);
-
-  for (const auto &Pair : SymbolSizes) {
-    object::SymbolRef Symbol = Pair.first;
-    SymbolRef::Type SymType = Symbol.getType();
-    if (SymType != SymbolRef::ST_Function)
-      continue;
-
-    // Function info
-    ErrorOr<uint64_t> AddrOrError = Symbol.getAddress();
-    if (!AddrOrError) {
-      continue; // Error.
-    }
-    uint64_t SingleAddr = AddrOrError.get();
-    uint64_t SingleSize = Pair.second;
-    if (SingleAddr < Addr) {
-      // The main function is always laid out first
-      Addr = SingleAddr;
-    }
-    Size += SingleSize;
-  }
-
-  uint32_t LastDebugOffset = (uint32_t)-1;
-  uint32_t NumDebugRanges = 0;
-  ICorDebugInfo::OffsetMapping *OM;
-
-  DILineInfoTable Lines = DwarfContext.getLineInfoForAddressRange(Addr, Size);
-
-  DILineInfoTable::iterator Begin = Lines.begin();
-  DILineInfoTable::iterator End = Lines.end();
-
-  // Count offset entries. Will skip an entry if the current IL offset
-  // matches the previous offset.
-  for (DILineInfoTable::iterator It = Begin; It != End; ++It) {
-    uint32_t LineNumber = (It->second).Line;
-
-    if (LineNumber != LastDebugOffset) {
-      NumDebugRanges++;
-      LastDebugOffset = LineNumber;
-    }
-  }
-
-  // Reset offset
-  LastDebugOffset = (uint32_t)-1;
-
-  if (NumDebugRanges > 0) {
-    // Allocate OffsetMapping array
-    unsigned SizeOfArray =
-        (NumDebugRanges) * sizeof(ICorDebugInfo::OffsetMapping);
-    OM = (ICorDebugInfo::OffsetMapping *)Context->JitInfo->allocateArray(
-        SizeOfArray);
-
-    unsigned CurrentDebugEntry = 0;
-
-    // Iterate through the debug entries and save IL offset, native
-    // offset, and source reason
-    for (DILineInfoTable::iterator It = Begin; It != End; ++It) {
-      int Offset = It->first;
-      uint32_t LineNumber = (It->second).Line;
-
-      // We store info about if the instruction is being recorded because
-      // it is a call in the column field
-      bool IsCall = (It->second).Column == 1;
-
-      if (LineNumber != LastDebugOffset) {
-        LastDebugOffset = LineNumber;
-        OM[CurrentDebugEntry].nativeOffset = Offset;
-        OM[CurrentDebugEntry].ilOffset = LineNumber;
-        OM[CurrentDebugEntry].source = IsCall ? ICorDebugInfo::CALL_INSTRUCTION
-                                              : ICorDebugInfo::STACK_EMPTY;
-        CurrentDebugEntry++;
-      }
-    }
-
-    // Send array of OffsetMappings to CLR EE
-    CORINFO_METHOD_INFO *MethodInfo = Context->MethodInfo;
-    CORINFO_METHOD_HANDLE MethodHandle = MethodInfo->ftn;
-
-    Context->JitInfo->setBoundaries(MethodHandle, NumDebugRanges, OM);
-
-    getDebugInfoForLocals(DwarfContext, Addr, Size);
-  }
-}
-
 void ObjectLoadListener::recordRelocations(
     const ObjectFile &Obj, const RuntimeDyld::LoadedObjectInfo &L) {
   for (section_iterator SI = Obj.section_begin(), SE = Obj.section_end();
@@ -799,171 +1220,6 @@ uint64_t ObjectLoadListener::getRelocationType(uint64_t LLVMRelocationType) {
   }
 }
 
-void ObjectLoadListener::getDebugInfoForLocals(
-    DWARFContextInMemory &DwarfContext, uint64_t Addr, uint64_t Size) {
-  for (const auto &CU : DwarfContext.compile_units()) {
-    const DWARFDebugInfoEntryMinimal *UnitDIE = CU->getUnitDIE(false);
-    const DWARFDebugInfoEntryMinimal *SubprogramDIE = getSubprogramDIE(UnitDIE);
-
-    ICorDebugInfo::RegNum FrameBaseRegister = ICorDebugInfo::REGNUM_COUNT;
-    DWARFFormValue FormValue;
-
-    // Find the frame_base register value
-    if (SubprogramDIE->getAttributeValue(CU.get(), dwarf::DW_AT_frame_base,
-                                         FormValue)) {
-      Optional<ArrayRef<uint8_t>> FormValues = FormValue.getAsBlock();
-      FrameBaseRegister = mapDwarfRegisterToRegNum(FormValues->back());
-    }
-
-    if (SubprogramDIE->getAttributeValue(CU.get(), dwarf::DW_AT_low_pc,
-                                         FormValue)) {
-      Optional<uint64_t> FormAddress = FormValue.getAsAddress(CU.get());
-
-      // If the Form address doesn't match the address for the function passed
-      // do not collect debug for locals since they do not go with the current
-      // function being processed
-      if (FormAddress.getValue() != Addr) {
-        return;
-      }
-    }
-
-    std::vector<uint64_t> Offsets;
-    extractLocalLocations(CU.get(), SubprogramDIE, Offsets);
-
-    // Allocate the array of NativeVarInfo objects that will be sent to the EE
-    ICorDebugInfo::NativeVarInfo *LocalVars;
-    unsigned SizeOfArray =
-        Offsets.size() * sizeof(ICorDebugInfo::NativeVarInfo);
-    if (SizeOfArray > 0) {
-      LocalVars =
-          (ICorDebugInfo::NativeVarInfo *)Context->JitInfo->allocateArray(
-              SizeOfArray);
-
-      unsigned CurrentDebugEntry = 0;
-
-      for (auto &Offset : Offsets) {
-        LocalVars[CurrentDebugEntry].startOffset = Addr;
-        LocalVars[CurrentDebugEntry].endOffset = Addr + Size;
-        LocalVars[CurrentDebugEntry].varNumber = CurrentDebugEntry;
-
-        // Assume all locals are on the stack
-        ICorDebugInfo::VarLoc VarLoc;
-        VarLoc.vlType = ICorDebugInfo::VLT_STK;
-        VarLoc.vlStk.vlsBaseReg = FrameBaseRegister;
-        VarLoc.vlStk.vlsOffset = Offset;
-
-        LocalVars[CurrentDebugEntry].loc = VarLoc;
-
-        CurrentDebugEntry++;
-      }
-
-      CORINFO_METHOD_INFO *MethodInfo = Context->MethodInfo;
-      CORINFO_METHOD_HANDLE MethodHandle = MethodInfo->ftn;
-
-      Context->JitInfo->setVars(MethodHandle, Offsets.size(), LocalVars);
-    }
-  }
-}
-
-void ObjectLoadListener::extractLocalLocations(
-    const DWARFUnit *CU, const DWARFDebugInfoEntryMinimal *DebugEntry,
-    std::vector<uint64_t> &Offsets) {
-  if (DebugEntry->isNULL())
-    return;
-  if (DebugEntry->getTag() == dwarf::DW_TAG_formal_parameter ||
-      DebugEntry->getTag() == dwarf::DW_TAG_variable) {
-    uint64_t Offset;
-
-    // Extract offset for each local found
-    DWARFFormValue FormValue;
-    if (DebugEntry->getAttributeValue(CU, dwarf::DW_AT_location, FormValue)) {
-      Optional<ArrayRef<uint8_t>> FormValues = FormValue.getAsBlock();
-      Offset = FormValues->back();
-    }
-
-    Offsets.push_back(Offset);
-  }
-
-  const DWARFDebugInfoEntryMinimal *Child = DebugEntry->getFirstChild();
-
-  // Extract info for DebugEntry's child and its child's siblings.
-  while (Child) {
-    extractLocalLocations(CU, Child, Offsets);
-    Child = Child->getSibling();
-  }
-}
-
-const DWARFDebugInfoEntryMinimal *ObjectLoadListener::getSubprogramDIE(
-    const DWARFDebugInfoEntryMinimal *DebugEntry) {
-  if (DebugEntry->isSubprogramDIE())
-    return DebugEntry;
-  else if (DebugEntry->hasChildren())
-    return getSubprogramDIE(DebugEntry->getFirstChild());
-  else
-    return nullptr;
-}
-
-ICorDebugInfo::RegNum
-ObjectLoadListener::mapDwarfRegisterToRegNum(uint8_t DwarfRegister) {
-  ICorDebugInfo::RegNum Register = ICorDebugInfo::REGNUM_COUNT;
-#if _TARGET_AMD64_
-  switch (DwarfRegister) {
-  case dwarf::DW_OP_reg0:
-    Register = ICorDebugInfo::REGNUM_RAX;
-    break;
-  case dwarf::DW_OP_reg1:
-    Register = ICorDebugInfo::REGNUM_RDX;
-    break;
-  case dwarf::DW_OP_reg2:
-    Register = ICorDebugInfo::REGNUM_RCX;
-    break;
-  case dwarf::DW_OP_reg3:
-    Register = ICorDebugInfo::REGNUM_RBX;
-    break;
-  case dwarf::DW_OP_reg4:
-    Register = ICorDebugInfo::REGNUM_RSI;
-    break;
-  case dwarf::DW_OP_reg5:
-    Register = ICorDebugInfo::REGNUM_RDI;
-    break;
-  case dwarf::DW_OP_reg6:
-    Register = ICorDebugInfo::REGNUM_RBP;
-    break;
-  case dwarf::DW_OP_reg7:
-    Register = ICorDebugInfo::REGNUM_RSP;
-    break;
-  case dwarf::DW_OP_reg8:
-    Register = ICorDebugInfo::REGNUM_R8;
-    break;
-  case dwarf::DW_OP_reg9:
-    Register = ICorDebugInfo::REGNUM_R9;
-    break;
-  case dwarf::DW_OP_reg10:
-    Register = ICorDebugInfo::REGNUM_R10;
-    break;
-  case dwarf::DW_OP_reg11:
-    Register = ICorDebugInfo::REGNUM_R11;
-    break;
-  case dwarf::DW_OP_reg12:
-    Register = ICorDebugInfo::REGNUM_R12;
-    break;
-  case dwarf::DW_OP_reg13:
-    Register = ICorDebugInfo::REGNUM_R13;
-    break;
-  case dwarf::DW_OP_reg14:
-    Register = ICorDebugInfo::REGNUM_R14;
-    break;
-  case dwarf::DW_OP_reg15:
-    Register = ICorDebugInfo::REGNUM_R15;
-    break;
-  default:
-    Register = ICorDebugInfo::REGNUM_COUNT;
-    break;
-  }
-#endif
-  return Register;
-}
-
 unsigned LLILCJit::getMaxIntrinsicSIMDVectorLength(DWORD CpuCompileFlags) {
   return getLLILCJitContext()->Options->PreferredIntrinsicSIMDVectorLength;
 }
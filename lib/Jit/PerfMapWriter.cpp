@@ -0,0 +1,292 @@
+//===----------------- lib/Jit/PerfMapWriter.cpp ----------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the perf map and jitdump writer.
+///
+/// The jitdump format is described by
+/// tools/perf/Documentation/jitdump-specification.txt in the Linux sources.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "PerfMapWriter.h"
+#include "llvm/ADT/StringExtras.h"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+#if defined(__linux__)
+
+namespace {
+
+const uint32_t JitDumpMagic = 0x4A695444; // "JiTD"
+const uint32_t JitDumpVersion = 1;
+
+enum JitDumpRecordId : uint32_t { JitCodeLoad = 0, JitCodeDebugInfo = 2 };
+
+struct JitDumpFileHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t TotalSize;
+  uint32_t ElfMach;
+  uint32_t Pad1;
+  uint32_t Pid;
+  uint64_t Timestamp;
+  uint64_t Flags;
+};
+
+struct JitDumpRecordHeader {
+  uint32_t Id;
+  uint32_t TotalSize;
+  uint64_t Timestamp;
+};
+
+struct JitDumpCodeLoad {
+  uint32_t Pid;
+  uint32_t Tid;
+  uint64_t Vma;
+  uint64_t CodeAddr;
+  uint64_t CodeSize;
+  uint64_t CodeIndex;
+  // Followed by the nul-terminated name and the code bytes.
+};
+
+struct JitDumpDebugInfo {
+  uint64_t CodeAddr;
+  uint64_t NumEntries;
+  // Followed by NumEntries entries.
+};
+
+struct JitDumpDebugEntry {
+  uint64_t CodeAddr;
+  uint32_t Line;
+  uint32_t Discriminator;
+  // Followed by the nul-terminated file name.
+};
+
+/// ELF machine of the code the jit produces.
+uint32_t getElfMachine() {
+#if defined(__x86_64__)
+  return 62; // EM_X86_64
+#elif defined(__aarch64__)
+  return 183; // EM_AARCH64
+#elif defined(__arm__)
+  return 40; // EM_ARM
+#elif defined(__i386__)
+  return 3; // EM_386
+#else
+  return 0;
+#endif
+}
+
+/// perf correlates jitdump records with samples by CLOCK_MONOTONIC time.
+uint64_t getTimestamp() {
+  struct timespec Now;
+  clock_gettime(CLOCK_MONOTONIC, &Now);
+  return (uint64_t)Now.tv_sec * 1000000000 + Now.tv_nsec;
+}
+
+template <typename T> void put(std::vector<char> &Buffer, const T &Value) {
+  const char *Bytes = (const char *)&Value;
+  Buffer.insert(Buffer.end(), Bytes, Bytes + sizeof(T));
+}
+
+void putBytes(std::vector<char> &Buffer, const void *Data, size_t Size) {
+  const char *Bytes = (const char *)Data;
+  Buffer.insert(Buffer.end(), Bytes, Bytes + Size);
+}
+
+void putString(std::vector<char> &Buffer, StringRef String) {
+  putBytes(Buffer, String.data(), String.size());
+  Buffer.push_back('\0');
+}
+
+/// Patch the size of the record that starts at \p Start.
+void finishRecord(std::vector<char> &Buffer, size_t Start) {
+  uint32_t Size = Buffer.size() - Start;
+  memcpy(&Buffer[Start] + offsetof(JitDumpRecordHeader, TotalSize), &Size,
+         sizeof(Size));
+}
+
+} // namespace
+
+PerfMapWriter *PerfMapWriter::create(bool WritePerfMap,
+                                     const std::string &JitDumpDir,
+                                     std::string &Error) {
+  if (!WritePerfMap && JitDumpDir.empty()) {
+    return nullptr;
+  }
+
+  std::unique_ptr<PerfMapWriter> Writer(new PerfMapWriter());
+  std::string Pid = std::to_string(getpid());
+
+  if (WritePerfMap) {
+    std::string Path = "/tmp/perf-" + Pid + ".map";
+    Writer->PerfMapFD =
+        open(Path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (Writer->PerfMapFD == -1) {
+      Error = "cannot open " + Path + ": " + strerror(errno);
+      return nullptr;
+    }
+  }
+
+  if (!JitDumpDir.empty()) {
+    std::string Path = JitDumpDir + "/jit-" + Pid + ".dump";
+    Writer->JitDumpFD = open(Path.c_str(),
+                             O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+                             0644);
+    if (Writer->JitDumpFD == -1) {
+      Error = "cannot open " + Path + ": " + strerror(errno);
+      return nullptr;
+    }
+
+    JitDumpFileHeader Header;
+    memset(&Header, 0, sizeof(Header));
+    Header.Magic = JitDumpMagic;
+    Header.Version = JitDumpVersion;
+    Header.TotalSize = sizeof(Header);
+    Header.ElfMach = getElfMachine();
+    Header.Pid = getpid();
+    Header.Timestamp = getTimestamp();
+    std::vector<char> Buffer;
+    put(Buffer, Header);
+    append(Writer->JitDumpFD, Buffer);
+
+    // perf finds the jitdump file through an executable mapping of it in
+    // the profiled process.
+    void *Marker = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC,
+                        MAP_PRIVATE, Writer->JitDumpFD, 0);
+    if (Marker == MAP_FAILED) {
+      Error = "cannot map " + Path + ": " + strerror(errno);
+      return nullptr;
+    }
+    Writer->JitDumpMarker = Marker;
+  }
+
+  return Writer.release();
+}
+
+PerfMapWriter::~PerfMapWriter() {
+  if (JitDumpMarker != nullptr) {
+    munmap(JitDumpMarker, sysconf(_SC_PAGESIZE));
+  }
+  if (JitDumpFD != -1) {
+    close(JitDumpFD);
+  }
+  if (PerfMapFD != -1) {
+    close(PerfMapFD);
+  }
+}
+
+void PerfMapWriter::append(int FD, const std::vector<char> &Buffer) {
+  // The file is opened for appending, so concurrent writes from other
+  // threads land whole and in some order. A short write (e.g. a full disk)
+  // loses this method's entry.
+  ssize_t Written;
+  do {
+    Written = write(FD, Buffer.data(), Buffer.size());
+  } while ((Written == -1) && (errno == EINTR));
+}
+
+void PerfMapWriter::logMethod(const std::string &Name, const uint8_t *Code,
+                              size_t CodeSize,
+                              ArrayRef<ICorDebugInfo::OffsetMapping> Mappings,
+                              std::vector<char> &Buffer) {
+  if (PerfMapFD != -1) {
+    Buffer.clear();
+    std::string Line = utohexstr((uintptr_t)Code) + " " +
+                       utohexstr(CodeSize) + " " + Name + "\n";
+    putBytes(Buffer, Line.data(), Line.size());
+    append(PerfMapFD, Buffer);
+  }
+
+  if (JitDumpFD == -1) {
+    return;
+  }
+
+  Buffer.clear();
+  uint64_t Timestamp = getTimestamp();
+  std::string FileName = Name + ".il";
+
+  // The debug info has to precede the code it describes.
+  uint64_t NumEntries = 0;
+  for (const auto &Mapping : Mappings) {
+    if (((int32_t)Mapping.ilOffset >= 0) && (Mapping.nativeOffset < CodeSize)) {
+      NumEntries++;
+    }
+  }
+  if (NumEntries > 0) {
+    size_t Start = Buffer.size();
+    put(Buffer, JitDumpRecordHeader{JitCodeDebugInfo, 0, Timestamp});
+    put(Buffer, JitDumpDebugInfo{(uint64_t)(uintptr_t)Code, NumEntries});
+    bool First = true;
+    for (const auto &Mapping : Mappings) {
+      // Skip the prolog, epilog and no-mapping markers.
+      if (((int32_t)Mapping.ilOffset < 0) ||
+          (Mapping.nativeOffset >= CodeSize)) {
+        continue;
+      }
+      put(Buffer, JitDumpDebugEntry{(uint64_t)(uintptr_t)Code +
+                                        Mapping.nativeOffset,
+                                    Mapping.ilOffset, 0});
+      // A name of "\xff" repeats the previous entry's file name.
+      putString(Buffer, First ? StringRef(FileName) : StringRef("\xff"));
+      First = false;
+    }
+    finishRecord(Buffer, Start);
+  }
+
+  size_t Start = Buffer.size();
+  put(Buffer, JitDumpRecordHeader{JitCodeLoad, 0, Timestamp});
+  put(Buffer, JitDumpCodeLoad{(uint32_t)getpid(),
+                              (uint32_t)syscall(SYS_gettid),
+                              (uint64_t)(uintptr_t)Code,
+                              (uint64_t)(uintptr_t)Code, CodeSize,
+                              NextCodeIndex.fetch_add(1)});
+  putString(Buffer, Name);
+  putBytes(Buffer, Code, CodeSize);
+  finishRecord(Buffer, Start);
+
+  append(JitDumpFD, Buffer);
+}
+
+#else // !defined(__linux__)
+
+PerfMapWriter *PerfMapWriter::create(bool WritePerfMap,
+                                     const std::string &JitDumpDir,
+                                     std::string &Error) {
+  if (WritePerfMap || !JitDumpDir.empty()) {
+    Error = "perf maps and jitdump files are only written on Linux";
+  }
+  return nullptr;
+}
+
+PerfMapWriter::~PerfMapWriter() {}
+
+void PerfMapWriter::append(int FD, const std::vector<char> &Buffer) {}
+
+void PerfMapWriter::logMethod(const std::string &Name, const uint8_t *Code,
+                              size_t CodeSize,
+                              ArrayRef<ICorDebugInfo::OffsetMapping> Mappings,
+                              std::vector<char> &Buffer) {}
+
+#endif // defined(__linux__)
@@ -0,0 +1,420 @@
+//===--------------- lib/Jit/StackAllocation.cpp ----------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the pass that moves objects which do not escape
+/// the method allocating them from the GC heap to the stack.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "LLILCJit.h"
+#include "GcInfo.h"
+#include "StackAllocation.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/CFG.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+
+namespace {
+
+/// \brief An instruction that uses an object or a pointer derived from it.
+struct ObjectUse {
+  Instruction *User; ///< The instruction.
+  Value *Pointer;    ///< The object, or the pointer derived from it, used.
+};
+
+/// \brief The uses of one allocation.
+class ObjectUses {
+public:
+  ObjectUses(const DataLayout &DL, unsigned WriteBarrierKind)
+      : DL(DL), WriteBarrierKind(WriteBarrierKind) {}
+
+  /// \brief Find the uses of \p Allocation and of the pointers derived from
+  /// it.
+  ///
+  /// \returns True if every use only accesses the first \p ObjectSize bytes
+  /// of the object, and none lets the object escape.
+  bool find(Instruction *Allocation, uint64_t ObjectSize);
+
+  /// Uses in the order they were found, so that a pointer is found before
+  /// its uses.
+  SmallVector<ObjectUse, 16> Uses;
+
+private:
+  /// \brief Check whether an access of \p Size bytes at \p Offset is
+  /// within the object.
+  bool isInObject(int64_t Offset, uint64_t Size) const {
+    return (Offset >= 0) && ((uint64_t)Offset + Size <= ObjectSize);
+  }
+
+  const DataLayout &DL;
+  unsigned WriteBarrierKind;
+  uint64_t ObjectSize;
+};
+
+} // namespace
+
+bool ObjectUses::find(Instruction *Allocation, uint64_t ObjectSize) {
+  this->ObjectSize = ObjectSize;
+  Uses.clear();
+
+  SmallVector<std::pair<Value *, int64_t>, 8> Worklist;
+  Worklist.push_back(std::make_pair(Allocation, 0));
+  while (!Worklist.empty()) {
+    Value *Pointer = Worklist.back().first;
+    int64_t Offset = Worklist.back().second;
+    Worklist.pop_back();
+
+    for (User *U : Pointer->users()) {
+      Instruction *Instr = cast<Instruction>(U);
+      Uses.push_back({Instr, Pointer});
+
+      if (isa<BitCastInst>(Instr) || isa<AddrSpaceCastInst>(Instr)) {
+        Worklist.push_back(std::make_pair(Instr, Offset));
+        continue;
+      }
+
+      if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(Instr)) {
+        APInt GEPOffset(
+            DL.getPointerSizeInBits(GEP->getPointerAddressSpace()), 0);
+        if ((GEP->getPointerOperand() != Pointer) ||
+            !GEP->accumulateConstantOffset(DL, GEPOffset)) {
+          return false;
+        }
+        int64_t NewOffset = Offset + GEPOffset.getSExtValue();
+        if (!isInObject(NewOffset, 0)) {
+          return false;
+        }
+        Worklist.push_back(std::make_pair(Instr, NewOffset));
+        continue;
+      }
+
+      if (LoadInst *Load = dyn_cast<LoadInst>(Instr)) {
+        if (!Load->isUnordered() ||
+            !isInObject(Offset, DL.getTypeStoreSize(Load->getType()))) {
+          return false;
+        }
+        continue;
+      }
+
+      if (StoreInst *Store = dyn_cast<StoreInst>(Instr)) {
+        Value *Stored = Store->getValueOperand();
+        if ((Stored == Pointer) || !Store->isUnordered() ||
+            !isInObject(Offset, DL.getTypeStoreSize(Stored->getType()))) {
+          return false;
+        }
+        continue;
+      }
+
+      // The object is never null.
+      if (ICmpInst *Compare = dyn_cast<ICmpInst>(Instr)) {
+        if (!Compare->isEquality() ||
+            (!isa<ConstantPointerNull>(Compare->getOperand(0)) &&
+             !isa<ConstantPointerNull>(Compare->getOperand(1)))) {
+          return false;
+        }
+        continue;
+      }
+
+      // A write barrier is a store of its second argument to the address in
+      // its first.
+      CallInst *Barrier = dyn_cast<CallInst>(Instr);
+      if ((Barrier != nullptr) &&
+          (Barrier->getMetadata(WriteBarrierKind) != nullptr) &&
+          (Barrier->getArgOperand(0) == Pointer) &&
+          (Barrier->getArgOperand(1) != Pointer) &&
+          isInObject(Offset, DL.getPointerSize())) {
+        continue;
+      }
+
+      return false;
+    }
+  }
+  return true;
+}
+
+/// \brief Check whether \p Block may be executed more than once in a call
+/// of the method.
+static bool isInCycle(BasicBlock *Block, LoopInfo &LI) {
+  if (LI.getLoopFor(Block) != nullptr) {
+    return true;
+  }
+
+  // LoopInfo only finds natural loops.
+  for (BasicBlock *Successor : successors(Block)) {
+    if (isPotentiallyReachable(Successor, Block, nullptr, &LI)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// \brief Get the helper call on the slow path of the inline allocation
+/// whose results \p Phi merges.
+///
+/// The reader allocates small objects inline when asked to, calling the
+/// helper only when the thread's allocation context is used up, and tags
+/// the merged result as well as the helper call.
+///
+/// \returns The helper call, or null if \p Phi is not such a merge or the
+/// allocation's blocks are not as the reader made them.
+static CallInst *getInlineAllocationHelper(PHINode *Phi,
+                                           unsigned NewObjectKind) {
+  BasicBlock *Join = Phi->getParent();
+  if ((Phi->getNumIncomingValues() != 2) || (&Join->front() != Phi) ||
+      isa<PHINode>(Phi->getNextNode())) {
+    return nullptr;
+  }
+  for (unsigned I = 0; I < 2; ++I) {
+    CallInst *Helper = dyn_cast<CallInst>(Phi->getIncomingValue(I));
+    if ((Helper == nullptr) ||
+        (Helper->getMetadata(NewObjectKind) == nullptr) ||
+        !Helper->hasOneUse()) {
+      continue;
+    }
+    // The fast path is a single block that the block choosing the path
+    // branches to; the helper's method table is computed before the choice.
+    BasicBlock *FastBlock = Phi->getIncomingBlock(1 - I);
+    BasicBlock *Fork = FastBlock->getSinglePredecessor();
+    if ((Fork == nullptr) || (FastBlock->getSingleSuccessor() != Join)) {
+      return nullptr;
+    }
+    BranchInst *Choice = dyn_cast<BranchInst>(Fork->getTerminator());
+    Instruction *MethodTable = dyn_cast<Instruction>(Helper->getArgOperand(0));
+    if ((Choice == nullptr) || !Choice->isConditional() ||
+        ((MethodTable != nullptr) &&
+         (MethodTable->getParent() == Helper->getParent()))) {
+      return nullptr;
+    }
+    return Helper;
+  }
+  return nullptr;
+}
+
+/// \brief Add \p Slot to the slots the method escapes, which are reported
+/// to the GC.
+static void escapeSlot(Function &F, AllocaInst *Slot) {
+  BasicBlock &Entry = F.getEntryBlock();
+  SmallVector<Value *, 8> Slots;
+  Instruction *InsertBefore = Entry.getTerminator();
+  for (Instruction &Instr : Entry) {
+    IntrinsicInst *Escape = dyn_cast<IntrinsicInst>(&Instr);
+    if ((Escape != nullptr) &&
+        (Escape->getIntrinsicID() == Intrinsic::localescape)) {
+      Slots.append(Escape->arg_operands().begin(),
+                   Escape->arg_operands().end());
+      InsertBefore = Escape->getNextNode();
+      Escape->eraseFromParent();
+      break;
+    }
+  }
+  Slots.push_back(Slot);
+  Function *LocalEscape =
+      Intrinsic::getDeclaration(F.getParent(), Intrinsic::localescape);
+  CallInst::Create(LocalEscape, Slots, "", InsertBefore);
+}
+
+/// \brief Move the object allocated by \p Allocation to \p Slot.
+static void rewriteUses(Instruction *Allocation, AllocaInst *Slot,
+                        ArrayRef<ObjectUse> Uses) {
+  LLVMContext &LLVMContext = Allocation->getContext();
+  DenseMap<Value *, Value *> NewPointers;
+  NewPointers[Allocation] = Slot;
+  SmallVector<Instruction *, 16> Dead;
+  for (const ObjectUse &Use : Uses) {
+    Instruction *User = Use.User;
+    Value *NewPointer = NewPointers[Use.Pointer];
+    IRBuilder<> Builder(User);
+
+    if (isa<BitCastInst>(User) || isa<AddrSpaceCastInst>(User)) {
+      Type *ElementTy = User->getType()->getPointerElementType();
+      NewPointers[User] = Builder.CreatePointerCast(
+          NewPointer, PointerType::get(ElementTy, 0), User->getName());
+      Dead.push_back(User);
+    } else if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(User)) {
+      SmallVector<Value *, 4> Indices(GEP->idx_begin(), GEP->idx_end());
+      GetElementPtrInst *NewGEP = GetElementPtrInst::Create(
+          GEP->getSourceElementType(), NewPointer, Indices, GEP->getName(),
+          GEP);
+      NewGEP->setIsInBounds(GEP->isInBounds());
+      NewPointers[User] = NewGEP;
+      Dead.push_back(User);
+    } else if (isa<LoadInst>(User)) {
+      User->setOperand(LoadInst::getPointerOperandIndex(), NewPointer);
+    } else if (isa<StoreInst>(User)) {
+      User->setOperand(StoreInst::getPointerOperandIndex(), NewPointer);
+    } else if (ICmpInst *Compare = dyn_cast<ICmpInst>(User)) {
+      bool IsNull = (Compare->getPredicate() == CmpInst::ICMP_EQ);
+      Compare->replaceAllUsesWith(ConstantInt::get(
+          Type::getInt1Ty(LLVMContext), IsNull ? 0 : 1));
+      Dead.push_back(User);
+    } else {
+      // A store to the stack needs no barrier.
+      CallInst *Barrier = cast<CallInst>(User);
+      Value *Stored = Barrier->getArgOperand(1);
+      Value *Address = Builder.CreatePointerCast(
+          NewPointer, PointerType::get(Stored->getType(), 0));
+      Builder.CreateStore(Stored, Address);
+      Dead.push_back(User);
+    }
+  }
+
+  for (auto I = Dead.rbegin(), E = Dead.rend(); I != E; ++I) {
+    (*I)->eraseFromParent();
+  }
+  Allocation->eraseFromParent();
+}
+
+//-----------------------------StackAllocation--------------------------------
+
+char StackAllocation::ID = 0;
+
+void StackAllocation::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.addRequired<LoopInfoWrapperPass>();
+}
+
+bool StackAllocation::runOnFunction(Function &F) {
+  LLVMContext &LLVMContext = F.getContext();
+  unsigned NewObjectKind = LLVMContext.getMDKindID("llilc.new.object");
+  unsigned WriteBarrierKind = LLVMContext.getMDKindID("llilc.write.barrier");
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+
+  // Each allocation is a helper call, or the merge of an inline allocation
+  // and its helper call. A helper call whose only use is a tagged merge is
+  // counted with the merge.
+  SmallVector<std::pair<Instruction *, CallInst *>, 8> Allocations;
+  uint32_t NumAllocations = 0;
+  uint32_t NumUnmatchedMerges = 0;
+  for (BasicBlock &Block : F) {
+    for (Instruction &Instr : Block) {
+      if (Instr.getMetadata(NewObjectKind) == nullptr) {
+        continue;
+      }
+      if (isa<CallInst>(Instr) && Instr.hasOneUse() &&
+          isa<PHINode>(*Instr.user_begin()) &&
+          (cast<PHINode>(*Instr.user_begin())->getMetadata(NewObjectKind) !=
+           nullptr)) {
+        continue;
+      }
+      ++NumAllocations;
+      CallInst *Helper = dyn_cast<CallInst>(&Instr);
+      if (PHINode *Phi = dyn_cast<PHINode>(&Instr)) {
+        Helper = getInlineAllocationHelper(Phi, NewObjectKind);
+        if (Helper == nullptr) {
+          ++NumUnmatchedMerges;
+        }
+      }
+      if ((Helper != nullptr) && !isInCycle(&Block, LI)) {
+        Allocations.push_back(std::make_pair(&Instr, Helper));
+      }
+    }
+  }
+
+  GcFuncInfo *GcFuncInfo = Context->GcInfo->getGcInfo(&F);
+  const uint32_t PointerSize = DL.getPointerSize();
+  uint32_t NumMoved = 0;
+  ObjectUses Uses(DL, WriteBarrierKind);
+  bool IsCFGChanged = false;
+  for (auto &Entry : Allocations) {
+    Instruction *Allocation = Entry.first;
+    CallInst *Helper = Entry.second;
+    StructType *ObjectTy =
+        dyn_cast<StructType>(Allocation->getType()->getPointerElementType());
+    // The box helper also takes the address of the value to copy into the
+    // new object.
+    bool IsBox = (Helper->getNumArgOperands() == 2);
+    if ((ObjectTy == nullptr) || !ObjectTy->isSized() ||
+        (IsBox && (ObjectTy->getNumElements() < 2)) ||
+        !Uses.find(Allocation, DL.getTypeStoreSize(ObjectTy))) {
+      continue;
+    }
+
+    Instruction *SlotInsertPoint = &*F.getEntryBlock().getFirstInsertionPt();
+    AllocaInst *Slot = new AllocaInst(ObjectTy, "StackObject", SlotInsertPoint);
+    Slot->setAlignment(PointerSize);
+    Constant *Zero = Constant::getNullValue(ObjectTy);
+    PHINode *Merge = dyn_cast<PHINode>(Allocation);
+    IRBuilder<> Builder(
+        (Merge != nullptr) ? &*Merge->getParent()->getFirstInsertionPt()
+                           : Allocation);
+    if (GcInfo::isGcAggregate(ObjectTy)) {
+      // The GC pointers in the object are reported for the whole method, so
+      // they must be null until the object is allocated.
+      new StoreInst(Zero, Slot, SlotInsertPoint);
+      GcFuncInfo->recordGcAlloca(Slot);
+      escapeSlot(F, Slot);
+    } else {
+      Builder.CreateStore(Zero, Slot);
+    }
+
+    Value *MethodTable = Helper->getArgOperand(0);
+    Builder.CreateStore(MethodTable,
+                        Builder.CreatePointerCast(
+                            Slot, PointerType::get(MethodTable->getType(), 0)));
+    if (IsBox) {
+      unsigned ValueIndex = ObjectTy->getNumElements() - 1;
+      Type *ValueTy = ObjectTy->getElementType(ValueIndex);
+      Value *Source = Helper->getArgOperand(1);
+      unsigned SourceSpace = Source->getType()->getPointerAddressSpace();
+      Source = Builder.CreatePointerCast(
+          Source, PointerType::get(ValueTy, SourceSpace));
+      Builder.CreateStore(Builder.CreateLoad(Source),
+                          Builder.CreateStructGEP(ObjectTy, Slot, ValueIndex));
+    }
+
+    // Neither path of an inline allocation is needed any more: branch
+    // straight to the merge, and remove the paths below.
+    if (Merge != nullptr) {
+      BasicBlock *Join = Merge->getParent();
+      BasicBlock *Fork = Merge->getIncomingBlock(0)->getSinglePredecessor();
+      if (Merge->getIncomingValue(0) == Helper) {
+        Fork = Merge->getIncomingBlock(1)->getSinglePredecessor();
+      }
+      TerminatorInst *Choice = Fork->getTerminator();
+      BranchInst::Create(Join, Choice);
+      Choice->eraseFromParent();
+      IsCFGChanged = true;
+    }
+
+    rewriteUses(Allocation, Slot, Uses.Uses);
+    ++NumMoved;
+  }
+  if (IsCFGChanged) {
+    removeUnreachableBlocks(F);
+  }
+
+  Context->NumAllocationsRemoved += NumMoved;
+  if ((NumAllocations != 0) &&
+      (Context->Options->DumpLevel == ::DumpLevel::VERBOSE)) {
+    dbgs() << "INFO:  moved " << NumMoved << " of " << NumAllocations
+           << " allocations to the stack in " << F.getName();
+    if (NumUnmatchedMerges != 0) {
+      dbgs() << " (" << NumUnmatchedMerges
+             << " inline allocations not in the reader's form)";
+    }
+    dbgs() << "\n";
+  }
+  return NumMoved != 0;
+}
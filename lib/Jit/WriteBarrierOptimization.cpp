@@ -0,0 +1,259 @@
+//===------------- lib/Jit/WriteBarrierOptimization.cpp ---------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the pass that removes the write barriers the GC
+/// does not need and marks cards inline for the rest.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "LLILCJit.h"
+#include "WriteBarrierOptimization.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+using namespace llvm;
+
+/// Objects at least this large are allocated in the large object heap,
+/// which the GC collects with its oldest generation.
+static const uint64_t LargeObjectSize = 85000;
+
+/// \brief Get the size of the object \p Allocation allocates, if the reader
+/// tagged it as a new object or as a new array of constant length.
+///
+/// \returns The size in bytes, or zero if it is not known.
+static uint64_t getAllocationSize(Instruction *Allocation,
+                                  unsigned NewObjectKind,
+                                  unsigned NewArrayKind,
+                                  const DataLayout &DL) {
+  StructType *ObjectTy =
+      dyn_cast<StructType>(Allocation->getType()->getPointerElementType());
+  if ((ObjectTy == nullptr) || !ObjectTy->isSized()) {
+    return 0;
+  }
+  if (Allocation->getMetadata(NewObjectKind) != nullptr) {
+    return DL.getTypeAllocSize(ObjectTy);
+  }
+
+  MDNode *NewArray = Allocation->getMetadata(NewArrayKind);
+  if ((NewArray == nullptr) || (NewArray->getNumOperands() != 1)) {
+    return 0;
+  }
+  ConstantInt *NumElements =
+      mdconst::dyn_extract<ConstantInt>(NewArray->getOperand(0));
+  unsigned ElementsIndex = ObjectTy->getNumElements() - 1;
+  ArrayType *ElementsTy =
+      dyn_cast<ArrayType>(ObjectTy->getElementType(ElementsIndex));
+  if ((NumElements == nullptr) || NumElements->isNegative() ||
+      (ElementsTy == nullptr)) {
+    return 0;
+  }
+
+  // On 32-bit targets the runtime puts large enough arrays of doubles in
+  // the large object heap, to align them.
+  Type *ElementTy = ElementsTy->getElementType();
+  if ((DL.getPointerSize() == 4) && ElementTy->isDoubleTy()) {
+    return 0;
+  }
+  return DL.getStructLayout(ObjectTy)->getElementOffset(ElementsIndex) +
+         NumElements->getZExtValue() * DL.getTypeAllocSize(ElementTy);
+}
+
+/// \brief Check whether the GC may run at \p Instr.
+static bool isSafepoint(Instruction *Instr, unsigned WriteBarrierKind) {
+  CallSite Call(Instr);
+  if (!Call || isa<IntrinsicInst>(Instr) ||
+      (Instr->getMetadata(WriteBarrierKind) != nullptr)) {
+    return false;
+  }
+  return !Call.getAttributes().hasAttribute(AttributeSet::FunctionIndex,
+                                            "gc-leaf-function");
+}
+
+/// \brief Check whether \p Barrier is only reached from \p Allocation, with
+/// no safepoint in between.
+///
+/// Only the chain of single predecessors of the barrier's block is searched
+/// for the allocation.
+static bool isReachedWithoutSafepoint(Instruction *Allocation,
+                                      CallInst *Barrier,
+                                      unsigned WriteBarrierKind) {
+  BasicBlock *Block = Barrier->getParent();
+  BasicBlock::iterator Cursor = Barrier->getIterator();
+  SmallPtrSet<BasicBlock *, 8> Visited;
+  while (Visited.insert(Block).second) {
+    while (Cursor != Block->begin()) {
+      --Cursor;
+      Instruction *Instr = &*Cursor;
+      if (Instr == Allocation) {
+        return true;
+      }
+      if (isSafepoint(Instr, WriteBarrierKind)) {
+        return false;
+      }
+    }
+    Block = Block->getSinglePredecessor();
+    if (Block == nullptr) {
+      return false;
+    }
+    Cursor = Block->end();
+  }
+  return false;
+}
+
+/// \brief Replace \p Barrier, which follows its store, with the runtime's
+/// card marking sequence.
+///
+/// A card covers 2K of the heap on 64-bit targets and 1K on 32-bit ones.
+/// The card table pointer is biased so that it can be indexed by address.
+static void expandBarrier(CallInst *Barrier, bool IsChecked,
+                          const WriteBarrierGlobals &Globals,
+                          const DataLayout &DL) {
+  LLVMContext &LLVMContext = Barrier->getContext();
+  Type *IntPtrTy = DL.getIntPtrType(LLVMContext);
+  IRBuilder<> Builder(Barrier);
+  auto LoadGlobal = [&](uint64_t Address, const char *Name) {
+    Value *Pointer = Builder.CreateIntToPtr(ConstantInt::get(IntPtrTy, Address),
+                                            PointerType::get(IntPtrTy, 0));
+    return Builder.CreateLoad(Pointer, Name);
+  };
+
+  // Only pointers to ephemeral objects need a card, and only stores into
+  // the GC heap; the unchecked barrier is only used for the latter.
+  Value *Address = Builder.CreatePtrToInt(Barrier->getArgOperand(0), IntPtrTy);
+  Value *Stored = Builder.CreatePtrToInt(Barrier->getArgOperand(1), IntPtrTy);
+  Value *NeedsCard = Builder.CreateAnd(
+      Builder.CreateICmpUGE(Stored,
+                            LoadGlobal(Globals.EphemeralLow, "EphemeralLow")),
+      Builder.CreateICmpULT(
+          Stored, LoadGlobal(Globals.EphemeralHigh, "EphemeralHigh")));
+  if (IsChecked) {
+    NeedsCard = Builder.CreateAnd(
+        NeedsCard,
+        Builder.CreateAnd(
+            Builder.CreateICmpUGE(
+                Address, LoadGlobal(Globals.LowestAddress, "HeapLow")),
+            Builder.CreateICmpULT(
+                Address, LoadGlobal(Globals.HighestAddress, "HeapHigh"))));
+  }
+
+  // Cards are only written if they are not already set, to keep the cache
+  // lines shared between processors clean.
+  TerminatorInst *MarkCard =
+      SplitBlockAndInsertIfThen(NeedsCard, Barrier, false);
+  Builder.SetInsertPoint(MarkCard);
+  const unsigned CardShift = (DL.getPointerSize() == 8) ? 11 : 10;
+  Value *CardAddress =
+      Builder.CreateAdd(LoadGlobal(Globals.CardTable, "CardTable"),
+                        Builder.CreateLShr(Address, CardShift));
+  Value *Card =
+      Builder.CreateIntToPtr(CardAddress, Type::getInt8PtrTy(LLVMContext));
+  Constant *Marked = ConstantInt::get(Type::getInt8Ty(LLVMContext), 0xFF);
+  Value *IsUnmarked =
+      Builder.CreateICmpNE(Builder.CreateLoad(Card, "Card"), Marked);
+  TerminatorInst *SetCard =
+      SplitBlockAndInsertIfThen(IsUnmarked, MarkCard, false);
+  Builder.SetInsertPoint(SetCard);
+  Builder.CreateStore(Marked, Card);
+  Barrier->eraseFromParent();
+}
+
+//-------------------------WriteBarrierOptimization---------------------------
+
+char WriteBarrierOptimization::ID = 0;
+
+bool WriteBarrierOptimization::runOnFunction(Function &F) {
+  LLVMContext &LLVMContext = F.getContext();
+  unsigned WriteBarrierKind = LLVMContext.getMDKindID("llilc.write.barrier");
+  unsigned NewObjectKind = LLVMContext.getMDKindID("llilc.new.object");
+  unsigned NewArrayKind = LLVMContext.getMDKindID("llilc.new.array");
+  const DataLayout &DL = F.getParent()->getDataLayout();
+
+  // Barriers in protected regions are invokes, which are left alone.
+  SmallVector<CallInst *, 16> Barriers;
+  uint32_t NumBarriers = 0;
+  for (BasicBlock &Block : F) {
+    for (Instruction &Instr : Block) {
+      if (Instr.getMetadata(WriteBarrierKind) == nullptr) {
+        continue;
+      }
+      ++NumBarriers;
+      if (CallInst *Barrier = dyn_cast<CallInst>(&Instr)) {
+        Barriers.push_back(Barrier);
+      }
+    }
+  }
+
+  const ::Options *Options = Context->Options;
+  uint32_t NumRemoved = 0;
+  uint32_t NumInlined = 0;
+  for (CallInst *Barrier : Barriers) {
+    Value *Address = Barrier->getArgOperand(0);
+    Value *Stored = Barrier->getArgOperand(1);
+
+    // A store to null must still fault.
+    if (isa<ConstantPointerNull>(Address->stripPointerCasts())) {
+      continue;
+    }
+
+    bool IsNeeded = true;
+    Value *Base = GetUnderlyingObject(Address, DL, 0);
+    Instruction *Allocation = dyn_cast<Instruction>(Base);
+    if (isa<ConstantPointerNull>(Stored) || isa<AllocaInst>(Base)) {
+      IsNeeded = false;
+    } else if (Allocation != nullptr) {
+      uint64_t Size =
+          getAllocationSize(Allocation, NewObjectKind, NewArrayKind, DL);
+      IsNeeded = (Size == 0) || (Size >= LargeObjectSize) ||
+                 !isReachedWithoutSafepoint(Allocation, Barrier,
+                                            WriteBarrierKind);
+    }
+    if (IsNeeded && !Options->DoInlineWriteBarrier) {
+      continue;
+    }
+
+    // The barrier stores its second argument to the address in its first.
+    IRBuilder<> Builder(Barrier);
+    unsigned AddressSpace = Address->getType()->getPointerAddressSpace();
+    Builder.CreateStore(Stored,
+                        Builder.CreatePointerCast(
+                            Address, PointerType::get(Stored->getType(),
+                                                      AddressSpace)));
+    if (IsNeeded) {
+      MDNode *Tag = Barrier->getMetadata(WriteBarrierKind);
+      bool IsChecked = (Tag->getNumOperands() != 0);
+      expandBarrier(Barrier, IsChecked, Options->WriteBarrierGlobals, DL);
+      ++NumInlined;
+    } else {
+      Barrier->eraseFromParent();
+      ++NumRemoved;
+    }
+  }
+
+  Context->NumWriteBarriersRemoved += NumRemoved;
+  if ((NumBarriers != 0) && (Options->DumpLevel == ::DumpLevel::VERBOSE)) {
+    dbgs() << "INFO:  removed " << NumRemoved << " and inlined " << NumInlined
+           << " of " << NumBarriers << " write barriers in " << F.getName()
+           << "\n";
+  }
+  return (NumRemoved + NumInlined) != 0;
+}
@@ -19,6 +19,14 @@
 #include "jitpch.h"
 #include "LLILCJit.h"
 #include "jitoptions.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdlib>
+#include <string>
+#if !defined(_MSC_VER)
+#include <unistd.h>
+#endif
 
 // Define a macro for cross-platform UTF-16 string literals.
 #if defined(_MSC_VER)
@@ -77,6 +85,24 @@ JitOptions::JitOptions(LLILCJitContext &Context) {
   // Set whether to do tail call opt.
   DoTailCallOpt = queryDoTailCallOpt(Context);
 
+  // Set whether to inline in the reader.
+  DoInlining = EnableOptimization && queryDoInlining(Context);
+  DoImplicitNullCheck = EnableOptimization && queryDoImplicitNullCheck(Context);
+  DoClassInstrument = queryDoClassInstrument(Context);
+  DoGuardedDevirt = EnableOptimization && queryDoGuardedDevirt(Context);
+  DoStackAllocation = EnableOptimization && queryDoStackAllocation(Context);
+  AllocContextOffset = 0;
+  DoInlineAlloc =
+      EnableOptimization && queryDoInlineAlloc(Context, AllocContextOffset);
+  WriteBarrierGlobals = ::WriteBarrierGlobals();
+  DoInlineWriteBarrier =
+      EnableOptimization &&
+      queryDoInlineWriteBarrier(Context, WriteBarrierGlobals);
+  CastCacheExcludeFlags =
+      EnableOptimization ? queryCastCacheExcludeFlags(Context) : 0;
+  ParentMethodTableOffset =
+      EnableOptimization ? queryParentMethodTableOffset(Context) : 0;
+
   LogGcInfo = queryLogGcInfo(Context);
 
   // Set whether to insert failfast in exception handlers.
@@ -87,6 +113,8 @@ JitOptions::JitOptions(LLILCJitContext &Context) {
   IsMSILDumpMethod = queryIsMSILDumpMethod(Context);
   IsLLVMDumpMethod = queryIsLLVMDumpMethod(Context);
   IsCodeRangeMethod = queryIsCodeRangeMethod(Context);
+  DoTimePasses = queryDoTimePasses(Context);
+  DoDirectEmit = queryDoDirectEmit(Context);
 
   if (IsAltJit) {
     PreferredIntrinsicSIMDVectorLength = 0;
@@ -103,6 +131,133 @@ bool JitOptions::queryDoTailCallOpt(LLILCJitContext &Context) {
   return (bool)DEFAULT_TAIL_CALL_OPT;
 }
 
+bool JitOptions::queryDoInlining(LLILCJitContext &Context) {
+  // ReadyToRun code may only inline within its version bubble, and its
+  // reader state is reset after each method.
+  if (Context.Flags & CORJIT_FLG_READYTORUN) {
+    return false;
+  }
+  return !queryNonNullNonEmpty(Context,
+                               (const char16_t *)UTF16("JitNoInline"));
+}
+
+bool JitOptions::queryDoImplicitNullCheck(LLILCJitContext &Context) {
+  return queryNonNullNonEmpty(Context,
+                              (const char16_t *)UTF16("JitImplicitNullChecks"));
+}
+
+// Instrumented code refers to the profile in this process's memory, which
+// an ngen image must not.
+bool JitOptions::queryDoClassInstrument(LLILCJitContext &Context) {
+  if (Context.Flags & (CORJIT_FLG_PREJIT | CORJIT_FLG_READYTORUN)) {
+    return false;
+  }
+  return queryNonNullNonEmpty(Context,
+                              (const char16_t *)UTF16("JitInstrumentClasses"));
+}
+
+// ReadyToRun code may not embed the class handles the guards compare with.
+bool JitOptions::queryDoGuardedDevirt(LLILCJitContext &Context) {
+  if (Context.Flags & CORJIT_FLG_READYTORUN) {
+    return false;
+  }
+  return queryNonNullNonEmpty(Context,
+                              (const char16_t *)UTF16("JitGuardedDevirt"));
+}
+
+bool JitOptions::queryDoStackAllocation(LLILCJitContext &Context) {
+  return queryNonNullNonEmpty(Context,
+                              (const char16_t *)UTF16("JitStackAllocation"));
+}
+
+// The layout of the runtime thread is specific to this process's runtime,
+// which an ngen image must not depend on.
+bool JitOptions::queryDoInlineAlloc(LLILCJitContext &Context,
+                                    unsigned &Offset) {
+  if (Context.Flags & (CORJIT_FLG_PREJIT | CORJIT_FLG_READYTORUN)) {
+    return false;
+  }
+  char16_t *OffsetWStr =
+      getStringConfigValue(Context.JitInfo, UTF16("JitAllocContextOffset"));
+  if (OffsetWStr == nullptr) {
+    return false;
+  }
+  std::unique_ptr<std::string> OffsetStr = Convert::utf16ToUtf8(OffsetWStr);
+  freeStringConfigValue(Context.JitInfo, OffsetWStr);
+  return !llvm::StringRef(*OffsetStr).getAsInteger(0, Offset);
+}
+
+// The GC's globals are at addresses specific to this process's runtime,
+// which an ngen image must not depend on.
+bool JitOptions::queryDoInlineWriteBarrier(LLILCJitContext &Context,
+                                           ::WriteBarrierGlobals &Globals) {
+  if (Context.Flags & (CORJIT_FLG_PREJIT | CORJIT_FLG_READYTORUN)) {
+    return false;
+  }
+  char16_t *GlobalsWStr =
+      getStringConfigValue(Context.JitInfo, UTF16("JitWriteBarrierGlobals"));
+  if (GlobalsWStr == nullptr) {
+    return false;
+  }
+  std::unique_ptr<std::string> GlobalsStr = Convert::utf16ToUtf8(GlobalsWStr);
+  freeStringConfigValue(Context.JitInfo, GlobalsWStr);
+
+  llvm::SmallVector<llvm::StringRef, 5> Addresses;
+  llvm::StringRef(*GlobalsStr).split(Addresses, ',');
+  uint64_t *Fields[] = {&Globals.LowestAddress, &Globals.HighestAddress,
+                        &Globals.EphemeralLow, &Globals.EphemeralHigh,
+                        &Globals.CardTable};
+  if (Addresses.size() != llvm::array_lengthof(Fields)) {
+    return false;
+  }
+  for (unsigned I = 0; I < Addresses.size(); ++I) {
+    if (Addresses[I].trim().getAsInteger(0, *Fields[I]) || (*Fields[I] == 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Cache cells are allocated in this process, and the flags are those of
+// its runtime's method tables, so an ngen image must not depend on either.
+uint32_t JitOptions::queryCastCacheExcludeFlags(LLILCJitContext &Context) {
+  if (Context.Flags & (CORJIT_FLG_PREJIT | CORJIT_FLG_READYTORUN)) {
+    return 0;
+  }
+  char16_t *FlagsWStr =
+      getStringConfigValue(Context.JitInfo, UTF16("JitCastCache"));
+  if (FlagsWStr == nullptr) {
+    return 0;
+  }
+  std::unique_ptr<std::string> FlagsStr = Convert::utf16ToUtf8(FlagsWStr);
+  freeStringConfigValue(Context.JitInfo, FlagsWStr);
+  uint32_t Flags;
+  if (llvm::StringRef(*FlagsStr).getAsInteger(0, Flags)) {
+    return 0;
+  }
+  return Flags;
+}
+
+// The layout of method tables is specific to this process's runtime, which
+// an ngen image must not depend on.
+unsigned JitOptions::queryParentMethodTableOffset(LLILCJitContext &Context) {
+  if (Context.Flags & (CORJIT_FLG_PREJIT | CORJIT_FLG_READYTORUN)) {
+    return 0;
+  }
+  char16_t *OffsetWStr = getStringConfigValue(
+      Context.JitInfo, UTF16("JitParentMethodTableOffset"));
+  if (OffsetWStr == nullptr) {
+    return 0;
+  }
+  std::unique_ptr<std::string> OffsetStr = Convert::utf16ToUtf8(OffsetWStr);
+  freeStringConfigValue(Context.JitInfo, OffsetWStr);
+  unsigned Offset;
+  if (llvm::StringRef(*OffsetStr).getAsInteger(0, Offset)) {
+    return 0;
+  }
+  return Offset;
+}
+
 bool JitOptions::queryIsAltJit(LLILCJitContext &Context) {
   // Initial state is that we are not an alternative jit until proven otherwise;
   bool IsAlternateJit = false;
@@ -273,13 +428,111 @@ bool JitOptions::queryDoSIMDIntrinsic(LLILCJitContext &Context) {
 
 OptLevel JitOptions::queryOptLevel(LLILCJitContext &Context) {
   ::OptLevel JitOptLevel = ::OptLevel::BLENDED_CODE;
-  // Currently we only check for the debug flag but this will be extended
-  // to account for further opt levels as we move forward.
+  // Debug code takes precedence over any size or speed preference.
   if ((Context.Flags & CORJIT_FLG_DEBUG_CODE) != 0) {
     JitOptLevel = ::OptLevel::DEBUG_CODE;
+  } else if ((Context.Flags & CORJIT_FLG_SIZE_OPT) != 0) {
+    JitOptLevel = ::OptLevel::SMALL_CODE;
+  } else if ((Context.Flags & CORJIT_FLG_SPEED_OPT) != 0) {
+    JitOptLevel = ::OptLevel::FAST_CODE;
   }
 
   return JitOptLevel;
 }
 
+// Determine if per-pass execution times should be reported.
+bool JitOptions::queryDoTimePasses(LLILCJitContext &Context) {
+  return queryNonNullNonEmpty(Context,
+                              (const char16_t *)UTF16("JitTimePasses"));
+}
+
+// Determine if code should be emitted straight into the EE's memory.
+// Ngen images need the relocations only the object file path reports.
+bool JitOptions::queryDoDirectEmit(LLILCJitContext &Context) {
+  if (Context.Flags & (CORJIT_FLG_PREJIT | CORJIT_FLG_READYTORUN)) {
+    return false;
+  }
+  return queryNonNullNonEmpty(Context,
+                              (const char16_t *)UTF16("JitDirectEmit"));
+}
+
+/// Replace any "%p" in \p Path with the process id.
+static void expandProcessId(std::string &Path) {
+  size_t Pos = Path.find("%p");
+  if (Pos != std::string::npos) {
+#if defined(_MSC_VER)
+    unsigned long ProcessId = GetCurrentProcessId();
+#else
+    unsigned long ProcessId = getpid();
+#endif
+    Path.replace(Pos, 2, std::to_string(ProcessId));
+  }
+}
+
+std::string JitOptions::queryRecordCollection(LLILCJitContext &Context) {
+  std::string Path;
+  char16_t *PathWStr =
+      getStringConfigValue(Context.JitInfo, UTF16("JitRecordCollection"));
+  if (PathWStr != nullptr) {
+    Path = *Convert::utf16ToUtf8(PathWStr);
+    freeStringConfigValue(Context.JitInfo, PathWStr);
+  }
+  expandProcessId(Path);
+  return Path;
+}
+
+uint64_t JitOptions::queryRecordCollectionSize(LLILCJitContext &Context) {
+  uint64_t SizeMB = 1024;
+  char16_t *SizeWStr = getStringConfigValue(
+      Context.JitInfo, UTF16("JitRecordCollectionSizeMB"));
+  if (SizeWStr != nullptr) {
+    std::unique_ptr<std::string> Size = Convert::utf16ToUtf8(SizeWStr);
+    uint64_t Value = std::strtoull(Size->c_str(), nullptr, 10);
+    if (Value != 0) {
+      SizeMB = Value;
+    }
+    freeStringConfigValue(Context.JitInfo, SizeWStr);
+  }
+  return SizeMB << 20;
+}
+
+bool JitOptions::queryDoPerfMap(LLILCJitContext &Context) {
+  return queryNonNullNonEmpty(Context, (const char16_t *)UTF16("JitPerfMap"));
+}
+
+std::string JitOptions::queryPerfJitDumpDir(LLILCJitContext &Context) {
+  std::string Dir;
+  char16_t *DirWStr =
+      getStringConfigValue(Context.JitInfo, UTF16("JitPerfDumpDir"));
+  if (DirWStr != nullptr) {
+    Dir = *Convert::utf16ToUtf8(DirWStr);
+    freeStringConfigValue(Context.JitInfo, DirWStr);
+  }
+  return Dir;
+}
+
+std::string JitOptions::queryEventLog(LLILCJitContext &Context) {
+  std::string Path;
+  char16_t *PathWStr =
+      getStringConfigValue(Context.JitInfo, UTF16("JitEventLog"));
+  if (PathWStr != nullptr) {
+    Path = *Convert::utf16ToUtf8(PathWStr);
+    freeStringConfigValue(Context.JitInfo, PathWStr);
+  }
+  expandProcessId(Path);
+  return Path;
+}
+
+std::string JitOptions::queryClassProfile(LLILCJitContext &Context) {
+  std::string Path;
+  char16_t *PathWStr =
+      getStringConfigValue(Context.JitInfo, UTF16("JitClassProfile"));
+  if (PathWStr != nullptr) {
+    Path = *Convert::utf16ToUtf8(PathWStr);
+    freeStringConfigValue(Context.JitInfo, PathWStr);
+  }
+  expandProcessId(Path);
+  return Path;
+}
+
 JitOptions::~JitOptions() {}
@@ -1,6 +1,7 @@
 // Utility code
 
 #include <cstdlib>
+#include <cstring>
 
 #include "global.h"
 #include "jitpch.h"
@@ -164,3 +165,30 @@ unique_ptr<std::string> Convert::utf16ToUtf8(const char16_t *WideStr) {
 
   return OutString;
 }
+
+//===----------------------------------------------------------------------===//
+//
+// ArenaAllocator
+//
+//===----------------------------------------------------------------------===//
+
+void *ArenaAllocator::allocate(size_t NumBytes) {
+  // Match the alignment guarantee of the calloc this arena replaces.
+  const size_t Alignment = 16;
+  void *Memory = Allocator.Allocate(NumBytes, Alignment);
+  memset(Memory, 0, NumBytes);
+  NumAllocations++;
+  return Memory;
+}
+
+void ArenaAllocator::reset() {
+  // Destroy objects in reverse order of registration, in case later objects
+  // refer to earlier ones.
+  for (auto I = Destructors.rbegin(), E = Destructors.rend(); I != E; ++I) {
+    I->second(I->first);
+  }
+  Destructors.clear();
+  PeakBytesAllocated = getPeakBytesAllocated();
+  NumAllocations = 0;
+  Allocator.Reset();
+}
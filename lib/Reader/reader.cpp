@@ -2327,6 +2327,12 @@ void ReaderBase::fgBuildPhase1(FlowGraphNode *Block, uint8_t *ILInput,
   HasAddressTaken = false;
   NextRegionTransitionOffset = NextOffset = CurrentOffset = 0;
 
+  uint32_t NumLocals = MethodInfo->locals.numArgs;
+  StoredLocals = (ReaderBitVector *)getTempMemory(sizeof(ReaderBitVector));
+  StoredLocals->allocateBitVector(NumLocals, this);
+  ReassignedLocals = (ReaderBitVector *)getTempMemory(sizeof(ReaderBitVector));
+  ReassignedLocals->allocateBitVector(NumLocals, this);
+
   // Keep going through the buffer of bytecodes until we get to the end.
   while (CurrentOffset < ILInputSize) {
     if ((EhRegionTree != nullptr) &&
@@ -2570,13 +2576,48 @@ void ReaderBase::fgBuildPhase1(FlowGraphNode *Block, uint8_t *ILInput,
       break;
 
     case ReaderBaseNS::CEE_LDLOCA:
-    case ReaderBaseNS::CEE_LDLOCA_S:
+    case ReaderBaseNS::CEE_LDLOCA_S: {
+      uint32_t LocalOrdinal = (Opcode == ReaderBaseNS::CEE_LDLOCA)
+                                  ? readValue<uint16_t>(Operand)
+                                  : readValue<uint8_t>(Operand);
+      if (LocalOrdinal < NumLocals) {
+        ReassignedLocals->setBit(LocalOrdinal);
+      }
+      HasAddressTaken = true;
+      break;
+    }
+
     case ReaderBaseNS::CEE_LDARGA:
     case ReaderBaseNS::CEE_LDARGA_S:
     case ReaderBaseNS::CEE_ARGLIST:
       HasAddressTaken = true;
       break;
 
+    // Keep track of which locals are only stored to once, so that the
+    // reader can know what they hold.
+    case ReaderBaseNS::CEE_STLOC:
+    case ReaderBaseNS::CEE_STLOC_S:
+    case ReaderBaseNS::CEE_STLOC_0:
+    case ReaderBaseNS::CEE_STLOC_1:
+    case ReaderBaseNS::CEE_STLOC_2:
+    case ReaderBaseNS::CEE_STLOC_3: {
+      uint32_t LocalOrdinal;
+      if (Opcode == ReaderBaseNS::CEE_STLOC) {
+        LocalOrdinal = readValue<uint16_t>(Operand);
+      } else if (Opcode == ReaderBaseNS::CEE_STLOC_S) {
+        LocalOrdinal = readValue<uint8_t>(Operand);
+      } else {
+        LocalOrdinal = OpcodeRemap[Opcode];
+      }
+      if (LocalOrdinal < NumLocals) {
+        if (StoredLocals->getBit(LocalOrdinal)) {
+          ReassignedLocals->setBit(LocalOrdinal);
+        }
+        StoredLocals->setBit(LocalOrdinal);
+      }
+      break;
+    }
+
     case ReaderBaseNS::CEE_CONSTRAINED:
       TokenConstrained = readValue<mdToken>(Operand);
       PreviousWasPrefix = true;
@@ -3099,6 +3140,14 @@ IRNode *ReaderBase::box(CORINFO_RESOLVED_TOKEN *ResolvedToken, IRNode *Arg2,
     return Arg2;
   }
 
+  if ((NextOffset != nullptr) && doBoxOpt()) {
+    RetVal = removeBox(ResolvedToken, Arg2, NextOffset);
+    if (RetVal != nullptr) {
+      boxRemoved(Class);
+      return RetVal;
+    }
+  }
+
   // Ensure that operand from operand stack has size that is
   // compatible with box destination, then get the (possibly
   // converted) operand's address.
@@ -3120,6 +3169,87 @@ IRNode *ReaderBase::box(CORINFO_RESOLVED_TOKEN *ResolvedToken, IRNode *Arg2,
   return RetVal;
 }
 
+IRNode *ReaderBase::removeBox(CORINFO_RESOLVED_TOKEN *ResolvedToken,
+                              IRNode *Value, uint32_t *NextOffset) {
+  CORINFO_CLASS_HANDLE Class = ResolvedToken->hClass;
+
+  // Skipping instructions would skip their verification. The box of a
+  // Nullable<T> may be null, and a shared class stands for several classes,
+  // so compares of it tell nothing about the boxed value's class.
+  if (VerificationNeeded ||
+      (getBoxHelper(Class) == CORINFO_HELP_BOX_NULLABLE) ||
+      (getClassAttribs(Class) & CORINFO_FLG_SHAREDINST)) {
+    return nullptr;
+  }
+
+  uint8_t *ILInput = MethodInfo->ILCode;
+  uint32_t ILSize = MethodInfo->ILCodeSize;
+  uint32_t EndOffset = fgNodeGetEndMSILOffset(CurrentFgNode);
+  ReaderBaseNS::OPCODE Opcode;
+  uint8_t *Operand;
+
+  if (*NextOffset >= EndOffset) {
+    return nullptr;
+  }
+  uint32_t Offset =
+      parseILOpcode(ILInput, *NextOffset, ILSize, this, &Opcode, &Operand);
+
+  switch (Opcode) {
+  case ReaderBaseNS::CEE_UNBOX_ANY: {
+    CORINFO_RESOLVED_TOKEN UnboxToken;
+    resolveToken(readValue<mdToken>(Operand), CORINFO_TOKENKIND_Class,
+                 &UnboxToken);
+    if (UnboxToken.hClass != Class) {
+      return nullptr;
+    }
+    handleClassAccess(&UnboxToken);
+    *NextOffset = Offset;
+    return convertToUnboxedStackType(Value, Class);
+  }
+
+  case ReaderBaseNS::CEE_BRTRUE:
+  case ReaderBaseNS::CEE_BRTRUE_S:
+  case ReaderBaseNS::CEE_BRFALSE:
+  case ReaderBaseNS::CEE_BRFALSE_S:
+    return loadConstantI4(1);
+
+  case ReaderBaseNS::CEE_ISINST: {
+    ReaderBaseNS::OPCODE BranchOpcode;
+    uint8_t *BranchOperand;
+    if (Offset >= EndOffset) {
+      return nullptr;
+    }
+    parseILOpcode(ILInput, Offset, ILSize, this, &BranchOpcode,
+                  &BranchOperand);
+    if ((BranchOpcode != ReaderBaseNS::CEE_BRTRUE) &&
+        (BranchOpcode != ReaderBaseNS::CEE_BRTRUE_S) &&
+        (BranchOpcode != ReaderBaseNS::CEE_BRFALSE) &&
+        (BranchOpcode != ReaderBaseNS::CEE_BRFALSE_S)) {
+      return nullptr;
+    }
+
+    CORINFO_RESOLVED_TOKEN CastToken;
+    resolveToken(readValue<mdToken>(Operand), CORINFO_TOKENKIND_Casting,
+                 &CastToken);
+    if (getClassAttribs(CastToken.hClass) & CORINFO_FLG_SHAREDINST) {
+      return nullptr;
+    }
+    // The runtime's isinst to Nullable<T> succeeds on a boxed T, which
+    // canCast does not know about.
+    if (getBoxHelper(CastToken.hClass) == CORINFO_HELP_BOX_NULLABLE) {
+      return nullptr;
+    }
+    handleClassAccess(&CastToken);
+    bool CanCast = JitInfo->canCast(Class, CastToken.hClass) != FALSE;
+    *NextOffset = Offset;
+    return loadConstantI4(CanCast ? 1 : 0);
+  }
+
+  default:
+    return nullptr;
+  }
+}
+
 // CastClass - Generate a simple helper call for the cast class.
 IRNode *ReaderBase::castClass(CORINFO_RESOLVED_TOKEN *ResolvedToken,
                               IRNode *ObjRefNode) {
@@ -3729,10 +3859,16 @@ ReaderBase::rdrGetStaticFieldAddress(CORINFO_RESOLVED_TOKEN *ResolvedToken,
       // be interpreted as interior GC pointers.
       IRNode *TempNode = makePtrNode(Reader_PtrGcInterior);
 
+      // As below, the call may be moved if the class has relaxed static
+      // init semantics.
+      bool CanMoveUp = (getClassAttribs(ResolvedToken->hClass) &
+                        CORINFO_FLG_BEFOREFIELDINIT) != 0;
+
       // Now make the call and attach the arguments.
       const bool MayThrow = false;
-      SharedStaticsBaseNode =
-          callHelper(FieldInfo->helper, MayThrow, TempNode, ClassHandleNode);
+      SharedStaticsBaseNode = callHelper(
+          FieldInfo->helper, MayThrow, TempNode, ClassHandleNode, nullptr,
+          nullptr, nullptr, Reader_AlignUnknown, false, false, CanMoveUp);
     } else {
       CorInfoHelpFunc HelperId = FieldInfo->helper;
       CORINFO_CLASS_HANDLE Class = ResolvedToken->hClass;
@@ -4802,6 +4938,12 @@ ReaderBase::rdrCall(ReaderCallTargetData *Data, ReaderBaseNS::CallOpcode Opcode,
   return ReturnNode;
 }
 
+bool ReaderBase::isSingleAssignmentLocal(uint32_t LocalOrdinal) {
+  return (LocalOrdinal < MethodInfo->locals.numArgs) &&
+         StoredLocals->getBit(LocalOrdinal) &&
+         !ReassignedLocals->getBit(LocalOrdinal);
+}
+
 bool ReaderBase::rdrCallIsDelegateInvoke(ReaderCallTargetData *CallTargetData) {
   uint32_t MethodAttribs = CallTargetData->getMethodAttribs();
   if ((MethodAttribs & CORINFO_FLG_DELEGATE_INVOKE) != 0) {
@@ -4825,6 +4967,13 @@ void ReaderBase::rdrMakeCallTargetNode(ReaderCallTargetData *CallTargetData,
   // Check for Delegate Invoke optimization
   if (rdrCallIsDelegateInvoke(CallTargetData)) {
     Target = rdrGetDelegateInvokeTarget(CallTargetData, ThisPtr);
+  } else if ((ThisPtr != nullptr) &&
+             rdrCanDevirtualize(CallTargetData, *ThisPtr)) {
+    // Virtual call whose target is known. Call it directly, checking the
+    // this pointer for null as the dispatch would have.
+    CallTargetData->IsDevirtualized = true;
+    CallTargetData->NeedsNullCheck = true;
+    Target = rdrGetDirectCallTarget(CallTargetData);
   } else {
     // Insert the code sequence to load a pointer to the target function.
     // If that sequence involves dereferencing the current method's instance
@@ -4868,6 +5017,21 @@ void ReaderBase::rdrMakeCallTargetNode(ReaderCallTargetData *CallTargetData,
       ASSERTMNR(UNREACHED, "Unexpected call kind");
       Target = nullptr;
     }
+
+    // If the receiver is likely of the class that declares the method,
+    // also get that method's entry point, for a call guarded by a check of
+    // the receiver's method table.
+    if ((ThisPtr != nullptr) &&
+        rdrCanGuardDevirtualize(CallTargetData, *ThisPtr)) {
+      CORINFO_CLASS_HANDLE Class = CallTargetData->getClassHandle();
+      bool IsIndirect;
+      void *ClassHandle = embedClassHandle(Class, &IsIndirect);
+      CallTargetData->GuardClassNode =
+          handleToIRNode(mdtClassHandle, ClassHandle, Class, IsIndirect,
+                         IsIndirect, true, false);
+      CallTargetData->GuardedCallTargetNode =
+          rdrGetDirectCallTarget(CallTargetData);
+    }
   }
 
   CallTargetData->CallTargetNode = Target;
@@ -5086,6 +5250,75 @@ ReaderBase::rdrGetVirtualTableCallTarget(ReaderCallTargetData *CallTargetData,
   return derefAddressNonNull(VTableSlot, false, true);
 }
 
+bool ReaderBase::rdrCanDevirtualize(ReaderCallTargetData *CallTargetData,
+                                    IRNode *ThisArg) {
+  CORINFO_CALL_INFO *CallInfo = CallTargetData->getCallInfo();
+  if ((CallInfo->kind != CORINFO_VIRTUALCALL_VTABLE) &&
+      (CallInfo->kind != CORINFO_VIRTUALCALL_STUB)) {
+    return false;
+  }
+
+  // In ReadyToRun mode the EE only describes how to reach the target of a
+  // direct call, and the target of a call from shared generic code may
+  // need a runtime lookup.
+  if ((Flags & CORJIT_FLG_READYTORUN) ||
+      CallInfo->exactContextNeedsRuntimeLookup || (ThisArg == nullptr)) {
+    return false;
+  }
+
+  // Nothing can override a final method, or a method of a sealed class.
+  if (((CallTargetData->getMethodAttribs() & CORINFO_FLG_FINAL) != 0) ||
+      ((CallTargetData->getClassAttribs() & CORINFO_FLG_FINAL) != 0)) {
+    return true;
+  }
+
+  // A receiver whose class declares the method uses that method. The EE
+  // interface cannot say which override a class uses for a method declared
+  // in one of its bases or interfaces, so those calls stay virtual.
+  CORINFO_CLASS_HANDLE ReceiverClass = getExactClass(ThisArg);
+  if (ReceiverClass == nullptr) {
+    ReceiverClass = inferThisClass(ThisArg);
+    if ((ReceiverClass == nullptr) ||
+        ((getClassAttribs(ReceiverClass) & CORINFO_FLG_FINAL) == 0)) {
+      return false;
+    }
+  }
+  return ReceiverClass == CallTargetData->getClassHandle();
+}
+
+bool ReaderBase::rdrCanGuardDevirtualize(ReaderCallTargetData *CallTargetData,
+                                         IRNode *ThisArg) {
+  CORINFO_CALL_INFO *CallInfo = CallTargetData->getCallInfo();
+  if ((CallInfo->kind != CORINFO_VIRTUALCALL_VTABLE) &&
+      (CallInfo->kind != CORINFO_VIRTUALCALL_STUB)) {
+    return false;
+  }
+  if ((Flags & CORJIT_FLG_READYTORUN) ||
+      CallInfo->exactContextNeedsRuntimeLookup || (ThisArg == nullptr)) {
+    return false;
+  }
+
+  // A call with a tail prefix must stay a tail call, which neither of a
+  // pair of guarded calls is.
+  if (CallTargetData->isTailCall() && !CallTargetData->isUnmarkedTailCall()) {
+    return false;
+  }
+
+  // The guard compares method tables, so there must be one method table for
+  // the class, and receivers of exactly that class. As with unguarded
+  // devirtualization, the override a derived class uses is not known, so
+  // the method of an interface cannot be called directly.
+  CORINFO_CLASS_HANDLE Class = CallTargetData->getClassHandle();
+  const uint32_t NotGuardedAttribs =
+      CORINFO_FLG_INTERFACE | CORINFO_FLG_ABSTRACT | CORINFO_FLG_ARRAY;
+  if (((CallTargetData->getClassAttribs() & NotGuardedAttribs) != 0) ||
+      ((CallTargetData->getMethodAttribs() & CORINFO_FLG_ABSTRACT) != 0) ||
+      !canInlineTypeCheckWithObjectVTable(Class)) {
+    return false;
+  }
+  return isLikelyReceiverClass(CurrInstrOffset, Class);
+}
+
 // Generate the target for a delegate invoke.
 IRNode *
 ReaderBase::rdrGetDelegateInvokeTarget(ReaderCallTargetData *CallTargetData,
@@ -7235,14 +7468,10 @@ void ReaderBase::readBytesForFlowGraphNode(FlowGraphNode *Fg,
     // stack for this block, verify that the current stack is empty.
     ReaderStack *Temp = fgNodeGetOperandStack(Fg);
     if (Temp) {
-      // If we are going to switch stacks make sure to clean up the active
-      // stack -- any important state was propagated to the successors
-      // already.
-      if (ReaderOperandStack != Temp) {
-        if (ReaderOperandStack != nullptr) {
-          delete ReaderOperandStack;
-        }
-      }
+      // We are going to switch stacks; any important state on the active
+      // stack was propagated to the successors already. The active stack
+      // lives in reader temporary memory, which the client releases once
+      // reading completes.
       ReaderOperandStack = Temp->copy();
     } else {
       ReaderOperandStack->assertEmpty();
@@ -7497,7 +7726,6 @@ void ReaderBase::msilToIR(void) {
     // Pop top block
     FlowGraphNode *Block = Worklist->Block;
     FlowGraphNodeWorkList *Next = Worklist->Next;
-    delete Worklist;
     // Prepend unvisited successors to worklist
     Worklist = fgPrependUnvisitedSuccToWorklist(Next, Block);
   }
@@ -7622,45 +7850,14 @@ void ReaderBase::msilToIR(void) {
   //
   readerPostPass(IsImportOnly);
 
-  // Cleanup memory used
-  for (uint32_t Index = 0; Index < NodeOffsetListArraySize; Index++) {
-    FlowGraphNodeOffsetList *Element = NodeOffsetListArray[Index];
-    while (Element != nullptr) {
-      FlowGraphNodeOffsetList *NextElement = Element->getNext();
-      delete Element;
-      Element = NextElement;
-    }
-  }
-  delete NodeOffsetListArray;
-
+  // Drop references to memory used by the reader. The memory itself was
+  // obtained via getTempMemory and getProcMemory and is owned by the client.
   for (FlowGraphNode *Block = FgHead; Block != nullptr;
        Block = fgNodeGetNext(Block)) {
-    ReaderStack *Stack = fgNodeGetOperandStack(Block);
-    if (Stack != nullptr) {
-      delete Stack;
-      fgNodeSetOperandStack(Block, nullptr);
-    }
-  }
-
-  if (ReaderOperandStack != nullptr) {
-    delete ReaderOperandStack;
-    ReaderOperandStack = nullptr;
-  }
-
-  EHRegionList *RegionList = AllRegionList;
-  while (RegionList != nullptr) {
-    EHRegionList *Next = rgnListGetNext(RegionList);
-    EHRegion *Region = rgnListGetRgn(RegionList);
-    EHRegionList *Children = rgnGetChildList(Region);
-    while (Children != nullptr) {
-      EHRegionList *NextChild = rgnListGetNext(Children);
-      free(Children);
-      Children = NextChild;
-    }
-    free(RegionList);
-    free(Region);
-    RegionList = Next;
+    fgNodeSetOperandStack(Block, nullptr);
   }
+  ReaderOperandStack = nullptr;
+  NodeOffsetListArray = nullptr;
 }
 
 bool ReaderBase::fgNodeHasMultiplePredsPropagatingStack(FlowGraphNode *Node) {
@@ -8107,6 +8304,7 @@ void ReaderCallTargetData::init(
   this->AreClassAttribsValid = false;
   this->IsCallInfoValid = false;
   this->NeedsNullCheck = false;
+  this->IsDevirtualized = false;
   this->CorIntrinsicId = CORINFO_INTRINSIC_Count;
   this->IsOptimizedDelegateCtor = false;
   this->CtorArgs = nullptr;
@@ -8115,6 +8313,8 @@ void ReaderCallTargetData::init(
   this->TargetMethodHandleNode = nullptr;
   this->IndirectionCellNode = nullptr;
   this->CallTargetNode = nullptr;
+  this->GuardClassNode = nullptr;
+  this->GuardedCallTargetNode = nullptr;
 
   // fill CALL_INFO, SIG_INFO, METHOD_HANDLE, METHOD_ATTRIBS
   fillTargetInfo(TargetToken, ConstraintToken, Context, Scope, Caller,
@@ -16,18 +16,26 @@
 #include "earlyincludes.h"
 #include "readerir.h"
 #include "imeta.h"
+#include "CastCache.h"
+#include "ClassProfile.h"
 #include "newvstate.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/IR/DebugLoc.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/Support/Debug.h"            // for dbgs()
 #include "llvm/Support/Format.h"           // for format()
 #include "llvm/Support/raw_ostream.h"      // for errs()
 #include "llvm/Support/ConvertUTF.h"       // for ConvertUTF16toUTF8
 #include "llvm/Transforms/Utils/Cloning.h" // for CloneBasicBlock/RemapInstr
 #include "llvm/Transforms/Utils/Local.h"   // for removeUnreachableBlocks
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include <cstdlib>
@@ -81,17 +89,21 @@ void GenStack::print() {
 #endif
 
 ReaderStack *GenStack::copy() {
-  void *Buffer = Reader->getTempMemory(sizeof(GenStack));
-  GenStack *Copy = new (Buffer) GenStack(Stack.capacity(), Reader);
+  GenStack *Copy = ((GenIR *)Reader)->allocateStack(Stack.capacity());
   for (auto Value : *this) {
     Copy->push(Value);
   }
   return Copy;
 }
 
-ReaderStack *GenIR::createStack() {
-  void *Buffer = getTempMemory(sizeof(GenStack));
-  return new (Buffer) GenStack(4, this);
+ReaderStack *GenIR::createStack() { return allocateStack(4); }
+
+GenStack *GenIR::allocateStack(uint32_t MaxStack) {
+  // The stack's storage is released along with the rest of the reader's
+  // temporary memory, so its destructor must run at that point too.
+  ArenaAllocator &Arena = JitContext->TempArena;
+  void *Buffer = Arena.allocate(sizeof(GenStack));
+  return Arena.registerDestructor(new (Buffer) GenStack(MaxStack, this));
 }
 
 #pragma endregion
@@ -132,14 +144,11 @@ public:
 };
 
 EHRegion *GenIR::rgnAllocateRegion() {
-  // TODO: Using ProcMemory here.
-  // Do we really want these Region objects to persist?
+  // Regions are referenced from the IR until the jit request completes.
   return (EHRegion *)getProcMemory(sizeof(EHRegion));
 }
 
 EHRegionList *GenIR::rgnAllocateRegionList() {
-  // TODO: Using ProcMemory here.
-  // Do we really want these Region objects to persist?
   return (EHRegionList *)getProcMemory(sizeof(EHRegionList));
 }
 
@@ -245,11 +254,14 @@ EHRegion *rgnGetEntryRegion(EHRegion *TryRegion) {
 //===----------------------------------------------------------------------===//
 
 // Get memory that will be freed at end of reader
+void *GenIR::getTempMemory(size_t NumBytes) {
+  return JitContext->TempArena.allocate(NumBytes);
+}
 
-void *GenIR::getTempMemory(size_t NumBytes) { return calloc(1, NumBytes); }
-
-// Get memory that will persist after the reader
-void *GenIR::getProcMemory(size_t NumBytes) { return calloc(1, NumBytes); }
+// Get memory that will persist until the jit request completes
+void *GenIR::getProcMemory(size_t NumBytes) {
+  return JitContext->ProcArena.allocate(NumBytes);
+}
 
 #pragma endregion
 
@@ -269,6 +281,20 @@ static Argument *functionArgAt(Function *F, uint32_t I) {
   return &*Args;
 }
 
+/// \brief Mark \p Length, a load of the length of an array or string, as
+/// invariant and in the range [0, INT32_MAX].
+static void setLengthMetadata(LoadInst *Length) {
+  LLVMContext &Context = Length->getContext();
+  MDNode *EmptyNode = MDNode::get(Context, ArrayRef<Metadata *>());
+  Length->setMetadata(LLVMContext::MD_invariant_load, EmptyNode);
+
+  unsigned BitWidth = Length->getType()->getIntegerBitWidth();
+  MDBuilder Builder(Context);
+  Length->setMetadata(LLVMContext::MD_range,
+                      Builder.createRange(APInt(BitWidth, 0),
+                                          APInt(BitWidth, 1U << 31)));
+}
+
 static bool doesArgumentHaveHome(const ABIArgInfo &Info) {
   switch (Info.getKind()) {
   case ABIArgInfo::Indirect:
@@ -321,10 +347,14 @@ void GenIR::readerPrePass(uint8_t *Buffer, uint32_t NumBytes) {
 
   LLVMBuilder = new IRBuilder<>(LLVMContext);
 
+  // The debug locations carry the IL offsets reported to the EE, so they
+  // are always created. The compile unit is only registered with the module
+  // (which is what makes codegen emit DWARF and track variables) when the EE
+  // asked for debug info.
   DBuilder = new DIBuilder(*JitContext->CurrentModule);
-  LLILCDebugInfo.TheCU = DBuilder->createCompileUnit(dwarf::DW_LANG_C_plus_plus,
-                                                     Function->getName().str(),
-                                                     ".", "LLILCJit", 0, "", 0);
+  LLILCDebugInfo.TheCU = DBuilder->createCompileUnit(
+      dwarf::DW_LANG_C_plus_plus, Function->getName().str(), ".", "LLILCJit",
+      0, "", 0, "", DIBuilder::FullDebug, 0, emitDebugInfo());
 
   LLVMBuilder->SetInsertPoint(EntryBlock);
 
@@ -507,9 +537,13 @@ void GenIR::readerPrePass(uint8_t *Buffer, uint32_t NumBytes) {
   Instruction *CurrentInstruction = &*LLVMBuilder->GetInsertPoint();
   IRNode *CurrentIRNode = (IRNode *)CurrentInstruction;
   FirstMSILBlock = fgSplitBlock(CurrentFlowGraphNode, CurrentIRNode);
+
+  JitContext->PhaseTimer.enterPhase(ReaderFlowGraphPhase);
 }
 
-void GenIR::readerMiddlePass() { return; }
+void GenIR::readerMiddlePass() {
+  JitContext->PhaseTimer.enterPhase(ReaderMainPassPhase);
+}
 
 void GenIR::readerPostVisit() {
   // Insert IR for some deferred prolog actions.  These logically have offset
@@ -801,7 +835,25 @@ void GenIR::markGCLeaf(CallSite Call) {
   Call.setAttributes(Attrs);
 }
 
+void GenIR::markNonNullResult(CallSite Call, uint64_t DereferenceableBytes) {
+  AttributeSet Attrs = Call.getAttributes();
+  Attrs = Attrs.addAttribute(*JitContext->LLVMContext,
+                             AttributeSet::ReturnIndex, Attribute::NonNull);
+  if (DereferenceableBytes != 0) {
+    Attrs = Attrs.addDereferenceableAttr(*JitContext->LLVMContext,
+                                         AttributeSet::ReturnIndex,
+                                         DereferenceableBytes);
+  }
+  Call.setAttributes(Attrs);
+}
+
 void GenIR::readerPostPass(bool IsImportOnly) {
+  if (!IsImportOnly && JitContext->Options->DoInlining) {
+    inlineCalls();
+  }
+  if (!IsImportOnly) {
+    promoteLocals();
+  }
 
   SmallVector<Value *, 4> EscapingLocs;
   GcFuncInfo->getEscapingLocations(EscapingLocs);
@@ -865,12 +917,284 @@ void GenIR::readerPostPass(bool IsImportOnly) {
 
   // While Jitting a method, SafepointPoll must appear after the function
   // actually being Jitted. EE's DebugInfoManager depends on the fact that
-  // the Jitted function starts at the allocated code block.
-  if (JitContext->Options->DoInsertStatepoints) {
+  // the Jitted function starts at the allocated code block. Inlinees share
+  // the module of the method being jitted, which creates it.
+  if (JitContext->Options->DoInsertStatepoints &&
+      (JitContext->InlineDepth == 0)) {
     createSafepointPoll();
   }
 }
 
+// Budget heuristics for inlining. Sizes are in bytes of IL. A method may
+// inline InlineBudgetScale times its own size, counting small methods as
+// MinInlineBudgetBase bytes.
+static const uint32_t AlwaysInlineILSize = 16;  // No bigger than a call.
+static const uint32_t DefaultInlineILSize = 32; // Limit for calls not in loops.
+static const uint32_t LoopInlineILSize = 64;    // Limit for calls in loops.
+static const uint32_t InlineBudgetScale = 4;
+static const uint32_t MinInlineBudgetBase = 32;
+static const uint32_t MaxInlineDepth = 3; // Levels of inlinees in inlinees.
+
+void GenIR::inlineCalls() {
+  // Weigh the calls before inlining changes the flow graph. A call in a loop
+  // is likely to run often; a call in a block that ends by throwing, or that
+  // never ran when the method was profiled, is not.
+  DominatorTree DomTree(*Function);
+  LoopInfo Loops(DomTree);
+  struct WeighedCall {
+    CallSite Call;
+    CORINFO_METHOD_HANDLE Method;
+    bool IsInLoop;
+  };
+  SmallVector<WeighedCall, 8> Calls;
+  for (const InlineCandidate &Candidate : InlineCandidates) {
+    Value *Call = Candidate.Call;
+    if (Call == nullptr) {
+      // The call was in an unreachable block.
+      continue;
+    }
+    BasicBlock *Block = cast<Instruction>(Call)->getParent();
+    if (Candidate.IsNeverRun || isa<UnreachableInst>(Block->getTerminator())) {
+      reportInlineDecision(Candidate.Method, INLINE_FAIL,
+                           "call site rarely run");
+      continue;
+    }
+    bool IsInLoop = Loops.getLoopFor(Block) != nullptr;
+    Calls.push_back({CallSite(Call), Candidate.Method, IsInLoop});
+  }
+  InlineCandidates.clear();
+
+  // Calls in loops get the first claim on the budget.
+  std::stable_partition(Calls.begin(), Calls.end(),
+                        [](const WeighedCall &C) { return C.IsInLoop; });
+
+  uint32_t Budget =
+      InlineBudgetScale *
+      std::max(JitContext->MethodInfo->ILCodeSize, MinInlineBudgetBase);
+  for (WeighedCall &C : Calls) {
+    CorInfoInline Result;
+    const char *Reason =
+        inlineCall(C.Call, C.Method, C.IsInLoop, Budget, Result);
+    reportInlineDecision(C.Method, Result, Reason);
+  }
+}
+
+/// \brief Delete an inlinee that was read but not inlined, along with its
+/// GC info.
+static void eraseInlinee(llvm::Function *Inlinee, ::GcInfo *GcInfo) {
+  if (Inlinee == nullptr) {
+    return;
+  }
+  GcInfo->deleteGcInfo(Inlinee);
+  Inlinee->dropAllReferences();
+  Inlinee->replaceAllUsesWith(UndefValue::get(Inlinee->getType()));
+  Inlinee->eraseFromParent();
+}
+
+const char *GenIR::inlineCall(CallSite Call, CORINFO_METHOD_HANDLE Method,
+                              bool IsInLoop, uint32_t &Budget,
+                              CorInfoInline &Result) {
+  Result = INLINE_FAIL;
+
+  if (JitContext->InlineDepth >= MaxInlineDepth) {
+    return "too deep";
+  }
+  CallInst *TheCall = dyn_cast<CallInst>(Call.getInstruction());
+  if ((TheCall != nullptr) && TheCall->isMustTailCall()) {
+    return "musttail call";
+  }
+  if (Call.getOperandBundle(LLVMContext::OB_funclet)) {
+    return "call site in a handler";
+  }
+
+  // Screen the method before asking the EE or reading it.
+  if (getMethodAttribs(Method) & CORINFO_FLG_SYNCH) {
+    return "synchronized";
+  }
+  CORINFO_METHOD_INFO Info;
+  if (!JitContext->JitInfo->getMethodInfo(Method, &Info)) {
+    return "no IL";
+  }
+  if (Info.EHcount > 0) {
+    return "has exception handling";
+  }
+  if (Info.args.hasTypeArg()) {
+    return "needs an instantiation argument";
+  }
+  uint32_t ILSize = Info.ILCodeSize;
+  const char *Profitability;
+  if (ILSize <= AlwaysInlineILSize) {
+    Profitability = "below always-inline size";
+  } else if (IsInLoop && (ILSize <= LoopInlineILSize)) {
+    Profitability = "call site in a loop";
+  } else if (ILSize <= DefaultInlineILSize) {
+    Profitability = "small method";
+  } else {
+    return "too many IL bytes";
+  }
+  if (ILSize > Budget) {
+    return "inline budget exhausted";
+  }
+
+  uint32_t Restrictions = 0;
+  Result = canInline(getCurrentMethodHandle(), Method, &Restrictions);
+  if (Result != INLINE_PASS) {
+    return "canInline declined";
+  }
+  Result = INLINE_FAIL;
+  if (Restrictions != 0) {
+    // Security boundaries, ldstr and same-this restrictions are not
+    // tracked, so any restriction rules the inlinee out.
+    return "inlining restrictions";
+  }
+
+  // Read the inlinee into a function of its own in this module. It is
+  // inlined with the reader's own inlining heuristics applied to its calls.
+  LLILCJitContext InlineeContext(JitContext, &Info);
+  GenIR Reader(&InlineeContext);
+  try {
+    Reader.msilToIR();
+  } catch (NotYetImplementedException &) {
+    eraseInlinee(Reader.Function, JitContext->GcInfo);
+    return "inlinee could not be read";
+  }
+  llvm::Function *Inlinee = Reader.Function;
+
+  // Check that what was read can be merged into this method.
+  const char *Reason = nullptr;
+  if (Reader.HasLocAlloc) {
+    Reason = "localloc";
+  } else if (Reader.containsUnmanagedCall()) {
+    Reason = "unmanaged call";
+  } else if (Reader.NeedsSecurityObject) {
+    Reason = "needs a security object";
+  } else if (Reader.KeepGenericContextAlive) {
+    Reason = "keeps the generic context alive";
+  } else if ((Inlinee->getType() != Call.getCalledValue()->getType()) ||
+             (Inlinee->getCallingConv() != Call.getCallingConv())) {
+    Reason = "signature mismatch";
+  } else if (!Inlinee->use_empty()) {
+    Reason = "recursive";
+  }
+  if (Reason == nullptr) {
+    for (Instruction &Instr : instructions(Inlinee)) {
+      CallInst *InlineeCall = dyn_cast<CallInst>(&Instr);
+      if ((InlineeCall != nullptr) && InlineeCall->isMustTailCall()) {
+        Reason = "jmp";
+        break;
+      }
+    }
+  }
+  // Only the GC's own slots can be merged; the other special slots belong
+  // to the method being jitted.
+  ::GcFuncInfo *InlineeGcInfo = JitContext->GcInfo->getGcInfo(Inlinee);
+  if (Reason == nullptr) {
+    const uint32_t MergeableFlags = AllocaFlags::GcValue | AllocaFlags::Pinned;
+    for (auto Entry : InlineeGcInfo->AllocaMap) {
+      const AllocaInfo &Slot = Entry.second;
+      if (!Slot.isGcValue() || ((Slot.Flags & ~MergeableFlags) != 0) ||
+          !Entry.first->isStaticAlloca()) {
+        Reason = "special stack slot";
+        break;
+      }
+    }
+  }
+  if (Reason != nullptr) {
+    eraseInlinee(Inlinee, JitContext->GcInfo);
+    return Reason;
+  }
+
+  // The inlinee's stack slots become this method's, so tag the ones the GC
+  // must know about to find their copies once inlined. The escape of the
+  // slots is redone for this method as a whole.
+  llvm::LLVMContext &LLVMContext = *JitContext->LLVMContext;
+  unsigned GcSlotKind = LLVMContext.getMDKindID("llilc.gc.slot");
+  Type *Int1Ty = Type::getInt1Ty(LLVMContext);
+  for (auto Entry : InlineeGcInfo->AllocaMap) {
+    AllocaInst *Alloca = const_cast<AllocaInst *>(Entry.first);
+    Constant *IsPinned = ConstantInt::get(Int1Ty, Entry.second.isPinned());
+    Alloca->setMetadata(
+        GcSlotKind,
+        MDNode::get(LLVMContext, ConstantAsMetadata::get(IsPinned)));
+  }
+  for (Instruction &Instr : Inlinee->getEntryBlock()) {
+    IntrinsicInst *Escape = dyn_cast<IntrinsicInst>(&Instr);
+    if ((Escape != nullptr) &&
+        (Escape->getIntrinsicID() == Intrinsic::localescape)) {
+      Escape->eraseFromParent();
+      break;
+    }
+  }
+
+  // The inlined code maps back to the IL offset of the call. Its calls
+  // can't be tail calls, since it may be passed pointers into this frame.
+  // Its null checks must stay explicit if it is inlined into a protected
+  // region.
+  DebugLoc CallLoc = Call->getDebugLoc();
+  bool IsProtected = Call.isInvoke();
+  for (Instruction &Instr : instructions(Inlinee)) {
+    Instr.setDebugLoc(CallLoc);
+    if (CallInst *InlineeCall = dyn_cast<CallInst>(&Instr)) {
+      InlineeCall->setTailCall(false);
+    }
+    if (IsProtected && isa<BranchInst>(Instr)) {
+      Instr.setMetadata(LLVMContext::MD_make_implicit, nullptr);
+    }
+  }
+
+  Value *Target = Call.getCalledValue();
+  Call.setCalledFunction(Inlinee);
+  Call->setDebugLoc(DebugLoc());
+  InlineFunctionInfo InlineInfo;
+  if (!InlineFunction(Call, InlineInfo)) {
+    Call.setCalledFunction(Target);
+    Call->setDebugLoc(CallLoc);
+    eraseInlinee(Inlinee, JitContext->GcInfo);
+    return "LLVM declined";
+  }
+
+  for (AllocaInst *Alloca : InlineInfo.StaticAllocas) {
+    MDNode *GcSlot = Alloca->getMetadata(GcSlotKind);
+    if (GcSlot == nullptr) {
+      continue;
+    }
+    Alloca->setMetadata(GcSlotKind, nullptr);
+    GcFuncInfo->recordGcAlloca(Alloca);
+    if (mdconst::extract<ConstantInt>(GcSlot->getOperand(0))->isOne()) {
+      GcFuncInfo->recordPinned(Alloca);
+    }
+  }
+  if ((AllocaInsertionPoint == nullptr) &&
+      !InlineInfo.StaticAllocas.empty()) {
+    // The inlined allocas now lead the entry block.
+    AllocaInsertionPoint = InlineInfo.StaticAllocas.back();
+  }
+
+  for (const auto &Entry : InlineeContext.NameToHandleMap) {
+    (*NameToHandleMap)[Entry.getKey()] = Entry.getValue();
+  }
+  JitContext->GcInfo->deleteGcInfo(Inlinee);
+  Inlinee->eraseFromParent();
+  Budget -= ILSize;
+  Result = INLINE_PASS;
+  return Profitability;
+}
+
+void GenIR::reportInlineDecision(CORINFO_METHOD_HANDLE Method,
+                                 CorInfoInline Result, const char *Reason) {
+  JitContext->JitInfo->reportInliningDecision(getCurrentMethodHandle(),
+                                              Method, Result, Reason);
+  if (JitContext->Options->DumpLevel == ::DumpLevel::VERBOSE) {
+    const char *ModuleName = nullptr;
+    const char *MethodName =
+        JitContext->JitInfo->getMethodName(Method, &ModuleName);
+    dbgs() << "INFO:  "
+           << ((Result == INLINE_PASS) ? "inlined " : "did not inline ")
+           << ModuleName << "." << MethodName << " into "
+           << JitContext->MethodName << " [" << Reason << "]\n";
+  }
+}
+
 void GenIR::insertIRToKeepGenericContextAlive() {
   IRBuilder<>::InsertPoint SavedInsertPoint = LLVMBuilder->saveIP();
   Value *ContextLocalAddress = nullptr;
@@ -1092,31 +1416,42 @@ void GenIR::createSym(uint32_t Num, bool IsAuto, CorInfoType CorType,
   bool UseNumber = false;
   uint32_t Number = Num;
 
+  // The number the EE knows the symbol by: IL arguments first, then IL
+  // locals, with special numbers for the hidden arguments.
+  uint32_t ILVarNumber;
+
   switch (SymType) {
   case ReaderSpecialSymbolType::Reader_ThisPtr:
     ASSERT(MethodSignature.hasThis());
     SymName = "this";
+    ILVarNumber = 0;
     break;
 
   case ReaderSpecialSymbolType::Reader_InstParam:
     ASSERT(MethodSignature.hasTypeArg());
     SymName = "$TypeArg";
+    ILVarNumber = (uint32_t)ICorDebugInfo::TYPECTXT_ILNUM;
     break;
 
   case ReaderSpecialSymbolType::Reader_VarArgsToken:
     ASSERT(MethodSignature.isVarArg());
     SymName = "$VarargsToken";
+    ILVarNumber = (uint32_t)ICorDebugInfo::VARARGS_HND_ILNUM;
     break;
 
   case ReaderSpecialSymbolType::Reader_SecretParam:
     ASSERT(MethodSignature.hasSecretParameter());
     SymName = "$SecretParam";
+    ILVarNumber = (uint32_t)ICorDebugInfo::UNKNOWN_ILNUM;
     break;
 
   default:
     UseNumber = true;
-    if (!IsAuto) {
+    if (IsAuto) {
+      ILVarNumber = JitContext->MethodInfo->args.totalILArgs() + Num;
+    } else {
       Number = MethodSignature.getILArgForArgIndex(Num);
+      ILVarNumber = Number;
     }
     break;
   }
@@ -1154,6 +1489,18 @@ void GenIR::createSym(uint32_t Num, bool IsAuto, CorInfoType CorType,
     GcFuncInfo->recordPinned(AllocaInst);
   }
 
+  if (IsAuto) {
+    LocalVars[Num] = AllocaInst;
+    LocalVarCorTypes[Num] = CorType;
+  } else {
+    Arguments[Num] = AllocaInst;
+  }
+
+  // Variable homes are only reported to the EE for debuggable code.
+  if (!emitDebugInfo()) {
+    return;
+  }
+
   DIFile *Unit = DBuilder->createFile(LLILCDebugInfo.TheCU->getFilename(),
                                       LLILCDebugInfo.TheCU->getDirectory());
 
@@ -1164,27 +1511,22 @@ void GenIR::createSym(uint32_t Num, bool IsAuto, CorInfoType CorType,
   std::string Name =
       (UseNumber ? Twine(SymName) + Twine(Number) : Twine(SymName)).str();
 
+  // As IL offsets are the lines of instructions, the IL variable number is
+  // the line of a variable. DebugInfoRecorder reports it to the EE.
+  DILocalVariable *DebugVar;
   if (IsAuto) {
-    auto *DebugVar =
-        DBuilder->createAutoVariable(LLILCDebugInfo.FunctionScope, Name, Unit,
-                                     0, DebugType, AlwaysPreserve, Flags);
-    auto DL = llvm::DebugLoc::get(0, 0, LLILCDebugInfo.FunctionScope);
-    DBuilder->insertDeclare(AllocaInst, DebugVar, DBuilder->createExpression(),
-                            DL, LLVMBuilder->GetInsertBlock());
-
-    LocalVars[Num] = AllocaInst;
-    LocalVarCorTypes[Num] = CorType;
+    DebugVar = DBuilder->createAutoVariable(LLILCDebugInfo.FunctionScope, Name,
+                                            Unit, ILVarNumber, DebugType,
+                                            AlwaysPreserve, Flags);
   } else {
     unsigned ArgNo = Num + 1;
-
-    auto *DebugVar = DBuilder->createParameterVariable(
-        LLILCDebugInfo.FunctionScope, Name, ArgNo, Unit, 0, DebugType,
-        AlwaysPreserve, Flags);
-    auto DL = llvm::DebugLoc::get(0, 0, LLILCDebugInfo.FunctionScope);
-    DBuilder->insertDeclare(AllocaInst, DebugVar, DBuilder->createExpression(),
-                            DL, LLVMBuilder->GetInsertBlock());
-    Arguments[Num] = AllocaInst;
+    DebugVar = DBuilder->createParameterVariable(
+        LLILCDebugInfo.FunctionScope, Name, ArgNo, Unit, ILVarNumber,
+        DebugType, AlwaysPreserve, Flags);
   }
+  auto DL = llvm::DebugLoc::get(0, 0, LLILCDebugInfo.FunctionScope);
+  DBuilder->insertDeclare(AllocaInst, DebugVar, DBuilder->createExpression(),
+                          DL, LLVMBuilder->GetInsertBlock());
 }
 
 void GenIR::zeroInit(Value *Var) {
@@ -1234,6 +1576,60 @@ void GenIR::zeroInitLocals() {
 #endif // !NDEBUG
 }
 
+void GenIR::promoteLocals() {
+  if (!JitContext->Options->EnableOptimization ||
+      (JitContext->MethodInfo->EHcount != 0)) {
+    return;
+  }
+
+  SmallVector<AllocaInst *, 8> Allocas;
+  // The homes promoted are deleted, so they are cleared here.
+  auto AddPromotable = [&](Value *&Home) {
+    AllocaInst *Alloca = dyn_cast_or_null<AllocaInst>(Home);
+    if ((Alloca == nullptr) ||
+        Alloca->getAllocatedType()->isAggregateType() ||
+        Alloca->getAllocatedType()->isVectorTy() ||
+        !isAllocaPromotable(Alloca)) {
+      return;
+    }
+    auto Record = GcFuncInfo->AllocaMap.find(Alloca);
+    if ((Record != GcFuncInfo->AllocaMap.end()) &&
+        (Record->second.Flags != AllocaFlags::GcPointer)) {
+      return;
+    }
+    Allocas.push_back(Alloca);
+    Home = nullptr;
+  };
+  for (Value *&LocalVar : LocalVars) {
+    AddPromotable(LocalVar);
+  }
+  for (Value *&Argument : Arguments) {
+    AddPromotable(Argument);
+  }
+  if (Allocas.empty()) {
+    return;
+  }
+
+  // GC pointers in stack slots are zeroed in the post-pass; those held in
+  // SSA values start as null instead.
+  IRBuilder<>::InsertPoint SavedInsertPoint = LLVMBuilder->saveIP();
+  for (AllocaInst *Alloca : Allocas) {
+    if (GcInfo::isGcAllocation(Alloca)) {
+      assert(AllocaInsertionPoint != nullptr);
+      LLVMBuilder->SetInsertPoint(
+          AllocaInsertionPoint->getParent(),
+          std::next(AllocaInsertionPoint->getIterator()));
+      zeroInit(Alloca);
+    }
+  }
+  LLVMBuilder->restoreIP(SavedInsertPoint);
+
+  // Promoting a GC pointer deletes its alloca, and with it the record that
+  // would have escaped it.
+  DominatorTree DomTree(*Function);
+  PromoteMemToReg(Allocas, DomTree);
+}
+
 void GenIR::zeroInitBlock(Value *Address, uint64_t Size) {
   bool IsSigned = false;
   ConstantInt *BlockSize = ConstantInt::get(
@@ -1623,6 +2019,16 @@ bool GenIR::doSimdIntrinsicOpt() {
   return JitContext->Options->DoSIMDIntrinsic;
 }
 
+bool GenIR::doBoxOpt() { return JitContext->Options->EnableOptimization; }
+
+void GenIR::boxRemoved(CORINFO_CLASS_HANDLE Class) {
+  ++JitContext->NumBoxesRemoved;
+  if (JitContext->Options->DumpLevel == ::DumpLevel::VERBOSE) {
+    dbgs() << "INFO:  removed box of " << getClassName(Class) << " in "
+           << JitContext->MethodName << "\n";
+  }
+}
+
 #pragma endregion
 
 #pragma region DIAGNOSTICS
@@ -3825,7 +4231,78 @@ void GenIR::fgAddLabelToBranchList(IRNode *LabelNode, IRNode *BranchNode) {
   return;
 }
 
-void GenIR::insertIBCAnnotations() { return; }
+void GenIR::insertIBCAnnotations() {
+  // The EE has block counts for methods in images trained with IBC.
+  if (!JitContext->Options->EnableOptimization) {
+    return;
+  }
+  ULONG NumBlocks = 0;
+  ICorJitInfo::ProfileBuffer *Blocks = nullptr;
+  ULONG NumRuns = 0;
+  HRESULT Result = JitContext->JitInfo->getBBProfileData(
+      JitContext->MethodInfo->ftn, &NumBlocks, &Blocks, &NumRuns);
+  if (FAILED(Result) || (Blocks == nullptr) || (NumBlocks == 0) ||
+      (NumRuns == 0)) {
+    return;
+  }
+  for (ULONG I = 0; I < NumBlocks; ++I) {
+    ProfileCounts.emplace_back(Blocks[I].ILOffset, Blocks[I].ExecutionCount);
+  }
+  std::sort(ProfileCounts.begin(), ProfileCounts.end());
+
+  uint32_t EntryCount;
+  if (getProfileCount(0, EntryCount)) {
+    Function->setEntryCount(EntryCount);
+  }
+
+  // Weigh each edge out of a conditional branch or switch by the count of
+  // the block it goes to, which is exact unless that block is a join. An
+  // edge to a block that never ran gets no weight, so block placement moves
+  // the block out of the way of the code that did run.
+  MDBuilder Builder(*JitContext->LLVMContext);
+  for (BasicBlock &Block : *Function) {
+    TerminatorInst *Terminator = Block.getTerminator();
+    if ((Terminator == nullptr) || (Terminator->getNumSuccessors() < 2) ||
+        !(isa<BranchInst>(Terminator) || isa<SwitchInst>(Terminator))) {
+      continue;
+    }
+    uint32_t BlockCount;
+    auto Info = FlowGraphInfoMap.find(&Block);
+    if ((Info == FlowGraphInfoMap.end()) ||
+        !getProfileCount(Info->second.StartMSILOffset, BlockCount)) {
+      continue;
+    }
+    SmallVector<uint32_t, 4> Weights;
+    for (BasicBlock *Successor : successors(&Block)) {
+      uint32_t Count;
+      Info = FlowGraphInfoMap.find(Successor);
+      if ((Info == FlowGraphInfoMap.end()) ||
+          !getProfileCount(Info->second.StartMSILOffset, Count)) {
+        Weights.clear();
+        break;
+      }
+      Weights.push_back(std::min(Count, BlockCount));
+    }
+    if (!Weights.empty()) {
+      Terminator->setMetadata(LLVMContext::MD_prof,
+                              Builder.createBranchWeights(Weights));
+    }
+  }
+}
+
+bool GenIR::getProfileCount(uint32_t Offset, uint32_t &Count) {
+  // Find the last profiled block starting at or before Offset.
+  auto Next = std::upper_bound(
+      ProfileCounts.begin(), ProfileCounts.end(), Offset,
+      [](uint32_t Key, const std::pair<uint32_t, uint32_t> &Block) {
+        return Key < Block.first;
+      });
+  if (Next == ProfileCounts.begin()) {
+    return false;
+  }
+  Count = std::prev(Next)->second;
+  return true;
+}
 
 IRNode *GenIR::fgNodeFindStartLabel(FlowGraphNode *Block) { return nullptr; }
 
@@ -3888,8 +4365,15 @@ IRNode *GenIR::loadLen(IRNode *Array, bool ArrayMayBeNull) {
   Value *LengthFieldAddress = LLVMBuilder->CreateStructGEP(nullptr, Array, 1);
 
   // Load and return the length.
-  // TODO: this load cannot be aliased.
-  Value *Length = makeLoad(LengthFieldAddress, false, ArrayMayBeNull);
+  LoadInst *Length = makeLoad(LengthFieldAddress, false, ArrayMayBeNull,
+                              getAccessTag("array length"));
+  setLengthMetadata(Length);
+
+  // Tag the load so that bounds check elimination can tell which array's
+  // length it is.
+  llvm::LLVMContext &LLVMContext = *JitContext->LLVMContext;
+  Length->setMetadata(LLVMContext.getMDKindID("llilc.array.length"),
+                      MDNode::get(LLVMContext, ArrayRef<Metadata *>()));
 
   // Result is an unsigned native int.
   IRNode *Result = convertToStackType((IRNode *)Length,
@@ -3923,8 +4407,9 @@ IRNode *GenIR::loadStringLen(IRNode *Address) {
   Value *LengthFieldAddress = LLVMBuilder->CreateStructGEP(nullptr, Address, 1);
 
   // Load and return the length.
-  // TODO: this load cannot be aliased.
-  Value *Length = makeLoad(LengthFieldAddress, false, !NullCheckBeforeLoad);
+  LoadInst *Length = makeLoad(LengthFieldAddress, false, !NullCheckBeforeLoad,
+                              getAccessTag("string length"));
+  setLengthMetadata(Length);
   return (IRNode *)Length;
 }
 
@@ -3961,7 +4446,8 @@ IRNode *GenIR::stringGetChar(IRNode *Address, IRNode *Index) {
   Value *CharAddress = LLVMBuilder->CreateInBoundsGEP(Address, Indexes);
 
   // Load and return the char.
-  Value *Char = makeLoad(CharAddress, false, !NullCheckBeforeLoad);
+  Value *Char = makeLoad(CharAddress, false, !NullCheckBeforeLoad,
+                         getAccessTag("string chars"));
   IRNode *Result =
       convertToStackType((IRNode *)Char, CorInfoType::CORINFO_TYPE_CHAR);
 
@@ -4442,6 +4928,15 @@ void GenIR::storeLocal(uint32_t LocalOrdinal, IRNode *Arg1,
       convertFromStackType(Arg1, LocalVarCorTypes[LocalIndex], LocalTy);
   storeAtAddressNoBarrierNonNull((IRNode *)LocalAddress, Value, LocalTy,
                                  IsVolatile);
+
+  // A local stored to just once holds null or what was stored, so loads of
+  // it have the stored object's exact class.
+  if (isSingleAssignmentLocal(LocalOrdinal)) {
+    CORINFO_CLASS_HANDLE Class = getExactClass(Value);
+    if (Class != nullptr) {
+      LocalExactClassMap[LocalOrdinal] = Class;
+    }
+  }
 }
 
 IRNode *GenIR::loadLocal(uint32_t LocalOrdinal) {
@@ -4449,9 +4944,14 @@ IRNode *GenIR::loadLocal(uint32_t LocalOrdinal) {
   Value *LocalAddress = LocalVars[LocalIndex];
   Type *LocalTy = LocalAddress->getType()->getPointerElementType();
   const bool IsVolatile = false;
-  return loadAtAddressNonNull((IRNode *)LocalAddress, LocalTy,
-                              LocalVarCorTypes[LocalIndex], Reader_AlignNatural,
-                              IsVolatile);
+  IRNode *Result = loadAtAddressNonNull((IRNode *)LocalAddress, LocalTy,
+                                        LocalVarCorTypes[LocalIndex],
+                                        Reader_AlignNatural, IsVolatile);
+  auto Iterator = LocalExactClassMap.find(LocalOrdinal);
+  if (Iterator != LocalExactClassMap.end()) {
+    ExactClassMap[Result] = Iterator->second;
+  }
+  return Result;
 }
 
 IRNode *GenIR::loadLocalAddress(uint32_t LocalOrdinal) {
@@ -4696,7 +5196,8 @@ IRNode *GenIR::loadField(CORINFO_RESOLVED_TOKEN *ResolvedToken, IRNode *Obj,
       getFieldAddress(ResolvedToken, &FieldInfo, Obj, NullCheckBeforeLoad);
 
   return loadAtAddress(Address, FieldTy, CorInfoType, ResolvedToken,
-                       AlignmentPrefix, IsVolatile, !NullCheckBeforeLoad);
+                       AlignmentPrefix, IsVolatile, !NullCheckBeforeLoad,
+                       getFieldAccessTag(ResolvedToken->hField));
 }
 
 // Generate instructions for loading value of the specified type at the
@@ -4704,13 +5205,14 @@ IRNode *GenIR::loadField(CORINFO_RESOLVED_TOKEN *ResolvedToken, IRNode *Obj,
 IRNode *GenIR::loadAtAddress(IRNode *Address, Type *Ty, CorInfoType CorType,
                              CORINFO_RESOLVED_TOKEN *ResolvedToken,
                              ReaderAlignType AlignmentPrefix, bool IsVolatile,
-                             bool AddressMayBeNull) {
+                             bool AddressMayBeNull, MDNode *AccessTag) {
   if (Ty->isStructTy()) {
     bool IsFieldAccess = ResolvedToken->hField != nullptr;
     return loadObj(ResolvedToken, Address, AlignmentPrefix, IsVolatile,
                    IsFieldAccess, AddressMayBeNull);
   } else {
-    LoadInst *LoadInst = makeLoad(Address, IsVolatile, AddressMayBeNull);
+    LoadInst *LoadInst =
+        makeLoad(Address, IsVolatile, AddressMayBeNull, AccessTag);
     uint32_t Align = convertReaderAlignment(AlignmentPrefix);
     LoadInst->setAlignment(Align);
 
@@ -4745,14 +5247,15 @@ IRNode *GenIR::loadAtAddress(IRNode *Address, Type *Ty, CorInfoType CorType,
 void GenIR::storeAtAddress(IRNode *Address, IRNode *ValueToStore, Type *Ty,
                            CORINFO_RESOLVED_TOKEN *ResolvedToken,
                            ReaderAlignType Alignment, bool IsVolatile,
-                           bool IsField, bool AddressMayBeNull) {
+                           bool IsField, bool AddressMayBeNull,
+                           MDNode *AccessTag) {
   // We do things differently based on whether the field is a value class.
   if (Ty->isStructTy()) {
     storeObj(ResolvedToken, ValueToStore, Address, Alignment, IsVolatile,
              IsField, AddressMayBeNull);
   } else {
-    StoreInst *StoreInst =
-        makeStore(ValueToStore, Address, IsVolatile, AddressMayBeNull);
+    StoreInst *StoreInst = makeStore(ValueToStore, Address, IsVolatile,
+                                     AddressMayBeNull, AccessTag);
     uint32_t Align = convertReaderAlignment(Alignment);
     StoreInst->setAlignment(Align);
   }
@@ -4840,7 +5343,8 @@ void GenIR::storeField(CORINFO_RESOLVED_TOKEN *FieldToken, IRNode *ValueToStore,
 
   bool IsField = true;
   return storeAtAddress(Address, ValueToStore, FieldTy, FieldToken, Alignment,
-                        IsVolatile, IsField, !NullCheckBeforeStore);
+                        IsVolatile, IsField, !NullCheckBeforeStore,
+                        getFieldAccessTag(FieldHandle));
 }
 
 void GenIR::storePrimitiveType(IRNode *Value, IRNode *Addr,
@@ -4915,7 +5419,8 @@ void GenIR::storeIndirectArg(const CallArgType &ValueArgType,
 
 // Helper used to wrap CreateStore
 StoreInst *GenIR::makeStore(Value *ValueToStore, Value *Address,
-                            bool IsVolatile, bool AddressMayBeNull) {
+                            bool IsVolatile, bool AddressMayBeNull,
+                            MDNode *AccessTag) {
   // TODO: There is a JitConfig setting JitLockWrite which can alter how
   // volatile stores are handled for x86 architectures. When this is set we
   // should emit a (lock) xchg intead of mov. RyuJit doesn't to look at this
@@ -4929,16 +5434,22 @@ StoreInst *GenIR::makeStore(Value *ValueToStore, Value *Address,
       // to generate.
     }
   }
+  StoreInst *Store;
   if (ValueToStore->getType()->isVectorTy()) {
-    return LLVMBuilder->CreateAlignedStore(ValueToStore, Address, 1,
-                                           IsVolatile);
+    Store = LLVMBuilder->CreateAlignedStore(ValueToStore, Address, 1,
+                                            IsVolatile);
+  } else {
+    Store = LLVMBuilder->CreateStore(ValueToStore, Address, IsVolatile);
+  }
+  if (AccessTag != nullptr) {
+    Store->setMetadata(LLVMContext::MD_tbaa, AccessTag);
   }
-  return LLVMBuilder->CreateStore(ValueToStore, Address, IsVolatile);
+  return Store;
 }
 
 // Helper used to wrap CreateLoad
 LoadInst *GenIR::makeLoad(Value *Address, bool IsVolatile,
-                          bool AddressMayBeNull) {
+                          bool AddressMayBeNull, MDNode *AccessTag) {
   if (AddressMayBeNull) {
     if (UseExplicitNullChecks) {
       Address = genNullCheck((IRNode *)Address);
@@ -4948,11 +5459,66 @@ LoadInst *GenIR::makeLoad(Value *Address, bool IsVolatile,
       // to generate.
     }
   }
+  LoadInst *Load;
   if (Address->getType()->isPointerTy() &&
       Address->getType()->getPointerElementType()->isVectorTy()) {
-    return LLVMBuilder->CreateAlignedLoad(Address, 1, IsVolatile);
+    Load = LLVMBuilder->CreateAlignedLoad(Address, 1, IsVolatile);
+  } else {
+    Load = LLVMBuilder->CreateLoad(Address, IsVolatile);
+  }
+  if (AccessTag != nullptr) {
+    Load->setMetadata(LLVMContext::MD_tbaa, AccessTag);
   }
-  return LLVMBuilder->CreateLoad(Address, IsVolatile);
+  return Load;
+}
+
+MDNode *GenIR::getAccessTag(const Twine &Name) {
+  // Every tag is a scalar type directly under one root, so tags only
+  // alias themselves. MDBuilder's nodes are uniqued by name, so asking
+  // again for a name gets the same tag.
+  MDBuilder Builder(*JitContext->LLVMContext);
+  MDNode *Root = Builder.createTBAARoot("LLILC TBAA");
+  MDNode *Node = Builder.createTBAAScalarTypeNode(Name.str(), Root);
+  return Builder.createTBAAStructTagNode(Node, Node, 0);
+}
+
+MDNode *GenIR::getFieldAccessTag(CORINFO_FIELD_HANDLE Field) {
+  auto Iterator = FieldAccessTagMap->find(Field);
+  if (Iterator != FieldAccessTagMap->end()) {
+    return Iterator->second;
+  }
+
+  MDNode *AccessTag = nullptr;
+  CORINFO_CLASS_HANDLE Class = getFieldClass(Field);
+  uint32_t ClassAttribs = getClassAttribs(Class);
+  if ((ClassAttribs &
+       (CORINFO_FLG_VALUECLASS | CORINFO_FLG_OVERLAPPING_FIELDS)) == 0) {
+    // Name the tag after the field and the class that declares it. Two
+    // fields with the same names share a tag, which is safe.
+    const char *ClassName = nullptr;
+    const char *FieldName = getFieldName(Field, &ClassName);
+    AccessTag = getAccessTag(Twine(ClassName ? ClassName : "") + "::" +
+                             (FieldName ? FieldName : ""));
+  }
+  (*FieldAccessTagMap)[Field] = AccessTag;
+  return AccessTag;
+}
+
+MDNode *GenIR::getArrayElementAccessTag(Type *ElementTy) {
+  if (ElementTy->isPointerTy() &&
+      GcInfo::isGcPointer(cast<PointerType>(ElementTy))) {
+    return getAccessTag("array element ref");
+  }
+  if (ElementTy->isIntegerTy() || ElementTy->isFloatingPointTy() ||
+      ElementTy->isPointerTy()) {
+    const DataLayout *DataLayout = &JitContext->CurrentModule->getDataLayout();
+    uint64_t Size = DataLayout->getTypeStoreSize(ElementTy);
+    return getAccessTag("array element " + Twine(Size) + " bytes");
+  }
+
+  // Struct and vector elements are accessed by copies that are not tagged,
+  // so their parts are not tagged either.
+  return nullptr;
 }
 
 CallSite GenIR::makeCall(Value *Callee, bool MayThrow, ArrayRef<Value *> Args,
@@ -5165,7 +5731,8 @@ IRNode *GenIR::loadElem(ReaderBaseNS::LdElemOpcode Opcode,
   IRNode *ElementAddress = genArrayElemAddress(Array, Index, ElementTy);
   bool IsVolatile = false;
   return loadAtAddressNonNull(ElementAddress, ElementTy, CorType, ResolvedToken,
-                              Alignment, IsVolatile);
+                              Alignment, IsVolatile,
+                              getArrayElementAccessTag(ElementTy));
 }
 
 IRNode *GenIR::loadElemA(CORINFO_RESOLVED_TOKEN *ResolvedToken, IRNode *Index,
@@ -5244,7 +5811,8 @@ void GenIR::storeElem(ReaderBaseNS::StElemOpcode Opcode,
                               IsValueIsPointer, IsField, IsUnchecked);
   } else {
     storeAtAddressNonNull(ElementAddress, ValueToStore, ElementTy,
-                          ResolvedToken, Alignment, IsVolatile, IsField);
+                          ResolvedToken, Alignment, IsVolatile, IsField,
+                          getArrayElementAccessTag(ElementTy));
   }
 }
 
@@ -5810,6 +6378,45 @@ CallSite GenIR::callHelperImpl(CorInfoHelpFunc HelperID, IRNode *Address,
   // transitioning to a valid stack type, if appropriate.
   CallSite Call = makeCall(Target, MayThrow, Arguments);
 
+  // Tag the helpers that allocate objects the method may keep to itself, and
+  // the write barriers that may store into them, for stack allocation and
+  // write barrier optimization. The checked barrier's tag says so, since it
+  // may also store outside the GC heap.
+  llvm::LLVMContext &LLVMContext = *JitContext->LLVMContext;
+  const char *Tag = nullptr;
+  SmallVector<Metadata *, 1> TagOperands;
+  switch (HelperID) {
+  case CORINFO_HELP_NEWSFAST:
+  case CORINFO_HELP_BOX:
+    Tag = "llilc.new.object";
+    break;
+  case CORINFO_HELP_ASSIGN_REF:
+    Tag = "llilc.write.barrier";
+    break;
+  case CORINFO_HELP_CHECKED_ASSIGN_REF:
+    Tag = "llilc.write.barrier";
+    TagOperands.push_back(MDString::get(LLVMContext, "checked"));
+    break;
+  default:
+    break;
+  }
+  if (Tag != nullptr) {
+    Call->setMetadata(LLVMContext.getMDKindID(Tag),
+                      MDNode::get(LLVMContext, TagOperands));
+  }
+
+  // Tag the class initialization and static base helpers that may be moved
+  // out of loops and removed if repeated, saying if they cannot run a class
+  // constructor.
+  if (CanMoveUp) {
+    SmallVector<Metadata *, 1> InitOperands;
+    if (NoCtor) {
+      InitOperands.push_back(MDString::get(LLVMContext, "noctor"));
+    }
+    Call->setMetadata(LLVMContext.getMDKindID("llilc.class.init"),
+                      MDNode::get(LLVMContext, InitOperands));
+  }
+
   if (IsVolatile && isNonVolatileWriteHelperCall(HelperID)) {
     // TODO: this is only needed where CLRConfig::INTERNAL_JitLockWrite is set
     // For now, conservatively we emit barrier regardless.
@@ -5986,6 +6593,58 @@ CORINFO_CLASS_HANDLE GenIR::inferThisClass(IRNode *ThisArgument) {
   return nullptr;
 }
 
+CORINFO_CLASS_HANDLE GenIR::getExactClass(IRNode *Node) {
+  Value *Object = ((Value *)Node)->stripPointerCasts();
+  auto Iterator = ExactClassMap.find(Object);
+  if (Iterator != ExactClassMap.end()) {
+    return Iterator->second;
+  }
+  return nullptr;
+}
+
+bool GenIR::isLikelyReceiverClass(uint32_t MsilOffset,
+                                  CORINFO_CLASS_HANDLE Class) {
+  if (!JitContext->Options->DoGuardedDevirt ||
+      (JitContext->ClassProfile == nullptr)) {
+    return false;
+  }
+  return JitContext->ClassProfile->isLikelyClass(
+      getProfileMethodName(), MsilOffset, getProfileClassName(Class), Class);
+}
+
+std::string GenIR::getProfileClassName(CORINFO_CLASS_HANDLE Class) {
+  std::string Name;
+  char *ClassName = getClassNameWithNamespace(Class);
+  if (ClassName != nullptr) {
+    Name = ClassName;
+    delete[] ClassName;
+  }
+  return Name;
+}
+
+const std::string &GenIR::getProfileMethodName() {
+  if (!ProfileMethodName.empty()) {
+    return ProfileMethodName;
+  }
+  CORINFO_METHOD_HANDLE Method = getCurrentMethodHandle();
+  const char *ClassName = nullptr;
+  raw_string_ostream OS(ProfileMethodName);
+  OS << getProfileClassName(getCurrentMethodClass())
+     << "::" << getMethodName(Method, &ClassName)
+     << format("#%08x", getMethodDefFromMethod(Method));
+  CORINFO_SIG_INFO Sig;
+  getMethodSig(Method, &Sig);
+  for (unsigned I = 0; I < Sig.sigInst.methInstCount; ++I) {
+    OS << ((I == 0) ? "<" : ",")
+       << getProfileClassName(Sig.sigInst.methInst[I]);
+  }
+  if (Sig.sigInst.methInstCount != 0) {
+    OS << ">";
+  }
+  OS.flush();
+  return ProfileMethodName;
+}
+
 bool GenIR::canMakeDirectCall(ReaderCallTargetData *CallTargetData) {
   return !CallTargetData->isJmp();
 }
@@ -6177,6 +6836,15 @@ IRNode *GenIR::genNewMDArrayCall(ReaderCallTargetData *CallTargetData,
   return *CallNode;
 }
 
+// Objects no bigger than this are allocated inline when the EE would use its
+// small object helpers. Bigger ones are more likely to exhaust the allocation
+// context anyway.
+static const uint64_t MaxInlineAllocSize = 512;
+
+// The smallest object the GC allocates, in pointers: the object header, the
+// method table pointer and room for a free list link.
+static const uint64_t MinObjectSizeInPointers = 3;
+
 IRNode *GenIR::genNewObjThisArg(ReaderCallTargetData *CallTargetData,
                                 CorInfoType CorType,
                                 CORINFO_CLASS_HANDLE Class) {
@@ -6220,22 +6888,145 @@ IRNode *GenIR::genNewObjThisArg(ReaderCallTargetData *CallTargetData,
   // and use its return value as the
   // 'this' pointer to be passed as the first argument to the constructor.
 
+  // The new object is never null, and all of its fixed-size part, from the
+  // method table pointer on, may be accessed.
+  uint64_t ObjectSize = 0;
+  Type *ObjectTy = cast<PointerType>(ThisType)->getElementType();
+  if (ObjectTy->isSized()) {
+    const DataLayout &DataLayout = JitContext->CurrentModule->getDataLayout();
+    ObjectSize = DataLayout.getTypeStoreSize(ObjectTy);
+  }
+
   // Create the address operand for the newobj helper.
-  CallSite TheCallSite;
   const bool MayThrow = true;
+  Value *ThisPointer = nullptr;
   if (JitContext->Flags & CORJIT_FLG_READYTORUN) {
-    TheCallSite =
+    CallSite TheCallSite =
         callReadyToRunHelperImpl(CORINFO_HELP_READYTORUN_NEW, MayThrow,
                                  ThisType, CallTargetData->getResolvedToken());
+    markNonNullResult(TheCallSite, ObjectSize);
+    ThisPointer = TheCallSite.getInstruction();
   } else {
     IRNode *ClassHandleNode = CallTargetData->getClassHandleNode();
     CorInfoHelpFunc HelperId = getNewHelper(CallTargetData->getResolvedToken());
-    TheCallSite = callHelperImpl(HelperId, MayThrow, ThisType, ClassHandleNode);
+    auto CallNewHelper = [&]() -> Value * {
+      CallSite TheCallSite =
+          callHelperImpl(HelperId, MayThrow, ThisType, ClassHandleNode);
+      markNonNullResult(TheCallSite, ObjectSize);
+      return TheCallSite.getInstruction();
+    };
+
+    // The EE only hands out the plain small object helper for classes that
+    // have no finalizer and need no special alignment or tracking. The
+    // runtime sizes such an object as its fields plus the object header and
+    // method table pointer, rounded up to pointer size.
+    const uint64_t PointerSize = TargetPointerSizeInBits / 8;
+    uint64_t HeapSize = RoundUpToAlignment(
+        getClassSize(Class) + 2 * PointerSize, PointerSize);
+    HeapSize = std::max(HeapSize, MinObjectSizeInPointers * PointerSize);
+    if (JitContext->Options->DoInlineAlloc &&
+        (HelperId == CORINFO_HELP_NEWSFAST) &&
+        (HeapSize <= MaxInlineAllocSize)) {
+      ThisPointer = genInlineAllocation(HeapSize, ClassHandleNode, nullptr,
+                                        ThisType, CallNewHelper);
+      // Like the helper call, the merged result is a new object.
+      LLVMContext &LLVMContext = *JitContext->LLVMContext;
+      cast<Instruction>(ThisPointer)
+          ->setMetadata(LLVMContext.getMDKindID("llilc.new.object"),
+                        MDNode::get(LLVMContext, ArrayRef<Metadata *>()));
+    } else {
+      ThisPointer = CallNewHelper();
+    }
   }
-  Value *ThisPointer = TheCallSite.getInstruction();
+  ExactClassMap[ThisPointer] = Class;
   return (IRNode *)ThisPointer;
 }
 
+Value *GenIR::genInlineAllocation(uint64_t Size, Value *MethodTable,
+                                  Value *NumElements, Type *ResultType,
+                                  function_ref<Value *()> CallHelper) {
+  LLVMContext &LLVMContext = *JitContext->LLVMContext;
+  Type *Int8PtrTy = getUnmanagedPointerType(Type::getInt8Ty(LLVMContext));
+  Type *Int32Ty = Type::getInt32Ty(LLVMContext);
+
+  // The allocation context starts with the next free byte and the end of
+  // the space the thread may allocate from without taking a lock.
+  Value *Context = LLVMBuilder->CreateLoad(getAllocContext());
+  Value *NextAddress = LLVMBuilder->CreatePointerCast(
+      Context, getUnmanagedPointerType(Int8PtrTy));
+  Value *LimitAddress =
+      LLVMBuilder->CreateInBoundsGEP(NextAddress, ConstantInt::get(Int32Ty, 1));
+  Value *Object = LLVMBuilder->CreateLoad(NextAddress, "AllocPtr");
+  Value *Limit = LLVMBuilder->CreateLoad(LimitAddress, "AllocLimit");
+  Value *NewNext = LLVMBuilder->CreateInBoundsGEP(
+      Object, ConstantInt::get(Type::getInt64Ty(LLVMContext), Size));
+  Value *Fits = LLVMBuilder->CreateICmpULE(NewNext, Limit, "AllocFits");
+
+  // Claim the space and fill in the header fields the GC needs.
+  IRBuilder<>::InsertPoint SavedInsertPoint = LLVMBuilder->saveIP();
+  BasicBlock *FastBlock = createPointBlock("AllocFast");
+  LLVMBuilder->SetInsertPoint(FastBlock);
+  LLVMBuilder->CreateStore(NewNext, NextAddress);
+  Type *ObjectTy = ResultType->getPointerElementType();
+  Value *TypedObject =
+      LLVMBuilder->CreatePointerCast(Object, getUnmanagedPointerType(ObjectTy));
+  Value *MethodTableAddress = LLVMBuilder->CreatePointerCast(
+      Object, getUnmanagedPointerType(MethodTable->getType()));
+  LLVMBuilder->CreateStore(MethodTable, MethodTableAddress);
+  if (NumElements != nullptr) {
+    // The length follows the method table pointer.
+    Value *LengthAddress =
+        LLVMBuilder->CreateStructGEP(nullptr, TypedObject, 1);
+    LLVMBuilder->CreateStore(
+        LLVMBuilder->CreateTrunc(NumElements, Int32Ty), LengthAddress);
+  }
+  Value *FastResult = LLVMBuilder->CreateAddrSpaceCast(TypedObject, ResultType);
+
+  BasicBlock *SlowBlock = createPointBlock("AllocSlow");
+  LLVMBuilder->SetInsertPoint(SlowBlock);
+  Value *SlowResult = CallHelper();
+  BasicBlock *SlowExit = LLVMBuilder->GetInsertBlock();
+  LLVMBuilder->restoreIP(SavedInsertPoint);
+
+  // Branch to one of the paths, and rejoin after both.
+  TerminatorInst *Goto;
+  BasicBlock *JoinBlock = splitCurrentBlock(&Goto);
+  replaceInstruction(Goto, BranchInst::Create(FastBlock, SlowBlock, Fits));
+  BranchInst::Create(JoinBlock, FastBlock);
+  BranchInst::Create(JoinBlock, SlowExit);
+  return mergeConditionalResults(JoinBlock, FastResult, FastBlock, SlowResult,
+                                 SlowExit, "NewObject");
+}
+
+Value *GenIR::getAllocContext() {
+  if (AllocContext != nullptr) {
+    return AllocContext;
+  }
+
+  LLVMContext &LLVMContext = *JitContext->LLVMContext;
+  Type *Int8PtrTy = getUnmanagedPointerType(Type::getInt8Ty(LLVMContext));
+  Instruction *ContextAddress = createTemporary(Int8PtrTy, "AllocContext");
+
+  // A method runs on one thread throughout, so the context is found once,
+  // right after the temporary is allocated.
+  IRBuilder<>::InsertPoint SavedInsertPoint = LLVMBuilder->saveIP();
+  LLVMBuilder->SetInsertPoint(ContextAddress->getParent(),
+                              std::next(ContextAddress->getIterator()));
+  const bool MayThrow = false;
+  CallSite GetThread =
+      callHelperImpl(CORINFO_HELP_GET_THREAD, MayThrow, Int8PtrTy);
+  markGCLeaf(GetThread);
+  Value *Context = LLVMBuilder->CreateInBoundsGEP(
+      GetThread.getInstruction(),
+      ConstantInt::get(Type::getInt32Ty(LLVMContext),
+                       JitContext->Options->AllocContextOffset));
+  LLVMBuilder->CreateStore(Context, ContextAddress);
+  LLVMBuilder->restoreIP(SavedInsertPoint);
+
+  AllocContext = ContextAddress;
+  return AllocContext;
+}
+
 IRNode *GenIR::genNewObjReturnNode(ReaderCallTargetData *CallTargetData,
                                    IRNode *ThisArg) {
   uint32_t ClassAttribs = CallTargetData->getClassAttribs();
@@ -6345,17 +7136,56 @@ IRNode *GenIR::genCall(ReaderCallTargetData *CallTargetInfo, bool MayThrow,
     }
   }
 
+  // Count the receiver classes of virtual calls if asked to, so that
+  // optimized code can guard direct calls to the likely class.
+  CORINFO_CALL_INFO *CallInfo = CallTargetInfo->getCallInfo();
+  if (JitContext->Options->DoClassInstrument &&
+      (JitContext->ClassProfile != nullptr) && (CallInfo != nullptr) &&
+      ((CallInfo->kind == CORINFO_VIRTUALCALL_VTABLE) ||
+       (CallInfo->kind == CORINFO_VIRTUALCALL_STUB)) &&
+      !IsJmp && !CallTargetInfo->isNewObj() &&
+      !CallTargetInfo->isDevirtualized() &&
+      (ArgumentTypes[0].CorType == CORINFO_TYPE_CLASS)) {
+    genReceiverClassProbe(CallTargetInfo, Arguments[0]);
+  }
+
   ABICallSignature ABICallSig(Signature, *this, *JitContext->TheABIInfo);
-  Value *ResultNode =
-      ABICallSig.emitCall(*this, (Value *)TargetNode, MayThrow, Arguments,
-                          (Value *)CallTargetInfo->getIndirectionCellNode(),
-                          IsJmp, (Value **)&Call);
+  Value *ResultNode;
+  Value *GuardedCall = nullptr;
+  if (CallTargetInfo->getGuardClassNode() != nullptr) {
+    ResultNode = genGuardedCall(CallTargetInfo, ABICallSig, (Value *)TargetNode,
+                                MayThrow, Arguments, &GuardedCall,
+                                (Value **)&Call);
+  } else {
+    ResultNode =
+        ABICallSig.emitCall(*this, (Value *)TargetNode, MayThrow, Arguments,
+                            (Value *)CallTargetInfo->getIndirectionCellNode(),
+                            IsJmp, (Value **)&Call);
+  }
 
   // Add VarArgs cookie to outgoing param list
   if (CC == CORINFO_CALLCONV_VARARG) {
     canonVarargsCall(Call, CallTargetInfo);
   }
 
+  if (CallTargetInfo->isDevirtualized() || (GuardedCall != nullptr)) {
+    const char *Kind;
+    if (CallTargetInfo->isDevirtualized()) {
+      ++JitContext->NumCallsDevirtualized;
+      Kind = "devirtualized";
+    } else {
+      ++JitContext->NumCallsGuarded;
+      Kind = "guarded";
+    }
+    if (JitContext->Options->DumpLevel == ::DumpLevel::VERBOSE) {
+      const char *ModuleName = nullptr;
+      const char *MethodName = JitContext->JitInfo->getMethodName(
+          CallTargetInfo->getMethodHandle(), &ModuleName);
+      dbgs() << "INFO:  " << Kind << " call to " << ModuleName << "."
+             << MethodName << " in " << JitContext->MethodName << "\n";
+    }
+  }
+
   // If this call is eligible for tail calls, mark it now.
   if (!IsJmp) {
     if (CallTargetInfo->isTailCall()) {
@@ -6371,6 +7201,30 @@ IRNode *GenIR::genCall(ReaderCallTargetData *CallTargetInfo, bool MayThrow,
     }
   }
 
+  // Note direct calls to methods known exactly; the profitable ones are
+  // inlined once the whole method has been read.
+  if (JitContext->Options->DoInlining && !IsJmp && !IsUnmanagedCall &&
+      isa<llvm::Function>(TargetNode) && !CallTargetInfo->isStubDispatch() &&
+      !CallTargetInfo->isOptimizedDelegateCtor()) {
+    CORINFO_METHOD_HANDLE Method = CallTargetInfo->getKnownMethodHandle();
+    if ((Method != nullptr) && (Method != getCurrentMethodHandle())) {
+      uint32_t Count;
+      bool IsNeverRun = getProfileCount(CurrInstrOffset, Count) && (Count == 0);
+      InlineCandidates.push_back({WeakVH((Value *)Call), Method, IsNeverRun});
+    }
+  }
+
+  // The direct call of a guarded call is to the method known exactly too.
+  if (JitContext->Options->DoInlining && (GuardedCall != nullptr) &&
+      isa<llvm::Function>(CallTargetInfo->getGuardedCallTargetNode())) {
+    CORINFO_METHOD_HANDLE Method = CallTargetInfo->getMethodHandle();
+    if (Method != getCurrentMethodHandle()) {
+      uint32_t Count;
+      bool IsNeverRun = getProfileCount(CurrInstrOffset, Count) && (Count == 0);
+      InlineCandidates.push_back({WeakVH(GuardedCall), Method, IsNeverRun});
+    }
+  }
+
   *CallNode = Call;
 
   if (ResultType.CorType != CORINFO_TYPE_VOID) {
@@ -6388,6 +7242,77 @@ IRNode *GenIR::genCall(ReaderCallTargetData *CallTargetInfo, bool MayThrow,
   }
 }
 
+void GenIR::genReceiverClassProbe(ReaderCallTargetData *CallTargetInfo,
+                                  Value *ThisArg) {
+  CORINFO_CLASS_HANDLE Class = CallTargetInfo->getClassHandle();
+  ClassProfileSite *Site = JitContext->ClassProfile->getSite(
+      getProfileMethodName(), CurrInstrOffset, getProfileClassName(Class),
+      Class);
+
+  // Pass the site and the method table to the profile's native recording
+  // function. It neither allocates nor throws, so it is not a safepoint.
+  LLVMContext &LLVMContext = *JitContext->LLVMContext;
+  Type *NativeIntTy = Type::getIntNTy(LLVMContext, TargetPointerSizeInBits);
+  Value *MethodTable = derefAddress((IRNode *)ThisArg, false, true);
+  Value *SiteAddress = ConstantInt::get(NativeIntTy, (uint64_t)Site);
+  Type *ArgTys[] = {NativeIntTy, NativeIntTy};
+  FunctionType *RecordTy =
+      FunctionType::get(Type::getVoidTy(LLVMContext), ArgTys, false);
+  Value *Record = LLVMBuilder->CreateIntToPtr(
+      ConstantInt::get(NativeIntTy, (uint64_t)&ClassProfile::recordReceiver),
+      getUnmanagedPointerType(RecordTy));
+  const bool MayThrow = false;
+  CallSite Call = makeCall(Record, MayThrow, {SiteAddress, MethodTable});
+  markGCLeaf(Call);
+}
+
+Value *GenIR::genGuardedCall(ReaderCallTargetData *CallTargetInfo,
+                             const ABICallSignature &ABICallSig,
+                             Value *VirtualTarget, bool MayThrow,
+                             ArrayRef<Value *> Arguments, Value **DirectCall,
+                             Value **VirtualCall) {
+  // The receiver has been checked for null, or dereferenced to find the
+  // virtual call target, so its method table can be loaded.
+  Value *MethodTable = derefAddress((IRNode *)Arguments[0], false, true);
+  Value *IsLikelyClass = LLVMBuilder->CreateICmpEQ(
+      MethodTable, CallTargetInfo->getGuardClassNode(), "IsLikelyClass");
+
+  // Make each call in a block of its own. Either may be an invoke, which
+  // splits its block.
+  const bool IsJmp = false;
+  IRBuilder<>::InsertPoint SavedInsertPoint = LLVMBuilder->saveIP();
+  BasicBlock *DirectBlock = createPointBlock("GuardedDirectCall");
+  LLVMBuilder->SetInsertPoint(DirectBlock);
+  Value *DirectResult = ABICallSig.emitCall(
+      *this, (Value *)CallTargetInfo->getGuardedCallTargetNode(), MayThrow,
+      Arguments, nullptr, IsJmp, DirectCall);
+  BasicBlock *DirectExit = LLVMBuilder->GetInsertBlock();
+
+  BasicBlock *VirtualBlock = createPointBlock("GuardedVirtualCall");
+  LLVMBuilder->SetInsertPoint(VirtualBlock);
+  Value *VirtualResult = ABICallSig.emitCall(
+      *this, VirtualTarget, MayThrow, Arguments,
+      (Value *)CallTargetInfo->getIndirectionCellNode(), IsJmp, VirtualCall);
+  BasicBlock *VirtualExit = LLVMBuilder->GetInsertBlock();
+  LLVMBuilder->restoreIP(SavedInsertPoint);
+
+  // Branch to one of the calls, and rejoin after both.
+  TerminatorInst *Goto;
+  BasicBlock *JoinBlock = splitCurrentBlock(&Goto);
+  replaceInstruction(Goto,
+                     BranchInst::Create(DirectBlock, VirtualBlock,
+                                        IsLikelyClass));
+  BranchInst::Create(JoinBlock, DirectExit);
+  BranchInst::Create(JoinBlock, VirtualExit);
+
+  if (VirtualResult->getType()->isVoidTy()) {
+    return VirtualResult;
+  }
+  return mergeConditionalResults(JoinBlock, DirectResult, DirectExit,
+                                 VirtualResult, VirtualExit,
+                                 "GuardedCallResult");
+}
+
 IRNode *GenIR::convertToBoxHelperArgumentType(IRNode *Opr, uint32_t DestSize) {
   Type *Ty = Opr->getType();
   switch (Ty->getTypeID()) {
@@ -6420,6 +7345,17 @@ IRNode *GenIR::convertToBoxHelperArgumentType(IRNode *Opr, uint32_t DestSize) {
   return Opr;
 }
 
+IRNode *GenIR::convertToUnboxedStackType(IRNode *Opr,
+                                         CORINFO_CLASS_HANDLE Class) {
+  // Other value classes are kept on the stack as they are boxed.
+  CorInfoType CorType = ReaderBase::getClassType(Class);
+  if (!isPrimitiveType(CorType)) {
+    return Opr;
+  }
+  Type *Ty = getType(CorType, Class);
+  return convertToStackType(convertFromStackType(Opr, CorType, Ty), CorType);
+}
+
 // Method is called with empty stack.
 void GenIR::jmp(ReaderBaseNS::CallOpcode Opcode, mdToken Token) {
   assert(Opcode == ReaderBaseNS::Jmp);
@@ -7155,8 +8091,23 @@ IRNode *GenIR::genNullCheck(IRNode *Node) {
 
   // Insert the conditional throw
   CorInfoHelpFunc HelperId = CORINFO_HELP_THROWNULLREF;
+  BasicBlock *CheckBlock = LLVMBuilder->GetInsertBlock();
   genConditionalThrow(Compare, HelperId, "ThrowNullRef");
 
+  // Let codegen fold the check into the first access through Node if that
+  // faults on null; the EE turns the fault into a NullReferenceException.
+  // This is only done outside protected regions: the EH tables only cover
+  // calls, and the GC info is only exact at safepoints, so the fault must
+  // unwind out of the method.
+  bool IsProtected =
+      (CurrentRegion != nullptr) && (CurrentRegion->HandlerEHPad != nullptr);
+  if (JitContext->Options->DoImplicitNullCheck && !IsProtected) {
+    llvm::LLVMContext &LLVMContext = *JitContext->LLVMContext;
+    CheckBlock->getTerminator()->setMetadata(
+        LLVMContext::MD_make_implicit,
+        MDNode::get(LLVMContext, ArrayRef<Metadata *>()));
+  }
+
   return Node;
 }
 
@@ -7174,6 +8125,13 @@ void GenIR::genBoundsCheck(Value *ArrayLength, Value *Index) {
       LLVMBuilder->CreateIntCast(Index, ArrayLengthType, IsSigned);
   Value *UpperBoundCompare =
       LLVMBuilder->CreateICmpUGE(ConvertedIndex, ArrayLength, "BoundsCheck");
+
+  // Tag the compare for bounds check elimination.
+  if (Instruction *Compare = dyn_cast<Instruction>(UpperBoundCompare)) {
+    llvm::LLVMContext &LLVMContext = *JitContext->LLVMContext;
+    Compare->setMetadata(LLVMContext.getMDKindID("llilc.bounds.check"),
+                         MDNode::get(LLVMContext, ArrayRef<Metadata *>()));
+  }
   genConditionalThrow(UpperBoundCompare, HelperId, "ThrowIndexOutOfRange");
 }
 
@@ -7650,6 +8608,16 @@ IRNode *GenIR::derefAddress(IRNode *Address, bool DstIsGCPtr, bool IsConst,
         MDNode::get(*JitContext->LLVMContext, ArrayRef<Metadata *>());
 
     Result->setMetadata(LLVMContext::MD_invariant_load, EmptyNode);
+
+    // Constant object pointers, such as method tables and the boxes of
+    // static value type fields, are never null.
+    if (DstIsGCPtr) {
+      Result->setMetadata(LLVMContext::MD_nonnull, EmptyNode);
+    }
+
+    // Constant runtime data, such as method table and vtable slots, is never
+    // stored to by managed code.
+    Result->setMetadata(LLVMContext::MD_tbaa, getAccessTag("runtime data"));
   }
 
   return (IRNode *)Result;
@@ -8312,10 +9280,11 @@ IRNode *GenIR::newArr(CORINFO_RESOLVED_TOKEN *ResolvedToken, IRNode *Arg1) {
   Value *Destination = Constant::getNullValue(ArrayType);
 
   const bool MayThrow = true;
+  IRNode *Array;
   if (JitContext->Flags & CORJIT_FLG_READYTORUN) {
-    return callReadyToRunHelper(CORINFO_HELP_READYTORUN_NEWARR_1, MayThrow,
-                                (IRNode *)Destination, ResolvedToken,
-                                NumOfElements);
+    Array = callReadyToRunHelper(CORINFO_HELP_READYTORUN_NEWARR_1, MayThrow,
+                                 (IRNode *)Destination, ResolvedToken,
+                                 NumOfElements);
   } else {
     // Or token with CORINFO_ANNOT_ARRAY so that we get back an array-type
     // handle.
@@ -8325,9 +9294,72 @@ IRNode *GenIR::newArr(CORINFO_RESOLVED_TOKEN *ResolvedToken, IRNode *Arg1) {
         genericTokenToNode(ResolvedToken, EmbedParent, MustRestoreHandle,
                            (CORINFO_GENERIC_HANDLE *)&ElementType, nullptr);
 
-    return callHelper(getNewArrHelper(ElementType), MayThrow,
-                      (IRNode *)Destination, Token, NumOfElements);
+    CorInfoHelpFunc HelperId = getNewArrHelper(ElementType);
+    auto CallNewArrHelper = [&]() -> Value * {
+      return (Value *)callHelper(HelperId, MayThrow, (IRNode *)Destination,
+                                 Token, NumOfElements);
+    };
+
+    uint64_t HeapSize = getInlineArraySize(HelperId, ArrayType, NumOfElements);
+    if (HeapSize != 0) {
+      Array = (IRNode *)genInlineAllocation(HeapSize, Token, NumOfElements,
+                                            ArrayType, CallNewArrHelper);
+    } else {
+      Array = (IRNode *)CallNewArrHelper();
+    }
+  }
+
+  // Tag the allocation for bounds check elimination, with the number of
+  // elements if it is a constant.
+  llvm::LLVMContext &LLVMContext = *JitContext->LLVMContext;
+  SmallVector<Metadata *, 1> NumElementsMD;
+  if (isa<ConstantInt>(NumOfElements)) {
+    NumElementsMD.push_back(
+        ConstantAsMetadata::get(cast<ConstantInt>(NumOfElements)));
+  }
+  cast<Instruction>(Array)->setMetadata(
+      LLVMContext.getMDKindID("llilc.new.array"),
+      MDNode::get(LLVMContext, NumElementsMD));
+
+  // The new array is never null.
+  CallSite Allocation(Array);
+  if (Allocation) {
+    markNonNullResult(Allocation);
+  }
+  return Array;
+}
+
+uint64_t GenIR::getInlineArraySize(CorInfoHelpFunc HelperId, Type *ArrayTy,
+                                   Value *NumElements) {
+  // Only the EE's small array helpers may be bypassed, and only for lengths
+  // known to fit the limit.
+  ConstantInt *Length = dyn_cast<ConstantInt>(NumElements);
+  if (!JitContext->Options->DoInlineAlloc ||
+      ((HelperId != CORINFO_HELP_NEWARR_1_VC) &&
+       (HelperId != CORINFO_HELP_NEWARR_1_OBJ)) ||
+      (Length == nullptr) || Length->isNegative() ||
+      (Length->getZExtValue() > MaxInlineAllocSize)) {
+    return 0;
   }
+  StructType *ArrayStructTy =
+      cast<StructType>(ArrayTy->getPointerElementType());
+  if (ArrayStructTy->isOpaque()) {
+    return 0;
+  }
+
+  // The runtime sizes an array as the object header, the fixed fields up to
+  // the elements, and the elements, rounded up to pointer size.
+  const DataLayout &DataLayout = JitContext->CurrentModule->getDataLayout();
+  unsigned ElementsIndex = ArrayStructTy->getNumElements() - 1;
+  Type *ElementTy =
+      cast<llvm::ArrayType>(ArrayStructTy->getElementType(ElementsIndex))
+          ->getElementType();
+  const uint64_t PointerSize = TargetPointerSizeInBits / 8;
+  uint64_t HeapSize = RoundUpToAlignment(
+      PointerSize + JitContext->EEInfo.offsetOfObjArrayData +
+          Length->getZExtValue() * DataLayout.getTypeAllocSize(ElementTy),
+      PointerSize);
+  return (HeapSize <= MaxInlineAllocSize) ? HeapSize : 0;
 }
 
 // CastOp - Generates code for castclass or isinst.
@@ -8353,30 +9385,53 @@ IRNode *GenIR::castOp(CORINFO_RESOLVED_TOKEN *ResolvedToken, IRNode *ObjRefNode,
   // Create the type node
   bool EmbedParent = false;
   bool MustRestoreHandle = false;
+  bool RuntimeLookup = false;
+
+  IRNode *ClassHandleNode =
+      genericTokenToNode(ResolvedToken, EmbedParent, MustRestoreHandle,
+                         &HandleType, &RuntimeLookup);
 
-  IRNode *ClassHandleNode = genericTokenToNode(
-      ResolvedToken, EmbedParent, MustRestoreHandle, &HandleType, nullptr);
+  // Decide which checks may be made inline. A class handle looked up at run
+  // time may be for any instantiation, so the checks are only made against
+  // a known class.
   bool Optimize = false;
-  if (!disableCastClassOptimization()) {
+  bool CheckExact = false;
+  bool MissIsNull = false;
+  bool CheckParent = false;
+  bool CheckCache = false;
+  CORINFO_CLASS_HANDLE CastClass = (CORINFO_CLASS_HANDLE)HandleType;
+  uint32_t Flags = getClassAttribs(CastClass);
+  bool IsKnownClass =
+      !RuntimeLookup &&
+      !(Flags & (CORINFO_FLG_MARSHAL_BYREF | CORINFO_FLG_CONTEXTFUL |
+                 CORINFO_FLG_SHAREDINST));
+  if (!disableCastClassOptimization() && IsKnownClass) {
     switch (HelperId) {
     case CORINFO_HELP_CHKCASTCLASS:
-      // TODO: It's not clear why calling this helper is safe. It assumes
-      // that trivial checks are inlined. Check this again if we decide to
-      // enable cast class optimization.
-      HelperId = CORINFO_HELP_CHKCASTCLASS_SPECIAL;
-
-    //
-    // FALL-THROUGH
-    //
-
-    case CORINFO_HELP_ISINSTANCEOFCLASS: {
-      uint32_t Flags = getClassAttribs((CORINFO_CLASS_HANDLE)HandleType);
-      if ((Flags & CORINFO_FLG_FINAL) &&
-          !(Flags & (CORINFO_FLG_MARSHAL_BYREF | CORINFO_FLG_CONTEXTFUL |
-                     CORINFO_FLG_SHAREDINST))) {
+    case CORINFO_HELP_ISINSTANCEOFCLASS:
+      // Arrays, nullables and the like have no method table that objects
+      // can be compared with.
+      if (!canInlineTypeCheckWithObjectVTable(CastClass)) {
+        break;
+      }
+      CheckExact = true;
+      if (Flags & CORINFO_FLG_FINAL) {
         Optimize = true;
+        MissIsNull = (HelperId == CORINFO_HELP_ISINSTANCEOFCLASS);
+      } else {
+        CheckParent = (JitContext->Options->ParentMethodTableOffset != 0);
+      }
+
+      // This helper leaves out the checks made inline.
+      if (HelperId == CORINFO_HELP_CHKCASTCLASS) {
+        HelperId = CORINFO_HELP_CHKCASTCLASS_SPECIAL;
       }
-    } break;
+      break;
+
+    case CORINFO_HELP_CHKCASTINTERFACE:
+    case CORINFO_HELP_ISINSTANCEOFINTERFACE:
+      CheckCache = (JitContext->CastCache != nullptr);
+      break;
 
     default:
       break;
@@ -8386,20 +9441,136 @@ IRNode *GenIR::castOp(CORINFO_RESOLVED_TOKEN *ResolvedToken, IRNode *ObjRefNode,
   // Generate the helper call or intrinsic
   const bool IsVolatile = false;
   const bool DoesNotInvokeStaticCtor = Optimize;
-  return (IRNode *)callHelperImpl(HelperId, MayThrow, ResultType,
-                                  ClassHandleNode, ObjRefNode, nullptr, nullptr,
-                                  Reader_AlignUnknown, IsVolatile,
-                                  DoesNotInvokeStaticCtor)
-      .getInstruction();
+  auto CallHelper = [&]() -> Value * {
+    return callHelperImpl(HelperId, MayThrow, ResultType, ClassHandleNode,
+                          ObjRefNode, nullptr, nullptr, Reader_AlignUnknown,
+                          IsVolatile, DoesNotInvokeStaticCtor)
+        .getInstruction();
+  };
+  if (disableCastClassOptimization()) {
+    return (IRNode *)CallHelper();
+  }
+  return (IRNode *)genInlineCast(ObjRefNode, ClassHandleNode, ResultType,
+                                 CheckExact, MissIsNull, CheckParent,
+                                 CheckCache, CallHelper);
+}
+
+Value *GenIR::genInlineCast(Value *Object, Value *ClassHandle,
+                            Type *ResultType, bool CheckExact,
+                            bool MissIsNull, bool CheckParent,
+                            bool CheckCache,
+                            function_ref<Value *()> CallHelper) {
+  LLVMContext &LLVMContext = *JitContext->LLVMContext;
+  Type *NativeIntTy = Type::getIntNTy(LLVMContext, TargetPointerSizeInBits);
+  Value *Null = Constant::getNullValue(ResultType);
+  Value *CastObject = LLVMBuilder->CreatePointerCast(Object, ResultType);
+  Value *IsNull = LLVMBuilder->CreateIsNull(Object, "IsNull");
+
+  // Each check after the null check ends a block of its own, which goes to
+  // the join block with the check's result if the check decides the cast,
+  // and on to the next block otherwise. The branches are made once the join
+  // block exists.
+  struct CastCheck {
+    BasicBlock *Block;
+    BasicBlock *Next;
+    Value *IsDecided;
+    Value *Result;
+  };
+  SmallVector<CastCheck, 3> Checks;
+  IRBuilder<>::InsertPoint SavedInsertPoint = LLVMBuilder->saveIP();
+  BasicBlock *FirstBlock = createPointBlock("CastCheck");
+  LLVMBuilder->SetInsertPoint(FirstBlock);
+  auto AddCheck = [&](Value *IsDecided) {
+    BasicBlock *Next = createPointBlock("CastCheck");
+    Checks.push_back(
+        {LLVMBuilder->GetInsertBlock(), Next, IsDecided, CastObject});
+    LLVMBuilder->SetInsertPoint(Next);
+  };
+
+  assert(!MissIsNull || (CheckExact && !CheckParent && !CheckCache));
+  Value *MethodTable = nullptr;
+  if (CheckExact || CheckParent || CheckCache) {
+    MethodTable = derefAddress((IRNode *)Object, false, true, false);
+  }
+  Value *Result = nullptr;
+  if (CheckExact) {
+    Value *IsExact =
+        LLVMBuilder->CreateICmpEQ(MethodTable, ClassHandle, "IsExactClass");
+    if (MissIsNull) {
+      Result = LLVMBuilder->CreateSelect(IsExact, CastObject, Null);
+    } else {
+      AddCheck(IsExact);
+    }
+  }
+  if (CheckParent) {
+    // Only the immediate parent is checked; deeper hierarchies go to the
+    // helper.
+    Value *ParentAddress = LLVMBuilder->CreateIntToPtr(
+        LLVMBuilder->CreateAdd(
+            MethodTable,
+            ConstantInt::get(NativeIntTy,
+                             JitContext->Options->ParentMethodTableOffset)),
+        getUnmanagedPointerType(NativeIntTy));
+    Value *Parent = LLVMBuilder->CreateLoad(ParentAddress, "ParentClass");
+    AddCheck(LLVMBuilder->CreateICmpEQ(Parent, ClassHandle, "IsParentClass"));
+  }
+  Value *CacheCell = nullptr;
+  Value *CachedClass = nullptr;
+  if (CheckCache) {
+    void **Cell = JitContext->CastCache->allocateCell();
+    CacheCell = LLVMBuilder->CreateIntToPtr(
+        ConstantInt::get(NativeIntTy, (uint64_t)Cell),
+        getUnmanagedPointerType(NativeIntTy));
+    CachedClass = LLVMBuilder->CreateLoad(CacheCell, "CachedClass");
+    AddCheck(
+        LLVMBuilder->CreateICmpEQ(MethodTable, CachedClass, "IsCachedClass"));
+  }
+  if (Result == nullptr) {
+    Result = CallHelper();
+    if (CheckCache) {
+      // A failed castclass throws, so only isinst can get here with null.
+      // Classes whose objects decide casts for themselves are never cached,
+      // so the cell only holds classes whose casts hold for all objects.
+      Type *FlagsTy = Type::getInt32Ty(LLVMContext);
+      Value *FlagsAddress = LLVMBuilder->CreateIntToPtr(
+          MethodTable, getUnmanagedPointerType(FlagsTy));
+      Value *ClassFlags = LLVMBuilder->CreateLoad(FlagsAddress, "ClassFlags");
+      Value *ExcludeFlags = LLVMBuilder->CreateAnd(
+          ClassFlags, ConstantInt::get(
+                          FlagsTy, JitContext->Options->CastCacheExcludeFlags));
+      Value *IsCacheable =
+          LLVMBuilder->CreateIsNull(ExcludeFlags, "IsCacheableClass");
+      Value *IsCast = LLVMBuilder->CreateIsNotNull(Result);
+      LLVMBuilder->CreateStore(
+          LLVMBuilder->CreateSelect(
+              LLVMBuilder->CreateAnd(IsCast, IsCacheable), MethodTable,
+              CachedClass),
+          CacheCell);
+    }
+  }
+  BasicBlock *LastBlock = LLVMBuilder->GetInsertBlock();
+  LLVMBuilder->restoreIP(SavedInsertPoint);
+
+  // Branch past the checks for null, and join after all of them.
+  TerminatorInst *Goto;
+  BasicBlock *JoinBlock = splitCurrentBlock(&Goto);
+  BasicBlock *NullBlock = Goto->getParent();
+  replaceInstruction(Goto, BranchInst::Create(JoinBlock, FirstBlock, IsNull));
+  PHINode *Phi =
+      createPHINode(JoinBlock, ResultType, Checks.size() + 2, "CastResult");
+  Phi->addIncoming(Null, NullBlock);
+  for (CastCheck &Check : Checks) {
+    BranchInst::Create(JoinBlock, Check.Next, Check.IsDecided, Check.Block);
+    Phi->addIncoming(Check.Result, Check.Block);
+  }
+  BranchInst::Create(JoinBlock, LastBlock);
+  Phi->addIncoming(Result, LastBlock);
+  return Phi;
 }
 
 // Override the cast class optimization
 bool GenIR::disableCastClassOptimization() {
-  // TODO: We may want to enable cast class optimization unless it's disabled
-  // by some flags or we are generating debug code or it's causing problems
-  // downstream.
-
-  return true;
+  return !JitContext->Options->EnableOptimization;
 }
 
 /// Optionally generate inline code for the \p abs opcode
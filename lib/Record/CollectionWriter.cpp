@@ -0,0 +1,203 @@
+//===--------------- lib/Record/CollectionWriter.cpp ------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the concurrent collection file writer.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "CollectionWriter.h"
+#include "llvm/Support/Process.h"
+#include <cstddef>
+#include <cstring>
+
+using namespace llvm;
+
+std::unique_ptr<CollectionWriter>
+CollectionWriter::create(StringRef Path, uint64_t Capacity, uint64_t ChunkSize,
+                         std::string &Error) {
+  if ((ChunkSize < sizeof(CollectionRecordHeader)) ||
+      (ChunkSize % RecordAlignment) ||
+      (Capacity < sizeof(CollectionFileHeader) + ChunkSize)) {
+    Error = "collection capacity or chunk size is too small";
+    return nullptr;
+  }
+
+  int FD;
+  std::error_code EC = sys::fs::openFileForWrite(Path, FD, sys::fs::F_None);
+  if (EC) {
+    Error = EC.message();
+    return nullptr;
+  }
+
+  // The file is extended to its full size up front so that it can be mapped
+  // once; the space is sparse until written.
+  std::unique_ptr<sys::fs::mapped_file_region> Region;
+  EC = sys::fs::resize_file(FD, Capacity);
+  if (!EC) {
+    Region.reset(new sys::fs::mapped_file_region(
+        FD, sys::fs::mapped_file_region::readwrite, Capacity, 0, EC));
+  }
+  sys::Process::SafelyCloseFileDescriptor(FD);
+  if (EC) {
+    Error = EC.message();
+    return nullptr;
+  }
+
+  return std::unique_ptr<CollectionWriter>(
+      new CollectionWriter(std::move(Region), Capacity, ChunkSize));
+}
+
+CollectionWriter::CollectionWriter(
+    std::unique_ptr<sys::fs::mapped_file_region> Region, uint64_t Capacity,
+    uint64_t ChunkSize)
+    : Region(std::move(Region)), Capacity(Capacity), ChunkSize(ChunkSize),
+      NextMethodId(0), Full(false), NumDropped(0), NumBlobsShared(0),
+      InternTable(new InternSlot[InternTableSize]) {
+  Base = this->Region->data();
+
+  CollectionFileHeader Header;
+  std::memset(&Header, 0, sizeof(Header));
+  std::memcpy(Header.Magic, CollectionFileHeader::MagicValue,
+              sizeof(Header.Magic));
+  Header.Version = CollectionFileHeader::CurrentVersion;
+  Header.PointerSize = sizeof(void *);
+  Header.Tail = sizeof(Header);
+  Header.ChunkSize = ChunkSize;
+  std::memcpy(Base, &Header, sizeof(Header));
+
+  // Writers reserve space by bumping the tail in place, so the header
+  // always describes what has been handed out.
+  Tail = reinterpret_cast<std::atomic<uint64_t> *>(
+      Base + offsetof(CollectionFileHeader, Tail));
+
+  for (size_t I = 0; I < InternTableSize; ++I) {
+    InternTable[I].Hash.store(0, std::memory_order_relaxed);
+    InternTable[I].Ref.store(0, std::memory_order_relaxed);
+  }
+}
+
+CollectionWriter::~CollectionWriter() {}
+
+uint64_t CollectionWriter::reserve(CollectionChunk &Chunk, uint64_t Size) {
+  if (Chunk.Next + Size <= Chunk.End) {
+    uint64_t Offset = Chunk.Next;
+    Chunk.Next += Size;
+    return Offset;
+  }
+
+  if (isFull()) {
+    return 0;
+  }
+
+  // Records bigger than a chunk get chunks of their own and leave the
+  // thread's current chunk alone. Whatever is left at the end of a chunk
+  // stays zero, which readers take as the end of the chunk.
+  uint64_t NumChunks = (Size + ChunkSize - 1) / ChunkSize;
+  uint64_t Start =
+      Tail->fetch_add(NumChunks * ChunkSize, std::memory_order_relaxed);
+  if (Start + NumChunks * ChunkSize > Capacity) {
+    Full.store(true, std::memory_order_relaxed);
+    return 0;
+  }
+
+  if (NumChunks == 1) {
+    Chunk.Next = Start + Size;
+    Chunk.End = Start + ChunkSize;
+  }
+  return Start;
+}
+
+uint64_t CollectionWriter::append(CollectionChunk &Chunk, RecordKind Kind,
+                                  JitApi Api, uint32_t MethodId,
+                                  StringRef Key, StringRef Value) {
+  uint64_t Size = alignRecordSize(sizeof(CollectionRecordHeader) +
+                                  Key.size() + Value.size());
+  uint64_t Offset = 0;
+  if (Size <= UINT32_MAX) {
+    Offset = reserve(Chunk, Size);
+  }
+  if (Offset == 0) {
+    NumDropped.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+
+  // The space is still zero, so the record reads as padding until its kind
+  // is stored below.
+  char *Record = Base + Offset;
+  CollectionRecordHeader Header;
+  Header.Size = static_cast<uint32_t>(Size);
+  Header.Kind = static_cast<uint16_t>(RecordKind::Padding);
+  Header.Api = static_cast<uint16_t>(Api);
+  Header.MethodId = MethodId;
+  Header.KeySize = static_cast<uint32_t>(Key.size());
+  std::memcpy(Record, &Header, sizeof(Header));
+  std::memcpy(Record + sizeof(Header), Key.data(), Key.size());
+  std::memcpy(Record + sizeof(Header) + Key.size(), Value.data(),
+              Value.size());
+
+  reinterpret_cast<std::atomic<uint16_t> *>(
+      Record + offsetof(CollectionRecordHeader, Kind))
+      ->store(static_cast<uint16_t>(Kind), std::memory_order_release);
+  return Offset;
+}
+
+bool CollectionWriter::blobMatches(uint64_t Ref, const void *Data,
+                                   size_t Size) const {
+  const char *Key = Base + Ref + sizeof(CollectionRecordHeader);
+  uint64_t Length;
+  std::memcpy(&Length, Key + sizeof(uint64_t), sizeof(Length));
+  return (Length == Size) &&
+         (std::memcmp(Key + 2 * sizeof(uint64_t), Data, Size) == 0);
+}
+
+uint64_t CollectionWriter::internBlob(CollectionChunk &Chunk,
+                                      const void *Data, size_t Size) {
+  uint64_t Hash = hashBytes(Data, Size);
+  uint64_t Key[2] = {Hash, Size};
+  StringRef KeyBytes((const char *)Key, sizeof(Key));
+  StringRef Bytes((const char *)Data, Size);
+
+  // Zero marks an empty slot, so nudge a zero hash out of the way.
+  uint64_t SlotHash = (Hash != 0) ? Hash : 1;
+  for (unsigned Probe = 0; Probe < InternProbeLimit; ++Probe) {
+    InternSlot &Slot = InternTable[(SlotHash + Probe) & (InternTableSize - 1)];
+    uint64_t Existing = Slot.Hash.load(std::memory_order_acquire);
+
+    if (Existing == 0) {
+      if (Slot.Hash.compare_exchange_strong(Existing, SlotHash,
+                                            std::memory_order_acq_rel)) {
+        uint64_t Ref = append(Chunk, RecordKind::Blob, JitApi(0), 0,
+                              KeyBytes, Bytes);
+        Slot.Ref.store(Ref, std::memory_order_release);
+        return Ref;
+      }
+      // Another thread claimed the slot first; Existing now holds its hash.
+    }
+
+    if (Existing == SlotHash) {
+      uint64_t Ref = Slot.Ref.load(std::memory_order_acquire);
+      if (Ref == 0) {
+        // The blob is still being written (or was dropped); rather than
+        // wait, store a private copy.
+        break;
+      }
+      if (blobMatches(Ref, Data, Size)) {
+        NumBlobsShared.fetch_add(1, std::memory_order_relaxed);
+        return Ref;
+      }
+    }
+  }
+
+  return append(Chunk, RecordKind::Blob, JitApi(0), 0, KeyBytes, Bytes);
+}
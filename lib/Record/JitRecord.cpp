@@ -0,0 +1,459 @@
+//===----------------- lib/Record/JitRecord.cpp -----------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Serialization of JIT-EE interface data to and from collection
+/// records, and the reader for collection files.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "JitRecord.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+
+using namespace llvm;
+
+const char CollectionFileHeader::MagicValue[8] = {'L', 'L', 'I', 'L',
+                                                  'C', 'J', 'R', '\0'};
+
+const char *getJitApiName(JitApi Api) {
+  static const char *const Names[] = {
+#define JITINTERFACE_METHOD(Ret, Name, Params, Args) #Name,
+#include "JitInterface.def"
+  };
+
+  if (Api >= JitApi::Count) {
+    return "<unknown>";
+  }
+  return Names[static_cast<uint16_t>(Api)];
+}
+
+uint64_t hashBytes(const void *Data, size_t Size, uint64_t Seed) {
+  const uint64_t OffsetBasis = 14695981039346656037ULL;
+  const uint64_t Prime = 1099511628211ULL;
+  const uint8_t *Bytes = static_cast<const uint8_t *>(Data);
+  uint64_t Hash = Seed ^ OffsetBasis;
+  for (size_t I = 0; I < Size; ++I) {
+    Hash ^= Bytes[I];
+    Hash *= Prime;
+  }
+  return Hash;
+}
+
+//===----------------------------------------------------------------------===//
+// RecordBuilder
+//===----------------------------------------------------------------------===//
+
+void RecordBuilder::putBlob(const void *Data, size_t Size) {
+  uint64_t Ref = 0;
+  if ((Data != nullptr) && (Size != 0)) {
+    assert(Interner != nullptr && "Blobs need an interner");
+    Ref = Interner->internBlob(Data, Size);
+  }
+  put(Ref);
+}
+
+void RecordBuilder::putString(const char *String) {
+  putBlob(String, (String == nullptr) ? 0 : strlen(String) + 1);
+}
+
+void RecordBuilder::putString16(const char16_t *String) {
+  size_t Length = 0;
+  if (String != nullptr) {
+    while (String[Length] != 0) {
+      Length++;
+    }
+    Length++;
+  }
+  putBlob(String, Length * sizeof(char16_t));
+}
+
+void RecordBuilder::putSig(const CORINFO_SIG_INFO &Sig) {
+  // The structure is stored as is; the readers patch up the pointers to
+  // refer to the blobs that follow. Sig.args is an opaque cursor that is
+  // only ever handed back to the EE, so it keeps its recorded value.
+  put(Sig);
+  putBlob(Sig.sigInst.classInst,
+          Sig.sigInst.classInstCount * sizeof(CORINFO_CLASS_HANDLE));
+  putBlob(Sig.sigInst.methInst,
+          Sig.sigInst.methInstCount * sizeof(CORINFO_CLASS_HANDLE));
+  putBlob(Sig.pSig, Sig.cbSig);
+}
+
+void RecordBuilder::putMethodInfo(const CORINFO_METHOD_INFO &Info) {
+  put(Info);
+  putBlob(Info.ILCode, Info.ILCodeSize);
+  putSig(Info.args);
+  putSig(Info.locals);
+}
+
+void RecordBuilder::putResolvedToken(const CORINFO_RESOLVED_TOKEN &Token) {
+  put(Token);
+  putBlob(Token.pTypeSpec, Token.cbTypeSpec);
+  putBlob(Token.pMethodSpec, Token.cbMethodSpec);
+}
+
+void RecordBuilder::putCallInfo(const CORINFO_CALL_INFO &Info) {
+  put(Info);
+  putSig(Info.sig);
+  putSig(Info.verSig);
+}
+
+void RecordBuilder::putKey(CORINFO_SIG_INFO *Sig) {
+  if (Sig == nullptr) {
+    put(uint64_t(0));
+    return;
+  }
+
+  uint64_t Hash = hashBytes(Sig->pSig, Sig->cbSig);
+  Hash = hashBytes(Sig->sigInst.classInst,
+                   Sig->sigInst.classInstCount * sizeof(CORINFO_CLASS_HANDLE),
+                   Hash);
+  Hash = hashBytes(Sig->sigInst.methInst,
+                   Sig->sigInst.methInstCount * sizeof(CORINFO_CLASS_HANDLE),
+                   Hash);
+  put(Hash);
+  put(Sig->scope);
+  put(Sig->token);
+  put(Sig->callConv);
+  put(uint32_t(Sig->numArgs));
+  put(uint32_t(Sig->flags));
+}
+
+void RecordBuilder::putKey(CORINFO_RESOLVED_TOKEN *Token) {
+  if (Token == nullptr) {
+    put(uint64_t(0));
+    return;
+  }
+
+  put(Token->tokenContext);
+  put(Token->tokenScope);
+  put(Token->token);
+  put(Token->tokenType);
+}
+
+void RecordBuilder::putKey(const char *String) {
+  size_t Length = (String == nullptr) ? 0 : strlen(String);
+  put(uint64_t(Length));
+  putBytes(String, Length);
+}
+
+//===----------------------------------------------------------------------===//
+// RecordCursor
+//===----------------------------------------------------------------------===//
+
+const char *RecordCursor::getBytes(size_t Size) {
+  if (Size > Data.size()) {
+    report_fatal_error("Collection record is shorter than expected");
+  }
+  const char *Bytes = Data.data();
+  Data = Data.drop_front(Size);
+  return Bytes;
+}
+
+ArrayRef<uint8_t> RecordCursor::getBlob() {
+  uint64_t Ref = get<uint64_t>();
+  if (Ref == 0) {
+    return ArrayRef<uint8_t>();
+  }
+  return Collection.getBlob(Ref);
+}
+
+const char *RecordCursor::getString() {
+  ArrayRef<uint8_t> Blob = getBlob();
+  return Blob.empty() ? nullptr : (const char *)Blob.data();
+}
+
+const char16_t *RecordCursor::getString16() {
+  ArrayRef<uint8_t> Blob = getBlob();
+  return Blob.empty() ? nullptr : (const char16_t *)Blob.data();
+}
+
+void RecordCursor::getSig(CORINFO_SIG_INFO &Sig) {
+  get(Sig);
+  Sig.sigInst.classInst = (CORINFO_CLASS_HANDLE *)getBlob().data();
+  Sig.sigInst.methInst = (CORINFO_CLASS_HANDLE *)getBlob().data();
+  Sig.pSig = (PCCOR_SIGNATURE)getBlob().data();
+}
+
+void RecordCursor::getMethodInfo(CORINFO_METHOD_INFO &Info) {
+  get(Info);
+  Info.ILCode = (BYTE *)getBlob().data();
+  getSig(Info.args);
+  getSig(Info.locals);
+}
+
+void RecordCursor::getResolvedToken(CORINFO_RESOLVED_TOKEN &Token) {
+  get(Token);
+  Token.pTypeSpec = (PCCOR_SIGNATURE)getBlob().data();
+  Token.pMethodSpec = (PCCOR_SIGNATURE)getBlob().data();
+}
+
+void RecordCursor::getCallInfo(CORINFO_CALL_INFO &Info) {
+  get(Info);
+  getSig(Info.sig);
+  getSig(Info.verSig);
+}
+
+//===----------------------------------------------------------------------===//
+// CollectionReader
+//===----------------------------------------------------------------------===//
+
+std::string makeQueryKey(JitApi Api, StringRef Key) {
+  std::string QueryKey;
+  QueryKey.reserve(sizeof(JitApi) + Key.size());
+  uint16_t ApiValue = static_cast<uint16_t>(Api);
+  QueryKey.append((const char *)&ApiValue, sizeof(ApiValue));
+  QueryKey.append(Key.data(), Key.size());
+  return QueryKey;
+}
+
+bool CollectionMethod::lookup(JitApi Api, StringRef Key,
+                              StringRef &Value) const {
+  auto Iterator = Queries.find(makeQueryKey(Api, Key));
+  if (Iterator == Queries.end()) {
+    return false;
+  }
+  Value = Iterator->getValue();
+  return true;
+}
+
+std::unique_ptr<CollectionReader> CollectionReader::open(StringRef Path,
+                                                         std::string &Error) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrError =
+      MemoryBuffer::getFile(Path, -1, /*RequiresNullTerminator=*/false);
+  if (!BufferOrError) {
+    Error = BufferOrError.getError().message();
+    return nullptr;
+  }
+
+  std::unique_ptr<CollectionReader> Reader(
+      new CollectionReader(std::move(BufferOrError.get())));
+  if (!Reader->index(Error)) {
+    return nullptr;
+  }
+  return Reader;
+}
+
+bool CollectionReader::index(std::string &Error) {
+  const char *Start = Buffer->getBufferStart();
+  uint64_t FileSize = Buffer->getBufferSize();
+
+  CollectionFileHeader FileHeader;
+  if (FileSize < sizeof(FileHeader)) {
+    Error = "file is too small to be a collection";
+    return false;
+  }
+  std::memcpy(&FileHeader, Start, sizeof(FileHeader));
+  if (std::memcmp(FileHeader.Magic, CollectionFileHeader::MagicValue,
+                  sizeof(FileHeader.Magic)) != 0) {
+    Error = "file is not a collection";
+    return false;
+  }
+  if (FileHeader.Version != CollectionFileHeader::CurrentVersion) {
+    Error = "unsupported collection version " +
+            std::to_string(FileHeader.Version);
+    return false;
+  }
+  if (FileHeader.PointerSize != sizeof(void *)) {
+    Error = "collection was recorded on a different architecture";
+    return false;
+  }
+
+  // The recorder may have been stopped before the tail was written out, so
+  // never trust it beyond the end of the file.
+  uint64_t Tail = std::min(FileHeader.Tail, FileSize);
+  DenseMap<uint32_t, CollectionMethod *> MethodsById;
+
+  uint64_t Offset = sizeof(FileHeader);
+  while (Offset + sizeof(CollectionRecordHeader) <= Tail) {
+    CollectionRecordHeader Header;
+    uint64_t ChunkLeft = ~uint64_t(0);
+    if (FileHeader.ChunkSize != 0) {
+      ChunkLeft = FileHeader.ChunkSize -
+                  (Offset - sizeof(FileHeader)) % FileHeader.ChunkSize;
+    }
+    if (ChunkLeft < sizeof(Header)) {
+      Header.Size = 0;
+    } else {
+      std::memcpy(&Header, Start + Offset, sizeof(Header));
+    }
+
+    if (Header.Size == 0) {
+      // The rest of this chunk was never used.
+      if (FileHeader.ChunkSize == 0) {
+        break;
+      }
+      Offset += ChunkLeft;
+      continue;
+    }
+    if ((Header.Size < sizeof(Header)) || (Header.Size % RecordAlignment) ||
+        (Offset + Header.Size > Tail) ||
+        (Header.KeySize > Header.Size - sizeof(Header))) {
+      Error = "malformed record at offset " + std::to_string(Offset);
+      return false;
+    }
+
+    const char *Payload = Start + Offset + sizeof(Header);
+    StringRef Key(Payload, Header.KeySize);
+    StringRef Value(Payload + Header.KeySize,
+                    Header.Size - sizeof(Header) - Header.KeySize);
+    RecordCursor Cursor(*this, Value);
+
+    switch (static_cast<RecordKind>(Header.Kind)) {
+    case RecordKind::MethodBegin: {
+      std::unique_ptr<CollectionMethod> Method(new CollectionMethod());
+      Method->Id = Header.MethodId;
+      Method->Flags = Cursor.get<uint32_t>();
+      Cursor.getMethodInfo(Method->Info);
+      Method->Name = Cursor.getString();
+      Method->HasResult = false;
+      Method->Result = CORJIT_INTERNALERROR;
+      Method->CodeSize = 0;
+      Method->CodeHash = 0;
+      MethodsById[Method->Id] = Method.get();
+      Methods.push_back(std::move(Method));
+      break;
+    }
+
+    case RecordKind::Query: {
+      auto Iterator = MethodsById.find(Header.MethodId);
+      if (Iterator != MethodsById.end()) {
+        // Repeated queries get the same answer; keep the first one.
+        Iterator->second->Queries.insert(
+            std::make_pair(makeQueryKey((JitApi)Header.Api, Key), Value));
+      }
+      break;
+    }
+
+    case RecordKind::MethodEnd: {
+      auto Iterator = MethodsById.find(Header.MethodId);
+      if (Iterator != MethodsById.end()) {
+        CollectionMethod *Method = Iterator->second;
+        Method->HasResult = true;
+        Method->Result = (CorJitResult)Cursor.get<uint32_t>();
+        Method->CodeSize = Cursor.get<uint32_t>();
+        Method->CodeHash = Cursor.get<uint64_t>();
+      }
+      break;
+    }
+
+    default:
+      // Padding, blobs (which are found by offset), and kinds added by
+      // newer recorders.
+      break;
+    }
+
+    Offset += Header.Size;
+  }
+
+  return true;
+}
+
+ArrayRef<uint8_t> CollectionReader::getBlob(uint64_t Ref) const {
+  const char *Start = Buffer->getBufferStart();
+  uint64_t FileSize = Buffer->getBufferSize();
+  const uint64_t KeySize = 2 * sizeof(uint64_t);
+
+  CollectionRecordHeader Header;
+  if ((Ref < sizeof(CollectionFileHeader)) ||
+      (Ref + sizeof(Header) + KeySize > FileSize)) {
+    report_fatal_error("Collection blob reference is out of range");
+  }
+  std::memcpy(&Header, Start + Ref, sizeof(Header));
+  if ((static_cast<RecordKind>(Header.Kind) != RecordKind::Blob) ||
+      (Header.KeySize != KeySize) || (Ref + Header.Size > FileSize)) {
+    report_fatal_error("Collection blob reference is malformed");
+  }
+
+  // The blob key is the hash of the bytes followed by their length.
+  uint64_t Length;
+  std::memcpy(&Length, Start + Ref + sizeof(Header) + sizeof(uint64_t),
+              sizeof(Length));
+  if (Length > Header.Size - sizeof(Header) - KeySize) {
+    report_fatal_error("Collection blob reference is malformed");
+  }
+  return ArrayRef<uint8_t>(
+      (const uint8_t *)(Start + Ref + sizeof(Header) + KeySize), Length);
+}
+
+//===----------------------------------------------------------------------===//
+// CodeDigest
+//===----------------------------------------------------------------------===//
+
+void CodeDigest::setCode(const uint8_t *HotCode, size_t HotCodeSize,
+                         const uint8_t *ColdCode, size_t ColdCodeSize,
+                         const uint8_t *ROData, size_t RODataSize) {
+  Sections[0] = {HotCode, HotCodeSize};
+  Sections[1] = {ColdCode, ColdCodeSize};
+  Sections[2] = {ROData, RODataSize};
+}
+
+unsigned CodeDigest::locate(const uint8_t *Address, uint64_t &Offset) const {
+  for (unsigned Index = 0; Index < 3; ++Index) {
+    const Section &S = Sections[Index];
+    if ((S.Start != nullptr) && (Address >= S.Start) &&
+        (Address < S.Start + S.Size)) {
+      Offset = Address - S.Start;
+      return Index + 1;
+    }
+  }
+  Offset = (uint64_t)Address;
+  return 0;
+}
+
+uint64_t CodeDigest::compute() const {
+  uint64_t Hash = 0;
+  std::vector<uint8_t> Contents;
+
+  for (unsigned Index = 0; Index < 3; ++Index) {
+    // A compile that failed before allocMem has no sections.
+    const Section &S = Sections[Index];
+    Contents.clear();
+    if (S.Start != nullptr) {
+      Contents.assign(S.Start, S.Start + S.Size);
+    }
+
+    // Blank out the relocated fields; they are hashed separately below.
+    for (const Relocation &Reloc : Relocations) {
+      uint64_t Offset;
+      if (locate(Reloc.Location, Offset) != Index + 1) {
+        continue;
+      }
+      size_t Width = (Reloc.Type == IMAGE_REL_BASED_DIR64) ? 8 : 4;
+      size_t End = std::min<size_t>(Offset + Width, Contents.size());
+      std::fill(Contents.begin() + Offset, Contents.begin() + End, 0);
+    }
+
+    uint64_t Size = S.Size;
+    Hash = hashBytes(&Size, sizeof(Size), Hash);
+    Hash = hashBytes(Contents.data(), Contents.size(), Hash);
+  }
+
+  for (const Relocation &Reloc : Relocations) {
+    uint64_t Fields[5];
+    Fields[0] = Reloc.Type;
+    Fields[1] = locate(Reloc.Location, Fields[2]);
+    if (Fields[1] == 0) {
+      // Fixups in unwind data land in blocks the EE owns; ignore them.
+      continue;
+    }
+    Fields[3] = locate(Reloc.Target, Fields[4]);
+    Hash = hashBytes(Fields, sizeof(Fields), Hash);
+  }
+
+  uint64_t Size = GCInfoSize;
+  Hash = hashBytes(&Size, sizeof(Size), Hash);
+  return hashBytes(GCInfo, GCInfoSize, Hash);
+}
@@ -0,0 +1,886 @@
+//===-------------- lib/Record/RecordingJitInfo.cpp -------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the ICorJitInfo that records compiles. Each
+/// query is passed to the EE, then keyed and encoded exactly as
+/// ReplayJitInfo decodes it.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "RecordingJitInfo.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+RecordingJitInfo::RecordingJitInfo(ICorJitInfo *Inner,
+                                   CollectionWriter &Writer,
+                                   CollectionChunk &Chunk,
+                                   CORINFO_METHOD_INFO *MethodInfo,
+                                   UINT Flags)
+    : ForwardingJitInfo(Inner), Writer(Writer), Chunk(Chunk),
+      MethodId(Writer.allocateMethodId()), RequestResult(CORJIT_INTERNALERROR),
+      Key(), Value(this), BlobDropped(false) {
+  if (Writer.isFull()) {
+    return;
+  }
+
+  const char *ClassName = nullptr;
+  const char *MethodName = Inner->getMethodName(MethodInfo->ftn, &ClassName);
+  std::string Name = ClassName ? ClassName : "";
+  Name += ":";
+  Name += MethodName ? MethodName : "";
+
+  Value.put<uint32_t>(Flags);
+  Value.putMethodInfo(*MethodInfo);
+  Value.putString(Name.c_str());
+  if (!BlobDropped) {
+    Writer.append(Chunk, RecordKind::MethodBegin, JitApi(0), MethodId,
+                  StringRef(), Value.bytes());
+  }
+}
+
+RecordingJitInfo::~RecordingJitInfo() {
+  if (Writer.isFull()) {
+    return;
+  }
+
+  Value.clear();
+  Value.put<uint32_t>(RequestResult);
+  Value.put<uint32_t>(Digest.getHotCodeSize());
+  Value.put<uint64_t>(Digest.compute());
+  Writer.append(Chunk, RecordKind::MethodEnd, JitApi(0), MethodId,
+                StringRef(), Value.bytes());
+}
+
+uint64_t RecordingJitInfo::internBlob(const void *Data, size_t Size) {
+  uint64_t Ref = Writer.internBlob(Chunk, Data, Size);
+  if (Ref == 0) {
+    // A value referring to a missing blob would replay as a null pointer,
+    // so the query it belongs to is dropped as well.
+    BlobDropped = true;
+  }
+  return Ref;
+}
+
+void RecordingJitInfo::endQuery(JitApi Api) {
+  if (!BlobDropped) {
+    Writer.append(Chunk, RecordKind::Query, Api, MethodId, Key.bytes(),
+                  Value.bytes());
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// ICorMethodInfo
+//===----------------------------------------------------------------------===//
+
+DWORD RecordingJitInfo::getMethodAttribs(CORINFO_METHOD_HANDLE ftn) {
+  return record(Inner->getMethodAttribs(ftn), JitApi::getMethodAttribs, ftn);
+}
+
+void RecordingJitInfo::getMethodSig(CORINFO_METHOD_HANDLE ftn,
+                                    CORINFO_SIG_INFO *sig,
+                                    CORINFO_CLASS_HANDLE memberParent) {
+  Inner->getMethodSig(ftn, sig, memberParent);
+  if (beginQuery(JitApi::getMethodSig, ftn, memberParent)) {
+    Value.putSig(*sig);
+    endQuery(JitApi::getMethodSig);
+  }
+}
+
+bool RecordingJitInfo::getMethodInfo(CORINFO_METHOD_HANDLE ftn,
+                                     CORINFO_METHOD_INFO *info) {
+  bool Result = Inner->getMethodInfo(ftn, info);
+  if (beginQuery(JitApi::getMethodInfo, ftn)) {
+    Value.put(Result);
+    if (Result) {
+      Value.putMethodInfo(*info);
+    }
+    endQuery(JitApi::getMethodInfo);
+  }
+  return Result;
+}
+
+CorInfoInline RecordingJitInfo::canInline(CORINFO_METHOD_HANDLE callerHnd,
+                                          CORINFO_METHOD_HANDLE calleeHnd,
+                                          DWORD *pRestrictions) {
+  DWORD Restrictions = 0;
+  CorInfoInline Result = Inner->canInline(callerHnd, calleeHnd, &Restrictions);
+  if (pRestrictions != nullptr) {
+    *pRestrictions = Restrictions;
+  }
+  if (beginQuery(JitApi::canInline, callerHnd, calleeHnd)) {
+    Value.put(Result);
+    Value.put(Restrictions);
+    endQuery(JitApi::canInline);
+  }
+  return Result;
+}
+
+bool RecordingJitInfo::canTailCall(CORINFO_METHOD_HANDLE callerHnd,
+                                   CORINFO_METHOD_HANDLE declaredCalleeHnd,
+                                   CORINFO_METHOD_HANDLE exactCalleeHnd,
+                                   bool fIsTailPrefix) {
+  return record(Inner->canTailCall(callerHnd, declaredCalleeHnd,
+                                   exactCalleeHnd, fIsTailPrefix),
+                JitApi::canTailCall, callerHnd, declaredCalleeHnd,
+                exactCalleeHnd, fIsTailPrefix);
+}
+
+void RecordingJitInfo::getEHinfo(CORINFO_METHOD_HANDLE ftn, unsigned EHnumber,
+                                 CORINFO_EH_CLAUSE *clause) {
+  Inner->getEHinfo(ftn, EHnumber, clause);
+  if (beginQuery(JitApi::getEHinfo, ftn, EHnumber)) {
+    Value.put(*clause);
+    endQuery(JitApi::getEHinfo);
+  }
+}
+
+CORINFO_CLASS_HANDLE
+RecordingJitInfo::getMethodClass(CORINFO_METHOD_HANDLE method) {
+  return record(Inner->getMethodClass(method), JitApi::getMethodClass,
+                method);
+}
+
+void RecordingJitInfo::getMethodVTableOffset(
+    CORINFO_METHOD_HANDLE method, unsigned *offsetOfIndirection,
+    unsigned *offsetAfterIndirection) {
+  Inner->getMethodVTableOffset(method, offsetOfIndirection,
+                               offsetAfterIndirection);
+  if (beginQuery(JitApi::getMethodVTableOffset, method)) {
+    Value.put(*offsetOfIndirection);
+    Value.put(*offsetAfterIndirection);
+    endQuery(JitApi::getMethodVTableOffset);
+  }
+}
+
+CorInfoIntrinsics
+RecordingJitInfo::getIntrinsicID(CORINFO_METHOD_HANDLE method) {
+  return record(Inner->getIntrinsicID(method), JitApi::getIntrinsicID,
+                method);
+}
+
+bool RecordingJitInfo::isInSIMDModule(CORINFO_CLASS_HANDLE classHnd) {
+  return record(Inner->isInSIMDModule(classHnd), JitApi::isInSIMDModule,
+                classHnd);
+}
+
+BOOL RecordingJitInfo::pInvokeMarshalingRequired(
+    CORINFO_METHOD_HANDLE method, CORINFO_SIG_INFO *callSiteSig) {
+  return record(Inner->pInvokeMarshalingRequired(method, callSiteSig),
+                JitApi::pInvokeMarshalingRequired, method, callSiteSig);
+}
+
+BOOL RecordingJitInfo::isDelegateCreationAllowed(
+    CORINFO_CLASS_HANDLE delegateHnd, CORINFO_METHOD_HANDLE calleeHnd) {
+  return record(Inner->isDelegateCreationAllowed(delegateHnd, calleeHnd),
+                JitApi::isDelegateCreationAllowed, delegateHnd, calleeHnd);
+}
+
+//===----------------------------------------------------------------------===//
+// ICorModuleInfo
+//===----------------------------------------------------------------------===//
+
+void RecordingJitInfo::resolveToken(CORINFO_RESOLVED_TOKEN *pResolvedToken) {
+  // The key fields are inputs, so they are unchanged by the call.
+  Inner->resolveToken(pResolvedToken);
+  if (beginQuery(JitApi::resolveToken, pResolvedToken)) {
+    Value.putResolvedToken(*pResolvedToken);
+    endQuery(JitApi::resolveToken);
+  }
+}
+
+void RecordingJitInfo::findSig(CORINFO_MODULE_HANDLE module, unsigned sigTOK,
+                               CORINFO_CONTEXT_HANDLE context,
+                               CORINFO_SIG_INFO *sig) {
+  Inner->findSig(module, sigTOK, context, sig);
+  if (beginQuery(JitApi::findSig, module, sigTOK, context)) {
+    Value.putSig(*sig);
+    endQuery(JitApi::findSig);
+  }
+}
+
+void RecordingJitInfo::findCallSiteSig(CORINFO_MODULE_HANDLE module,
+                                       unsigned methTOK,
+                                       CORINFO_CONTEXT_HANDLE context,
+                                       CORINFO_SIG_INFO *sig) {
+  Inner->findCallSiteSig(module, methTOK, context, sig);
+  if (beginQuery(JitApi::findCallSiteSig, module, methTOK, context)) {
+    Value.putSig(*sig);
+    endQuery(JitApi::findCallSiteSig);
+  }
+}
+
+CORINFO_CLASS_HANDLE RecordingJitInfo::getTokenTypeAsHandle(
+    CORINFO_RESOLVED_TOKEN *pResolvedToken) {
+  return record(Inner->getTokenTypeAsHandle(pResolvedToken),
+                JitApi::getTokenTypeAsHandle, pResolvedToken);
+}
+
+BOOL RecordingJitInfo::isValidToken(CORINFO_MODULE_HANDLE module,
+                                    unsigned metaTOK) {
+  return record(Inner->isValidToken(module, metaTOK), JitApi::isValidToken,
+                module, metaTOK);
+}
+
+//===----------------------------------------------------------------------===//
+// ICorClassInfo
+//===----------------------------------------------------------------------===//
+
+CorInfoType RecordingJitInfo::asCorInfoType(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->asCorInfoType(cls), JitApi::asCorInfoType, cls);
+}
+
+const char *RecordingJitInfo::getClassName(CORINFO_CLASS_HANDLE cls) {
+  const char *Result = Inner->getClassName(cls);
+  if (beginQuery(JitApi::getClassName, cls)) {
+    Value.putString(Result);
+    endQuery(JitApi::getClassName);
+  }
+  return Result;
+}
+
+int RecordingJitInfo::appendClassName(WCHAR **ppBuf, int *pnBufLen,
+                                      CORINFO_CLASS_HANDLE cls,
+                                      BOOL fNamespace, BOOL fFullInst,
+                                      BOOL fAssembly) {
+  WCHAR *Start = (ppBuf != nullptr) ? *ppBuf : nullptr;
+  int Length = Inner->appendClassName(ppBuf, pnBufLen, cls, fNamespace,
+                                      fFullInst, fAssembly);
+  if (beginQuery(JitApi::appendClassName, cls, fNamespace, fFullInst,
+                 fAssembly)) {
+    // The replayer needs the whole name. The jit usually asks for the
+    // length first, so fetch the name separately unless it all fit.
+    std::vector<char16_t> Name;
+    if ((Start != nullptr) && (*ppBuf - Start == Length)) {
+      Name.assign((const char16_t *)Start, (const char16_t *)*ppBuf);
+    } else {
+      Name.resize(Length + 1);
+      WCHAR *Buffer = (WCHAR *)Name.data();
+      int BufferLength = Length + 1;
+      Inner->appendClassName(&Buffer, &BufferLength, cls, fNamespace,
+                             fFullInst, fAssembly);
+      Name.resize(Length);
+    }
+    Name.push_back(0);
+    Value.putString16(Name.data());
+    endQuery(JitApi::appendClassName);
+  }
+  return Length;
+}
+
+BOOL RecordingJitInfo::isValueClass(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->isValueClass(cls), JitApi::isValueClass, cls);
+}
+
+BOOL RecordingJitInfo::canInlineTypeCheckWithObjectVTable(
+    CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->canInlineTypeCheckWithObjectVTable(cls),
+                JitApi::canInlineTypeCheckWithObjectVTable, cls);
+}
+
+DWORD RecordingJitInfo::getClassAttribs(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->getClassAttribs(cls), JitApi::getClassAttribs, cls);
+}
+
+BOOL RecordingJitInfo::isStructRequiringStackAllocRetBuf(
+    CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->isStructRequiringStackAllocRetBuf(cls),
+                JitApi::isStructRequiringStackAllocRetBuf, cls);
+}
+
+size_t RecordingJitInfo::getClassModuleIdForStatics(
+    CORINFO_CLASS_HANDLE cls, CORINFO_MODULE_HANDLE *pModule,
+    void **ppIndirection) {
+  CORINFO_MODULE_HANDLE Module = nullptr;
+  size_t Result =
+      Inner->getClassModuleIdForStatics(cls, &Module, ppIndirection);
+  if (pModule != nullptr) {
+    *pModule = Module;
+  }
+  if (beginQuery(JitApi::getClassModuleIdForStatics, cls)) {
+    Value.put(Result);
+    Value.put(Module);
+    Value.put((ppIndirection != nullptr) ? *ppIndirection : (void *)nullptr);
+    endQuery(JitApi::getClassModuleIdForStatics);
+  }
+  return Result;
+}
+
+unsigned RecordingJitInfo::getClassSize(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->getClassSize(cls), JitApi::getClassSize, cls);
+}
+
+unsigned RecordingJitInfo::getClassAlignmentRequirement(
+    CORINFO_CLASS_HANDLE cls, BOOL fDoubleAlignHint) {
+  return record(Inner->getClassAlignmentRequirement(cls, fDoubleAlignHint),
+                JitApi::getClassAlignmentRequirement, cls, fDoubleAlignHint);
+}
+
+unsigned RecordingJitInfo::getClassGClayout(CORINFO_CLASS_HANDLE cls,
+                                            BYTE *gcPtrs) {
+  unsigned Result = Inner->getClassGClayout(cls, gcPtrs);
+  if (beginQuery(JitApi::getClassGClayout, cls)) {
+    // The layout has one byte per pointer-sized slot of the class.
+    unsigned NumSlots =
+        (Inner->getClassSize(cls) + sizeof(void *) - 1) / sizeof(void *);
+    Value.put(Result);
+    Value.putBlob(gcPtrs, NumSlots);
+    endQuery(JitApi::getClassGClayout);
+  }
+  return Result;
+}
+
+unsigned RecordingJitInfo::getClassNumInstanceFields(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->getClassNumInstanceFields(cls),
+                JitApi::getClassNumInstanceFields, cls);
+}
+
+CORINFO_FIELD_HANDLE
+RecordingJitInfo::getFieldInClass(CORINFO_CLASS_HANDLE clsHnd, INT num) {
+  return record(Inner->getFieldInClass(clsHnd, num), JitApi::getFieldInClass,
+                clsHnd, num);
+}
+
+BOOL RecordingJitInfo::checkMethodModifier(CORINFO_METHOD_HANDLE hMethod,
+                                           LPCSTR modifier, BOOL fOptional) {
+  return record(Inner->checkMethodModifier(hMethod, modifier, fOptional),
+                JitApi::checkMethodModifier, hMethod, modifier, fOptional);
+}
+
+CorInfoHelpFunc
+RecordingJitInfo::getNewHelper(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                               CORINFO_METHOD_HANDLE callerHandle) {
+  return record(Inner->getNewHelper(pResolvedToken, callerHandle),
+                JitApi::getNewHelper, pResolvedToken, callerHandle);
+}
+
+CorInfoHelpFunc
+RecordingJitInfo::getNewArrHelper(CORINFO_CLASS_HANDLE arrayCls) {
+  return record(Inner->getNewArrHelper(arrayCls), JitApi::getNewArrHelper,
+                arrayCls);
+}
+
+CorInfoHelpFunc
+RecordingJitInfo::getCastingHelper(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                                   bool fThrowing) {
+  return record(Inner->getCastingHelper(pResolvedToken, fThrowing),
+                JitApi::getCastingHelper, pResolvedToken, fThrowing);
+}
+
+CorInfoHelpFunc
+RecordingJitInfo::getSharedCCtorHelper(CORINFO_CLASS_HANDLE clsHnd) {
+  return record(Inner->getSharedCCtorHelper(clsHnd),
+                JitApi::getSharedCCtorHelper, clsHnd);
+}
+
+CorInfoHelpFunc
+RecordingJitInfo::getSecurityPrologHelper(CORINFO_METHOD_HANDLE ftn) {
+  return record(Inner->getSecurityPrologHelper(ftn),
+                JitApi::getSecurityPrologHelper, ftn);
+}
+
+CORINFO_CLASS_HANDLE
+RecordingJitInfo::getTypeForBox(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->getTypeForBox(cls), JitApi::getTypeForBox, cls);
+}
+
+CorInfoHelpFunc RecordingJitInfo::getBoxHelper(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->getBoxHelper(cls), JitApi::getBoxHelper, cls);
+}
+
+CorInfoHelpFunc RecordingJitInfo::getUnBoxHelper(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->getUnBoxHelper(cls), JitApi::getUnBoxHelper, cls);
+}
+
+void RecordingJitInfo::getReadyToRunHelper(
+    CORINFO_RESOLVED_TOKEN *pResolvedToken, CorInfoHelpFunc id,
+    CORINFO_CONST_LOOKUP *pLookup) {
+  Inner->getReadyToRunHelper(pResolvedToken, id, pLookup);
+  if (beginQuery(JitApi::getReadyToRunHelper, pResolvedToken, id)) {
+    Value.put(*pLookup);
+    endQuery(JitApi::getReadyToRunHelper);
+  }
+}
+
+const char *RecordingJitInfo::getHelperName(CorInfoHelpFunc helpFunc) {
+  const char *Result = Inner->getHelperName(helpFunc);
+  if (beginQuery(JitApi::getHelperName, helpFunc)) {
+    Value.putString(Result);
+    endQuery(JitApi::getHelperName);
+  }
+  return Result;
+}
+
+CorInfoInitClassResult
+RecordingJitInfo::initClass(CORINFO_FIELD_HANDLE field,
+                            CORINFO_METHOD_HANDLE method,
+                            CORINFO_CONTEXT_HANDLE context, BOOL speculative) {
+  return record(Inner->initClass(field, method, context, speculative),
+                JitApi::initClass, field, method, context, speculative);
+}
+
+CORINFO_CLASS_HANDLE
+RecordingJitInfo::getBuiltinClass(CorInfoClassId classId) {
+  return record(Inner->getBuiltinClass(classId), JitApi::getBuiltinClass,
+                classId);
+}
+
+CORINFO_CLASS_HANDLE
+RecordingJitInfo::mergeClasses(CORINFO_CLASS_HANDLE cls1,
+                               CORINFO_CLASS_HANDLE cls2) {
+  return record(Inner->mergeClasses(cls1, cls2), JitApi::mergeClasses, cls1,
+                cls2);
+}
+
+CORINFO_CLASS_HANDLE
+RecordingJitInfo::getParentType(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->getParentType(cls), JitApi::getParentType, cls);
+}
+
+CorInfoType RecordingJitInfo::getChildType(CORINFO_CLASS_HANDLE clsHnd,
+                                           CORINFO_CLASS_HANDLE *clsRet) {
+  CorInfoType Result = Inner->getChildType(clsHnd, clsRet);
+  if (beginQuery(JitApi::getChildType, clsHnd)) {
+    Value.put(Result);
+    Value.put(*clsRet);
+    endQuery(JitApi::getChildType);
+  }
+  return Result;
+}
+
+BOOL RecordingJitInfo::isSDArray(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->isSDArray(cls), JitApi::isSDArray, cls);
+}
+
+unsigned RecordingJitInfo::getArrayRank(CORINFO_CLASS_HANDLE cls) {
+  return record(Inner->getArrayRank(cls), JitApi::getArrayRank, cls);
+}
+
+CorInfoIsAccessAllowedResult
+RecordingJitInfo::canAccessClass(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                                 CORINFO_METHOD_HANDLE callerHandle,
+                                 CORINFO_HELPER_DESC *pAccessHelper) {
+  CorInfoIsAccessAllowedResult Result =
+      Inner->canAccessClass(pResolvedToken, callerHandle, pAccessHelper);
+  if (beginQuery(JitApi::canAccessClass, pResolvedToken, callerHandle)) {
+    Value.put(Result);
+    Value.put(*pAccessHelper);
+    endQuery(JitApi::canAccessClass);
+  }
+  return Result;
+}
+
+//===----------------------------------------------------------------------===//
+// ICorFieldInfo
+//===----------------------------------------------------------------------===//
+
+const char *RecordingJitInfo::getFieldName(CORINFO_FIELD_HANDLE ftn,
+                                           const char **moduleName) {
+  const char *ModuleName = nullptr;
+  const char *Result = Inner->getFieldName(ftn, &ModuleName);
+  if (moduleName != nullptr) {
+    *moduleName = ModuleName;
+  }
+  if (beginQuery(JitApi::getFieldName, ftn)) {
+    Value.putString(Result);
+    Value.putString(ModuleName);
+    endQuery(JitApi::getFieldName);
+  }
+  return Result;
+}
+
+CORINFO_CLASS_HANDLE
+RecordingJitInfo::getFieldClass(CORINFO_FIELD_HANDLE field) {
+  return record(Inner->getFieldClass(field), JitApi::getFieldClass, field);
+}
+
+CorInfoType RecordingJitInfo::getFieldType(CORINFO_FIELD_HANDLE field,
+                                           CORINFO_CLASS_HANDLE *structType,
+                                           CORINFO_CLASS_HANDLE memberParent) {
+  CORINFO_CLASS_HANDLE StructType = nullptr;
+  CorInfoType Result = Inner->getFieldType(field, &StructType, memberParent);
+  if (structType != nullptr) {
+    *structType = StructType;
+  }
+  if (beginQuery(JitApi::getFieldType, field, memberParent)) {
+    Value.put(Result);
+    Value.put(StructType);
+    endQuery(JitApi::getFieldType);
+  }
+  return Result;
+}
+
+unsigned RecordingJitInfo::getFieldOffset(CORINFO_FIELD_HANDLE field) {
+  return record(Inner->getFieldOffset(field), JitApi::getFieldOffset, field);
+}
+
+bool RecordingJitInfo::isWriteBarrierHelperRequired(
+    CORINFO_FIELD_HANDLE field) {
+  return record(Inner->isWriteBarrierHelperRequired(field),
+                JitApi::isWriteBarrierHelperRequired, field);
+}
+
+void RecordingJitInfo::getFieldInfo(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                                    CORINFO_METHOD_HANDLE callerHandle,
+                                    CORINFO_ACCESS_FLAGS flags,
+                                    CORINFO_FIELD_INFO *pResult) {
+  Inner->getFieldInfo(pResolvedToken, callerHandle, flags, pResult);
+  if (beginQuery(JitApi::getFieldInfo, pResolvedToken, callerHandle, flags)) {
+    Value.put(*pResult);
+    endQuery(JitApi::getFieldInfo);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// ICorDebugInfo
+//===----------------------------------------------------------------------===//
+
+void RecordingJitInfo::getBoundaries(
+    CORINFO_METHOD_HANDLE ftn, unsigned int *cILOffsets, DWORD **pILOffsets,
+    ICorDebugInfo::BoundaryTypes *implictBoundaries) {
+  Inner->getBoundaries(ftn, cILOffsets, pILOffsets, implictBoundaries);
+  if (beginQuery(JitApi::getBoundaries, ftn)) {
+    Value.put(*cILOffsets);
+    Value.putBlob(*pILOffsets, *cILOffsets * sizeof(DWORD));
+    Value.put(*implictBoundaries);
+    endQuery(JitApi::getBoundaries);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// ICorArgInfo
+//===----------------------------------------------------------------------===//
+
+CORINFO_ARG_LIST_HANDLE
+RecordingJitInfo::getArgNext(CORINFO_ARG_LIST_HANDLE args) {
+  return record(Inner->getArgNext(args), JitApi::getArgNext, args);
+}
+
+CorInfoTypeWithMod
+RecordingJitInfo::getArgType(CORINFO_SIG_INFO *sig,
+                             CORINFO_ARG_LIST_HANDLE args,
+                             CORINFO_CLASS_HANDLE *vcTypeRet) {
+  CorInfoTypeWithMod Result = Inner->getArgType(sig, args, vcTypeRet);
+  if (beginQuery(JitApi::getArgType, sig, args)) {
+    Value.put(Result);
+    Value.put(*vcTypeRet);
+    endQuery(JitApi::getArgType);
+  }
+  return Result;
+}
+
+CORINFO_CLASS_HANDLE
+RecordingJitInfo::getArgClass(CORINFO_SIG_INFO *sig,
+                              CORINFO_ARG_LIST_HANDLE args) {
+  return record(Inner->getArgClass(sig, args), JitApi::getArgClass, sig,
+                args);
+}
+
+//===----------------------------------------------------------------------===//
+// ICorStaticInfo
+//===----------------------------------------------------------------------===//
+
+void RecordingJitInfo::getEEInfo(CORINFO_EE_INFO *pEEInfoOut) {
+  Inner->getEEInfo(pEEInfoOut);
+  if (beginQuery(JitApi::getEEInfo)) {
+    Value.put(*pEEInfoOut);
+    endQuery(JitApi::getEEInfo);
+  }
+}
+
+mdMethodDef
+RecordingJitInfo::getMethodDefFromMethod(CORINFO_METHOD_HANDLE hMethod) {
+  return record(Inner->getMethodDefFromMethod(hMethod),
+                JitApi::getMethodDefFromMethod, hMethod);
+}
+
+const char *RecordingJitInfo::getMethodName(CORINFO_METHOD_HANDLE ftn,
+                                            const char **moduleName) {
+  const char *ModuleName = nullptr;
+  const char *Result = Inner->getMethodName(ftn, &ModuleName);
+  if (moduleName != nullptr) {
+    *moduleName = ModuleName;
+  }
+  if (beginQuery(JitApi::getMethodName, ftn)) {
+    Value.putString(Result);
+    Value.putString(ModuleName);
+    endQuery(JitApi::getMethodName);
+  }
+  return Result;
+}
+
+unsigned RecordingJitInfo::getMethodHash(CORINFO_METHOD_HANDLE ftn) {
+  return record(Inner->getMethodHash(ftn), JitApi::getMethodHash, ftn);
+}
+
+size_t RecordingJitInfo::findNameOfToken(CORINFO_MODULE_HANDLE module,
+                                         mdToken metaTOK, char *szFQName,
+                                         size_t FQNameCapacity) {
+  size_t Result =
+      Inner->findNameOfToken(module, metaTOK, szFQName, FQNameCapacity);
+  if (beginQuery(JitApi::findNameOfToken, module, metaTOK)) {
+    Value.put(Result);
+    Value.putString(((szFQName != nullptr) && (FQNameCapacity > 0))
+                        ? szFQName
+                        : nullptr);
+    endQuery(JitApi::findNameOfToken);
+  }
+  return Result;
+}
+
+bool RecordingJitInfo::getSystemVAmd64PassStructInRegisterDescriptor(
+    CORINFO_CLASS_HANDLE structHnd,
+    SYSTEMV_AMD64_CORINFO_STRUCT_REG_PASSING_DESCRIPTOR
+        *structPassInRegDescPtr) {
+  bool Result = Inner->getSystemVAmd64PassStructInRegisterDescriptor(
+      structHnd, structPassInRegDescPtr);
+  if (beginQuery(JitApi::getSystemVAmd64PassStructInRegisterDescriptor,
+                 structHnd)) {
+    Value.put(Result);
+    Value.put(*structPassInRegDescPtr);
+    endQuery(JitApi::getSystemVAmd64PassStructInRegisterDescriptor);
+  }
+  return Result;
+}
+
+//===----------------------------------------------------------------------===//
+// ICorDynamicInfo
+//===----------------------------------------------------------------------===//
+
+LONG *RecordingJitInfo::getAddrOfCaptureThreadGlobal(void **ppIndirection) {
+  return recordIndirectable(Inner->getAddrOfCaptureThreadGlobal(ppIndirection),
+                            ppIndirection,
+                            JitApi::getAddrOfCaptureThreadGlobal);
+}
+
+void *RecordingJitInfo::getHelperFtn(CorInfoHelpFunc ftnNum,
+                                     void **ppIndirection) {
+  return recordIndirectable(Inner->getHelperFtn(ftnNum, ppIndirection),
+                            ppIndirection, JitApi::getHelperFtn, ftnNum);
+}
+
+void RecordingJitInfo::getFunctionEntryPoint(
+    CORINFO_METHOD_HANDLE ftn, CORINFO_CONST_LOOKUP *pResult,
+    CORINFO_ACCESS_FLAGS accessFlags) {
+  Inner->getFunctionEntryPoint(ftn, pResult, accessFlags);
+  if (beginQuery(JitApi::getFunctionEntryPoint, ftn, accessFlags)) {
+    Value.put(*pResult);
+    endQuery(JitApi::getFunctionEntryPoint);
+  }
+}
+
+void RecordingJitInfo::getFunctionFixedEntryPoint(
+    CORINFO_METHOD_HANDLE ftn, CORINFO_CONST_LOOKUP *pResult) {
+  Inner->getFunctionFixedEntryPoint(ftn, pResult);
+  if (beginQuery(JitApi::getFunctionFixedEntryPoint, ftn)) {
+    Value.put(*pResult);
+    endQuery(JitApi::getFunctionFixedEntryPoint);
+  }
+}
+
+void *RecordingJitInfo::getMethodSync(CORINFO_METHOD_HANDLE ftn,
+                                      void **ppIndirection) {
+  return recordIndirectable(Inner->getMethodSync(ftn, ppIndirection),
+                            ppIndirection, JitApi::getMethodSync, ftn);
+}
+
+CORINFO_MODULE_HANDLE
+RecordingJitInfo::embedModuleHandle(CORINFO_MODULE_HANDLE handle,
+                                    void **ppIndirection) {
+  return recordIndirectable(Inner->embedModuleHandle(handle, ppIndirection),
+                            ppIndirection, JitApi::embedModuleHandle, handle);
+}
+
+CORINFO_CLASS_HANDLE
+RecordingJitInfo::embedClassHandle(CORINFO_CLASS_HANDLE handle,
+                                   void **ppIndirection) {
+  return recordIndirectable(Inner->embedClassHandle(handle, ppIndirection),
+                            ppIndirection, JitApi::embedClassHandle, handle);
+}
+
+CORINFO_METHOD_HANDLE
+RecordingJitInfo::embedMethodHandle(CORINFO_METHOD_HANDLE handle,
+                                    void **ppIndirection) {
+  return recordIndirectable(Inner->embedMethodHandle(handle, ppIndirection),
+                            ppIndirection, JitApi::embedMethodHandle, handle);
+}
+
+CORINFO_FIELD_HANDLE
+RecordingJitInfo::embedFieldHandle(CORINFO_FIELD_HANDLE handle,
+                                   void **ppIndirection) {
+  return recordIndirectable(Inner->embedFieldHandle(handle, ppIndirection),
+                            ppIndirection, JitApi::embedFieldHandle, handle);
+}
+
+void RecordingJitInfo::embedGenericHandle(
+    CORINFO_RESOLVED_TOKEN *pResolvedToken, BOOL fEmbedParent,
+    CORINFO_GENERICHANDLE_RESULT *pResult) {
+  Inner->embedGenericHandle(pResolvedToken, fEmbedParent, pResult);
+  if (beginQuery(JitApi::embedGenericHandle, pResolvedToken, fEmbedParent)) {
+    Value.put(*pResult);
+    endQuery(JitApi::embedGenericHandle);
+  }
+}
+
+CORINFO_LOOKUP_KIND
+RecordingJitInfo::getLocationOfThisType(CORINFO_METHOD_HANDLE context) {
+  return record(Inner->getLocationOfThisType(context),
+                JitApi::getLocationOfThisType, context);
+}
+
+void *RecordingJitInfo::getPInvokeUnmanagedTarget(CORINFO_METHOD_HANDLE method,
+                                                  void **ppIndirection) {
+  return recordIndirectable(
+      Inner->getPInvokeUnmanagedTarget(method, ppIndirection), ppIndirection,
+      JitApi::getPInvokeUnmanagedTarget, method);
+}
+
+void *RecordingJitInfo::getAddressOfPInvokeFixup(CORINFO_METHOD_HANDLE method,
+                                                 void **ppIndirection) {
+  return recordIndirectable(
+      Inner->getAddressOfPInvokeFixup(method, ppIndirection), ppIndirection,
+      JitApi::getAddressOfPInvokeFixup, method);
+}
+
+LPVOID
+RecordingJitInfo::GetCookieForPInvokeCalliSig(CORINFO_SIG_INFO *szMetaSig,
+                                              void **ppIndirection) {
+  return recordIndirectable(
+      Inner->GetCookieForPInvokeCalliSig(szMetaSig, ppIndirection),
+      ppIndirection, JitApi::GetCookieForPInvokeCalliSig, szMetaSig);
+}
+
+bool RecordingJitInfo::canGetCookieForPInvokeCalliSig(
+    CORINFO_SIG_INFO *szMetaSig) {
+  return record(Inner->canGetCookieForPInvokeCalliSig(szMetaSig),
+                JitApi::canGetCookieForPInvokeCalliSig, szMetaSig);
+}
+
+CORINFO_JUST_MY_CODE_HANDLE RecordingJitInfo::getJustMyCodeHandle(
+    CORINFO_METHOD_HANDLE method,
+    CORINFO_JUST_MY_CODE_HANDLE **ppIndirection) {
+  return recordIndirectable(
+      Inner->getJustMyCodeHandle(method, ppIndirection),
+      (void **)ppIndirection, JitApi::getJustMyCodeHandle, method);
+}
+
+void RecordingJitInfo::getCallInfo(
+    CORINFO_RESOLVED_TOKEN *pResolvedToken,
+    CORINFO_RESOLVED_TOKEN *pConstrainedResolvedToken,
+    CORINFO_METHOD_HANDLE callerHandle, CORINFO_CALLINFO_FLAGS flags,
+    CORINFO_CALL_INFO *pResult) {
+  Inner->getCallInfo(pResolvedToken, pConstrainedResolvedToken, callerHandle,
+                     flags, pResult);
+  if (beginQuery(JitApi::getCallInfo, pResolvedToken,
+                 pConstrainedResolvedToken, callerHandle, flags)) {
+    Value.putCallInfo(*pResult);
+    endQuery(JitApi::getCallInfo);
+  }
+}
+
+unsigned RecordingJitInfo::getClassDomainID(CORINFO_CLASS_HANDLE cls,
+                                            void **ppIndirection) {
+  return recordIndirectable(Inner->getClassDomainID(cls, ppIndirection),
+                            ppIndirection, JitApi::getClassDomainID, cls);
+}
+
+void *RecordingJitInfo::getFieldAddress(CORINFO_FIELD_HANDLE field,
+                                        void **ppIndirection) {
+  return recordIndirectable(Inner->getFieldAddress(field, ppIndirection),
+                            ppIndirection, JitApi::getFieldAddress, field);
+}
+
+CORINFO_VARARGS_HANDLE
+RecordingJitInfo::getVarArgsHandle(CORINFO_SIG_INFO *pSig,
+                                   void **ppIndirection) {
+  return recordIndirectable(Inner->getVarArgsHandle(pSig, ppIndirection),
+                            ppIndirection, JitApi::getVarArgsHandle, pSig);
+}
+
+bool RecordingJitInfo::canGetVarArgsHandle(CORINFO_SIG_INFO *pSig) {
+  return record(Inner->canGetVarArgsHandle(pSig), JitApi::canGetVarArgsHandle,
+                pSig);
+}
+
+InfoAccessType
+RecordingJitInfo::constructStringLiteral(CORINFO_MODULE_HANDLE module,
+                                         mdToken metaTok, void **ppValue) {
+  InfoAccessType Result =
+      Inner->constructStringLiteral(module, metaTok, ppValue);
+  if (beginQuery(JitApi::constructStringLiteral, module, metaTok)) {
+    Value.put(Result);
+    Value.put(*ppValue);
+    endQuery(JitApi::constructStringLiteral);
+  }
+  return Result;
+}
+
+InfoAccessType RecordingJitInfo::emptyStringLiteral(void **ppValue) {
+  InfoAccessType Result = Inner->emptyStringLiteral(ppValue);
+  if (beginQuery(JitApi::emptyStringLiteral)) {
+    Value.put(Result);
+    Value.put(*ppValue);
+    endQuery(JitApi::emptyStringLiteral);
+  }
+  return Result;
+}
+
+CORINFO_METHOD_HANDLE
+RecordingJitInfo::GetDelegateCtor(CORINFO_METHOD_HANDLE methHnd,
+                                  CORINFO_CLASS_HANDLE clsHnd,
+                                  CORINFO_METHOD_HANDLE targetMethodHnd,
+                                  DelegateCtorArgs *pCtorData) {
+  CORINFO_METHOD_HANDLE Result =
+      Inner->GetDelegateCtor(methHnd, clsHnd, targetMethodHnd, pCtorData);
+  if (beginQuery(JitApi::GetDelegateCtor, methHnd, clsHnd, targetMethodHnd)) {
+    Value.put(Result);
+    Value.put(*pCtorData);
+    endQuery(JitApi::GetDelegateCtor);
+  }
+  return Result;
+}
+
+//===----------------------------------------------------------------------===//
+// ICorJitInfo
+//===----------------------------------------------------------------------===//
+
+void RecordingJitInfo::allocMem(ULONG hotCodeSize, ULONG coldCodeSize,
+                                ULONG roDataSize, ULONG xcptnsCount,
+                                CorJitAllocMemFlag flag, void **hotCodeBlock,
+                                void **coldCodeBlock, void **roDataBlock) {
+  Inner->allocMem(hotCodeSize, coldCodeSize, roDataSize, xcptnsCount, flag,
+                  hotCodeBlock, coldCodeBlock, roDataBlock);
+  Digest.setCode((const uint8_t *)*hotCodeBlock, hotCodeSize,
+                 (coldCodeBlock != nullptr) ? (const uint8_t *)*coldCodeBlock
+                                            : nullptr,
+                 coldCodeSize,
+                 (roDataBlock != nullptr) ? (const uint8_t *)*roDataBlock
+                                          : nullptr,
+                 roDataSize);
+}
+
+void *RecordingJitInfo::allocGCInfo(size_t size) {
+  void *Block = Inner->allocGCInfo(size);
+  Digest.setGCInfo((const uint8_t *)Block, size);
+  return Block;
+}
+
+void RecordingJitInfo::recordRelocation(void *location, void *target,
+                                        WORD fRelocType, WORD slotNum,
+                                        INT32 addlDelta) {
+  Inner->recordRelocation(location, target, fRelocType, slotNum, addlDelta);
+  Digest.addRelocation((const uint8_t *)location, (const uint8_t *)target,
+                       fRelocType);
+}
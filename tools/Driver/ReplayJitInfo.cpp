@@ -0,0 +1,778 @@
+//===---------------- tools/Driver/ReplayJitInfo.cpp ------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Implementation of the ICorJitInfo used to replay recorded
+/// compiles. Each query rebuilds the key the recorder used for it and
+/// decodes the recorded value in the order the recorder wrote it.
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "ReplayJitInfo.h"
+#include <algorithm>
+
+using namespace llvm;
+
+//===----------------------------------------------------------------------===//
+// ICorMethodInfo
+//===----------------------------------------------------------------------===//
+
+DWORD ReplayJitInfo::getMethodAttribs(CORINFO_METHOD_HANDLE ftn) {
+  return lookup(JitApi::getMethodAttribs, ftn).get<DWORD>();
+}
+
+void ReplayJitInfo::setMethodAttribs(CORINFO_METHOD_HANDLE ftn,
+                                     CorInfoMethodRuntimeFlags attribs) {}
+
+void ReplayJitInfo::getMethodSig(CORINFO_METHOD_HANDLE ftn,
+                                 CORINFO_SIG_INFO *sig,
+                                 CORINFO_CLASS_HANDLE memberParent) {
+  lookup(JitApi::getMethodSig, ftn, memberParent).getSig(*sig);
+}
+
+bool ReplayJitInfo::getMethodInfo(CORINFO_METHOD_HANDLE ftn,
+                                  CORINFO_METHOD_INFO *info) {
+  RecordCursor Cursor = lookup(JitApi::getMethodInfo, ftn);
+  bool Result = Cursor.get<bool>();
+  if (Result) {
+    Cursor.getMethodInfo(*info);
+  }
+  return Result;
+}
+
+CorInfoInline ReplayJitInfo::canInline(CORINFO_METHOD_HANDLE callerHnd,
+                                       CORINFO_METHOD_HANDLE calleeHnd,
+                                       DWORD *pRestrictions) {
+  RecordCursor Cursor = lookup(JitApi::canInline, callerHnd, calleeHnd);
+  CorInfoInline Result = Cursor.get<CorInfoInline>();
+  DWORD Restrictions = Cursor.get<DWORD>();
+  if (pRestrictions != nullptr) {
+    *pRestrictions = Restrictions;
+  }
+  return Result;
+}
+
+void ReplayJitInfo::reportInliningDecision(CORINFO_METHOD_HANDLE inlinerHnd,
+                                           CORINFO_METHOD_HANDLE inlineeHnd,
+                                           CorInfoInline inlineResult,
+                                           const char *reason) {}
+
+bool ReplayJitInfo::canTailCall(CORINFO_METHOD_HANDLE callerHnd,
+                                CORINFO_METHOD_HANDLE declaredCalleeHnd,
+                                CORINFO_METHOD_HANDLE exactCalleeHnd,
+                                bool fIsTailPrefix) {
+  return lookup(JitApi::canTailCall, callerHnd, declaredCalleeHnd,
+                exactCalleeHnd, fIsTailPrefix)
+      .get<bool>();
+}
+
+void ReplayJitInfo::reportTailCallDecision(CORINFO_METHOD_HANDLE callerHnd,
+                                           CORINFO_METHOD_HANDLE calleeHnd,
+                                           bool fIsTailPrefix,
+                                           CorInfoTailCall tailCallResult,
+                                           const char *reason) {}
+
+void ReplayJitInfo::getEHinfo(CORINFO_METHOD_HANDLE ftn, unsigned EHnumber,
+                              CORINFO_EH_CLAUSE *clause) {
+  lookup(JitApi::getEHinfo, ftn, EHnumber).get(*clause);
+}
+
+CORINFO_CLASS_HANDLE
+ReplayJitInfo::getMethodClass(CORINFO_METHOD_HANDLE method) {
+  return lookup(JitApi::getMethodClass, method).get<CORINFO_CLASS_HANDLE>();
+}
+
+void ReplayJitInfo::getMethodVTableOffset(CORINFO_METHOD_HANDLE method,
+                                          unsigned *offsetOfIndirection,
+                                          unsigned *offsetAfterIndirection) {
+  RecordCursor Cursor = lookup(JitApi::getMethodVTableOffset, method);
+  Cursor.get(*offsetOfIndirection);
+  Cursor.get(*offsetAfterIndirection);
+}
+
+CorInfoIntrinsics ReplayJitInfo::getIntrinsicID(CORINFO_METHOD_HANDLE method) {
+  return lookup(JitApi::getIntrinsicID, method).get<CorInfoIntrinsics>();
+}
+
+bool ReplayJitInfo::isInSIMDModule(CORINFO_CLASS_HANDLE classHnd) {
+  return lookup(JitApi::isInSIMDModule, classHnd).get<bool>();
+}
+
+BOOL ReplayJitInfo::pInvokeMarshalingRequired(CORINFO_METHOD_HANDLE method,
+                                              CORINFO_SIG_INFO *callSiteSig) {
+  return lookup(JitApi::pInvokeMarshalingRequired, method, callSiteSig)
+      .get<BOOL>();
+}
+
+BOOL ReplayJitInfo::isDelegateCreationAllowed(
+    CORINFO_CLASS_HANDLE delegateHnd, CORINFO_METHOD_HANDLE calleeHnd) {
+  return lookup(JitApi::isDelegateCreationAllowed, delegateHnd, calleeHnd)
+      .get<BOOL>();
+}
+
+void ReplayJitInfo::methodMustBeLoadedBeforeCodeIsRun(
+    CORINFO_METHOD_HANDLE method) {}
+
+//===----------------------------------------------------------------------===//
+// ICorModuleInfo
+//===----------------------------------------------------------------------===//
+
+void ReplayJitInfo::resolveToken(CORINFO_RESOLVED_TOKEN *pResolvedToken) {
+  lookup(JitApi::resolveToken, pResolvedToken)
+      .getResolvedToken(*pResolvedToken);
+}
+
+void ReplayJitInfo::findSig(CORINFO_MODULE_HANDLE module, unsigned sigTOK,
+                            CORINFO_CONTEXT_HANDLE context,
+                            CORINFO_SIG_INFO *sig) {
+  lookup(JitApi::findSig, module, sigTOK, context).getSig(*sig);
+}
+
+void ReplayJitInfo::findCallSiteSig(CORINFO_MODULE_HANDLE module,
+                                    unsigned methTOK,
+                                    CORINFO_CONTEXT_HANDLE context,
+                                    CORINFO_SIG_INFO *sig) {
+  lookup(JitApi::findCallSiteSig, module, methTOK, context).getSig(*sig);
+}
+
+CORINFO_CLASS_HANDLE
+ReplayJitInfo::getTokenTypeAsHandle(CORINFO_RESOLVED_TOKEN *pResolvedToken) {
+  return lookup(JitApi::getTokenTypeAsHandle, pResolvedToken)
+      .get<CORINFO_CLASS_HANDLE>();
+}
+
+BOOL ReplayJitInfo::isValidToken(CORINFO_MODULE_HANDLE module,
+                                 unsigned metaTOK) {
+  return lookup(JitApi::isValidToken, module, metaTOK).get<BOOL>();
+}
+
+//===----------------------------------------------------------------------===//
+// ICorClassInfo
+//===----------------------------------------------------------------------===//
+
+CorInfoType ReplayJitInfo::asCorInfoType(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::asCorInfoType, cls).get<CorInfoType>();
+}
+
+const char *ReplayJitInfo::getClassName(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::getClassName, cls).getString();
+}
+
+int ReplayJitInfo::appendClassName(WCHAR **ppBuf, int *pnBufLen,
+                                   CORINFO_CLASS_HANDLE cls, BOOL fNamespace,
+                                   BOOL fFullInst, BOOL fAssembly) {
+  const char16_t *Name =
+      lookup(JitApi::appendClassName, cls, fNamespace, fFullInst, fAssembly)
+          .getString16();
+  int Length = 0;
+  if (Name != nullptr) {
+    while (Name[Length] != 0) {
+      Length++;
+    }
+  }
+
+  // Mirror the EE: copy as much as fits (leaving room for the terminator),
+  // advance the buffer past it, and return the full length of the name.
+  if ((ppBuf != nullptr) && (*ppBuf != nullptr) && (*pnBufLen > 0)) {
+    int Copied = std::min(Length, *pnBufLen - 1);
+    char16_t *Buffer = (char16_t *)*ppBuf;
+    std::copy(Name, Name + Copied, Buffer);
+    Buffer[Copied] = 0;
+    *ppBuf = (WCHAR *)(Buffer + Copied);
+    *pnBufLen -= Copied;
+  }
+  return Length;
+}
+
+BOOL ReplayJitInfo::isValueClass(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::isValueClass, cls).get<BOOL>();
+}
+
+BOOL ReplayJitInfo::canInlineTypeCheckWithObjectVTable(
+    CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::canInlineTypeCheckWithObjectVTable, cls).get<BOOL>();
+}
+
+DWORD ReplayJitInfo::getClassAttribs(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::getClassAttribs, cls).get<DWORD>();
+}
+
+BOOL ReplayJitInfo::isStructRequiringStackAllocRetBuf(
+    CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::isStructRequiringStackAllocRetBuf, cls).get<BOOL>();
+}
+
+size_t ReplayJitInfo::getClassModuleIdForStatics(
+    CORINFO_CLASS_HANDLE cls, CORINFO_MODULE_HANDLE *pModule,
+    void **ppIndirection) {
+  RecordCursor Cursor = lookup(JitApi::getClassModuleIdForStatics, cls);
+  size_t Result = Cursor.get<size_t>();
+  CORINFO_MODULE_HANDLE Module = Cursor.get<CORINFO_MODULE_HANDLE>();
+  void *Indirection = Cursor.get<void *>();
+  if (pModule != nullptr) {
+    *pModule = Module;
+  }
+  if (ppIndirection != nullptr) {
+    *ppIndirection = Indirection;
+  }
+  return Result;
+}
+
+unsigned ReplayJitInfo::getClassSize(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::getClassSize, cls).get<unsigned>();
+}
+
+unsigned ReplayJitInfo::getClassAlignmentRequirement(CORINFO_CLASS_HANDLE cls,
+                                                     BOOL fDoubleAlignHint) {
+  return lookup(JitApi::getClassAlignmentRequirement, cls, fDoubleAlignHint)
+      .get<unsigned>();
+}
+
+unsigned ReplayJitInfo::getClassGClayout(CORINFO_CLASS_HANDLE cls,
+                                         BYTE *gcPtrs) {
+  RecordCursor Cursor = lookup(JitApi::getClassGClayout, cls);
+  unsigned Result = Cursor.get<unsigned>();
+  ArrayRef<uint8_t> Layout = Cursor.getBlob();
+  std::copy(Layout.begin(), Layout.end(), gcPtrs);
+  return Result;
+}
+
+unsigned ReplayJitInfo::getClassNumInstanceFields(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::getClassNumInstanceFields, cls).get<unsigned>();
+}
+
+CORINFO_FIELD_HANDLE ReplayJitInfo::getFieldInClass(CORINFO_CLASS_HANDLE clsHnd,
+                                                    INT num) {
+  return lookup(JitApi::getFieldInClass, clsHnd, num)
+      .get<CORINFO_FIELD_HANDLE>();
+}
+
+BOOL ReplayJitInfo::checkMethodModifier(CORINFO_METHOD_HANDLE hMethod,
+                                        LPCSTR modifier, BOOL fOptional) {
+  return lookup(JitApi::checkMethodModifier, hMethod, modifier, fOptional)
+      .get<BOOL>();
+}
+
+CorInfoHelpFunc
+ReplayJitInfo::getNewHelper(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                            CORINFO_METHOD_HANDLE callerHandle) {
+  return lookup(JitApi::getNewHelper, pResolvedToken, callerHandle)
+      .get<CorInfoHelpFunc>();
+}
+
+CorInfoHelpFunc ReplayJitInfo::getNewArrHelper(CORINFO_CLASS_HANDLE arrayCls) {
+  return lookup(JitApi::getNewArrHelper, arrayCls).get<CorInfoHelpFunc>();
+}
+
+CorInfoHelpFunc
+ReplayJitInfo::getCastingHelper(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                                bool fThrowing) {
+  return lookup(JitApi::getCastingHelper, pResolvedToken, fThrowing)
+      .get<CorInfoHelpFunc>();
+}
+
+CorInfoHelpFunc
+ReplayJitInfo::getSharedCCtorHelper(CORINFO_CLASS_HANDLE clsHnd) {
+  return lookup(JitApi::getSharedCCtorHelper, clsHnd).get<CorInfoHelpFunc>();
+}
+
+CorInfoHelpFunc
+ReplayJitInfo::getSecurityPrologHelper(CORINFO_METHOD_HANDLE ftn) {
+  return lookup(JitApi::getSecurityPrologHelper, ftn).get<CorInfoHelpFunc>();
+}
+
+CORINFO_CLASS_HANDLE ReplayJitInfo::getTypeForBox(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::getTypeForBox, cls).get<CORINFO_CLASS_HANDLE>();
+}
+
+CorInfoHelpFunc ReplayJitInfo::getBoxHelper(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::getBoxHelper, cls).get<CorInfoHelpFunc>();
+}
+
+CorInfoHelpFunc ReplayJitInfo::getUnBoxHelper(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::getUnBoxHelper, cls).get<CorInfoHelpFunc>();
+}
+
+void ReplayJitInfo::getReadyToRunHelper(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                                        CorInfoHelpFunc id,
+                                        CORINFO_CONST_LOOKUP *pLookup) {
+  lookup(JitApi::getReadyToRunHelper, pResolvedToken, id).get(*pLookup);
+}
+
+const char *ReplayJitInfo::getHelperName(CorInfoHelpFunc helpFunc) {
+  return lookup(JitApi::getHelperName, helpFunc).getString();
+}
+
+CorInfoInitClassResult ReplayJitInfo::initClass(CORINFO_FIELD_HANDLE field,
+                                                CORINFO_METHOD_HANDLE method,
+                                                CORINFO_CONTEXT_HANDLE context,
+                                                BOOL speculative) {
+  return lookup(JitApi::initClass, field, method, context, speculative)
+      .get<CorInfoInitClassResult>();
+}
+
+void ReplayJitInfo::classMustBeLoadedBeforeCodeIsRun(
+    CORINFO_CLASS_HANDLE cls) {}
+
+CORINFO_CLASS_HANDLE ReplayJitInfo::getBuiltinClass(CorInfoClassId classId) {
+  return lookup(JitApi::getBuiltinClass, classId).get<CORINFO_CLASS_HANDLE>();
+}
+
+CORINFO_CLASS_HANDLE ReplayJitInfo::mergeClasses(CORINFO_CLASS_HANDLE cls1,
+                                                 CORINFO_CLASS_HANDLE cls2) {
+  return lookup(JitApi::mergeClasses, cls1, cls2).get<CORINFO_CLASS_HANDLE>();
+}
+
+CORINFO_CLASS_HANDLE ReplayJitInfo::getParentType(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::getParentType, cls).get<CORINFO_CLASS_HANDLE>();
+}
+
+CorInfoType ReplayJitInfo::getChildType(CORINFO_CLASS_HANDLE clsHnd,
+                                        CORINFO_CLASS_HANDLE *clsRet) {
+  RecordCursor Cursor = lookup(JitApi::getChildType, clsHnd);
+  CorInfoType Result = Cursor.get<CorInfoType>();
+  Cursor.get(*clsRet);
+  return Result;
+}
+
+BOOL ReplayJitInfo::isSDArray(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::isSDArray, cls).get<BOOL>();
+}
+
+unsigned ReplayJitInfo::getArrayRank(CORINFO_CLASS_HANDLE cls) {
+  return lookup(JitApi::getArrayRank, cls).get<unsigned>();
+}
+
+CorInfoIsAccessAllowedResult
+ReplayJitInfo::canAccessClass(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                              CORINFO_METHOD_HANDLE callerHandle,
+                              CORINFO_HELPER_DESC *pAccessHelper) {
+  RecordCursor Cursor =
+      lookup(JitApi::canAccessClass, pResolvedToken, callerHandle);
+  CorInfoIsAccessAllowedResult Result =
+      Cursor.get<CorInfoIsAccessAllowedResult>();
+  Cursor.get(*pAccessHelper);
+  return Result;
+}
+
+//===----------------------------------------------------------------------===//
+// ICorFieldInfo
+//===----------------------------------------------------------------------===//
+
+const char *ReplayJitInfo::getFieldName(CORINFO_FIELD_HANDLE ftn,
+                                        const char **moduleName) {
+  RecordCursor Cursor = lookup(JitApi::getFieldName, ftn);
+  const char *Result = Cursor.getString();
+  const char *ModuleName = Cursor.getString();
+  if (moduleName != nullptr) {
+    *moduleName = ModuleName;
+  }
+  return Result;
+}
+
+CORINFO_CLASS_HANDLE ReplayJitInfo::getFieldClass(CORINFO_FIELD_HANDLE field) {
+  return lookup(JitApi::getFieldClass, field).get<CORINFO_CLASS_HANDLE>();
+}
+
+CorInfoType ReplayJitInfo::getFieldType(CORINFO_FIELD_HANDLE field,
+                                        CORINFO_CLASS_HANDLE *structType,
+                                        CORINFO_CLASS_HANDLE memberParent) {
+  RecordCursor Cursor = lookup(JitApi::getFieldType, field, memberParent);
+  CorInfoType Result = Cursor.get<CorInfoType>();
+  CORINFO_CLASS_HANDLE StructType = Cursor.get<CORINFO_CLASS_HANDLE>();
+  if (structType != nullptr) {
+    *structType = StructType;
+  }
+  return Result;
+}
+
+unsigned ReplayJitInfo::getFieldOffset(CORINFO_FIELD_HANDLE field) {
+  return lookup(JitApi::getFieldOffset, field).get<unsigned>();
+}
+
+bool ReplayJitInfo::isWriteBarrierHelperRequired(CORINFO_FIELD_HANDLE field) {
+  return lookup(JitApi::isWriteBarrierHelperRequired, field).get<bool>();
+}
+
+void ReplayJitInfo::getFieldInfo(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                                 CORINFO_METHOD_HANDLE callerHandle,
+                                 CORINFO_ACCESS_FLAGS flags,
+                                 CORINFO_FIELD_INFO *pResult) {
+  lookup(JitApi::getFieldInfo, pResolvedToken, callerHandle, flags)
+      .get(*pResult);
+}
+
+//===----------------------------------------------------------------------===//
+// ICorDebugInfo
+//===----------------------------------------------------------------------===//
+
+void ReplayJitInfo::getBoundaries(
+    CORINFO_METHOD_HANDLE ftn, unsigned int *cILOffsets, DWORD **pILOffsets,
+    ICorDebugInfo::BoundaryTypes *implictBoundaries) {
+  RecordCursor Cursor = lookup(JitApi::getBoundaries, ftn);
+  Cursor.get(*cILOffsets);
+  ArrayRef<uint8_t> Offsets = Cursor.getBlob();
+  Cursor.get(*implictBoundaries);
+
+  // The jit releases the offsets with freeArray, so hand out a copy.
+  *pILOffsets = nullptr;
+  if (!Offsets.empty()) {
+    *pILOffsets = (DWORD *)allocateArray(Offsets.size());
+    std::copy(Offsets.begin(), Offsets.end(), (uint8_t *)*pILOffsets);
+  }
+}
+
+void ReplayJitInfo::setBoundaries(CORINFO_METHOD_HANDLE ftn, ULONG32 cMap,
+                                  ICorDebugInfo::OffsetMapping *pMap) {}
+
+void ReplayJitInfo::setVars(CORINFO_METHOD_HANDLE ftn, ULONG32 cVars,
+                            ICorDebugInfo::NativeVarInfo *vars) {}
+
+void *ReplayJitInfo::allocateArray(ULONG cBytes) {
+  return Allocator.Allocate(cBytes, sizeof(void *));
+}
+
+void ReplayJitInfo::freeArray(void *array) {
+  // Everything is released when the method's replay is done.
+}
+
+//===----------------------------------------------------------------------===//
+// ICorArgInfo
+//===----------------------------------------------------------------------===//
+
+CORINFO_ARG_LIST_HANDLE
+ReplayJitInfo::getArgNext(CORINFO_ARG_LIST_HANDLE args) {
+  return lookup(JitApi::getArgNext, args).get<CORINFO_ARG_LIST_HANDLE>();
+}
+
+CorInfoTypeWithMod ReplayJitInfo::getArgType(CORINFO_SIG_INFO *sig,
+                                             CORINFO_ARG_LIST_HANDLE args,
+                                             CORINFO_CLASS_HANDLE *vcTypeRet) {
+  RecordCursor Cursor = lookup(JitApi::getArgType, sig, args);
+  CorInfoTypeWithMod Result = Cursor.get<CorInfoTypeWithMod>();
+  Cursor.get(*vcTypeRet);
+  return Result;
+}
+
+CORINFO_CLASS_HANDLE ReplayJitInfo::getArgClass(CORINFO_SIG_INFO *sig,
+                                                CORINFO_ARG_LIST_HANDLE args) {
+  return lookup(JitApi::getArgClass, sig, args).get<CORINFO_CLASS_HANDLE>();
+}
+
+//===----------------------------------------------------------------------===//
+// ICorErrorInfo
+//===----------------------------------------------------------------------===//
+
+// There is no EE to raise exceptions during replay, so the jit's exception
+// filters never see one of ours.
+
+HRESULT
+ReplayJitInfo::GetErrorHRESULT(struct _EXCEPTION_POINTERS *pExceptionPointers) {
+  return E_FAIL;
+}
+
+int ReplayJitInfo::FilterException(
+    struct _EXCEPTION_POINTERS *pExceptionPointers) {
+  return EXCEPTION_CONTINUE_SEARCH;
+}
+
+void ReplayJitInfo::HandleException(
+    struct _EXCEPTION_POINTERS *pExceptionPointers) {}
+
+void ReplayJitInfo::ThrowExceptionForHelper(
+    const CORINFO_HELPER_DESC *throwHelper) {
+  throw ReplayException(ReplayException::EEException,
+                        JitApi::ThrowExceptionForHelper);
+}
+
+//===----------------------------------------------------------------------===//
+// ICorStaticInfo
+//===----------------------------------------------------------------------===//
+
+void ReplayJitInfo::getEEInfo(CORINFO_EE_INFO *pEEInfoOut) {
+  lookup(JitApi::getEEInfo).get(*pEEInfoOut);
+}
+
+mdMethodDef
+ReplayJitInfo::getMethodDefFromMethod(CORINFO_METHOD_HANDLE hMethod) {
+  return lookup(JitApi::getMethodDefFromMethod, hMethod).get<mdMethodDef>();
+}
+
+const char *ReplayJitInfo::getMethodName(CORINFO_METHOD_HANDLE ftn,
+                                         const char **moduleName) {
+  RecordCursor Cursor = lookup(JitApi::getMethodName, ftn);
+  const char *Result = Cursor.getString();
+  const char *ModuleName = Cursor.getString();
+  if (moduleName != nullptr) {
+    *moduleName = ModuleName;
+  }
+  return Result;
+}
+
+unsigned ReplayJitInfo::getMethodHash(CORINFO_METHOD_HANDLE ftn) {
+  return lookup(JitApi::getMethodHash, ftn).get<unsigned>();
+}
+
+size_t ReplayJitInfo::findNameOfToken(CORINFO_MODULE_HANDLE module,
+                                      mdToken metaTOK, char *szFQName,
+                                      size_t FQNameCapacity) {
+  RecordCursor Cursor = lookup(JitApi::findNameOfToken, module, metaTOK);
+  size_t Result = Cursor.get<size_t>();
+  const char *Name = Cursor.getString();
+  if ((szFQName != nullptr) && (FQNameCapacity > 0)) {
+    size_t Length = (Name == nullptr) ? 0 : strlen(Name);
+    size_t Copied = std::min(Length, FQNameCapacity - 1);
+    std::copy(Name, Name + Copied, szFQName);
+    szFQName[Copied] = 0;
+  }
+  return Result;
+}
+
+bool ReplayJitInfo::getSystemVAmd64PassStructInRegisterDescriptor(
+    CORINFO_CLASS_HANDLE structHnd,
+    SYSTEMV_AMD64_CORINFO_STRUCT_REG_PASSING_DESCRIPTOR
+        *structPassInRegDescPtr) {
+  RecordCursor Cursor =
+      lookup(JitApi::getSystemVAmd64PassStructInRegisterDescriptor, structHnd);
+  bool Result = Cursor.get<bool>();
+  Cursor.get(*structPassInRegDescPtr);
+  return Result;
+}
+
+//===----------------------------------------------------------------------===//
+// ICorDynamicInfo
+//===----------------------------------------------------------------------===//
+
+LONG *ReplayJitInfo::getAddrOfCaptureThreadGlobal(void **ppIndirection) {
+  return getIndirectable<LONG *>(lookup(JitApi::getAddrOfCaptureThreadGlobal),
+                                 ppIndirection);
+}
+
+void *ReplayJitInfo::getHelperFtn(CorInfoHelpFunc ftnNum,
+                                  void **ppIndirection) {
+  return getIndirectable<void *>(lookup(JitApi::getHelperFtn, ftnNum),
+                                 ppIndirection);
+}
+
+void ReplayJitInfo::getFunctionEntryPoint(CORINFO_METHOD_HANDLE ftn,
+                                          CORINFO_CONST_LOOKUP *pResult,
+                                          CORINFO_ACCESS_FLAGS accessFlags) {
+  lookup(JitApi::getFunctionEntryPoint, ftn, accessFlags).get(*pResult);
+}
+
+void ReplayJitInfo::getFunctionFixedEntryPoint(CORINFO_METHOD_HANDLE ftn,
+                                               CORINFO_CONST_LOOKUP *pResult) {
+  lookup(JitApi::getFunctionFixedEntryPoint, ftn).get(*pResult);
+}
+
+void *ReplayJitInfo::getMethodSync(CORINFO_METHOD_HANDLE ftn,
+                                   void **ppIndirection) {
+  return getIndirectable<void *>(lookup(JitApi::getMethodSync, ftn),
+                                 ppIndirection);
+}
+
+CORINFO_MODULE_HANDLE
+ReplayJitInfo::embedModuleHandle(CORINFO_MODULE_HANDLE handle,
+                                 void **ppIndirection) {
+  return getIndirectable<CORINFO_MODULE_HANDLE>(
+      lookup(JitApi::embedModuleHandle, handle), ppIndirection);
+}
+
+CORINFO_CLASS_HANDLE
+ReplayJitInfo::embedClassHandle(CORINFO_CLASS_HANDLE handle,
+                                void **ppIndirection) {
+  return getIndirectable<CORINFO_CLASS_HANDLE>(
+      lookup(JitApi::embedClassHandle, handle), ppIndirection);
+}
+
+CORINFO_METHOD_HANDLE
+ReplayJitInfo::embedMethodHandle(CORINFO_METHOD_HANDLE handle,
+                                 void **ppIndirection) {
+  return getIndirectable<CORINFO_METHOD_HANDLE>(
+      lookup(JitApi::embedMethodHandle, handle), ppIndirection);
+}
+
+CORINFO_FIELD_HANDLE
+ReplayJitInfo::embedFieldHandle(CORINFO_FIELD_HANDLE handle,
+                                void **ppIndirection) {
+  return getIndirectable<CORINFO_FIELD_HANDLE>(
+      lookup(JitApi::embedFieldHandle, handle), ppIndirection);
+}
+
+void ReplayJitInfo::embedGenericHandle(CORINFO_RESOLVED_TOKEN *pResolvedToken,
+                                       BOOL fEmbedParent,
+                                       CORINFO_GENERICHANDLE_RESULT *pResult) {
+  lookup(JitApi::embedGenericHandle, pResolvedToken, fEmbedParent)
+      .get(*pResult);
+}
+
+CORINFO_LOOKUP_KIND
+ReplayJitInfo::getLocationOfThisType(CORINFO_METHOD_HANDLE context) {
+  return lookup(JitApi::getLocationOfThisType, context)
+      .get<CORINFO_LOOKUP_KIND>();
+}
+
+void *ReplayJitInfo::getPInvokeUnmanagedTarget(CORINFO_METHOD_HANDLE method,
+                                               void **ppIndirection) {
+  return getIndirectable<void *>(
+      lookup(JitApi::getPInvokeUnmanagedTarget, method), ppIndirection);
+}
+
+void *ReplayJitInfo::getAddressOfPInvokeFixup(CORINFO_METHOD_HANDLE method,
+                                              void **ppIndirection) {
+  return getIndirectable<void *>(
+      lookup(JitApi::getAddressOfPInvokeFixup, method), ppIndirection);
+}
+
+LPVOID ReplayJitInfo::GetCookieForPInvokeCalliSig(CORINFO_SIG_INFO *szMetaSig,
+                                                  void **ppIndirection) {
+  return getIndirectable<LPVOID>(
+      lookup(JitApi::GetCookieForPInvokeCalliSig, szMetaSig), ppIndirection);
+}
+
+bool ReplayJitInfo::canGetCookieForPInvokeCalliSig(
+    CORINFO_SIG_INFO *szMetaSig) {
+  return lookup(JitApi::canGetCookieForPInvokeCalliSig, szMetaSig)
+      .get<bool>();
+}
+
+CORINFO_JUST_MY_CODE_HANDLE ReplayJitInfo::getJustMyCodeHandle(
+    CORINFO_METHOD_HANDLE method,
+    CORINFO_JUST_MY_CODE_HANDLE **ppIndirection) {
+  return getIndirectable<CORINFO_JUST_MY_CODE_HANDLE>(
+      lookup(JitApi::getJustMyCodeHandle, method), (void **)ppIndirection);
+}
+
+void ReplayJitInfo::getCallInfo(
+    CORINFO_RESOLVED_TOKEN *pResolvedToken,
+    CORINFO_RESOLVED_TOKEN *pConstrainedResolvedToken,
+    CORINFO_METHOD_HANDLE callerHandle, CORINFO_CALLINFO_FLAGS flags,
+    CORINFO_CALL_INFO *pResult) {
+  lookup(JitApi::getCallInfo, pResolvedToken, pConstrainedResolvedToken,
+         callerHandle, flags)
+      .getCallInfo(*pResult);
+}
+
+unsigned ReplayJitInfo::getClassDomainID(CORINFO_CLASS_HANDLE cls,
+                                         void **ppIndirection) {
+  return getIndirectable<unsigned>(lookup(JitApi::getClassDomainID, cls),
+                                   ppIndirection);
+}
+
+void *ReplayJitInfo::getFieldAddress(CORINFO_FIELD_HANDLE field,
+                                     void **ppIndirection) {
+  return getIndirectable<void *>(lookup(JitApi::getFieldAddress, field),
+                                 ppIndirection);
+}
+
+CORINFO_VARARGS_HANDLE ReplayJitInfo::getVarArgsHandle(CORINFO_SIG_INFO *pSig,
+                                                       void **ppIndirection) {
+  return getIndirectable<CORINFO_VARARGS_HANDLE>(
+      lookup(JitApi::getVarArgsHandle, pSig), ppIndirection);
+}
+
+bool ReplayJitInfo::canGetVarArgsHandle(CORINFO_SIG_INFO *pSig) {
+  return lookup(JitApi::canGetVarArgsHandle, pSig).get<bool>();
+}
+
+InfoAccessType
+ReplayJitInfo::constructStringLiteral(CORINFO_MODULE_HANDLE module,
+                                      mdToken metaTok, void **ppValue) {
+  RecordCursor Cursor =
+      lookup(JitApi::constructStringLiteral, module, metaTok);
+  InfoAccessType Result = Cursor.get<InfoAccessType>();
+  Cursor.get(*ppValue);
+  return Result;
+}
+
+InfoAccessType ReplayJitInfo::emptyStringLiteral(void **ppValue) {
+  RecordCursor Cursor = lookup(JitApi::emptyStringLiteral);
+  InfoAccessType Result = Cursor.get<InfoAccessType>();
+  Cursor.get(*ppValue);
+  return Result;
+}
+
+CORINFO_METHOD_HANDLE
+ReplayJitInfo::GetDelegateCtor(CORINFO_METHOD_HANDLE methHnd,
+                               CORINFO_CLASS_HANDLE clsHnd,
+                               CORINFO_METHOD_HANDLE targetMethodHnd,
+                               DelegateCtorArgs *pCtorData) {
+  RecordCursor Cursor =
+      lookup(JitApi::GetDelegateCtor, methHnd, clsHnd, targetMethodHnd);
+  CORINFO_METHOD_HANDLE Result = Cursor.get<CORINFO_METHOD_HANDLE>();
+  Cursor.get(*pCtorData);
+  return Result;
+}
+
+//===----------------------------------------------------------------------===//
+// ICorJitInfo
+//===----------------------------------------------------------------------===//
+
+void ReplayJitInfo::allocMem(ULONG hotCodeSize, ULONG coldCodeSize,
+                             ULONG roDataSize, ULONG xcptnsCount,
+                             CorJitAllocMemFlag flag, void **hotCodeBlock,
+                             void **coldCodeBlock, void **roDataBlock) {
+  const size_t SectionAlignment = 16;
+  uint8_t *HotCode = nullptr;
+  uint8_t *ColdCode = nullptr;
+  uint8_t *ROData = nullptr;
+
+  HotCode = (uint8_t *)Allocator.Allocate(hotCodeSize, SectionAlignment);
+  if (coldCodeSize != 0) {
+    ColdCode = (uint8_t *)Allocator.Allocate(coldCodeSize, SectionAlignment);
+  }
+  if (roDataSize != 0) {
+    ROData = (uint8_t *)Allocator.Allocate(roDataSize, SectionAlignment);
+  }
+  Digest.setCode(HotCode, hotCodeSize, ColdCode, coldCodeSize, ROData,
+                 roDataSize);
+
+  *hotCodeBlock = HotCode;
+  if (coldCodeBlock != nullptr) {
+    *coldCodeBlock = ColdCode;
+  }
+  if (roDataBlock != nullptr) {
+    *roDataBlock = ROData;
+  }
+}
+
+void ReplayJitInfo::reserveUnwindInfo(BOOL isFunclet, BOOL isColdCode,
+                                      ULONG unwindSize) {}
+
+void ReplayJitInfo::allocUnwindInfo(BYTE *pHotCode, BYTE *pColdCode,
+                                    ULONG startOffset, ULONG endOffset,
+                                    ULONG unwindSize, BYTE *pUnwindBlock,
+                                    CorJitFuncKind funcKind) {}
+
+void *ReplayJitInfo::allocGCInfo(size_t size) {
+  uint8_t *Block = (uint8_t *)Allocator.Allocate(size, sizeof(void *));
+  Digest.setGCInfo(Block, size);
+  return Block;
+}
+
+void ReplayJitInfo::yieldExecution() {}
+
+void ReplayJitInfo::setEHcount(unsigned cEH) {}
+
+void ReplayJitInfo::setEHinfo(unsigned EHnumber,
+                              const CORINFO_EH_CLAUSE *clause) {}
+
+void ReplayJitInfo::recordCallSite(ULONG instrOffset, CORINFO_SIG_INFO *callSig,
+                                   CORINFO_METHOD_HANDLE methodHandle) {}
+
+void ReplayJitInfo::recordRelocation(void *location, void *target,
+                                     WORD fRelocType, WORD slotNum,
+                                     INT32 addlDelta) {
+  // The jit has already applied the fixup; just note it for the digest.
+  Digest.addRelocation((uint8_t *)location, (uint8_t *)target, fRelocType);
+}
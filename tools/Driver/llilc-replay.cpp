@@ -0,0 +1,446 @@
+//===---------------- tools/Driver/llilc-replay.cpp -------------*- C++ -*-===//
+//
+// LLILC
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license.
+// See LICENSE file in the project root for full license information.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Offline driver that replays a collection of recorded compile
+/// requests against a jit, without a CoreCLR process.
+///
+/// The driver loads the jit shared library, hands it a host that reads
+/// COMPlus_ settings from the environment, and calls compileMethod for each
+/// selected method with an ICorJitInfo that answers from the collection.
+/// It reports compile throughput and memory use, and can write a digest of
+/// each method's code so that two jit builds can be compared (A/B) or a
+/// regression narrowed down to a single method (bisect).
+///
+//===----------------------------------------------------------------------===//
+
+#include "earlyincludes.h"
+#include "global.h"
+#include "jitpch.h"
+#include "JitRecord.h"
+#include "ReplayJitInfo.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace llvm;
+
+static cl::opt<std::string> CollectionPath(cl::Positional, cl::Required,
+                                           cl::desc("<collection>"));
+
+static cl::opt<std::string> JitPath("jit", cl::Required,
+                                    cl::desc("Path to the jit to replay with"),
+                                    cl::value_desc("path"));
+
+static cl::list<unsigned>
+    MethodIndices("method", cl::CommaSeparated,
+                  cl::desc("Replay only the methods with these indices"),
+                  cl::value_desc("index,..."));
+
+static cl::opt<unsigned> FirstMethod("first", cl::init(0),
+                                     cl::desc("Index of the first method to "
+                                              "replay"));
+
+static cl::opt<unsigned> MethodCount("count", cl::init(0),
+                                     cl::desc("Number of methods to replay, "
+                                              "or 0 for all"));
+
+static cl::opt<unsigned>
+    RepeatCount("repeat", cl::init(1),
+                cl::desc("Number of times to replay the selected methods"));
+
+static cl::opt<std::string>
+    DigestPath("digests",
+               cl::desc("Write the result and code digest of each method "
+                        "to this file"),
+               cl::value_desc("path"));
+
+static cl::opt<bool>
+    VerifyDigests("verify",
+                  cl::desc("Compare each method's code digest with the "
+                           "recorded one"));
+
+static cl::opt<bool> CompareDirectEmit(
+    "compare-direct-emit",
+    cl::desc("Replay with and without JitDirectEmit and compare the two"));
+
+static cl::opt<bool> ListMethods("list",
+                                 cl::desc("List the methods in the "
+                                          "collection and exit"));
+
+/// \brief ICorJitHost that takes configuration from the environment, the
+/// way CLRConfig does: the setting Foo is read from COMPlus_Foo.
+class ReplayJitHost : public ICorJitHost {
+public:
+  void *allocateMemory(size_t Size, bool UsePageAllocator) override {
+    return malloc(Size);
+  }
+
+  void freeMemory(void *Block, bool UsePageAllocator) override {
+    free(Block);
+  }
+
+  int getIntConfigValue(const wchar_t *Name, int DefaultValue) override {
+    const char *Value = getenv(getVariableName(Name).c_str());
+    if (Value == nullptr) {
+      return DefaultValue;
+    }
+    // CLRConfig integers are hexadecimal.
+    return (int)strtoul(Value, nullptr, 16);
+  }
+
+  const wchar_t *getStringConfigValue(const wchar_t *Name) override {
+    std::string Variable = getVariableName(Name);
+    const char *Value = getenv(Variable.c_str());
+    auto Override = Overrides.find(Variable);
+    if (Override != Overrides.end()) {
+      Value = Override->second.c_str();
+    }
+
+    // The jit runs as the alt jit and only compiles the methods that
+    // AltJit selects; unless told otherwise, replay all of them.
+    if ((Value == nullptr) && (Variable == "COMPlus_AltJit")) {
+      Value = "*";
+    }
+    if (Value == nullptr) {
+      return nullptr;
+    }
+
+    // Settings are ASCII, so widening each byte is enough.
+    size_t Length = strlen(Value);
+    char16_t *Result = new char16_t[Length + 1];
+    for (size_t I = 0; I <= Length; ++I) {
+      Result[I] = (unsigned char)Value[I];
+    }
+    return (const wchar_t *)Result;
+  }
+
+  void freeStringConfigValue(const wchar_t *Value) override {
+    delete[](const char16_t *) Value;
+  }
+
+  /// Make the setting \p Name read as \p Value, whatever the environment
+  /// says. An empty value reads as unset for the jit's boolean settings.
+  void setOverride(StringRef Name, StringRef Value) {
+    Overrides[("COMPlus_" + Name).str()] = Value;
+  }
+
+private:
+  /// The jit passes UTF-16 names regardless of the width of wchar_t.
+  static std::string getVariableName(const wchar_t *Name) {
+    const char16_t *Name16 = (const char16_t *)Name;
+    std::string Variable = "COMPlus_";
+    for (size_t I = 0; Name16[I] != 0; ++I) {
+      Variable.push_back((char)Name16[I]);
+    }
+    return Variable;
+  }
+
+  std::map<std::string, std::string> Overrides;
+};
+
+typedef void(__stdcall *JitStartupFunction)(ICorJitHost *);
+typedef ICorJitCompiler *(__stdcall *GetJitFunction)();
+
+/// \brief Load the jit library and initialize it with \p Host.
+static ICorJitCompiler *loadJit(StringRef Path, ICorJitHost *Host) {
+  std::string Error;
+  sys::DynamicLibrary Library =
+      sys::DynamicLibrary::getPermanentLibrary(Path.str().c_str(), &Error);
+  if (!Library.isValid()) {
+    errs() << "error: unable to load jit '" << Path << "': " << Error << "\n";
+    return nullptr;
+  }
+
+  JitStartupFunction JitStartup =
+      (JitStartupFunction)Library.getAddressOfSymbol("jitStartup");
+  GetJitFunction GetJit = (GetJitFunction)Library.getAddressOfSymbol("getJit");
+  if ((JitStartup == nullptr) || (GetJit == nullptr)) {
+    errs() << "error: '" << Path << "' does not export the jit interface\n";
+    return nullptr;
+  }
+
+  JitStartup(Host);
+  return GetJit();
+}
+
+/// \brief Get the peak resident set size of this process, in bytes.
+static uint64_t getPeakResidentBytes() {
+#if defined(_MSC_VER)
+  PROCESS_MEMORY_COUNTERS Counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &Counters,
+                           sizeof(Counters))) {
+    return Counters.PeakWorkingSetSize;
+  }
+  return 0;
+#else
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return Usage.ru_maxrss;
+#else
+  return (uint64_t)Usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+/// \brief Totals over all replayed compiles.
+struct ReplayStatistics {
+  ReplayStatistics()
+      : Attempted(0), Succeeded(0), Failed(0), Missed(0), EEExceptions(0),
+        Mismatched(0), ILBytes(0), Seconds(0),
+        MissesByApi(static_cast<size_t>(JitApi::Count), 0) {}
+
+  uint32_t Attempted;    ///< compileMethod calls made.
+  uint32_t Succeeded;    ///< Calls that returned CORJIT_OK.
+  uint32_t Failed;       ///< Calls that returned an error.
+  uint32_t Missed;       ///< Calls abandoned on a query not recorded.
+  uint32_t EEExceptions; ///< Calls abandoned on an EE exception.
+  uint32_t Mismatched;   ///< Digests that differ from the recorded ones.
+  uint64_t ILBytes;      ///< IL bytes in the attempted methods.
+  double Seconds;        ///< Time spent inside compileMethod.
+  std::vector<uint32_t> MissesByApi;
+};
+
+/// \brief Replay one method and write its digest line if requested.
+/// \returns The digest of the method's code and GC info, or 0 if the
+/// compile did not succeed.
+static uint64_t replayMethod(ICorJitCompiler *Jit,
+                             const CollectionReader &Collection, uint32_t Index,
+                             ReplayStatistics &Stats, raw_ostream *Digests) {
+  const CollectionMethod &Method = *Collection.methods()[Index];
+  ReplayJitInfo JitInfo(Collection, Method);
+  CORINFO_METHOD_INFO Info = Method.Info;
+  BYTE *NativeEntry = nullptr;
+  ULONG NativeSize = 0;
+  CorJitResult Result = CORJIT_INTERNALERROR;
+  const char *Outcome = nullptr;
+
+  Stats.Attempted++;
+  Stats.ILBytes += Info.ILCodeSize;
+
+  auto Start = std::chrono::steady_clock::now();
+  try {
+    Result = Jit->compileMethod(&JitInfo, &Info, Method.Flags, &NativeEntry,
+                                &NativeSize);
+  } catch (const ReplayException &Exception) {
+    if (Exception.Kind == ReplayException::MissingQuery) {
+      Stats.Missed++;
+      Stats.MissesByApi[static_cast<size_t>(Exception.Api)]++;
+      Outcome = "miss";
+    } else {
+      Stats.EEExceptions++;
+      Outcome = "ee-exception";
+    }
+  }
+  auto End = std::chrono::steady_clock::now();
+  Stats.Seconds += std::chrono::duration<double>(End - Start).count();
+
+  uint64_t Hash = 0;
+  if (Outcome == nullptr) {
+    if (Result == CORJIT_OK) {
+      Stats.Succeeded++;
+      Outcome = "ok";
+      Hash = JitInfo.getCodeHash();
+      if (VerifyDigests && Method.HasResult &&
+          (Method.Result == CORJIT_OK) && (Method.CodeHash != Hash)) {
+        Stats.Mismatched++;
+        Outcome = "mismatch";
+      }
+    } else {
+      Stats.Failed++;
+      Outcome = "failed";
+    }
+  }
+
+  if (Digests != nullptr) {
+    *Digests << Index << " " << Outcome << " " << JitInfo.getHotCodeSize()
+             << " " << format_hex(Hash, 18) << " "
+             << (Method.Name ? Method.Name : "<unknown>") << "\n";
+  }
+  return Hash;
+}
+
+/// \brief Print the throughput of the compiles in \p Stats.
+static void printThroughput(const ReplayStatistics &Stats) {
+  if (Stats.Seconds > 0) {
+    outs() << "  Time in compileMethod: " << format("%.3f", Stats.Seconds)
+           << "s, " << format("%.1f", Stats.Attempted / Stats.Seconds)
+           << " methods/sec, " << format("%.0f", Stats.ILBytes / Stats.Seconds)
+           << " IL bytes/sec\n";
+  }
+}
+
+/// \brief Replay the selected methods with direct emission off and then on,
+/// and report the time each took and the methods whose code differs.
+static void compareDirectEmit(ICorJitCompiler *Jit, ReplayJitHost &Host,
+                              const CollectionReader &Collection,
+                              const std::vector<uint32_t> &Selected) {
+  static const char *const ModeNames[2] = {"object file", "direct emit"};
+  ReplayStatistics ModeStats[2];
+  std::vector<uint64_t> Hashes[2];
+  for (unsigned Mode = 0; Mode < 2; ++Mode) {
+    Host.setOverride("JitDirectEmit", (Mode == 0) ? "" : "1");
+    for (unsigned Pass = 0; Pass < RepeatCount; ++Pass) {
+      for (uint32_t Index : Selected) {
+        uint64_t Hash =
+            replayMethod(Jit, Collection, Index, ModeStats[Mode], nullptr);
+        if (Pass == 0) {
+          Hashes[Mode].push_back(Hash);
+        }
+      }
+    }
+  }
+
+  uint32_t NumDifferent = 0;
+  for (size_t I = 0; I < Selected.size(); ++I) {
+    if (Hashes[0][I] != Hashes[1][I]) {
+      if (NumDifferent++ < 10) {
+        outs() << "  Code differs for method " << Selected[I] << "\n";
+      }
+    }
+  }
+
+  for (unsigned Mode = 0; Mode < 2; ++Mode) {
+    const ReplayStatistics &Stats = ModeStats[Mode];
+    outs() << "Mode " << ModeNames[Mode] << ": " << Stats.Succeeded
+           << " of " << Stats.Attempted << " compiles succeeded\n";
+    printThroughput(Stats);
+  }
+  if ((ModeStats[0].Seconds > 0) && (ModeStats[1].Seconds > 0)) {
+    outs() << "Direct emit speedup: "
+           << format("%.3f", ModeStats[0].Seconds / ModeStats[1].Seconds)
+           << "x\n";
+  }
+  outs() << "Methods whose code differs between modes: " << NumDifferent
+         << "\n";
+}
+
+int main(int Argc, char **Argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(Argc, Argv);
+  llvm_shutdown_obj Y;
+
+  cl::ParseCommandLineOptions(Argc, Argv, "LLILC offline replay driver\n");
+
+  std::string Error;
+  std::unique_ptr<CollectionReader> Collection =
+      CollectionReader::open(CollectionPath, Error);
+  if (!Collection) {
+    errs() << "error: unable to read '" << CollectionPath << "': " << Error
+           << "\n";
+    return 1;
+  }
+
+  const auto &Methods = Collection->methods();
+  if (ListMethods) {
+    for (uint32_t Index = 0; Index < Methods.size(); ++Index) {
+      const CollectionMethod &Method = *Methods[Index];
+      outs() << Index << " " << Method.Info.ILCodeSize << " "
+             << (Method.Name ? Method.Name : "<unknown>") << "\n";
+    }
+    return 0;
+  }
+
+  // Pick the methods to replay: an explicit list, or a range (all methods
+  // by default). Bisecting a difference is a matter of halving the range.
+  std::vector<uint32_t> Selected;
+  if (!MethodIndices.empty()) {
+    for (unsigned Index : MethodIndices) {
+      if (Index >= Methods.size()) {
+        errs() << "error: method index " << Index << " is out of range\n";
+        return 1;
+      }
+      Selected.push_back(Index);
+    }
+  } else {
+    uint32_t Last = Methods.size();
+    if ((MethodCount != 0) && (FirstMethod + MethodCount < Last)) {
+      Last = FirstMethod + MethodCount;
+    }
+    for (uint32_t Index = FirstMethod; Index < Last; ++Index) {
+      Selected.push_back(Index);
+    }
+  }
+
+  ReplayJitHost Host;
+  ICorJitCompiler *Jit = loadJit(JitPath, &Host);
+  if (Jit == nullptr) {
+    return 1;
+  }
+
+  if (CompareDirectEmit) {
+    compareDirectEmit(Jit, Host, *Collection, Selected);
+    return 0;
+  }
+
+  std::unique_ptr<raw_fd_ostream> Digests;
+  if (!DigestPath.empty()) {
+    std::error_code EC;
+    Digests.reset(new raw_fd_ostream(DigestPath, EC, sys::fs::F_Text));
+    if (EC) {
+      errs() << "error: unable to write '" << DigestPath
+             << "': " << EC.message() << "\n";
+      return 1;
+    }
+  }
+
+  ReplayStatistics Stats;
+  for (unsigned Pass = 0; Pass < RepeatCount; ++Pass) {
+    // Digests only need to be written once.
+    raw_ostream *PassDigests = (Pass == 0) ? Digests.get() : nullptr;
+    for (uint32_t Index : Selected) {
+      replayMethod(Jit, *Collection, Index, Stats, PassDigests);
+    }
+  }
+
+  outs() << "Replayed " << Stats.Attempted << " compiles of "
+         << Selected.size() << " methods from " << CollectionPath << "\n";
+  outs() << "  Succeeded: " << Stats.Succeeded << ", failed: " << Stats.Failed
+         << ", missing queries: " << Stats.Missed
+         << ", EE exceptions: " << Stats.EEExceptions << "\n";
+  if (VerifyDigests) {
+    outs() << "  Digests differing from the recording: " << Stats.Mismatched
+           << "\n";
+  }
+  printThroughput(Stats);
+  outs() << "  Peak resident memory: "
+         << format("%.1f", getPeakResidentBytes() / (1024.0 * 1024.0))
+         << " MB\n";
+
+  for (size_t Api = 0; Api < Stats.MissesByApi.size(); ++Api) {
+    if (Stats.MissesByApi[Api] != 0) {
+      outs() << "  Unrecorded " << getJitApiName(static_cast<JitApi>(Api))
+             << ": " << Stats.MissesByApi[Api] << "\n";
+    }
+  }
+
+  return (Stats.Failed + Stats.Missed + Stats.EEExceptions + Stats.Mismatched)
+             ? 1
+             : 0;
+}